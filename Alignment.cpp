@@ -1,18 +1,56 @@
 #include "Alignment.h"
 #include "Parser.h"
+#include "CpuFeatures.h"
+#include "ScoringBatch.h"
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <utility>
 #include <cmath>
+#include <cstring>
+#include <cstdio>
 #include <ctype.h>
 #include <algorithm>
 
 using namespace std;
 
+/**
+ * Bit mask of protein codes accepted by Alignment::gapOrAA
+ */
+static uint32_t gapOrAACodes() {
+    uint32_t mask = 0;
+    for (int code = 0; code < PACKED_AA_EXCEPTION; code++) {
+        char a = PackedPairs::aminoAcid(code);
+        if ((a >= 'A' && a <= 'Z') || a == '-') {
+            mask |= 1u << code;
+        }
+    }
+    return mask;
+}
+
+static const uint32_t GAP_OR_AA_CODES = gapOrAACodes();
+
+/**
+ * Code of an amino acid row symbol, found through PackedPairs::aminoAcid
+ * which does not depend on the order of static initialization
+ */
+static int symbolCode(char symbol) {
+    for (int code = 0; code < PACKED_AA_EXCEPTION; code++) {
+        if (PackedPairs::aminoAcid(code) == symbol) {
+            return code;
+        }
+    }
+    return PACKED_AA_EXCEPTION;
+}
+
+static const int SPACE_CODE = symbolCode(' ');
+static const int FIRST_PHASE_CODE = symbolCode('1');
+static const int THIRD_PHASE_CODE = symbolCode('3');
+
 Alignment::Alignment() {
-    pairs.reserve(N);
+    blockLines.resize(BLOCK_ITEMS_CNT);
+    exactScores = false;
     start = NULL;
     stop = NULL;
 }
@@ -44,7 +82,6 @@ void Alignment::clear() {
 int Alignment::parse(istream& inputStream, string headerLine, bool forward) {
     clear();
     this->forward = forward;
-    vector<string> blockLines(BLOCK_ITEMS_CNT);
     string line;
 
     // Read header
@@ -108,8 +145,83 @@ int Alignment::parse(istream& inputStream, string headerLine, bool forward) {
 
     // Unify gaps
     replace(blockLines[1].begin(), blockLines[1].end(), ' ', '-');
+    return parseBlockLines();
+}
+
+int Alignment::load(const Rows & header, PackedPairs::Columns & columns) {
+    clear();
+    forward = header.forward;
+    gene = header.gene;
+    protein = header.protein;
+    dnaStart = header.dnaStart;
+    proteinStart = header.proteinStart;
+    realPositionCounter = dnaStart;
+
+    // Same replacements as done by AlignedPair for translated codons
+    int stopCode = PackedPairs::aminoAcidCode('*');
+    int jCode = PackedPairs::aminoAcidCode('J');
+    uint16_t mask = (PACKED_AA_CODES - 1) << PACKED_SCORE_SHIFT;
+    uint16_t * data = columns.pairs.data();
+    for (unsigned int i = 0; i < columns.pairs.size(); i++) {
+        int code = PackedPairs::translatedCode(data[i]);
+        if (code == stopCode) {
+            data[i] = (data[i] & ~mask) |
+                    PackedPairs::aminoAcidCode('A') << PACKED_SCORE_SHIFT;
+        } else if (code == jCode) {
+            data[i] = (data[i] & ~mask) |
+                    PackedPairs::aminoAcidCode('S') << PACKED_SCORE_SHIFT;
+        }
+    }
+
+    pairs.assign(dnaStart, forward, columns);
+    blockLength = pairs.size();
+    return findStructure();
+}
+
+void Alignment::getRows(Rows & rows) const {
+    rows.gene = gene;
+    rows.protein = protein;
+    rows.forward = forward;
+    rows.dnaStart = dnaStart;
+    rows.proteinStart = proteinStart;
+    rows.lines = blockLines;
+}
+
+int Alignment::parseBlockLines() {
     // Start actual parsing
+    pairs.reset(dnaStart, forward);
     parseBlock(blockLines);
+    return findStructure();
+}
+
+int Alignment::findStructure() {
+    const uint16_t * data = pairs.data();
+    int last = blockLength - 1;
+    int step = forward ? 1 : -1;
+    int position = realPositionCounter;
+    for (int column = 0; column <= last; column++) {
+        bool intron = data[column] & PACKED_INTRON_BIT;
+        bool gap = PackedPairs::isGap(data[column]);
+        // Most columns just continue an exon or an intron
+        if (intron != insideIntron || donorFlag || (insideIntron && gap) ||
+                position == dnaStart || column == 2 || column == last) {
+            index = column;
+            realPositionCounter = position;
+            checkForIntron(intron, gap);
+            if (column == 2) {
+                checkForStart();
+            }
+            if (column == last) {
+                checkForStop();
+            }
+        }
+        if (!gap) {
+            position += step;
+        }
+    }
+    index = blockLength;
+    realPositionCounter = position;
+    assignCodonPhases();
 
     // Potential single-exon gene
     if (exons.size() == 1) {
@@ -143,39 +255,29 @@ int Alignment::parseHeader(string headerLine) {
     return FORMAT_FAIL;
 }
 
-void Alignment::parseBlock(const vector<string>& lines) {
-    // Parse individual pairs
-    for (unsigned i = 0; i < lines[0].size(); i++) {
-        AlignedPair pair(lines[0][i], lines[1][i], lines[2][i], insideIntron);
-
-        checkForIntron(pair);
-        checkForStart(pair);
-        checkForStop(pair);
-
-        if (pair.nucleotide != '-' && pair.nucleotide != ' ') {
-            if (forward) {
-                pair.realPosition = realPositionCounter++;
-            } else {
-                pair.realPosition = realPositionCounter--;
-            }
-        } else {
-            // Don't increment the counter
-            if (forward) {
-                pair.realPosition = realPositionCounter - 1;
-            } else {
-                pair.realPosition = realPositionCounter + 1;
-            }
+bool Alignment::validHeader(const char * line, size_t length) {
+    // The same rule as parseHeader(), the protein follows a second marker
+    for (size_t i = 1; i < length; i++) {
+        if (line[i] == '>' || line[i] == '<') {
+            return true;
         }
+    }
+    return false;
+}
 
-        // Reuse space if possible
-        if ((int) pairs.size() <= index) {
-            pairs.push_back(pair);
-        } else {
-            pairs[index] = pair;
-        }
-        index++;
+void Alignment::parseBlock(const vector<string>& lines) {
+    nucleotideClasses.resize(lines[1].size());
+    CpuFeatures::kernels()->classifyNucleotides(lines[1].data(), lines[1].size(),
+                                                nucleotideClasses.data());
+
+    // Parse individual pairs, the structure is found on the packed pairs
+    bool intron = false;
+    for (unsigned i = 0; i < lines[0].size(); i++) {
+        AlignedPair pair(lines[0][i], lines[1][i], lines[2][i],
+                         nucleotideClasses[i], intron);
+        pairs.push(pair.translatedCodon, pair.nucleotide, pair.protein, pair.type);
+        intron = pair.type == 'i';
     }
-    assignCodonPhases();
 }
 
 bool Alignment::gapOrAA(char a) {
@@ -185,43 +287,45 @@ bool Alignment::gapOrAA(char a) {
     return false;
 }
 
+inline int Alignment::codonPhase(const uint16_t * data, int i, int shift) {
+    if (i == 0) {
+        return FIRST_PHASE_CODE;
+    } else if (i == (int) blockLength - 1) {
+        return THIRD_PHASE_CODE;
+    } else if (GAP_OR_AA_CODES >> ((data[i + 1] >> shift) & (PACKED_AA_CODES - 1)) & 1) {
+        return FIRST_PHASE_CODE;
+    } else if (GAP_OR_AA_CODES >> ((data[i - 1] >> shift) & (PACKED_AA_CODES - 1)) & 1) {
+        return THIRD_PHASE_CODE;
+    } else if (data[i + 1] & PACKED_INTRON_BIT) {
+        return FIRST_PHASE_CODE;
+    } else if (data[i - 1] & PACKED_INTRON_BIT) {
+        return THIRD_PHASE_CODE;
+    }
+    return SPACE_CODE;
+}
+
 void Alignment::assignCodonPhases() {
+    const uint16_t * data = pairs.data();
     for (unsigned int i = 0; i < blockLength; i++) {
-        if (pairs[i].translatedCodon == ' ' && pairs[i].type == 'e') {
-            if (i == 0) {
-                pairs[i].translatedCodon = '1';
-            } else if (i == blockLength - 1) {
-                pairs[i].translatedCodon = '3';
-            } else if (gapOrAA(pairs[i + 1].translatedCodon)) {
-                pairs[i].translatedCodon = '1';
-            } else if (gapOrAA(pairs[i - 1].translatedCodon)) {
-                pairs[i].translatedCodon = '3';
-            } else if (pairs[i + 1].type == 'i') {
-                pairs[i].translatedCodon = '1';
-            } else if (pairs[i - 1].type == 'i') {
-                pairs[i].translatedCodon = '3';
+        if (data[i] & PACKED_INTRON_BIT) {
+            continue;
+        }
+        if (PackedPairs::translatedCode(data[i]) == SPACE_CODE) {
+            int phase = codonPhase(data, i, PACKED_SCORE_SHIFT);
+            if (phase != SPACE_CODE) {
+                pairs.setTranslatedCode(i, phase);
             }
         }
-
-        if (pairs[i].protein == ' ' && pairs[i].type == 'e') {
-            if (i == 0) {
-                pairs[i].protein = '1';
-            } else if (i == blockLength - 1) {
-                pairs[i].protein = '3';
-            } else if (gapOrAA(pairs[i + 1].protein)) {
-                pairs[i].protein = '1';
-            } else if (gapOrAA(pairs[i - 1].protein)) {
-                pairs[i].protein = '3';
-            } else if (pairs[i + 1].type == 'i') {
-                pairs[i].protein = '1';
-            } else if (pairs[i - 1].type == 'i') {
-                pairs[i].protein = '3';
+        if (PackedPairs::proteinCode(data[i]) == SPACE_CODE) {
+            int phase = codonPhase(data, i, PACKED_PROTEIN_SHIFT);
+            if (phase != SPACE_CODE) {
+                pairs.setProteinCode(i, phase);
             }
         }
     }
 }
 
-void Alignment::checkForIntron(AlignedPair& pair) {
+void Alignment::checkForIntron(bool intron, bool gap) {
     // Some alignments start with a gap or intron, do not create initial exon
     // in such cases
     int alignmentPosition;
@@ -230,24 +334,24 @@ void Alignment::checkForIntron(AlignedPair& pair) {
     } else {
         alignmentPosition = dnaStart - realPositionCounter + 1;
     }
-    if (alignmentPosition == 1 && pair.type == 'e' && pair.nucleotide != '-') {
+    if (alignmentPosition == 1 && !intron && !gap) {
         exons.push_back(new Exon(index));
     }
 
     // Alignment end
-    if (index == (int) blockLength - 1 && pair.type == 'e') {
+    if (index == (int) blockLength - 1 && !intron) {
         exons.back()->end = index;
     }
 
     if (donorFlag) {
-        introns.back().donor[1] = pair.nucleotide;
+        introns.back().donor[1] = pairs.nucleotide(index);
         donorFlag = false;
     }
 
-    if (!insideIntron && pair.type == 'i') { // intron start
+    if (!insideIntron && intron) { // intron start
         Intron i;
         i.start = index;
-        i.donor[0] = pair.nucleotide;
+        i.donor[0] = pairs.nucleotide(index);
         if (index != 0) {
             exons.back()->end = index - 1;
             i.leftExon = exons.back();
@@ -255,26 +359,26 @@ void Alignment::checkForIntron(AlignedPair& pair) {
         introns.push_back(i);
         insideIntron = true;
         donorFlag = true;
-    } else if (insideIntron && pair.type != 'i') { // intron end
+    } else if (insideIntron && !intron) { // intron end
         insideIntron = false;
         exons.push_back(new Exon(index));
 
         // Make the decision about exon phase based on
         // how the preceeding exon was split.
         if (introns.back().start != 0) {
-            if (gapOrAA(pairs[introns.back().start - 1].protein)) {
+            if (gapOrAA(pairs.protein(introns.back().start - 1))) {
                 exons.back()->phase = 1;
             } else if (introns.back().start - 2 < 0) {
                 // Reached start of alignment
                 exons.back()->phase = 2;
             } else {
                 int position = introns.back().start - 2;
-                if (pairs[position].type != 'e') {
+                if (pairs.type(position) != 'e') {
                     // Check if still in exon (some exons are just 1 nt long).
                     // If not, take last nt from next exon upstream
                     position = introns[introns.size() - 2].start - 1;
                 }
-                if (position >= 0 && gapOrAA(pairs[position].protein)) {
+                if (position >= 0 && gapOrAA(pairs.protein(position))) {
                     exons.back()->phase = 0;
                 } else {
                     exons.back()->phase = 2;
@@ -287,43 +391,41 @@ void Alignment::checkForIntron(AlignedPair& pair) {
             introns.pop_back();
         } else {
             introns.back().end = index - 1;
-            introns.back().acceptor[0] = pairs[index - 2].nucleotide;
-            introns.back().acceptor[1] = pairs[index - 1].nucleotide;
+            introns.back().acceptor[0] = pairs.nucleotide(index - 2);
+            introns.back().acceptor[1] = pairs.nucleotide(index - 1);
             if (introns.back().start != 0 && introns.back().gap == false) {
                 introns.back().complete = true;
             }
             introns.back().rightExon = exons.back();
         }
-    } else if (insideIntron && pair.nucleotide == '-') {
+    } else if (insideIntron && gap) {
         // Gap (AA aligned) inside introns, do not report these introns
         introns.back().gap = true;
     }
 }
 
-void Alignment::checkForStart(AlignedPair& pair) {
-    if (index == 2) {
-        string codon = "";
-        codon += pair.nucleotide;
-        for (int i = 1; i < 3; i++) {
-            codon = pairs[index - i].nucleotide + codon;
-        }
-        if (codon == "ATG") {
-            // Check if protein alignment starts with its first M
-            if (proteinStart == 1 && pairs[index - 1].protein == 'M') {
-                start = new Codon(index - 2, exons.back());
-                exons.back()->initial = true;
-            }
+void Alignment::checkForStart() {
+    string codon = "";
+    codon += pairs.nucleotide(index);
+    for (int i = 1; i < 3; i++) {
+        codon = pairs.nucleotide(index - i) + codon;
+    }
+    if (codon == "ATG") {
+        // Check if protein alignment starts with its first M
+        if (proteinStart == 1 && pairs.protein(index - 1) == 'M') {
+            start = new Codon(index - 2, exons.back());
+            exons.back()->initial = true;
         }
     }
 }
 
-void Alignment::checkForStop(AlignedPair& pair) {
-    if (index == (int) blockLength - 1 && pairs[index - 3].type == 'e' &&
-            (pair.nucleotide == 'a' || pair.nucleotide == 'g')) {
+void Alignment::checkForStop() {
+    char nucleotide = pairs.nucleotide(index);
+    if (pairs.type(index - 3) == 'e' && (nucleotide == 'a' || nucleotide == 'g')) {
         string codon = "";
-        codon += pair.nucleotide;
+        codon += nucleotide;
         for (int i = 1; i < 3; i++) {
-            codon = pairs[index - i].nucleotide + codon;
+            codon = pairs.nucleotide(index - i) + codon;
         }
 
         if (codon == "taa" || codon == "tag" || codon == "tga") {
@@ -333,38 +435,81 @@ void Alignment::checkForStop(AlignedPair& pair) {
 }
 
 void Alignment::scoreHints(int windowWidth,
-        const ScoreMatrix * scoreMatrix, Kernel * kernel) {
+        const ScoreMatrix * scoreMatrix, Kernel * kernel, bool integerScoring) {
+    prepareScoring(windowWidth, scoreMatrix, kernel, integerScoring);
+    for (unsigned int i = 0; i < windows.size(); i++) {
+        *windows[i].score = scoreWindow(windows[i].start, windows[i].step,
+                                        windowWidth);
+    }
+    finishScoring();
+}
+
+void Alignment::queueWindows(ScoringBatch & batch, int windowWidth,
+        const ScoreMatrix * scoreMatrix, Kernel * kernel, bool integerScoring) {
+    prepareScoring(windowWidth, scoreMatrix, kernel, integerScoring);
+    for (unsigned int i = 0; i < windows.size(); i++) {
+        batch.addWindow(pairs, windows[i].start, windows[i].step,
+                        windows[i].score);
+    }
+}
+
+void Alignment::prepareScoring(int windowWidth,
+        const ScoreMatrix * scoreMatrix, Kernel * kernel, bool integerScoring) {
     this->scoreMatrix = scoreMatrix;
     this->kernel = kernel;
-    this->kernel->setWidth(windowWidth);
+    this->integerScoring = integerScoring;
+    // Kernels may be shared by several threads, only write when necessary
+    if (this->kernel->getWidth() != windowWidth) {
+        this->kernel->setWidth(windowWidth);
+    }
 
     for (unsigned int i = 0; i < exons.size(); i++) {
         scoreExon(exons[i]);
     }
 
-    scoreStart(windowWidth);
-    scoreStop(windowWidth);
-
+    windows.clear();
+    if (start != NULL) {
+        windows.push_back(Window(start->position + 1, 3, &start->score));
+    }
+    if (stop != NULL) {
+        windows.push_back(Window(stop->position - 2, -3, &stop->score));
+    }
     for (unsigned int i = 0; i < introns.size(); i++) {
         if (introns[i].complete && !introns[i].scoreSet) {
-            scoreIntron(introns[i], windowWidth);
+            addIntronWindows(introns[i]);
         }
     }
+}
+
+void Alignment::finishScoring() {
+    double weightSum = windowWeightSum();
+    if (start != NULL) {
+        start->score /= weightSum;
+        start->score /= scoreMatrix->getMaxScore();
+    }
+    if (stop != NULL) {
+        stop->score /= weightSum;
+        stop->score /= scoreMatrix->getMaxScore();
+    }
 
+    for (unsigned int i = 0; i < introns.size(); i++) {
+        if (introns[i].complete && !introns[i].scoreSet) {
+            scoreIntron(introns[i], weightSum);
+        }
+    }
 }
 
-double Alignment::scoreIntron(Intron& intron, int windowWidth) {
-    intron.leftScore = intron.rightScore = 0;
+void Alignment::addIntronWindows(Intron & intron) {
     int left, right;
 
     // Determine if codon is split and how
-    if (pairs[intron.start - 1].protein == '3' ||
-            pairs[intron.start - 1].translatedCodon == '3') {
+    if (pairs.protein(intron.start - 1) == '3' ||
+            pairs.translatedCodon(intron.start - 1) == '3') {
         // Codon is not split
         left = intron.start - 2;
         right = intron.end + 2;
-    } else if (pairs[intron.start - 1].protein == '1'
-            || pairs[intron.start - 1].translatedCodon == '1') {
+    } else if (pairs.protein(intron.start - 1) == '1'
+            || pairs.translatedCodon(intron.start - 1) == '1') {
         // Codon is split after the first nucleotide
         left = intron.start - 3;
         right = intron.end + 1;
@@ -374,10 +519,11 @@ double Alignment::scoreIntron(Intron& intron, int windowWidth) {
         right = intron.end + 3;
     }
 
-    scoreLeft(intron, left, windowWidth);
-    scoreRight(intron, right, windowWidth);
-    double weightSum = kernel->weightSum();
+    windows.push_back(Window(left, -3, &intron.leftScore));
+    windows.push_back(Window(right, 3, &intron.rightScore));
+}
 
+double Alignment::scoreIntron(Intron& intron, double weightSum) {
     // Normalize alignments by the area under kernel
     if (intron.leftScore <= 0 || intron.rightScore <= 0) {
         intron.score = 0;
@@ -392,100 +538,128 @@ double Alignment::scoreIntron(Intron& intron, int windowWidth) {
     return intron.score;
 }
 
-void Alignment::scoreLeft(Intron & intron, int start, int windowWidth) {
-    for (int i = start; i > (start - windowWidth * 3); i -= 3) {
-        // Check for end of local alignment
-        if (i < 0 || pairs[i].type != 'e') {
-            return;
-        }
-        double weight = kernel->getWeight((i - start) / 3);
-        intron.leftScore += pairs[i].score(scoreMatrix) * weight;
+double Alignment::scoreWindow(int start, int step, int windowWidth) {
+    const SimdKernels * simd = CpuFeatures::kernels();
+    int count = pairs.exonWindow(start, step, windowWidth);
+    if (count == 0) {
+        return 0;
     }
-}
+    const uint16_t * window = pairs.data() + start;
 
-void Alignment::scoreRight(Intron & intron, int start, int windowWidth) {
-    for (int i = start; i < (start + windowWidth * 3); i += 3) {
-        // Check for end of local alignment
-        if (i >= index || pairs[i].type != 'e') {
-            return;
+    if (integerScoring) {
+        fixedWindowScores.resize(count);
+        simd->gatherFixedScores(window, step, count,
+                scoreMatrix->getFixedPairScores(), fixedWindowScores.data());
+        if (pairs.hasAminoAcidExceptions()) {
+            for (int k = 0; k < count; k++) {
+                fixedWindowScores[k] = pairs.fixedScore(start + k * step, scoreMatrix);
+            }
         }
-        double weight = kernel->getWeight((i - start) / 3);
-        intron.rightScore += pairs[i].score(scoreMatrix) * weight;
+        return simd->fixedDotProduct(fixedWindowScores.data(),
+                                     kernel->getFixedWeights(), count);
     }
-}
 
-void Alignment::scoreStart(int windowWidth) {
-    if (start == NULL) {
-        return;
-    }
-    start->score = 0;
-    for (int i = start->position + 1; i < (start->position + 1 + windowWidth * 3); i += 3) {
-        // Check for end of local alignment
-        if (i >= index || pairs[i].type != 'e') {
-            break;
+    windowScores.resize(count);
+    simd->gatherScores(window, step, count, scoreMatrix->getPairScores(),
+                       windowScores.data());
+    if (pairs.hasAminoAcidExceptions()) {
+        for (int k = 0; k < count; k++) {
+            windowScores[k] = pairs.score(start + k * step, scoreMatrix);
         }
-        double weight = kernel->getWeight((i - start->position - 1) / 3);
-        start->score += pairs[i].score(scoreMatrix) * weight;
     }
-    start->score /=  kernel->weightSum();
-    start->score /= scoreMatrix->getMaxScore();
+    return simd->dotProduct(windowScores.data(), kernel->getWeights(), count);
 }
 
-void Alignment::scoreStop(int windowWidth) {
-    if (stop == NULL) {
-        return;
+double Alignment::windowWeightSum() {
+    if (integerScoring) {
+        return kernel->fixedWeightSum();
     }
-    stop->score = 0;
-    for (int i = stop->position - 2; i > (stop->position - 2 - windowWidth * 3); i -= 3) {
-        // Check for end of local alignment
-        if (i < 0 || pairs[i].type != 'e') {
-            break;
-        }
-        double weight = kernel->getWeight((i - stop->position + 2) / 3);
-        stop->score += pairs[i].score(scoreMatrix) * weight;
-    }
-    stop->score /=  kernel->weightSum();
-    stop->score /= scoreMatrix->getMaxScore();
+    return kernel->weightSum();
 }
 
 void Alignment::scoreExon(Exon* exon) {
     int i = exon->start;
     exon->score = 0;
+    int32_t fixedScore = 0;
     int length = 0;
+    if (!pairs.hasAminoAcidExceptions() && exon->end >= exon->start) {
+        const SimdKernels * simd = CpuFeatures::kernels();
+        int count = exon->end - exon->start + 1;
+        if (integerScoring) {
+            fixedScore = simd->fixedMaskedSum(pairs.data() + i, count,
+                    scoreMatrix->getFixedPairScores(), GAP_OR_AA_CODES, &length);
+        } else {
+            exon->score = simd->maskedSum(pairs.data() + i, count,
+                    scoreMatrix->getPairScores(), GAP_OR_AA_CODES, &length);
+        }
+        i = exon->end + 1;
+    }
     while (i <= exon->end) {
-        if (gapOrAA(pairs[i].protein)) {
-            exon->score += pairs[i].score(scoreMatrix);
+        if (gapOrAA(pairs.protein(i))) {
+            if (integerScoring) {
+                fixedScore += pairs.fixedScore(i, scoreMatrix);
+            } else {
+                exon->score += pairs.score(i, scoreMatrix);
+            }
             length++;
         }
         i++;
     }
+    if (integerScoring) {
+        exon->score = fixedScore;
+    }
     exon->normalizedScore = exon->score / length;
 }
 
 void Alignment::printHints(string output, double minExonScore,
                            double minInitialExonScore, double minInitialIntronScore) {
     ofstream ofs(output.c_str(), std::ofstream::out | std::ofstream::app);
+    printHints(ofs, minExonScore, minInitialExonScore, minInitialIntronScore);
+    ofs.close();
+}
+
+void Alignment::printHints(ostream & ofs, double minExonScore,
+                           double minInitialExonScore, double minInitialIntronScore,
+                           const HintFilter * filter, bool exactScores) {
+    this->exactScores = exactScores;
     char strand;
     if (forward) {
         strand = '+';
     } else {
         strand = '-';
     }
+    if (filter != NULL && !filter->isSet()) {
+        filter = NULL;
+    }
 
     printIntrons(ofs, strand, minExonScore, minInitialExonScore,
-                 minInitialIntronScore);
+                 minInitialIntronScore, filter);
     printStart(ofs, strand, minExonScore, minInitialExonScore,
-               minInitialIntronScore);
+               minInitialIntronScore, filter);
     printExons(ofs, strand, minExonScore, minInitialExonScore,
-               minInitialIntronScore);
-    printStop(ofs, strand, minExonScore);
+               minInitialIntronScore, filter);
+    printStop(ofs, strand, minExonScore, filter);
+}
 
-    ofs.close();
+void Alignment::startRecord(const char * type, int first, int last, char strand) {
+    hintRecord.clear();
+    hintRecord.setText(HintRecord::TYPE, type, strlen(type));
+    hintRecord.setText(HintRecord::CONTIG, gene.data(), gene.size());
+    hintRecord.setText(HintRecord::PROT, protein.data(), protein.size());
+    hintRecord.setText(HintRecord::STRAND, &strand, 1);
+    if (forward) {
+        hintRecord.setNumber(HintRecord::START, pairs.realPosition(first));
+        hintRecord.setNumber(HintRecord::END, pairs.realPosition(last));
+    } else {
+        hintRecord.setNumber(HintRecord::START, pairs.realPosition(last));
+        hintRecord.setNumber(HintRecord::END, pairs.realPosition(first));
+    }
 }
 
-void Alignment::printIntrons(ofstream& ofs, char strand,
+void Alignment::printIntrons(ostream& ofs, char strand,
                              double minExonScore, double minInitialExonScore,
-                             double minInitialIntronScore) {
+                             double minInitialIntronScore,
+                             const HintFilter * filter) {
     for (unsigned int i = 0; i < introns.size(); i++) {
         if (!introns[i].complete || introns[i].rightExon->score < minExonScore) {
             continue;
@@ -505,13 +679,29 @@ void Alignment::printIntrons(ofstream& ofs, char strand,
         spliceSites.append("_");
         spliceSites.append(introns[i].acceptor, 2);
 
+        if (filter != NULL) {
+            startRecord("Intron", introns[i].start, introns[i].end, strand);
+            hintRecord.setNumber(HintRecord::INTRON_ID, i + 1);
+            hintRecord.setNumber(HintRecord::INITIAL, introns[i].leftExon->initial);
+            hintRecord.setText(HintRecord::SPLICE_SITES, spliceSites.data(),
+                               spliceSites.size());
+            hintRecord.setNumber(HintRecord::AL_SCORE, introns[i].score);
+            hintRecord.setNumber(HintRecord::LE_SCORE, introns[i].leftExon->score);
+            hintRecord.setNumber(HintRecord::RE_SCORE, introns[i].rightExon->score);
+            hintRecord.setNumber(HintRecord::LE_N_SCORE,
+                                 introns[i].leftExon->normalizedScore);
+            if (!filter->accepts(hintRecord)) {
+                continue;
+            }
+        }
+
         ofs << gene << "\tSpaln_scorer\tIntron\t";
         if (forward) {
-            ofs << pairs[introns[i].start].realPosition << "\t";
-            ofs << pairs[introns[i].end].realPosition << "\t";
+            ofs << pairs.realPosition(introns[i].start) << "\t";
+            ofs << pairs.realPosition(introns[i].end) << "\t";
         } else {
-            ofs << pairs[introns[i].end].realPosition << "\t";
-            ofs << pairs[introns[i].start].realPosition << "\t";
+            ofs << pairs.realPosition(introns[i].end) << "\t";
+            ofs << pairs.realPosition(introns[i].start) << "\t";
         }
         ofs << ".\t" << strand << "\t.\tprot=" << protein;
         ofs << "; intron_id=" << i + 1 << ";";
@@ -520,14 +710,17 @@ void Alignment::printIntrons(ofstream& ofs, char strand,
         ofs << " al_score=" << introns[i].score << ";";
         ofs << " LeScore=" << introns[i].leftExon->score << ";";
         ofs << " ReScore=" << introns[i].rightExon->score << ";";
-        ofs << " LeNScore=" << introns[i].leftExon->normalizedScore << ";\n";
+        ofs << " LeNScore=" << introns[i].leftExon->normalizedScore << ";";
+        printExactScore(ofs, introns[i].score);
+        ofs << "\n";
     }
 }
 
-void Alignment::printStart(ofstream& ofs, char strand,
+void Alignment::printStart(ostream& ofs, char strand,
                            double minExonScore,
                            double minInitialExonScore,
-                           double minInitialIntronScore) {
+                           double minInitialIntronScore,
+                           const HintFilter * filter) {
     if (start == NULL || start->exon->score < minInitialExonScore) {
         return;
     }
@@ -542,13 +735,24 @@ void Alignment::printStart(ofstream& ofs, char strand,
         }
     }
 
+    if (filter != NULL) {
+        startRecord("start_codon", start->position, start->position + 2, strand);
+        hintRecord.setNumber(HintRecord::FRAME, 0);
+        hintRecord.setNumber(HintRecord::AL_SCORE, start->score);
+        hintRecord.setNumber(HintRecord::E_SCORE, start->exon->score);
+        hintRecord.setNumber(HintRecord::E_N_SCORE, start->exon->normalizedScore);
+        if (!filter->accepts(hintRecord)) {
+            return;
+        }
+    }
+
     ofs << gene << "\tSpaln_scorer\tstart_codon\t";
     if (forward) {
-        ofs << pairs[start->position].realPosition << "\t";
-        ofs << pairs[start->position + 2].realPosition  << "\t";
+        ofs << pairs.realPosition(start->position) << "\t";
+        ofs << pairs.realPosition(start->position + 2)  << "\t";
     } else {
-        ofs << pairs[start->position + 2].realPosition  << "\t";
-        ofs << pairs[start->position].realPosition << "\t";
+        ofs << pairs.realPosition(start->position + 2)  << "\t";
+        ofs << pairs.realPosition(start->position) << "\t";
     }
     ofs << ".\t" << strand << "\t0\tprot=" << protein << ";";
     ofs << " al_score=" << start->score << ";";
@@ -560,19 +764,22 @@ void Alignment::printStart(ofstream& ofs, char strand,
         introns[0].rightExon->score >= minExonScore &&
         introns[0].score >= minInitialIntronScore &&
         introns[0].leftExon->initial) {
-        int offsetStart = pairs[introns[0].start].realPosition -
-            pairs[start->position].realPosition;
-        int offsetEnd = pairs[introns[0].end].realPosition -
-            pairs[start->position].realPosition;
-        ofs << " nextIntron=" << offsetStart << "-" << offsetEnd << ";\n";
+        int offsetStart = pairs.realPosition(introns[0].start) -
+            pairs.realPosition(start->position);
+        int offsetEnd = pairs.realPosition(introns[0].end) -
+            pairs.realPosition(start->position);
+        ofs << " nextIntron=" << offsetStart << "-" << offsetEnd << ";";
     } else {
-        ofs << " nextIntron=-;\n";
+        ofs << " nextIntron=-;";
     }
+    printExactScore(ofs, start->score);
+    ofs << "\n";
 }
 
-void Alignment::printExons(ofstream& ofs, char strand, double minExonScore,
+void Alignment::printExons(ostream& ofs, char strand, double minExonScore,
                            double minInitialExonScore,
-                           double minInitialIntronScore) {
+                           double minInitialIntronScore,
+                           const HintFilter * filter) {
     for (unsigned int i = 0; i < exons.size(); i++) {
         if (exons[i]->score < minExonScore) {
             // Initial exons can have lower score, if the first intron
@@ -585,53 +792,87 @@ void Alignment::printExons(ofstream& ofs, char strand, double minExonScore,
                 continue;
             }
         }
+        if (filter != NULL) {
+            startRecord("CDS", exons[i]->start, exons[i]->end, strand);
+            hintRecord.setNumber(HintRecord::FRAME, exons[i]->phase);
+            hintRecord.setNumber(HintRecord::EXON_ID, i + 1);
+            hintRecord.setNumber(HintRecord::INITIAL, exons[i]->initial);
+            hintRecord.setNumber(HintRecord::E_SCORE, exons[i]->score);
+            hintRecord.setNumber(HintRecord::E_N_SCORE, exons[i]->normalizedScore);
+            if (!filter->accepts(hintRecord)) {
+                continue;
+            }
+        }
         ofs << gene << "\tSpaln_scorer\tCDS\t";
         if (forward) {
-            ofs << pairs[exons[i]->start].realPosition << "\t";
-            ofs << pairs[exons[i]->end].realPosition << "\t";
+            ofs << pairs.realPosition(exons[i]->start) << "\t";
+            ofs << pairs.realPosition(exons[i]->end) << "\t";
         } else {
-            ofs << pairs[exons[i]->end].realPosition << "\t";
-            ofs << pairs[exons[i]->start].realPosition << "\t";
+            ofs << pairs.realPosition(exons[i]->end) << "\t";
+            ofs << pairs.realPosition(exons[i]->start) << "\t";
         }
         ofs << ".\t" << strand << "\t" << exons[i]->phase << "\tprot=" << protein;
         ofs << "; exon_id=" << i + 1 << ";";
         ofs << " initial=" << exons[i]->initial << ";";
         ofs << " eScore=" << exons[i]->score << ";";
-        ofs << " eNScore=" << exons[i]->normalizedScore << ";\n";
+        ofs << " eNScore=" << exons[i]->normalizedScore << ";";
+        printExactScore(ofs, exons[i]->score);
+        ofs << "\n";
     }
 }
 
-void Alignment::printStop(ofstream& ofs, char strand, double minExonScore) {
+void Alignment::printStop(ostream& ofs, char strand, double minExonScore,
+                          const HintFilter * filter) {
     if (stop != NULL && stop->exon->score >= minExonScore) {
+        if (filter != NULL) {
+            startRecord("stop_codon", stop->position, stop->position + 2, strand);
+            hintRecord.setNumber(HintRecord::FRAME, 0);
+            hintRecord.setNumber(HintRecord::AL_SCORE, stop->score);
+            hintRecord.setNumber(HintRecord::E_SCORE, stop->exon->score);
+            if (!filter->accepts(hintRecord)) {
+                return;
+            }
+        }
         ofs << gene << "\tSpaln_scorer\tstop_codon\t";
         if (forward) {
-            ofs << pairs[stop->position].realPosition << "\t";
-            ofs << pairs[stop->position + 2].realPosition  << "\t";
+            ofs << pairs.realPosition(stop->position) << "\t";
+            ofs << pairs.realPosition(stop->position + 2)  << "\t";
         } else {
-            ofs << pairs[stop->position + 2].realPosition  << "\t";
-            ofs << pairs[stop->position].realPosition << "\t";
+            ofs << pairs.realPosition(stop->position + 2)  << "\t";
+            ofs << pairs.realPosition(stop->position) << "\t";
         }
         ofs << ".\t" << strand << "\t0\tprot=" << protein << ";";
         ofs << " al_score=" << stop->score << ";";
-        ofs << " eScore=" << stop->exon->score << ";\n";
+        ofs << " eScore=" << stop->exon->score << ";";
+        printExactScore(ofs, stop->score);
+        ofs << "\n";
+    }
+}
+
+void Alignment::printExactScore(ostream & ofs, double score) {
+    if (exactScores) {
+        // Hexadecimal floating point keeps all bits of the score
+        char buffer[32];
+        snprintf(buffer, sizeof (buffer), "%a", score);
+        ofs << " exact_score=" << buffer << ";";
     }
 }
 
 void Alignment::print(ostream& os) {
     for (unsigned int i = 0; i < blockLength; i++) {
-        os << pairs[i].translatedCodon;
+        os << pairs.translatedCodon(i);
     }
     os << endl;
     for (unsigned int i = 0; i < blockLength; i++) {
-        os << pairs[i].nucleotide;
+        os << pairs.nucleotide(i);
     }
     os << endl;
     for (unsigned int i = 0; i < blockLength; i++) {
-        os << pairs[i].protein;
+        os << pairs.protein(i);
     }
     os << endl;
     for (unsigned int i = 0; i < blockLength; i++) {
-        os << pairs[i].type;
+        os << pairs.type(i);
     }
     os << endl;
 }
@@ -648,11 +889,13 @@ int Alignment::getLength() {
     return index;
 }
 
-Alignment::AlignedPair::AlignedPair(char tc, char n, char p, bool insideIntron) :
+Alignment::AlignedPair::AlignedPair(char tc, char n, char p,
+                                    uint8_t nucleotideClass, bool insideIntron) :
 nucleotide(n),
 translatedCodon(tc),
 protein(p) {
-    if (islower(n) || (insideIntron && n == '-')) {
+    if ((nucleotideClass & CLASS_LOWERCASE) ||
+            (insideIntron && (nucleotideClass & CLASS_GAP))) {
         this->type = 'i';
     } else {
         this->type = 'e';
@@ -668,10 +911,6 @@ protein(p) {
     }
 }
 
-double Alignment::AlignedPair::score(const ScoreMatrix * scoreMatrix) {
-    return scoreMatrix->getScore(translatedCodon, protein);
-}
-
 Alignment::Intron::Intron() {
     scoreSet = false;
     complete = false;
@@ -685,6 +924,12 @@ Alignment::Exon::Exon(int start) {
     initial = false;
 }
 
+Alignment::Window::Window(int start, int step, double * score) {
+    this->start = start;
+    this->step = step;
+    this->score = score;
+}
+
 Alignment::Codon::Codon(int position, Exon * exon) {
     this->position = position;
     this->exon = exon;
@@ -6,13 +6,30 @@
 #include <string>
 #include "ScoreMatrix.h"
 #include "Kernel.h"
+#include "PackedPairs.h"
+#include "HintFilter.h"
 
 using namespace std;
 
+class ScoringBatch;
+
 /// Class for parsing a single gene-protein alignment
 
 class Alignment {
 public:
+    /// Trimmed alignment rows of a single record, without text formatting
+    struct Rows {
+        string gene;
+        string protein;
+        bool forward;
+        /// Starting position of the alignment in DNA
+        int dnaStart;
+        /// Starting position of the alignment in protein
+        int proteinStart;
+        /// Translated DNA, DNA (with unified gaps) and protein rows
+        vector<string> lines;
+    };
+
     Alignment();
     ~Alignment();
     /**
@@ -26,6 +43,17 @@ public:
      * @param forward    Whether the alignment is on forward strand
      */
     int parse(istream & inputStream, string headerLine, bool forward);
+    /**
+     * Load an alignment from already packed columns, skipping all text
+     * processing done by parse(). The columns are swapped into the
+     * alignment.
+     * @param header Names, strand and start positions, its lines are not used
+     */
+    int load(const Rows & header, PackedPairs::Columns & columns);
+    /**
+     * Export rows of the last alignment read by parse()
+     */
+    void getRows(Rows & rows) const;
     /**
      * @return Name of the aligned gene
      */
@@ -52,26 +80,67 @@ public:
      */
     void printHints(string output, double minExonScore,
                     double minInitialExonScore, double minInitialIntronScore);
+    /**
+     * Print scored hints into an already open stream
+     *
+     * @param os                    Output stream
+     * @param minExonScore          Do not print hints with exon score lower than this
+     * @param minInitialExonScore   Do not print hints with initial exon score lower than this
+     * @param minInitialIntronScore Do not print hints with initial intron score lower than this
+     * @param filter                Print only hints accepted by this filter
+     *                              expression, evaluated before the hints
+     *                              are formatted
+     * @param exactScores           Append the unrounded score of every hint
+     *                              as exact_score, for the aggregation
+     */
+    void printHints(ostream & os, double minExonScore,
+                    double minInitialExonScore, double minInitialIntronScore,
+                    const HintFilter * filter = NULL, bool exactScores = false);
     /**
      * Score all hints in the alignment
      * @param windowWidth Number of amino acids scored in the upstream/
      *                    downstream regions
      * @param scoreMatrix Scoring matrix used for scoring amino acids.
+     * @param kernel      Kernel weighting amino acids in the windows
+     * @param integerScoring Accumulate integer matrix scores with quantized
+     *                    kernel weights, the matrix must be integer-valued
      */
     void scoreHints(int windowWidth,
-            const ScoreMatrix * scoreMatrix, Kernel * kernel);
+            const ScoreMatrix * scoreMatrix, Kernel * kernel,
+            bool integerScoring = false);
+    /**
+     * Score exons and queue the intron, start and stop windows in a batch
+     * instead of scoring them directly. finishScoring() must be called
+     * once the batch was scored. Parameters are the same as in
+     * scoreHints().
+     */
+    void queueWindows(ScoringBatch & batch, int windowWidth,
+            const ScoreMatrix * scoreMatrix, Kernel * kernel,
+            bool integerScoring);
+    /**
+     * Normalize the window scores into the final intron, start and stop
+     * scores
+     */
+    void finishScoring();
+    /**
+     * Check whether parse() accepts a header line, i.e. whether it names
+     * both the gene and the protein
+     */
+    static bool validHeader(const char * line, size_t length);
+
+    /// Number of lines in an alignment block
+    static const int BLOCK_ITEMS_CNT = 3;
+    /// Width of the position column preceding each alignment line
+    static const int BLOCK_OFFSET = 9;
 private:
-    /// Single nucleotide-amino acid pair
+    /// Single nucleotide-amino acid pair, used while the alignment is read
     struct AlignedPair {
         /**
          * Save pair and determine exon/intron
+         * @param nucleotideClass CLASS_LOWERCASE/CLASS_GAP flags of N
          */
-        AlignedPair(char tc, char n, char p, bool insideIntron);
-        /**
-         * Return amino acid score
-         * @return AA score
-         */
-        double score(const ScoreMatrix * scoreMatrix);
+        AlignedPair(char tc, char n, char p, uint8_t nucleotideClass,
+                    bool insideIntron);
         char nucleotide;
         /**
          * The protein translations and proteins are saved as follows: 1A3
@@ -86,8 +155,6 @@ private:
          * 'e' for exon
          */
         char type;
-        /// Position of a nucleotide in the alignment relative to a gene start
-        int realPosition;
     };
 
     /// Structure for parsed exons
@@ -138,6 +205,15 @@ private:
      *  Parse individual block of lines containing the alignment and its properties
      */
     void parseBlock(const vector<string>& lines);
+    /**
+     * Parse the trimmed block lines and finish the alignment structure
+     */
+    int parseBlockLines();
+    /**
+     * Find introns, exons, start and stop in the packed pairs and assign
+     * codon phases
+     */
+    int findStructure();
     /**
      * Check if the given character is an amino acid or a gap
      */
@@ -146,6 +222,15 @@ private:
      * Assign phases to all positions
      */
     void assignCodonPhases();
+    /**
+     * Assign phase to a space in exon of one amino acid row
+     * @param data  Packed pairs
+     * @param shift PACKED_SCORE_SHIFT for translated codons,
+     *              PACKED_PROTEIN_SHIFT for proteins
+     * @return Code of '1', '3' or of space if the phase can not be
+     *         determined
+     */
+    int codonPhase(const uint16_t * data, int i, int shift);
     void printLineError();
     /**
      * Detect and save introns.
@@ -153,42 +238,75 @@ private:
      * such as its start/end position and donor/acceptor site.
      * Exons are saved as well during this process.
      */
-    void checkForIntron(AlignedPair & pair);
+    void checkForIntron(bool intron, bool gap);
+    /**
+     * Detect and save start codon, called at the third column
+     */
+    void checkForStart();
+    /**
+     * Detect and save stop codon, called at the last column
+     */
+    void checkForStop();
+    /// Scoring window next to an intron, start or stop
+    struct Window {
+        Window(int start, int step, double * score);
+        /// First scored position
+        int start;
+        /// 3 for scoring downstream, -3 for scoring upstream
+        int step;
+        /// Where the weighted window score is saved
+        double * score;
+    };
+
     /**
-     * Detect and save start codon
+     * Score exons and collect all windows which need to be scored
      */
-    void checkForStart(AlignedPair & pair);
+    void prepareScoring(int windowWidth, const ScoreMatrix * scoreMatrix,
+                        Kernel * kernel, bool integerScoring);
     /**
-     * Detect and save stop codon
+     * Collect the upstream and downstream windows of an intron
      */
-    void checkForStop(AlignedPair & pair);
+    void addIntronWindows(Intron & intron);
     /**
-     * Determine score of a single intron using exon alignment in the
-     * upstream and downstream region
+     * Determine score of a single intron from the scores of exon alignment
+     * in the upstream and downstream windows
      */
-    double scoreIntron(Intron & intron, int windowWidth);
+    double scoreIntron(Intron & intron, double weightSum);
     /**
-     * Compute alignment score of amino acids upstream of intron
+     * Compute kernel weighted alignment score of amino acids in a window
+     * @param start First scored position
+     * @param step  3 for scoring downstream, -3 for scoring upstream
+     * @return Weighted score, in fixed-point units with integer scoring
      */
-    void scoreLeft(Intron & intron, int start, int windowWidth);
+    double scoreWindow(int start, int step, int windowWidth);
     /**
-     * Compute alignment score of amino acids downstream of intron
+     * @return Area under kernel, in the units of scoreWindow()
      */
-    void scoreRight(Intron & intron, int start, int windowWidth);
+    double windowWeightSum();
     void scoreExon(Exon * exon);
-    void scoreStart(int windowWidth);
-    void scoreStop(int windowWidth);
 
-    void printIntrons(ofstream & ofs, char strand, double minExonScore,
-                      double minInitialExonScore, double minInitialIntronScore);
-    void printStart(ofstream & ofs, char strand, double minExonScore,
-                    double minInitialExonScore, double minInitialIntronScore);
-    void printExons(ofstream & ofs, char strand, double minExonScore,
-                    double minInitialExonScore, double minInitialIntronScore);
-    void printStop(ofstream & ofs, char strand, double minExonScore);
+    /**
+     * Fill the fields shared by all hints into hintRecord
+     * @param first First position of the hint in the alignment
+     * @param last  Last position of the hint in the alignment
+     */
+    void startRecord(const char * type, int first, int last, char strand);
+    void printIntrons(ostream & ofs, char strand, double minExonScore,
+                      double minInitialExonScore, double minInitialIntronScore,
+                      const HintFilter * filter);
+    void printStart(ostream & ofs, char strand, double minExonScore,
+                    double minInitialExonScore, double minInitialIntronScore,
+                    const HintFilter * filter);
+    void printExons(ostream & ofs, char strand, double minExonScore,
+                    double minInitialExonScore, double minInitialIntronScore,
+                    const HintFilter * filter);
+    void printStop(ostream & ofs, char strand, double minExonScore,
+                   const HintFilter * filter);
+    /**
+     * Print the exact_score attribute if exact scores are printed
+     */
+    void printExactScore(ostream & ofs, double score);
 
-    static const int BLOCK_ITEMS_CNT = 3;
-    static const int BLOCK_OFFSET = 9;
     /// Starting position of the alignment in DNA
     int dnaStart;
     /// Starting position of the alignment in protein
@@ -204,10 +322,17 @@ private:
     /// (gaps do not increment the counter)
     int realPositionCounter;
     bool forward;
-    /// Initial size of alignment vector
-    static const int N = 3000;
-    /// Array containing the actual alignment pairs
-    vector<AlignedPair> pairs;
+    /// Trimmed lines of the current alignment block
+    vector<string> blockLines;
+    /// Bit-packed alignment pairs
+    PackedPairs pairs;
+    /// Classes of the DNA row symbols, see SimdKernels::classifyNucleotides
+    vector<uint8_t> nucleotideClasses;
+    /// Windows of the alignment which are being scored
+    vector<Window> windows;
+    /// Buffers for scores of a single window
+    vector<double> windowScores;
+    vector<int32_t> fixedWindowScores;
     // Whether the parser is inside intron state
     bool insideIntron;
     /// Flag indicating that donor position of an intron is being read
@@ -215,9 +340,14 @@ private:
     vector<Intron> introns;
     vector<Exon*> exons;
     Codon * start;
+    /// Values of the hint which is evaluated by a filter
+    HintRecord hintRecord;
+    /// Whether the hints being printed carry their unrounded scores
+    bool exactScores;
     Codon * stop;
     const ScoreMatrix * scoreMatrix;
     Kernel * kernel;
+    bool integerScoring;
 };
 
 
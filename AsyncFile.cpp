@@ -0,0 +1,402 @@
+#include "AsyncFile.h"
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+/**
+ * Allocate aligned buffers of all blocks
+ */
+static void allocateBlocks(AsyncBlock * blocks) {
+    for (int i = 0; i < ASYNC_BLOCKS; i++) {
+        void * data;
+        if (posix_memalign(&data, ASYNC_BLOCK_ALIGNMENT, ASYNC_BLOCK_SIZE) != 0) {
+            data = malloc(ASYNC_BLOCK_SIZE);
+        }
+        blocks[i].data = (char *) data;
+        blocks[i].length = 0;
+    }
+}
+
+static void releaseBlocks(AsyncBlock * blocks) {
+    for (int i = 0; i < ASYNC_BLOCKS; i++) {
+        free(blocks[i].data);
+    }
+}
+
+AsyncReader::AsyncReader() : spare(ASYNC_BLOCKS), filled(ASYNC_BLOCKS + 1) {
+    fd = -1;
+    skip = 0;
+    current = NULL;
+    finished = false;
+    stopping = false;
+    error = false;
+    wakeup[0] = -1;
+    wakeup[1] = -1;
+    allocateBlocks(blocks);
+}
+
+AsyncReader::~AsyncReader() {
+    stop();
+    releaseBlocks(blocks);
+}
+
+void AsyncReader::start(int fd, unsigned long long skip) {
+    this->fd = fd;
+    this->skip = skip;
+    if (pipe(wakeup) != 0) {
+        wakeup[0] = -1;
+        wakeup[1] = -1;
+    }
+    for (int i = 0; i < ASYNC_BLOCKS; i++) {
+        spare.push(&blocks[i]);
+    }
+    reader = thread(&AsyncReader::readBlocks, this);
+}
+
+/**
+ * Read into a buffer, retrying interrupted calls
+ */
+static ssize_t readRetry(int fd, char * buffer, size_t length) {
+    ssize_t bytes;
+    do {
+        bytes = read(fd, buffer, length);
+    } while (bytes < 0 && errno == EINTR);
+    return bytes;
+}
+
+bool AsyncReader::waitForInput() {
+    if (wakeup[0] < 0) {
+        return !stopping;
+    }
+    struct pollfd fds[2];
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = wakeup[0];
+    fds[1].events = POLLIN;
+    while (true) {
+        int result = poll(fds, 2, -1);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            // The descriptor cannot be polled, fall back to a blocking read
+            return !stopping;
+        }
+        // Hang-up and errors of the input are reported by the following read()
+        return fds[1].revents == 0;
+    }
+}
+
+void AsyncReader::readBlocks() {
+    AsyncBlock * block;
+    while (freeBlock(block)) {
+        // Skipped bytes are read into the block and dropped
+        while (skip > 0 && !error) {
+            if (!waitForInput()) {
+                return;
+            }
+            size_t length = skip < ASYNC_BLOCK_SIZE ? skip : ASYNC_BLOCK_SIZE;
+            ssize_t bytes = readRetry(fd, block->data, length);
+            if (bytes <= 0) {
+                error = true;
+            } else {
+                skip -= bytes;
+            }
+        }
+
+        if (!error && !waitForInput()) {
+            return;
+        }
+        ssize_t bytes = error ? 0 : readRetry(fd, block->data, ASYNC_BLOCK_SIZE);
+        if (bytes < 0) {
+            error = true;
+            bytes = 0;
+        }
+        block->length = bytes;
+        filled.push(block);
+        if (bytes == 0) {
+            break;
+        }
+    }
+}
+
+bool AsyncReader::freeBlock(AsyncBlock * & block) {
+    RingBackoff backoff;
+    while (!spare.tryPop(block)) {
+        if (stopping) {
+            return false;
+        }
+        backoff.wait();
+    }
+    return true;
+}
+
+bool AsyncReader::next(const char * & data, size_t & length) {
+    if (finished) {
+        return false;
+    }
+    if (current != NULL) {
+        spare.push(current);
+    }
+    filled.pop(current);
+    if (current->length == 0) {
+        finished = true;
+        return false;
+    }
+    data = current->data;
+    length = current->length;
+    return true;
+}
+
+bool AsyncReader::failed() const {
+    return error;
+}
+
+bool AsyncReader::skipped() const {
+    return skip == 0;
+}
+
+bool AsyncReader::ready() const {
+    return finished || !filled.empty();
+}
+
+void AsyncReader::stop() {
+    stopping = true;
+    if (wakeup[1] >= 0) {
+        // Wake the thread up when it waits for an idle upstream
+        char byte = 0;
+        while (write(wakeup[1], &byte, 1) < 0 && errno == EINTR) {
+        }
+    }
+    if (reader.joinable()) {
+        reader.join();
+    }
+    for (int i = 0; i < 2; i++) {
+        if (wakeup[i] >= 0) {
+            close(wakeup[i]);
+            wakeup[i] = -1;
+        }
+    }
+}
+
+LineReader::LineReader(AsyncReader & reader) : reader(reader) {
+    data = NULL;
+    end = NULL;
+    more = true;
+    partialReturned = false;
+}
+
+bool LineReader::next(const char * & line, size_t & length, bool & newline) {
+    if (partialReturned) {
+        partial.clear();
+        partialReturned = false;
+    }
+
+    while (true) {
+        if (data < end) {
+            const char * found = (const char *) memchr(data, '\n', end - data);
+            if (found != NULL) {
+                if (partial.empty()) {
+                    line = data;
+                    length = found - data;
+                } else {
+                    partial.append(data, found - data);
+                    line = partial.data();
+                    length = partial.size();
+                    partialReturned = true;
+                }
+                data = found + 1;
+                newline = true;
+                return true;
+            }
+            // The line continues in the next block
+            partial.append(data, end - data);
+            data = end;
+        }
+
+        if (!more) {
+            return false;
+        }
+        const char * block;
+        size_t blockLength;
+        if (!reader.next(block, blockLength)) {
+            more = false;
+            if (partial.empty()) {
+                return false;
+            }
+            // Last line without a newline
+            line = partial.data();
+            length = partial.size();
+            partialReturned = true;
+            newline = false;
+            return true;
+        }
+        data = block;
+        end = block + blockLength;
+    }
+}
+
+bool LineReader::waiting() const {
+    // An unfinished line at the end of the block needs the next one too
+    return more && !reader.ready() &&
+            (data >= end || memchr(data, '\n', end - data) == NULL);
+}
+
+AsyncWriteBuffer::AsyncWriteBuffer() : spare(ASYNC_BLOCKS), full(ASYNC_BLOCKS + 1) {
+    fd = -1;
+    current = NULL;
+    offset = 0;
+    submitted = 0;
+    written = 0;
+    error = false;
+    pipeClosed = false;
+    allocateBlocks(blocks);
+}
+
+AsyncWriteBuffer::~AsyncWriteBuffer() {
+    close();
+    releaseBlocks(blocks);
+}
+
+bool AsyncWriteBuffer::open(string filename, bool append) {
+    if (filename == STANDARD_OUTPUT) {
+        // A copy, so that closing the buffer leaves the standard output open
+        fd = dup(STDOUT_FILENO);
+        append = false;
+    } else {
+        fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | (append ? 0 : O_TRUNC), 0666);
+    }
+    if (fd < 0) {
+        return false;
+    }
+    off_t end = append ? lseek(fd, 0, SEEK_END) : 0;
+    offset = end < 0 ? 0 : end;
+    submitted = 0;
+    written = 0;
+    error = false;
+    pipeClosed = false;
+
+    for (int i = 0; i < ASYNC_BLOCKS; i++) {
+        spare.push(&blocks[i]);
+    }
+    spare.pop(current);
+    setp(current->data, current->data + ASYNC_BLOCK_SIZE);
+    writer = thread(&AsyncWriteBuffer::writeBlocks, this);
+    return true;
+}
+
+bool AsyncWriteBuffer::close() {
+    if (fd < 0) {
+        return true;
+    }
+    sync();
+    full.push(NULL);
+    writer.join();
+    spare.push(current);
+    current = NULL;
+    setp(NULL, NULL);
+    if (::close(fd) != 0) {
+        error = true;
+    }
+    fd = -1;
+    return !error;
+}
+
+bool AsyncWriteBuffer::broken() const {
+    return pipeClosed;
+}
+
+void AsyncWriteBuffer::writeBlocks() {
+    AsyncBlock * block;
+    while (true) {
+        full.pop(block);
+        if (block == NULL) {
+            break;
+        }
+        size_t done = 0;
+        while (done < block->length && !error) {
+            ssize_t bytes = write(fd, block->data + done, block->length - done);
+            if (bytes < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytes <= 0) {
+                pipeClosed = bytes < 0 && errno == EPIPE;
+                error = true;
+                break;
+            }
+            done += bytes;
+        }
+        written += block->length;
+        spare.push(block);
+    }
+}
+
+bool AsyncWriteBuffer::submit() {
+    size_t length = pptr() - pbase();
+    if (length > 0) {
+        current->length = length;
+        offset += length;
+        submitted += length;
+        full.push(current);
+        spare.pop(current);
+        setp(current->data, current->data + ASYNC_BLOCK_SIZE);
+    }
+    return !error;
+}
+
+int AsyncWriteBuffer::overflow(int c) {
+    if (fd < 0 || !submit()) {
+        return EOF;
+    }
+    if (c != EOF) {
+        *pptr() = (char) c;
+        pbump(1);
+    }
+    return c == EOF ? 0 : c;
+}
+
+int AsyncWriteBuffer::sync() {
+    if (fd < 0) {
+        return 0;
+    }
+    submit();
+    RingBackoff backoff;
+    while (written < submitted) {
+        backoff.wait();
+    }
+    return error ? -1 : 0;
+}
+
+streampos AsyncWriteBuffer::seekoff(streamoff offset, ios_base::seekdir direction,
+                                    ios_base::openmode mode) {
+    // Only reporting the position is supported
+    if (offset != 0 || direction != ios_base::cur || !(mode & ios_base::out)) {
+        return streampos(streamoff(-1));
+    }
+    return this->offset + (pptr() - pbase());
+}
+
+AsyncOutputStream::AsyncOutputStream() : ostream(NULL) {
+    rdbuf(&buffer);
+}
+
+bool AsyncOutputStream::open(string filename, bool append) {
+    if (!buffer.open(filename, append)) {
+        setstate(failbit);
+        return false;
+    }
+    return true;
+}
+
+bool AsyncOutputStream::close() {
+    flush();
+    return buffer.close();
+}
+
+bool AsyncOutputStream::broken() const {
+    return buffer.broken();
+}
@@ -0,0 +1,190 @@
+#ifndef ASYNC_FILE_H
+#define ASYNC_FILE_H
+
+#include <string>
+#include <ostream>
+#include <streambuf>
+#include <thread>
+#include <atomic>
+#include "RingBuffer.h"
+
+using namespace std;
+
+/// Size of blocks read and written by the I/O threads
+#define ASYNC_BLOCK_SIZE (1024 * 1024)
+/// Number of blocks in flight, one is filled while others are processed
+#define ASYNC_BLOCKS 3
+/// Alignment of the block buffers
+#define ASYNC_BLOCK_ALIGNMENT 4096
+/// Output file name standing for the standard output
+#define STANDARD_OUTPUT "-"
+
+/// Aligned buffer passed between an I/O thread and the processing thread
+struct AsyncBlock {
+    char * data;
+    size_t length;
+};
+
+/// Input read ahead by a dedicated thread
+
+/**
+ * The thread fills a few aligned blocks with large read() calls while the
+ * previous blocks are parsed and scored, so computation overlaps with disk
+ * and pipe I/O. Blocks are recycled, nothing is allocated after start().
+ */
+class AsyncReader {
+public:
+    AsyncReader();
+    ~AsyncReader();
+    /**
+     * Start reading a file descriptor from its current offset
+     * @param skip Number of bytes discarded before the first block
+     */
+    void start(int fd, unsigned long long skip = 0);
+    /**
+     * Get the next block of the input. The block stays valid until the
+     * following call.
+     * @return False at the end of the input or after a read error
+     */
+    bool next(const char * & data, size_t & length);
+    /**
+     * @return Whether reading failed or the input was shorter than the
+     *         number of bytes to skip
+     */
+    bool failed() const;
+    /**
+     * @return Whether all bytes to skip were skipped, valid once next()
+     *         returned false
+     */
+    bool skipped() const;
+    /**
+     * @return Whether the next block is already read, otherwise next()
+     *         may wait for the input
+     */
+    bool ready() const;
+private:
+    void readBlocks();
+    /**
+     * Wait for a free block
+     * @return False when the reader is being stopped
+     */
+    bool freeBlock(AsyncBlock * & block);
+    /**
+     * Wait until the input can be read without blocking
+     * @return False when stop() interrupted the wait
+     */
+    bool waitForInput();
+    void stop();
+
+    int fd;
+    unsigned long long skip;
+    AsyncBlock blocks[ASYNC_BLOCKS];
+    /// Blocks returned by the consumer
+    SpscRing<AsyncBlock *> spare;
+    /// Blocks filled by the thread, an empty block marks the end
+    SpscRing<AsyncBlock *> filled;
+    /// Block held by the consumer
+    AsyncBlock * current;
+    bool finished;
+    atomic<bool> stopping;
+    atomic<bool> error;
+    /// Pipe written by stop() to interrupt a wait for an idle upstream
+    int wakeup[2];
+    thread reader;
+};
+
+/// Splits blocks of an AsyncReader into lines
+
+class LineReader {
+public:
+    LineReader(AsyncReader & reader);
+    /**
+     * Get the next line without the newline character. The line stays
+     * valid until the following call.
+     * @param newline Whether the line was terminated by a newline
+     * @return False at the end of the input
+     */
+    bool next(const char * & line, size_t & length, bool & newline);
+    /**
+     * @return Whether the next call would wait for more input
+     */
+    bool waiting() const;
+private:
+    AsyncReader & reader;
+    const char * data;
+    const char * end;
+    bool more;
+    /// Line split between two blocks
+    string partial;
+    /// Whether the partial line was returned and can be cleared
+    bool partialReturned;
+};
+
+/// Stream buffer whose blocks are written behind by a dedicated thread
+
+class AsyncWriteBuffer : public streambuf {
+public:
+    AsyncWriteBuffer();
+    ~AsyncWriteBuffer();
+    /**
+     * Open the output file and start the writing thread
+     * @param filename Output file, or STANDARD_OUTPUT
+     * @param append   Continue at the end of an existing file instead of
+     *                 truncating it
+     * @return Whether the file was opened
+     */
+    bool open(string filename, bool append);
+    /**
+     * Write all buffered data and stop the writing thread
+     * @return Whether all data were written
+     */
+    bool close();
+    /**
+     * @return Whether writing failed because the reading end of the output
+     *         pipe was closed
+     */
+    bool broken() const;
+protected:
+    int overflow(int c);
+    /**
+     * Hand the current block over and wait until everything is written
+     */
+    int sync();
+    streampos seekoff(streamoff offset, ios_base::seekdir direction,
+                      ios_base::openmode mode);
+private:
+    void writeBlocks();
+    /**
+     * Pass the current block to the writing thread and take a free one
+     */
+    bool submit();
+
+    int fd;
+    AsyncBlock blocks[ASYNC_BLOCKS];
+    /// Blocks returned by the writing thread
+    SpscRing<AsyncBlock *> spare;
+    /// Blocks to write, NULL stops the thread
+    SpscRing<AsyncBlock *> full;
+    AsyncBlock * current;
+    /// File offset of the current block
+    unsigned long long offset;
+    atomic<unsigned long long> submitted;
+    atomic<unsigned long long> written;
+    atomic<bool> error;
+    atomic<bool> pipeClosed;
+    thread writer;
+};
+
+/// Output stream written behind by a dedicated thread
+
+class AsyncOutputStream : public ostream {
+public:
+    AsyncOutputStream();
+    bool open(string filename, bool append);
+    bool close();
+    bool broken() const;
+private:
+    AsyncWriteBuffer buffer;
+};
+
+#endif /* ASYNC_FILE_H */
@@ -0,0 +1,498 @@
+#include "BinaryFormat.h"
+#include <cstring>
+#include <ctype.h>
+
+using namespace std;
+
+static const char BINARY_MAGIC[] = "SBSALN02";
+/// Length of the magic string without its version number
+static const size_t BINARY_MAGIC_PREFIX = 6;
+static const char DNA_ALPHABET[] = "ACGT";
+/// Expected distance between symbols of the amino acid rows
+static const size_t CODON_DISTANCE = 3;
+/// Expected column of the first symbol of the amino acid rows
+static const size_t FIRST_SYMBOL = 1;
+
+/// Position and length of a run of equal symbols
+struct Run {
+    Run(size_t start, size_t length) : start(start), length(length) {}
+    size_t start, length;
+};
+
+/// Runs and exceptions of a DNA row, followed by the packed bases
+struct BinaryReader::DnaRow {
+    /// Runs of gaps and of lowercase bases
+    vector<Run> runs[2];
+    vector<pair<size_t, char> > exceptions;
+    const unsigned char * packed;
+};
+
+/// Non-space symbols of an amino acid row, read in order by next()
+struct BinaryReader::AminoAcidRow {
+    AminoAcidRow() : symbol(0), position(FIRST_SYMBOL - CODON_DISTANCE), nextSpacing(0),
+            nextException(0) {}
+    /**
+     * Read the next symbol
+     * @param code   PackedPairs code of the symbol
+     * @param letter Receives the symbol if CODE is an exception
+     * @return Column of the symbol
+     */
+    size_t next(int & code, char & letter) {
+        size_t distance = CODON_DISTANCE;
+        if (nextSpacing < spacing.size() && spacing[nextSpacing].first == symbol) {
+            distance = spacing[nextSpacing++].second;
+        }
+        position += distance;
+        size_t bit = symbol * 5;
+        unsigned int bits = packed[bit / 8];
+        if (bit % 8 > 3) {
+            bits |= packed[bit / 8 + 1] << 8;
+        }
+        code = (bits >> (bit % 8)) & 0x1F;
+        if (code == PACKED_AA_EXCEPTION) {
+            letter = nextException < exceptions.size() &&
+                    exceptions[nextException].first == symbol ?
+                    exceptions[nextException++].second : '\0';
+        }
+        symbol++;
+        return position;
+    }
+
+    uint64_t count;
+    /// Symbol index and distance from the previous symbol, unless 3
+    vector<pair<uint64_t, size_t> > spacing;
+    /// Symbol index and symbol outside of the 5-bit alphabet
+    vector<pair<uint64_t, char> > exceptions;
+    const unsigned char * packed;
+    uint64_t symbol;
+    size_t position;
+    size_t nextSpacing;
+    size_t nextException;
+};
+
+bool BinaryWriter::open(string filename) {
+    ofs.open(filename.c_str(), std::ofstream::binary);
+    if (!ofs) {
+        return false;
+    }
+    ofs.write(BINARY_MAGIC, BINARY_MAGIC_SIZE);
+    return ofs.good();
+}
+
+void BinaryWriter::write(const Alignment::Rows & rows) {
+    record.clear();
+    putString(rows.gene);
+    putString(rows.protein);
+    record.push_back(rows.forward);
+    putNumber(rows.dnaStart);
+    putNumber(rows.proteinStart);
+    putNumber(rows.lines[1].size());
+    encodeDna(rows.lines[1]);
+    encodeAminoAcids(rows.lines[0]);
+    encodeAminoAcids(rows.lines[2]);
+
+    uint32_t length = record.size();
+    ofs.write((const char *) &length, sizeof (length));
+    ofs.write(record.data(), record.size());
+}
+
+bool BinaryWriter::close() {
+    ofs.close();
+    return !ofs.fail();
+}
+
+void BinaryWriter::encodeDna(const string & dna) {
+    vector<Run> gaps, lowercase;
+    vector<size_t> exceptions;
+    string packed((dna.size() + 3) / 4, '\0');
+
+    for (size_t i = 0; i < dna.size(); i++) {
+        char base = dna[i];
+        if (base == '-') {
+            if (!gaps.empty() && gaps.back().start + gaps.back().length == i) {
+                gaps.back().length++;
+            } else {
+                gaps.push_back(Run(i, 1));
+            }
+            continue;
+        }
+        if (islower(base)) {
+            if (!lowercase.empty() && lowercase.back().start + lowercase.back().length == i) {
+                lowercase.back().length++;
+            } else {
+                lowercase.push_back(Run(i, 1));
+            }
+        }
+        const char * code = strchr(DNA_ALPHABET, toupper(base));
+        if (base == '\0' || code == NULL) {
+            exceptions.push_back(i);
+        } else {
+            packed[i / 4] |= (code - DNA_ALPHABET) << ((i % 4) * 2);
+        }
+    }
+
+    const vector<Run> * runs[] = {&gaps, &lowercase};
+    for (int r = 0; r < 2; r++) {
+        putNumber(runs[r]->size());
+        size_t previousEnd = 0;
+        for (size_t i = 0; i < runs[r]->size(); i++) {
+            putNumber((*runs[r])[i].start - previousEnd);
+            putNumber((*runs[r])[i].length);
+            previousEnd = (*runs[r])[i].start + (*runs[r])[i].length;
+        }
+    }
+
+    putNumber(exceptions.size());
+    size_t previous = 0;
+    for (size_t i = 0; i < exceptions.size(); i++) {
+        putNumber(exceptions[i] - previous);
+        record.push_back(dna[exceptions[i]]);
+        previous = exceptions[i];
+    }
+    record.append(packed);
+}
+
+void BinaryWriter::encodeAminoAcids(const string & row) {
+    vector<size_t> symbols, exceptions;
+    vector<pair<size_t, size_t> > spacing;
+    size_t previous = FIRST_SYMBOL - CODON_DISTANCE;
+    for (size_t i = 0; i < row.size(); i++) {
+        if (row[i] == ' ') {
+            continue;
+        }
+        if (i - previous != CODON_DISTANCE) {
+            spacing.push_back(make_pair(symbols.size(), i - previous));
+        }
+        if (PackedPairs::aminoAcidCode(row[i]) == PACKED_AA_EXCEPTION) {
+            exceptions.push_back(symbols.size());
+        }
+        symbols.push_back(i);
+        previous = i;
+    }
+
+    putNumber(symbols.size());
+    putNumber(spacing.size());
+    size_t previousSymbol = 0;
+    for (size_t i = 0; i < spacing.size(); i++) {
+        putNumber(spacing[i].first - previousSymbol);
+        putNumber(spacing[i].second);
+        previousSymbol = spacing[i].first;
+    }
+    putNumber(exceptions.size());
+    previousSymbol = 0;
+    for (size_t i = 0; i < exceptions.size(); i++) {
+        putNumber(exceptions[i] - previousSymbol);
+        record.push_back(row[symbols[exceptions[i]]]);
+        previousSymbol = exceptions[i];
+    }
+
+    string packed((symbols.size() * 5 + 7) / 8, '\0');
+    for (size_t i = 0; i < symbols.size(); i++) {
+        size_t bit = i * 5;
+        unsigned int shifted = PackedPairs::aminoAcidCode(row[symbols[i]]) << (bit % 8);
+        packed[bit / 8] |= shifted & 0xFF;
+        if (shifted > 0xFF) {
+            packed[bit / 8 + 1] |= shifted >> 8;
+        }
+    }
+    record.append(packed);
+}
+
+void BinaryWriter::putNumber(uint64_t number) {
+    while (number >= 0x80) {
+        record.push_back((char) ((number & 0x7F) | 0x80));
+        number >>= 7;
+    }
+    record.push_back((char) number);
+}
+
+void BinaryWriter::putString(const string & text) {
+    putNumber(text.size());
+    record.append(text);
+}
+
+bool BinaryReader::isBinary(const char * data, size_t length) {
+    return length >= BINARY_MAGIC_SIZE &&
+            memcmp(data, BINARY_MAGIC, BINARY_MAGIC_SIZE) == 0;
+}
+
+bool BinaryReader::isOutdated(const char * data, size_t length) {
+    return length >= BINARY_MAGIC_SIZE && !isBinary(data, length) &&
+            memcmp(data, BINARY_MAGIC, BINARY_MAGIC_PREFIX) == 0;
+}
+
+size_t BinaryReader::recordEnd(const char * data, size_t length, size_t position) {
+    uint32_t recordLength;
+    if (position + sizeof (recordLength) > length) {
+        return length;
+    }
+    memcpy(&recordLength, data + position, sizeof (recordLength));
+    position += sizeof (recordLength) + recordLength;
+    return position > length ? length : position;
+}
+
+bool BinaryReader::decode(const char * record, size_t length, Alignment::Rows & rows) {
+    BinaryReader reader;
+    uint64_t blockLength;
+    if (!reader.decodeHeader(record, length, rows, blockLength)) {
+        return false;
+    }
+    rows.lines.resize(Alignment::BLOCK_ITEMS_CNT);
+    return reader.decodeDna(rows.lines[1], blockLength) &&
+            reader.decodeAminoAcids(rows.lines[0], blockLength) &&
+            reader.decodeAminoAcids(rows.lines[2], blockLength);
+}
+
+bool BinaryReader::decode(const char * record, size_t length, Alignment::Rows & rows,
+                          PackedPairs::Columns & columns) {
+    BinaryReader reader;
+    uint64_t blockLength;
+    if (!reader.decodeHeader(record, length, rows, blockLength)) {
+        return false;
+    }
+    columns.nucleotideExceptions.clear();
+    columns.translatedExceptions.clear();
+    columns.proteinExceptions.clear();
+    return reader.decodeDna(columns, blockLength) &&
+            reader.decodeAminoAcids(columns, blockLength, PACKED_SCORE_SHIFT,
+                                    columns.translatedExceptions) &&
+            reader.decodeAminoAcids(columns, blockLength, PACKED_PROTEIN_SHIFT,
+                                    columns.proteinExceptions);
+}
+
+bool BinaryReader::decodeHeader(const char * record, size_t length,
+                                Alignment::Rows & rows, uint64_t & blockLength) {
+    uint32_t recordLength;
+    if (length < sizeof (recordLength)) {
+        return false;
+    }
+    memcpy(&recordLength, record, sizeof (recordLength));
+    if (recordLength > length - sizeof (recordLength)) {
+        return false;
+    }
+    data = record + sizeof (recordLength);
+    end = data + recordLength;
+
+    uint64_t dnaStart, proteinStart;
+    if (!getString(rows.gene) || !getString(rows.protein) || data == end) {
+        return false;
+    }
+    rows.forward = *data++;
+    if (!getNumber(dnaStart) || !getNumber(proteinStart) || !getNumber(blockLength)) {
+        return false;
+    }
+    rows.dnaStart = dnaStart;
+    rows.proteinStart = proteinStart;
+    // Every column takes at least 2 bits of the record
+    return blockLength <= (uint64_t) (end - data) * 4;
+}
+
+bool BinaryReader::getNumber(uint64_t & number) {
+    number = 0;
+    for (int shift = 0; data < end && shift < 64; shift += 7) {
+        unsigned char byte = *data++;
+        number |= (uint64_t) (byte & 0x7F) << shift;
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BinaryReader::getString(string & text) {
+    uint64_t length;
+    if (!getNumber(length) || length > (uint64_t) (end - data)) {
+        return false;
+    }
+    text.assign(data, length);
+    data += length;
+    return true;
+}
+
+bool BinaryReader::readDna(DnaRow & row, size_t length) {
+    for (int r = 0; r < 2; r++) {
+        uint64_t count, start, runLength;
+        if (!getNumber(count)) {
+            return false;
+        }
+        size_t previousEnd = 0;
+        for (uint64_t i = 0; i < count; i++) {
+            if (!getNumber(start) || !getNumber(runLength) ||
+                    start > length || runLength > length ||
+                    previousEnd + start + runLength > length) {
+                return false;
+            }
+            row.runs[r].push_back(Run(previousEnd + start, runLength));
+            previousEnd += start + runLength;
+        }
+    }
+
+    uint64_t count, delta;
+    if (!getNumber(count)) {
+        return false;
+    }
+    size_t position = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        if (!getNumber(delta) || data == end || delta >= length ||
+                position + delta >= length) {
+            return false;
+        }
+        position += delta;
+        row.exceptions.push_back(make_pair(position, *data++));
+    }
+
+    size_t packedLength = (length + 3) / 4;
+    if (packedLength > (size_t) (end - data)) {
+        return false;
+    }
+    row.packed = (const unsigned char *) data;
+    data += packedLength;
+    return true;
+}
+
+bool BinaryReader::readAminoAcids(AminoAcidRow & row, size_t length) {
+    uint64_t count, index, value;
+    if (!getNumber(row.count) || row.count > length || !getNumber(count)) {
+        return false;
+    }
+    // Distances must keep all symbols inside the row
+    size_t symbol = 0, total = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        if (!getNumber(index) || !getNumber(value) || index > row.count ||
+                (i > 0 && index == 0) || symbol + index >= row.count ||
+                value == 0 || value > length) {
+            return false;
+        }
+        symbol += index;
+        total += value;
+        row.spacing.push_back(make_pair((uint64_t) symbol, (size_t) value));
+    }
+    total += (row.count - row.spacing.size()) * CODON_DISTANCE;
+    if (row.count > 0 && total + FIRST_SYMBOL >= length + CODON_DISTANCE) {
+        return false;
+    }
+
+    if (!getNumber(count)) {
+        return false;
+    }
+    symbol = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        if (!getNumber(index) || data == end || index > row.count ||
+                symbol + index >= row.count) {
+            return false;
+        }
+        symbol += index;
+        row.exceptions.push_back(make_pair((uint64_t) symbol, *data++));
+    }
+
+    size_t packedLength = (row.count * 5 + 7) / 8;
+    if (packedLength > (size_t) (end - data)) {
+        return false;
+    }
+    row.packed = (const unsigned char *) data;
+    data += packedLength;
+    return true;
+}
+
+bool BinaryReader::decodeDna(string & dna, size_t length) {
+    DnaRow row;
+    if (!readDna(row, length)) {
+        return false;
+    }
+    dna.resize(length);
+    for (size_t i = 0; i < length; i++) {
+        dna[i] = DNA_ALPHABET[(row.packed[i / 4] >> ((i % 4) * 2)) & 3];
+    }
+    for (size_t i = 0; i < row.runs[1].size(); i++) {
+        for (size_t j = row.runs[1][i].start; j < row.runs[1][i].start + row.runs[1][i].length; j++) {
+            dna[j] = tolower(dna[j]);
+        }
+    }
+    for (size_t i = 0; i < row.runs[0].size(); i++) {
+        dna.replace(row.runs[0][i].start, row.runs[0][i].length, row.runs[0][i].length, '-');
+    }
+    for (size_t i = 0; i < row.exceptions.size(); i++) {
+        dna[row.exceptions[i].first] = row.exceptions[i].second;
+    }
+    return true;
+}
+
+bool BinaryReader::decodeAminoAcids(string & text, size_t length) {
+    AminoAcidRow row;
+    if (!readAminoAcids(row, length)) {
+        return false;
+    }
+    text.assign(length, ' ');
+    for (uint64_t i = 0; i < row.count; i++) {
+        int code;
+        char letter;
+        size_t position = row.next(code, letter);
+        text[position] = code == PACKED_AA_EXCEPTION ? letter : PackedPairs::aminoAcid(code);
+    }
+    return true;
+}
+
+bool BinaryReader::decodeDna(PackedPairs::Columns & columns, size_t length) {
+    DnaRow row;
+    if (!readDna(row, length)) {
+        return false;
+    }
+    int space = PackedPairs::aminoAcidCode(' ');
+    uint16_t bases[4];
+    for (int b = 0; b < 4; b++) {
+        bases[b] = PackedPairs::pack(PackedPairs::nucleotideCode(DNA_ALPHABET[b]),
+                                     space, space, false);
+    }
+    columns.pairs.resize(length);
+    uint16_t * pairs = columns.pairs.data();
+    for (size_t i = 0; i < length; i++) {
+        pairs[i] = bases[(row.packed[i / 4] >> ((i % 4) * 2)) & 3];
+    }
+
+    // Lowercase bases are introns, so are the gaps which follow them
+    for (size_t i = 0; i < row.runs[1].size(); i++) {
+        for (size_t j = row.runs[1][i].start; j < row.runs[1][i].start + row.runs[1][i].length; j++) {
+            pairs[j] |= PACKED_INTRON_BIT;
+        }
+    }
+    uint16_t gap = PackedPairs::pack(PACKED_NUCLEOTIDE_GAP, space, space, false);
+    for (size_t i = 0; i < row.runs[0].size(); i++) {
+        const Run & run = row.runs[0][i];
+        uint16_t value = gap;
+        if (run.start > 0 && (pairs[run.start - 1] & PACKED_INTRON_BIT)) {
+            value |= PACKED_INTRON_BIT;
+        }
+        for (size_t j = run.start; j < run.start + run.length; j++) {
+            pairs[j] = value;
+        }
+    }
+    for (size_t i = 0; i < row.exceptions.size(); i++) {
+        size_t position = row.exceptions[i].first;
+        char symbol = row.exceptions[i].second;
+        int code = PackedPairs::nucleotideCode(symbol);
+        if (code == PACKED_NUCLEOTIDE_EXCEPTION) {
+            columns.nucleotideExceptions.push_back(make_pair((int) position, symbol));
+        }
+        pairs[position] = (pairs[position] & ~0x7) | code;
+    }
+    return true;
+}
+
+bool BinaryReader::decodeAminoAcids(PackedPairs::Columns & columns, size_t length,
+                                    int shift, PackedPairs::Exceptions & exceptions) {
+    AminoAcidRow row;
+    if (!readAminoAcids(row, length)) {
+        return false;
+    }
+    uint16_t * pairs = columns.pairs.data();
+    for (uint64_t i = 0; i < row.count; i++) {
+        int code;
+        char letter;
+        size_t position = row.next(code, letter);
+        if (code == PACKED_AA_EXCEPTION) {
+            exceptions.push_back(make_pair((int) position, letter));
+        }
+        pairs[position] = (pairs[position] & ~(0x1F << shift)) | code << shift;
+    }
+    return true;
+}
@@ -0,0 +1,116 @@
+#ifndef BINARY_FORMAT_H
+#define BINARY_FORMAT_H
+
+#include "Alignment.h"
+#include "PackedPairs.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdint.h>
+
+using namespace std;
+
+/// Size of the magic string at the start of binary alignment files
+#define BINARY_MAGIC_SIZE 8
+
+/**
+ * Compact binary format of pre-parsed Spaln alignments
+ *
+ * The file starts with a magic string followed by records. Each record is
+ * prefixed by its 32-bit length and contains gene and protein names,
+ * strand, alignment start positions and the three alignment rows:
+ *   - DNA bases packed in 2 bits, with runs of gaps, runs of lowercase
+ *     (intron) bases and a list of non-ACGT exceptions stored separately
+ *   - translated and protein rows reduced to their non-space symbols,
+ *     which sit in the middle of codons. The symbols are packed in 5 bits
+ *     by their PackedPairs codes and are expected 3 columns apart. Other
+ *     distances (introns, frameshifts) and symbols outside of the 5-bit
+ *     alphabet are kept in lists of exceptions.
+ * Integers are stored as variable-length (LEB128) numbers and run
+ * positions are delta-encoded. Records can be decoded either into text
+ * rows or directly into packed alignment columns.
+ */
+class BinaryWriter {
+public:
+    /**
+     * Create the binary file and write its magic string
+     * @return Whether the file was created
+     */
+    bool open(string filename);
+    /**
+     * Append a single alignment
+     */
+    void write(const Alignment::Rows & rows);
+    /**
+     * @return Whether all data were written successfully
+     */
+    bool close();
+private:
+    void encodeDna(const string & dna);
+    void encodeAminoAcids(const string & row);
+    void putNumber(uint64_t number);
+    void putString(const string & text);
+
+    ofstream ofs;
+    /// Record being encoded
+    string record;
+};
+
+/// Decoding of binary alignment files
+
+class BinaryReader {
+public:
+    /**
+     * Check whether the data start with the binary file magic string
+     */
+    static bool isBinary(const char * data, size_t length);
+    /**
+     * Check whether the data start with the magic string of an older,
+     * no longer readable version of the format
+     */
+    static bool isOutdated(const char * data, size_t length);
+    /**
+     * Find the end of a record
+     * @param position Start of the record. The first record starts right
+     *                 after the magic string.
+     * @return Start of the next record, at most LENGTH
+     */
+    static size_t recordEnd(const char * data, size_t length, size_t position);
+    /**
+     * Decode a single record (including its length prefix)
+     * @return Whether the record was decoded
+     */
+    static bool decode(const char * record, size_t length, Alignment::Rows & rows);
+    /**
+     * Decode a single record directly into packed alignment columns,
+     * without building the text rows
+     * @param rows Receives the names, strand and start positions, its
+     *             lines are left untouched
+     */
+    static bool decode(const char * record, size_t length, Alignment::Rows & rows,
+                       PackedPairs::Columns & columns);
+private:
+    struct DnaRow;
+    struct AminoAcidRow;
+
+    /**
+     * Check the length prefix of a record and read its header
+     * @param blockLength Receives the number of alignment columns
+     */
+    bool decodeHeader(const char * record, size_t length, Alignment::Rows & rows,
+                      uint64_t & blockLength);
+    bool getNumber(uint64_t & number);
+    bool getString(string & text);
+    bool readDna(DnaRow & row, size_t length);
+    bool readAminoAcids(AminoAcidRow & row, size_t length);
+    bool decodeDna(string & dna, size_t length);
+    bool decodeAminoAcids(string & row, size_t length);
+    bool decodeDna(PackedPairs::Columns & columns, size_t length);
+    bool decodeAminoAcids(PackedPairs::Columns & columns, size_t length,
+                          int shift, PackedPairs::Exceptions & exceptions);
+
+    const char * data;
+    const char * end;
+};
+
+#endif /* BINARY_FORMAT_H */
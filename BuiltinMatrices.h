@@ -0,0 +1,40 @@
+#ifndef BUILTIN_MATRICES_H
+#define BUILTIN_MATRICES_H
+
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+/// Number of amino acid symbols in built-in matrices
+#define BUILTIN_ALPHABET_SIZE 24
+/// Number of built-in matrices
+#define BUILTIN_MATRICES_CNT 8
+
+/// Substitution matrix compiled into the program
+
+/**
+ * Built-in matrices make the program start without reading and parsing
+ * a matrix file. They are selected with "builtin:NAME" in place of
+ * a matrix file name.
+ */
+struct BuiltinMatrix {
+    const char * name;
+    /// Scores indexed in the order of BUILTIN_ALPHABET
+    int8_t scores[BUILTIN_ALPHABET_SIZE][BUILTIN_ALPHABET_SIZE];
+};
+
+/// Uppercase amino acid symbols of the matrix rows and columns
+extern const char BUILTIN_ALPHABET[];
+
+/**
+ * Find a built-in matrix by its (case-insensitive) name
+ * @return The matrix or NULL if there is no such matrix
+ */
+const BuiltinMatrix * findBuiltinMatrix(string name);
+/**
+ * @return Comma separated names of all built-in matrices
+ */
+string builtinMatrixNames();
+
+#endif /* BUILTIN_MATRICES_H */
@@ -0,0 +1,58 @@
+#include "Checkpoint.h"
+#include <cstdio>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+Checkpoint::Checkpoint() {
+    inputOffset = 0;
+    alignments = 0;
+    outputLength = 0;
+    parameters = 0;
+    inputSize = 0;
+}
+
+bool Checkpoint::save(string filename) const {
+    string temporary = filename + ".tmp";
+    FILE * file = fopen(temporary.c_str(), "w");
+    if (file == NULL) {
+        cerr << "error: Could not write checkpoint \"" << temporary << "\"" << endl;
+        return false;
+    }
+
+    fprintf(file, "input_offset %llu\n", inputOffset);
+    fprintf(file, "alignments %llu\n", alignments);
+    fprintf(file, "output_length %llu\n", outputLength);
+    fprintf(file, "parameters %016llx\n", (unsigned long long) parameters);
+    fprintf(file, "input_size %llu\n", inputSize);
+
+    bool written = fflush(file) == 0 && fsync(fileno(file)) == 0;
+    written = fclose(file) == 0 && written;
+    if (!written || rename(temporary.c_str(), filename.c_str()) != 0) {
+        cerr << "error: Could not write checkpoint \"" << filename << "\"" << endl;
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Checkpoint::load(string filename) {
+    FILE * file = fopen(filename.c_str(), "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    unsigned long long hash;
+    int fields = fscanf(file, "input_offset %llu alignments %llu output_length %llu "
+                        "parameters %llx input_size %llu", &inputOffset, &alignments,
+                        &outputLength, &hash, &inputSize);
+    fclose(file);
+    parameters = hash;
+    if (fields != 5) {
+        cerr << "error: Corrupted checkpoint \"" << filename << "\"" << endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+/// Position of a run at an alignment record boundary
+
+/**
+ * A checkpoint ties the number of input bytes consumed to the length of
+ * the output written for them. Resuming a run truncates the output to
+ * the recorded length and continues reading the input at the recorded
+ * offset, which yields the same output as an uninterrupted run. The
+ * scoring parameters and the input size are recorded too, so that a run
+ * is not resumed with different options or a different input.
+ */
+class Checkpoint {
+public:
+    Checkpoint();
+    /**
+     * Atomically replace the checkpoint file with the current state.
+     * The state is written into a temporary file which is synced and
+     * renamed over the checkpoint file.
+     * @return Whether the checkpoint was saved
+     */
+    bool save(string filename) const;
+    /**
+     * Load a previously saved checkpoint
+     * @return Whether the checkpoint was loaded
+     */
+    bool load(string filename);
+
+    /// Number of input bytes processed
+    unsigned long long inputOffset;
+    /// Number of alignments processed
+    unsigned long long alignments;
+    /// Output file length corresponding to the processed input
+    unsigned long long outputLength;
+    /// Hash of the settings the output was written with
+    uint64_t parameters;
+    /// Size of the input, 0 when the input is not a regular file
+    unsigned long long inputSize;
+};
+
+#endif /* CHECKPOINT_H */
@@ -0,0 +1,476 @@
+#include "ColumnarFormat.h"
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+
+using namespace std;
+
+/// Size of the header: magic string, column count and block size
+#define COLUMNAR_HEADER_SIZE (COLUMNAR_MAGIC_SIZE + 8)
+/// Size of the trailer: footer offset and magic string
+#define COLUMNAR_TRAILER_SIZE (8 + COLUMNAR_MAGIC_SIZE)
+
+static const char * TYPE_NAMES[] = {"", "Intron", "start_codon", "CDS", "stop_codon"};
+/// Names of the score attributes, in the order of ColumnarRow::scores
+static const char * SCORE_NAMES[] = {"al_score", "LeScore", "ReScore",
+    "LeNScore", "eScore", "eNScore"};
+static const int AL_SCORE = 0, LE_SCORE = 1, RE_SCORE = 2, LE_N_SCORE = 3,
+    E_SCORE = 4, E_N_SCORE = 5;
+
+static size_t padded(size_t length) {
+    return (length + 7) & ~(size_t) 7;
+}
+
+int Columnar::width(Column column) {
+    switch (column) {
+        case TYPE: case STRAND: case FRAME: case INITIAL:
+            return 1;
+        case START: case END: case NEXT_INTRON_START: case NEXT_INTRON_END:
+        case AL_SCORE: case LE_SCORE: case RE_SCORE: case LE_N_SCORE:
+        case E_SCORE: case E_N_SCORE:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+void ColumnarRow::print(const string & contigName, const string & proteinName,
+                        ostream & output) const {
+    output << contigName << "\tSpaln_scorer\t" << TYPE_NAMES[type] << "\t";
+    output << start << "\t" << end << "\t.\t" << strand << "\t" << frame;
+    output << "\tprot=" << proteinName;
+    char spliceSitesText[] = {
+        (char) (spliceSites & 0xff), (char) ((spliceSites >> 8) & 0xff), '_',
+        (char) ((spliceSites >> 16) & 0xff), (char) (spliceSites >> 24), '\0'
+    };
+    switch (type) {
+        case COLUMNAR_TYPE_INTRON:
+            output << "; intron_id=" << id << ";";
+            output << " initial=" << (int) initial << ";";
+            output << " splice_sites=" << spliceSitesText << ";";
+            output << " al_score=" << scores[AL_SCORE] << ";";
+            output << " LeScore=" << scores[LE_SCORE] << ";";
+            output << " ReScore=" << scores[RE_SCORE] << ";";
+            output << " LeNScore=" << scores[LE_N_SCORE] << ";";
+            break;
+        case COLUMNAR_TYPE_START:
+            output << "; al_score=" << scores[AL_SCORE] << ";";
+            output << " eScore=" << scores[E_SCORE] << ";";
+            output << " eNScore=" << scores[E_N_SCORE] << ";";
+            if (nextIntronStart == COLUMNAR_NO_NEXT_INTRON) {
+                output << " nextIntron=-;";
+            } else {
+                output << " nextIntron=" << nextIntronStart << "-" << nextIntronEnd << ";";
+            }
+            break;
+        case COLUMNAR_TYPE_CDS:
+            output << "; exon_id=" << id << ";";
+            output << " initial=" << (int) initial << ";";
+            output << " eScore=" << scores[E_SCORE] << ";";
+            output << " eNScore=" << scores[E_N_SCORE] << ";";
+            break;
+        default:
+            output << "; al_score=" << scores[AL_SCORE] << ";";
+            output << " eScore=" << scores[E_SCORE] << ";";
+    }
+}
+
+/**
+ * @return COLUMNAR_TYPE_* of the hint type, COLUMNAR_TYPE_RAW if unknown
+ */
+static uint8_t typeCode(const HintLine & hint) {
+    for (uint8_t type = COLUMNAR_TYPE_INTRON; type <= COLUMNAR_TYPE_STOP; type++) {
+        if (hint.fieldLength(2) == strlen(TYPE_NAMES[type]) &&
+                strncmp(hint.field(2), TYPE_NAMES[type], hint.fieldLength(2)) == 0) {
+            return type;
+        }
+    }
+    return COLUMNAR_TYPE_RAW;
+}
+
+/**
+ * Parse a numeric attribute
+ * @return False if the attribute is missing
+ */
+static bool attributeNumber(const HintLine & hint, const char * name, double & number) {
+    const char * value;
+    size_t length;
+    if (!hint.attribute(name, value, length) || length == 0) {
+        return false;
+    }
+    number = strtod(value, NULL);
+    return true;
+}
+
+ColumnarWriter::ColumnarWriter() {
+    output = NULL;
+    offset = 0;
+    rows = 0;
+}
+
+void ColumnarWriter::start(ostream & output) {
+    this->output = &output;
+    offset = 0;
+    write(COLUMNAR_MAGIC, COLUMNAR_MAGIC_SIZE);
+    uint32_t header[] = {Columnar::COLUMN_COUNT, COLUMNAR_BLOCK_ROWS};
+    write(header, sizeof (header));
+}
+
+void ColumnarWriter::write(const void * data, size_t length) {
+    output->write((const char *) data, length);
+    offset += length;
+}
+
+void ColumnarWriter::pad() {
+    static const char zeros[8] = {0};
+    write(zeros, padded(offset) - offset);
+}
+
+uint32_t ColumnarWriter::intern(const char * text, size_t length) {
+    string name(text, length);
+    unordered_map<string, uint32_t>::iterator it = dictionaryIds.find(name);
+    if (it != dictionaryIds.end()) {
+        return it->second;
+    }
+    uint32_t id = dictionary.size();
+    dictionaryIds[name] = id;
+    dictionary.push_back(name);
+    return id;
+}
+
+bool ColumnarWriter::decompose(const char * line, size_t length) {
+    if (!hint.parse(line, length) || hint.fieldLength(6) != 1 ||
+            hint.fieldLength(7) != 1) {
+        return false;
+    }
+    row.type = typeCode(hint);
+    const char * protein;
+    size_t proteinLength;
+    if (row.type == COLUMNAR_TYPE_RAW ||
+            !hint.attribute("prot", protein, proteinLength)) {
+        return false;
+    }
+    row.strand = hint.strand();
+    row.frame = hint.frame();
+    row.start = hint.start();
+    row.end = hint.end();
+    row.initial = -1;
+    row.id = 0;
+    row.spliceSites = 0;
+    row.nextIntronStart = row.nextIntronEnd = COLUMNAR_NO_NEXT_INTRON;
+    for (int i = 0; i < 6; i++) {
+        row.scores[i] = NAN;
+    }
+
+    // Attributes which each type has, in the printed order
+    const int * scores;
+    static const int INTRON_SCORES[] = {AL_SCORE, LE_SCORE, RE_SCORE, LE_N_SCORE, -1};
+    static const int START_SCORES[] = {AL_SCORE, E_SCORE, E_N_SCORE, -1};
+    static const int CDS_SCORES[] = {E_SCORE, E_N_SCORE, -1};
+    static const int STOP_SCORES[] = {AL_SCORE, E_SCORE, -1};
+    double number;
+    const char * value;
+    size_t valueLength;
+    if (row.type == COLUMNAR_TYPE_INTRON || row.type == COLUMNAR_TYPE_CDS) {
+        const char * idName = row.type == COLUMNAR_TYPE_INTRON ? "intron_id" : "exon_id";
+        if (!attributeNumber(hint, idName, number)) {
+            return false;
+        }
+        row.id = number;
+        if (!attributeNumber(hint, "initial", number)) {
+            return false;
+        }
+        row.initial = number;
+    }
+    switch (row.type) {
+        case COLUMNAR_TYPE_INTRON:
+            if (!hint.attribute("splice_sites", value, valueLength) ||
+                    valueLength != 5 || value[2] != '_') {
+                return false;
+            }
+            row.spliceSites = (uint8_t) value[0] | (uint8_t) value[1] << 8 |
+                    (uint8_t) value[3] << 16 | (uint32_t) (uint8_t) value[4] << 24;
+            scores = INTRON_SCORES;
+            break;
+        case COLUMNAR_TYPE_START:
+            if (!hint.attribute("nextIntron", value, valueLength)) {
+                return false;
+            }
+            if (valueLength != 1 || value[0] != '-') {
+                char * end;
+                row.nextIntronStart = strtoll(value, &end, 10);
+                if (*end != '-') {
+                    return false;
+                }
+                row.nextIntronEnd = strtoll(end + 1, NULL, 10);
+            }
+            scores = START_SCORES;
+            break;
+        case COLUMNAR_TYPE_CDS:
+            scores = CDS_SCORES;
+            break;
+        default:
+            scores = STOP_SCORES;
+    }
+    for (int i = 0; scores[i] != -1; i++) {
+        if (!attributeNumber(hint, SCORE_NAMES[scores[i]], row.scores[scores[i]])) {
+            return false;
+        }
+    }
+
+    // The line is stored decomposed only if it can be printed back exactly
+    string contigName(hint.field(0), hint.fieldLength(0));
+    string proteinName(protein, proteinLength);
+    rendered.str("");
+    row.print(contigName, proteinName, rendered);
+    const string & text = rendered.str();
+    if (text.size() > length || memcmp(text.data(), line, text.size()) != 0) {
+        return false;
+    }
+    row.contig = intern(contigName.data(), contigName.size());
+    row.protein = intern(proteinName.data(), proteinName.size());
+    row.extra = 0;
+    if (text.size() < length) {
+        row.extra = intern(line + text.size(), length - text.size()) + 1;
+    }
+    row.raw = 0;
+    return true;
+}
+
+void ColumnarWriter::line(const char * line, size_t length) {
+    if (!decompose(line, length)) {
+        // Raw lines still have the columns which can be parsed, so that
+        // they can be filtered by coordinates
+        memset(&row, 0, sizeof (row));
+        for (int i = 0; i < 6; i++) {
+            row.scores[i] = NAN;
+        }
+        row.initial = -1;
+        row.nextIntronStart = row.nextIntronEnd = COLUMNAR_NO_NEXT_INTRON;
+        if (hint.parse(line, length)) {
+            row.contig = intern(hint.field(0), hint.fieldLength(0));
+            row.type = typeCode(hint);
+            row.strand = hint.strand();
+            row.frame = hint.frame();
+            row.start = hint.start();
+            row.end = hint.end();
+        }
+        row.raw = intern(line, length) + 1;
+    }
+    append(row);
+}
+
+void ColumnarWriter::append(const ColumnarRow & row) {
+    const void * values[] = {
+        &row.contig, &row.protein, &row.type, &row.strand, &row.frame,
+        &row.initial, &row.start, &row.end, &row.nextIntronStart,
+        &row.nextIntronEnd, &row.id, &row.spliceSites,
+        &row.scores[AL_SCORE], &row.scores[LE_SCORE], &row.scores[RE_SCORE],
+        &row.scores[LE_N_SCORE], &row.scores[E_SCORE], &row.scores[E_N_SCORE],
+        &row.extra, &row.raw
+    };
+    for (int i = 0; i < Columnar::COLUMN_COUNT; i++) {
+        const char * bytes = (const char *) values[i];
+        columns[i].insert(columns[i].end(), bytes,
+                          bytes + Columnar::width((Columnar::Column) i));
+    }
+    rows++;
+    if (rows == COLUMNAR_BLOCK_ROWS) {
+        writeBlock();
+    }
+}
+
+void ColumnarWriter::writeBlock() {
+    if (rows == 0) {
+        return;
+    }
+    blockRows.push_back(rows);
+    for (int i = 0; i < Columnar::COLUMN_COUNT; i++) {
+        blockOffsets.push_back(offset);
+        write(columns[i].data(), columns[i].size());
+        pad();
+        columns[i].clear();
+    }
+    rows = 0;
+}
+
+bool ColumnarWriter::finish() {
+    writeBlock();
+    uint64_t footerOffset = offset;
+    uint64_t count = dictionary.size();
+    write(&count, sizeof (count));
+    for (unsigned int i = 0; i < dictionary.size(); i++) {
+        uint32_t length = dictionary[i].size();
+        write(&length, sizeof (length));
+        write(dictionary[i].data(), length);
+    }
+    pad();
+    count = blockRows.size();
+    write(&count, sizeof (count));
+    for (unsigned int i = 0; i < blockRows.size(); i++) {
+        uint32_t rows[] = {blockRows[i], 0};
+        write(rows, sizeof (rows));
+        write(&blockOffsets[i * Columnar::COLUMN_COUNT],
+              Columnar::COLUMN_COUNT * sizeof (uint64_t));
+    }
+    write(&footerOffset, sizeof (footerOffset));
+    write(COLUMNAR_MAGIC, COLUMNAR_MAGIC_SIZE);
+    output->flush();
+    return output->good();
+}
+
+bool ColumnarReader::isColumnar(const char * data, size_t length) {
+    return length >= COLUMNAR_MAGIC_SIZE &&
+            memcmp(data, COLUMNAR_MAGIC, COLUMNAR_MAGIC_SIZE) == 0;
+}
+
+bool ColumnarReader::open(string filename) {
+    dictionary.clear();
+    blockRows.clear();
+    blockOffsets.clear();
+    if (!file.map(filename)) {
+        return false;
+    }
+    const char * data = file.data();
+    size_t size = file.size();
+    uint32_t header[2];
+    if (size < COLUMNAR_HEADER_SIZE + COLUMNAR_TRAILER_SIZE ||
+            !isColumnar(data, size) ||
+            !isColumnar(data + size - COLUMNAR_MAGIC_SIZE, COLUMNAR_MAGIC_SIZE)) {
+        return false;
+    }
+    memcpy(header, data + COLUMNAR_MAGIC_SIZE, sizeof (header));
+    if (header[0] != Columnar::COLUMN_COUNT) {
+        return false;
+    }
+
+    // Footer, every read is checked against its end
+    uint64_t position;
+    size_t footerEnd = size - COLUMNAR_TRAILER_SIZE;
+    memcpy(&position, data + footerEnd, sizeof (position));
+    uint64_t count;
+    if (position < COLUMNAR_HEADER_SIZE || position > footerEnd - sizeof (count)) {
+        return false;
+    }
+    memcpy(&count, data + position, sizeof (count));
+    position += sizeof (count);
+    for (uint64_t i = 0; i < count; i++) {
+        uint32_t length;
+        if (footerEnd - position < sizeof (length)) {
+            return false;
+        }
+        memcpy(&length, data + position, sizeof (length));
+        position += sizeof (length);
+        if (footerEnd - position < length) {
+            return false;
+        }
+        dictionary.push_back(string(data + position, length));
+        position += length;
+    }
+    position = padded(position);
+    if (position > footerEnd || footerEnd - position < sizeof (count)) {
+        return false;
+    }
+    memcpy(&count, data + position, sizeof (count));
+    position += sizeof (count);
+    size_t entry = 8 + Columnar::COLUMN_COUNT * sizeof (uint64_t);
+    if ((footerEnd - position) / entry < count) {
+        return false;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        uint32_t rows;
+        memcpy(&rows, data + position, sizeof (rows));
+        blockRows.push_back(rows);
+        position += 8;
+        for (int j = 0; j < Columnar::COLUMN_COUNT; j++) {
+            uint64_t columnOffset;
+            memcpy(&columnOffset, data + position, sizeof (columnOffset));
+            position += sizeof (columnOffset);
+            uint64_t columnLength = (uint64_t) rows * Columnar::width((Columnar::Column) j);
+            if (columnOffset % 8 != 0 || columnOffset > footerEnd ||
+                    footerEnd - columnOffset < columnLength) {
+                return false;
+            }
+            blockOffsets.push_back(columnOffset);
+        }
+    }
+
+    // Dictionary IDs are checked once so that rows can be printed unchecked
+    for (size_t block = 0; block < blockRows.size(); block++) {
+        const uint32_t * ids[] = {
+            values<uint32_t>(block, Columnar::CONTIG),
+            values<uint32_t>(block, Columnar::PROTEIN),
+            values<uint32_t>(block, Columnar::EXTRA),
+            values<uint32_t>(block, Columnar::RAW)
+        };
+        const uint8_t * types = values<uint8_t>(block, Columnar::TYPE);
+        for (uint32_t row = 0; row < blockRows[block]; row++) {
+            if (ids[0][row] >= dictionary.size() ||
+                    ids[2][row] > dictionary.size() || ids[3][row] > dictionary.size() ||
+                    types[row] > COLUMNAR_TYPE_STOP ||
+                    (types[row] == COLUMNAR_TYPE_RAW && ids[3][row] == 0) ||
+                    (ids[3][row] == 0 && ids[1][row] >= dictionary.size())) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+size_t ColumnarReader::blockCount() const {
+    return blockRows.size();
+}
+
+uint32_t ColumnarReader::rows(size_t block) const {
+    return blockRows[block];
+}
+
+const void * ColumnarReader::column(size_t block, Columnar::Column column) const {
+    return file.data() + blockOffsets[block * Columnar::COLUMN_COUNT + column];
+}
+
+const string & ColumnarReader::name(uint32_t id) const {
+    return dictionary[id];
+}
+
+void ColumnarReader::row(size_t block, uint32_t index, ColumnarRow & row) const {
+    row.contig = values<uint32_t>(block, Columnar::CONTIG)[index];
+    row.protein = values<uint32_t>(block, Columnar::PROTEIN)[index];
+    row.type = values<uint8_t>(block, Columnar::TYPE)[index];
+    row.strand = values<char>(block, Columnar::STRAND)[index];
+    row.frame = values<char>(block, Columnar::FRAME)[index];
+    row.initial = values<int8_t>(block, Columnar::INITIAL)[index];
+    row.start = values<int64_t>(block, Columnar::START)[index];
+    row.end = values<int64_t>(block, Columnar::END)[index];
+    row.nextIntronStart = values<int64_t>(block, Columnar::NEXT_INTRON_START)[index];
+    row.nextIntronEnd = values<int64_t>(block, Columnar::NEXT_INTRON_END)[index];
+    row.id = values<uint32_t>(block, Columnar::ID)[index];
+    row.spliceSites = values<uint32_t>(block, Columnar::SPLICE_SITES)[index];
+    for (int i = 0; i < 6; i++) {
+        row.scores[i] = values<double>(block, (Columnar::Column) (Columnar::AL_SCORE + i))[index];
+    }
+    row.extra = values<uint32_t>(block, Columnar::EXTRA)[index];
+    row.raw = values<uint32_t>(block, Columnar::RAW)[index];
+}
+
+void ColumnarReader::print(size_t block, uint32_t index, ostream & output) const {
+    ColumnarRow values;
+    row(block, index, values);
+    if (values.raw != 0) {
+        output << dictionary[values.raw - 1] << "\n";
+        return;
+    }
+    values.print(dictionary[values.contig], dictionary[values.protein], output);
+    if (values.extra != 0) {
+        output << dictionary[values.extra - 1];
+    }
+    output << "\n";
+}
+
+void ColumnarReader::dump(ostream & output) const {
+    for (size_t block = 0; block < blockRows.size(); block++) {
+        for (uint32_t row = 0; row < blockRows[block]; row++) {
+            print(block, row, output);
+        }
+    }
+}
@@ -0,0 +1,189 @@
+#ifndef COLUMNAR_FORMAT_H
+#define COLUMNAR_FORMAT_H
+
+#include "MappedFile.h"
+#include "HintLine.h"
+#include <string>
+#include <vector>
+#include <ostream>
+#include <unordered_map>
+#include <sstream>
+#include <stdint.h>
+
+using namespace std;
+
+/// Magic string at the start and at the end of columnar hint files
+#define COLUMNAR_MAGIC "SPHCOL01"
+#define COLUMNAR_MAGIC_SIZE 8
+/// Number of hints in a block of columns
+#define COLUMNAR_BLOCK_ROWS 65536
+
+/// Hint types of the TYPE column. Lines which do not have the layout
+/// printed by Alignment (e.g. aggregated hints) are stored whole in the RAW
+/// column, with only the contig, type, coordinates, strand and frame
+/// columns filled in.
+#define COLUMNAR_TYPE_RAW 0
+#define COLUMNAR_TYPE_INTRON 1
+#define COLUMNAR_TYPE_START 2
+#define COLUMNAR_TYPE_CDS 3
+#define COLUMNAR_TYPE_STOP 4
+
+/// Value of the NEXT_INTRON columns of starts printed with "nextIntron=-"
+#define COLUMNAR_NO_NEXT_INTRON INT64_MIN
+
+/**
+ * Columnar binary format of scored hints
+ *
+ * The header holds the magic string, the number of columns and the maximum
+ * number of rows in a block. Hints are stored in blocks of up to
+ * COLUMNAR_BLOCK_ROWS rows. A block holds one fixed-width little-endian
+ * array per column, each aligned to 8 bytes, so a mapped file can be
+ * scanned and filtered column by column without any text parsing. Names (contigs, proteins, extra attributes and
+ * raw lines) are dictionary IDs. The footer holds the dictionary and the
+ * offsets of all columns, and ends with the offset of the footer and the
+ * magic string.
+ *
+ * Scores which the hint does not have are NaN, IDs and splice sites which
+ * the hint does not have are 0. Splice sites are the four letters of the
+ * donor and acceptor, donor first in the lowest byte.
+ */
+class Columnar {
+public:
+    enum Column {
+        /// uint32_t dictionary IDs
+        CONTIG, PROTEIN,
+        /// uint8_t COLUMNAR_TYPE_*, strand and frame characters, int8_t
+        /// initial flag (-1 if missing)
+        TYPE, STRAND, FRAME, INITIAL,
+        /// int64_t coordinates and the offsets of the next intron of starts
+        START, END, NEXT_INTRON_START, NEXT_INTRON_END,
+        /// uint32_t intron_id or exon_id, splice sites
+        ID, SPLICE_SITES,
+        /// double scores
+        AL_SCORE, LE_SCORE, RE_SCORE, LE_N_SCORE, E_SCORE, E_N_SCORE,
+        /// uint32_t dictionary IDs + 1 of attributes appended after the
+        /// standard ones and of whole raw lines, 0 if none
+        EXTRA, RAW,
+        COLUMN_COUNT
+    };
+
+    /**
+     * @return Width of the values of a column in bytes
+     */
+    static int width(Column column);
+};
+
+/// Values of one hint, in the units of the columns
+
+struct ColumnarRow {
+    uint32_t contig, protein;
+    uint8_t type;
+    char strand, frame;
+    int8_t initial;
+    int64_t start, end, nextIntronStart, nextIntronEnd;
+    uint32_t id, spliceSites;
+    /// al_score, LeScore, ReScore, LeNScore, eScore and eNScore
+    double scores[6];
+    uint32_t extra, raw;
+
+    /**
+     * Print the hint without the extra attributes and the newline, exactly
+     * as Alignment prints it
+     */
+    void print(const string & contigName, const string & proteinName,
+               ostream & output) const;
+};
+
+/// Converts hint lines into the columnar format
+
+class ColumnarWriter : public LineListener {
+public:
+    ColumnarWriter();
+    /**
+     * Write the header into a binary output
+     */
+    void start(ostream & output);
+    /**
+     * Add a hint line without the trailing newline
+     */
+    void line(const char * line, size_t length);
+    /**
+     * Write the last block and the footer
+     * @return Whether all data were written successfully
+     */
+    bool finish();
+private:
+    /**
+     * Decompose a line into the columns of the current row
+     * @return False if the line does not have the layout printed by
+     *         Alignment and has to be stored raw
+     */
+    bool decompose(const char * line, size_t length);
+    void append(const ColumnarRow & row);
+    void writeBlock();
+    uint32_t intern(const char * text, size_t length);
+    void write(const void * data, size_t length);
+    void pad();
+
+    ostream * output;
+    /// Bytes written so far
+    uint64_t offset;
+    /// Columns of the block being filled
+    vector<char> columns[Columnar::COLUMN_COUNT];
+    uint32_t rows;
+    /// Column offsets of all written blocks
+    vector<uint64_t> blockOffsets;
+    vector<uint32_t> blockRows;
+    vector<string> dictionary;
+    unordered_map<string, uint32_t> dictionaryIds;
+    HintLine hint;
+    ColumnarRow row;
+    /// Decomposed line rendered back, to check that nothing was lost
+    ostringstream rendered;
+};
+
+/// Reader of memory-mapped columnar hint files
+
+class ColumnarReader {
+public:
+    /**
+     * Map the file and check its footer
+     * @return Whether the file is a valid columnar file
+     */
+    bool open(string filename);
+    /**
+     * Check whether the data start with the columnar magic string
+     */
+    static bool isColumnar(const char * data, size_t length);
+    size_t blockCount() const;
+    uint32_t rows(size_t block) const;
+    /**
+     * @return Values of a column in a block, see Columnar::Column for the
+     *         types
+     */
+    const void * column(size_t block, Columnar::Column column) const;
+    template<class T> const T * values(size_t block, Columnar::Column column) const {
+        return (const T *) this->column(block, column);
+    }
+    const string & name(uint32_t id) const;
+    /**
+     * Read all values of a hint
+     */
+    void row(size_t block, uint32_t index, ColumnarRow & row) const;
+    /**
+     * Print a hint as the GFF line which it was converted from
+     */
+    void print(size_t block, uint32_t index, ostream & output) const;
+    /**
+     * Print all hints in the GFF format
+     */
+    void dump(ostream & output) const;
+private:
+    MappedFile file;
+    vector<string> dictionary;
+    vector<uint32_t> blockRows;
+    /// COLUMN_COUNT offsets per block
+    vector<uint64_t> blockOffsets;
+};
+
+#endif /* COLUMNAR_FORMAT_H */
@@ -0,0 +1,291 @@
+#include "CompressedOutput.h"
+#include "AsyncFile.h"
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <stdint.h>
+
+using namespace std;
+
+/// Gzip member header with the BGZF extra field, without the block size
+static const unsigned char BGZF_HEADER[] = {
+    0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0
+};
+/// Header including the block size, and the CRC and size trailer
+#define BGZF_HEADER_SIZE 18
+#define BGZF_TRAILER_SIZE 8
+/// Empty block marking the end of a BGZF file
+static const unsigned char BGZF_EOF[] = {
+    0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0,
+    0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static void putLittleEndian(char * data, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        data[i] = (char) (value >> (8 * i));
+    }
+}
+
+static bool writeAll(int fd, const char * data, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t bytes = write(fd, data + done, length - done);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            return false;
+        }
+        done += bytes;
+    }
+    return true;
+}
+
+bool compressedName(const string & filename) {
+    const char * suffixes[] = {".gz", ".bgz"};
+    for (int i = 0; i < 2; i++) {
+        size_t length = strlen(suffixes[i]);
+        if (filename.size() > length &&
+                filename.compare(filename.size() - length, length, suffixes[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+CompressedWriteBuffer::CompressedWriteBuffer() {
+    fd = -1;
+    current = 0;
+    nextCompressed = 0;
+    nextWritten = 0;
+    submitted = 0;
+    written = 0;
+    stopping = false;
+    error = false;
+    pipeClosed = false;
+}
+
+CompressedWriteBuffer::~CompressedWriteBuffer() {
+    close();
+}
+
+bool CompressedWriteBuffer::open(string filename, int threads) {
+    if (filename == STANDARD_OUTPUT) {
+        fd = dup(STDOUT_FILENO);
+    } else {
+        fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    }
+    if (fd < 0) {
+        return false;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    // Every thread can compress a batch while others wait to be written
+    // and one is filled
+    batches.resize(2 * threads + 1);
+    for (unsigned int i = 0; i < batches.size(); i++) {
+        batches[i].state = Batch::FREE;
+        batches[i].data.resize(COMPRESSED_BATCH);
+        batches[i].length = 0;
+    }
+    current = 0;
+    nextCompressed = 0;
+    nextWritten = 0;
+    submitted = 0;
+    written = 0;
+    stopping = false;
+    error = false;
+    pipeClosed = false;
+    setp(batches[0].data.data(), batches[0].data.data() + COMPRESSED_BATCH);
+    for (int i = 0; i < threads; i++) {
+        compressors.push_back(thread(&CompressedWriteBuffer::compressBatches, this));
+    }
+    writer = thread(&CompressedWriteBuffer::writeBatches, this);
+    return true;
+}
+
+bool CompressedWriteBuffer::close() {
+    if (fd < 0) {
+        return true;
+    }
+    sync();
+    {
+        unique_lock<mutex> guard(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    for (unsigned int i = 0; i < compressors.size(); i++) {
+        compressors[i].join();
+    }
+    compressors.clear();
+    writer.join();
+    if (!error && !writeAll(fd, (const char *) BGZF_EOF, sizeof (BGZF_EOF))) {
+        pipeClosed = errno == EPIPE;
+        error = true;
+    }
+    if (::close(fd) != 0) {
+        error = true;
+    }
+    fd = -1;
+    setp(NULL, NULL);
+    return !error;
+}
+
+bool CompressedWriteBuffer::submit() {
+    size_t length = pptr() - pbase();
+    unique_lock<mutex> guard(lock);
+    if (length > 0) {
+        batches[current].length = length;
+        batches[current].state = Batch::FILLED;
+        submitted++;
+        changed.notify_all();
+        current = (current + 1) % batches.size();
+        while (batches[current].state != Batch::FREE && !error) {
+            changed.wait(guard);
+        }
+        char * data = batches[current].data.data();
+        setp(data, data + COMPRESSED_BATCH);
+    }
+    return !error;
+}
+
+void CompressedWriteBuffer::drain() {
+    unique_lock<mutex> guard(lock);
+    while (written < submitted && !error) {
+        changed.wait(guard);
+    }
+}
+
+int CompressedWriteBuffer::overflow(int c) {
+    if (fd < 0 || !submit()) {
+        return EOF;
+    }
+    if (c != EOF) {
+        *pptr() = (char) c;
+        pbump(1);
+    }
+    return c == EOF ? 0 : c;
+}
+
+int CompressedWriteBuffer::sync() {
+    if (fd < 0) {
+        return 0;
+    }
+    submit();
+    drain();
+    return error ? -1 : 0;
+}
+
+void CompressedWriteBuffer::compressBatches() {
+    z_stream stream;
+    memset(&stream, 0, sizeof (stream));
+    // Raw deflate, the gzip framing of the blocks is written here
+    bool initialized = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                                    -15, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    size_t blockBound = BGZF_HEADER_SIZE + deflateBound(&stream, BGZF_BLOCK_INPUT) +
+            BGZF_TRAILER_SIZE;
+    while (true) {
+        unique_lock<mutex> guard(lock);
+        while (batches[nextCompressed].state != Batch::FILLED && !stopping) {
+            changed.wait(guard);
+        }
+        if (batches[nextCompressed].state != Batch::FILLED) {
+            break;
+        }
+        Batch & batch = batches[nextCompressed];
+        nextCompressed = (nextCompressed + 1) % batches.size();
+        guard.unlock();
+
+        bool failed = !initialized;
+        size_t blocks = (batch.length + BGZF_BLOCK_INPUT - 1) / BGZF_BLOCK_INPUT;
+        batch.compressed.resize(blocks * blockBound);
+        size_t length = 0;
+        for (size_t start = 0; start < batch.length && !failed; start += BGZF_BLOCK_INPUT) {
+            size_t input = min((size_t) BGZF_BLOCK_INPUT, batch.length - start);
+            char * block = batch.compressed.data() + length;
+            deflateReset(&stream);
+            stream.next_in = (Bytef *) batch.data.data() + start;
+            stream.avail_in = input;
+            stream.next_out = (Bytef *) block + BGZF_HEADER_SIZE;
+            stream.avail_out = blockBound - BGZF_HEADER_SIZE - BGZF_TRAILER_SIZE;
+            if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+                failed = true;
+                break;
+            }
+            size_t blockSize = BGZF_HEADER_SIZE + stream.total_out + BGZF_TRAILER_SIZE;
+            memcpy(block, BGZF_HEADER, sizeof (BGZF_HEADER));
+            putLittleEndian(block + sizeof (BGZF_HEADER), blockSize - 1, 2);
+            uLong crc = crc32(0L, (const Bytef *) batch.data.data() + start, input);
+            putLittleEndian(block + blockSize - BGZF_TRAILER_SIZE, crc, 4);
+            putLittleEndian(block + blockSize - 4, input, 4);
+            length += blockSize;
+        }
+        batch.compressed.resize(length);
+
+        guard.lock();
+        if (failed) {
+            error = true;
+        }
+        batch.state = Batch::COMPRESSED;
+        changed.notify_all();
+    }
+    if (initialized) {
+        deflateEnd(&stream);
+    }
+}
+
+void CompressedWriteBuffer::writeBatches() {
+    while (true) {
+        unique_lock<mutex> guard(lock);
+        while (batches[nextWritten].state != Batch::COMPRESSED && !stopping) {
+            changed.wait(guard);
+        }
+        if (batches[nextWritten].state != Batch::COMPRESSED) {
+            break;
+        }
+        Batch & batch = batches[nextWritten];
+        guard.unlock();
+
+        bool failed = error || !writeAll(fd, batch.compressed.data(), batch.compressed.size());
+        if (failed && errno == EPIPE) {
+            pipeClosed = true;
+        }
+
+        guard.lock();
+        if (failed) {
+            error = true;
+        }
+        batch.state = Batch::FREE;
+        nextWritten = (nextWritten + 1) % batches.size();
+        written++;
+        changed.notify_all();
+    }
+}
+
+bool CompressedWriteBuffer::broken() const {
+    return pipeClosed;
+}
+
+CompressedOutputStream::CompressedOutputStream() : ostream(NULL) {
+    rdbuf(&buffer);
+}
+
+bool CompressedOutputStream::open(string filename, int threads) {
+    if (!buffer.open(filename, threads)) {
+        setstate(failbit);
+        return false;
+    }
+    return true;
+}
+
+bool CompressedOutputStream::close() {
+    flush();
+    return buffer.close();
+}
+
+bool CompressedOutputStream::broken() const {
+    return buffer.broken();
+}
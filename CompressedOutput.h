@@ -0,0 +1,122 @@
+#ifndef COMPRESSED_OUTPUT_H
+#define COMPRESSED_OUTPUT_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+/// Maximum uncompressed size of a BGZF block, so that the compressed
+/// block always fits into 64 KB
+#define BGZF_BLOCK_INPUT 0xff00
+/// Uncompressed data handed to a compression thread at once
+#define COMPRESSED_BATCH (16 * BGZF_BLOCK_INPUT)
+
+/// Compression of output files
+#define COMPRESSION_AUTO 0
+#define COMPRESSION_NONE 1
+#define COMPRESSION_BGZF 2
+
+/**
+ * @return Whether a file with this name is compressed with the
+ *         COMPRESSION_AUTO setting (it ends with ".gz" or ".bgz")
+ */
+bool compressedName(const string & filename);
+
+/// Stream buffer compressing its data into BGZF on several threads
+
+/**
+ * The data are cut into batches of COMPRESSED_BATCH bytes, which are
+ * compressed by a pool of threads into independent BGZF blocks (gzip
+ * members with the block size in an extra field) and written in order by
+ * a dedicated thread. The output is a valid gzip file and, when the hints
+ * are sorted, it can be indexed by tabix. The file ends with the BGZF end
+ * of file block.
+ */
+class CompressedWriteBuffer : public streambuf {
+public:
+    CompressedWriteBuffer();
+    ~CompressedWriteBuffer();
+    /**
+     * Create the output file and start the threads
+     * @param filename Output file, or STANDARD_OUTPUT
+     * @param threads  Number of compression threads
+     * @return Whether the file was created
+     */
+    bool open(string filename, int threads);
+    /**
+     * Compress and write all data, write the end of file block and stop
+     * the threads
+     * @return Whether all data were written
+     */
+    bool close();
+    /**
+     * @return Whether writing failed because the reading end of the output
+     *         pipe was closed
+     */
+    bool broken() const;
+protected:
+    int overflow(int c);
+    /**
+     * Compress and write the buffered data. The data are cut into a BGZF
+     * block early.
+     */
+    int sync();
+private:
+    struct Batch {
+        enum State {FREE, FILLED, COMPRESSED};
+        State state;
+        vector<char> data;
+        size_t length;
+        vector<char> compressed;
+    };
+
+    /**
+     * Pass the current batch to the compression threads and take the next
+     * free one
+     */
+    bool submit();
+    void compressBatches();
+    void writeBatches();
+    /**
+     * Wait until all submitted batches are written
+     */
+    void drain();
+
+    int fd;
+    vector<Batch> batches;
+    /// Batch being filled
+    size_t current;
+    /// Next batch to compress and to write
+    size_t nextCompressed;
+    size_t nextWritten;
+    /// Number of submitted and written batches
+    unsigned long long submitted;
+    unsigned long long written;
+    bool stopping;
+    bool error;
+    atomic<bool> pipeClosed;
+    mutex lock;
+    condition_variable changed;
+    vector<thread> compressors;
+    thread writer;
+};
+
+/// Output stream compressed into BGZF on several threads
+
+class CompressedOutputStream : public ostream {
+public:
+    CompressedOutputStream();
+    bool open(string filename, int threads);
+    bool close();
+    bool broken() const;
+private:
+    CompressedWriteBuffer buffer;
+};
+
+#endif /* COMPRESSED_OUTPUT_H */
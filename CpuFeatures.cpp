@@ -0,0 +1,68 @@
+#include "CpuFeatures.h"
+
+static const SimdKernels * const VARIANTS[SIMD_LEVELS] = {
+    &GENERIC_KERNELS,
+    &AVX2_KERNELS,
+    &AVX512_KERNELS
+};
+
+const SimdKernels * CpuFeatures::selected = VARIANTS[CpuFeatures::detect()];
+
+int CpuFeatures::detect() {
+    // May run before constructors of the runtime library
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return SIMD_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SIMD_AVX2;
+    }
+    return SIMD_GENERIC;
+}
+
+bool CpuFeatures::supports(int level) {
+    return level >= 0 && level <= detect();
+}
+
+bool CpuFeatures::select(int level) {
+    if (!supports(level)) {
+        return false;
+    }
+    selected = VARIANTS[level];
+    return true;
+}
+
+int CpuFeatures::level(string name) {
+    for (int i = 0; i < SIMD_LEVELS; i++) {
+        if (name == VARIANTS[i]->name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void CpuFeatures::print(ostream & os) {
+    __builtin_cpu_init();
+    os << "cpu features:";
+    // __builtin_cpu_supports only accepts string literals
+#define PRINT_FEATURE(feature) \
+    if (__builtin_cpu_supports(feature)) { \
+        os << " " << feature; \
+    }
+    PRINT_FEATURE("sse4.2");
+    PRINT_FEATURE("popcnt");
+    PRINT_FEATURE("avx");
+    PRINT_FEATURE("avx2");
+    PRINT_FEATURE("fma");
+    PRINT_FEATURE("bmi2");
+    PRINT_FEATURE("avx512f");
+    PRINT_FEATURE("avx512bw");
+#undef PRINT_FEATURE
+    os << endl;
+    os << "supported kernels:";
+    for (int i = 0; i <= detect(); i++) {
+        os << " " << VARIANTS[i]->name;
+    }
+    os << endl;
+    os << "selected kernels: " << selected->name << endl;
+}
@@ -0,0 +1,57 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#include <ostream>
+#include <string>
+#include "SimdKernels.h"
+
+using namespace std;
+
+#define SIMD_GENERIC 0
+#define SIMD_AVX2 1
+#define SIMD_AVX512 2
+/// Number of kernel variants
+#define SIMD_LEVELS 3
+
+/// Runtime selection of the SimdKernels variant
+
+/**
+ * The best variant supported by the CPU is selected at startup. A different
+ * (supported) variant can be forced before any worker threads are started.
+ */
+class CpuFeatures {
+public:
+    /**
+     * @return Best kernel level supported by the CPU and operating system
+     */
+    static int detect();
+    /**
+     * @return Whether the CPU supports kernels of the given level
+     */
+    static bool supports(int level);
+    /**
+     * Use kernels of the given level
+     * @return False if the level is not supported, the selection is
+     *         not changed in that case
+     */
+    static bool select(int level);
+    /**
+     * @return Kernel level for a name ("generic", "avx2" or "avx512"),
+     *         -1 for unknown names
+     */
+    static int level(string name);
+    /**
+     * @return Currently selected kernels
+     */
+    static const SimdKernels * kernels() {
+        return selected;
+    }
+    /**
+     * Print detected CPU features and the selected kernels
+     */
+    static void print(ostream & os);
+private:
+    static const SimdKernels * selected;
+};
+
+#endif /* CPU_FEATURES_H */
@@ -0,0 +1,41 @@
+#include "Hash.h"
+#include <cstring>
+
+uint64_t hash64(const void * data, size_t length, uint64_t seed) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    const unsigned char * bytes = (const unsigned char *) data;
+    const unsigned char * end = bytes + (length / 8) * 8;
+    uint64_t h = seed ^ (length * m);
+
+    while (bytes != end) {
+        uint64_t k;
+        memcpy(&k, bytes, 8);
+        bytes += 8;
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+
+    switch (length & 7) {
+        case 7: h ^= uint64_t(bytes[6]) << 48;
+        case 6: h ^= uint64_t(bytes[5]) << 40;
+        case 5: h ^= uint64_t(bytes[4]) << 32;
+        case 4: h ^= uint64_t(bytes[3]) << 24;
+        case 3: h ^= uint64_t(bytes[2]) << 16;
+        case 2: h ^= uint64_t(bytes[1]) << 8;
+        case 1: h ^= uint64_t(bytes[0]);
+            h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+uint64_t hashCombine(uint64_t hash, uint64_t value) {
+    return hash64(&value, sizeof (value), hash);
+}
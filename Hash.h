@@ -0,0 +1,20 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * Fast non-cryptographic 64-bit hash of a memory range (MurmurHash64A)
+ * @param data   Hashed data
+ * @param length Number of bytes to hash
+ * @param seed   Hash seed, different seeds give independent hashes
+ */
+uint64_t hash64(const void * data, size_t length, uint64_t seed);
+
+/**
+ * Combine a hash with another 64-bit value
+ */
+uint64_t hashCombine(uint64_t hash, uint64_t value);
+
+#endif /* HASH_H */
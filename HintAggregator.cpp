@@ -0,0 +1,403 @@
+#include "HintAggregator.h"
+#include "Hash.h"
+#include "HintLine.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/// Initial number of slots of the hash table
+#define AGGREGATE_INITIAL_SLOTS 1024
+/// Buffer of the run files
+#define AGGREGATE_RUN_BUFFER (1024 * 1024)
+
+HintAggregator::HintAggregator() {
+    reducers = AGGREGATE_COUNT;
+    memoryLimit = 0;
+    lastContig = -1;
+    error = false;
+    clearTable();
+}
+
+HintAggregator::~HintAggregator() {
+    for (unsigned int i = 0; i < runs.size(); i++) {
+        remove(runs[i].c_str());
+    }
+}
+
+void HintAggregator::setup(int reducers, unsigned long long memoryLimit,
+                           string runPrefix) {
+    this->reducers = reducers;
+    this->memoryLimit = memoryLimit;
+    this->runPrefix = runPrefix;
+}
+
+int HintAggregator::parseReducers(string list) {
+    int result = 0;
+    stringstream stream(list);
+    string name;
+    while (getline(stream, name, ',')) {
+        if (name == "count") {
+            result |= AGGREGATE_COUNT;
+        } else if (name == "max") {
+            result |= AGGREGATE_MAX;
+        } else if (name == "mean") {
+            result |= AGGREGATE_MEAN;
+        } else if (name == "proteins") {
+            result |= AGGREGATE_PROTEINS;
+        } else {
+            return 0;
+        }
+    }
+    return result;
+}
+
+int HintAggregator::spills() const {
+    return runs.size();
+}
+
+bool HintAggregator::add(const char * line, size_t length) {
+    HintLine fields;
+    if (!fields.parse(line, length)) {
+        return false;
+    }
+
+    Entry hint;
+    if (lastContig < 0 || contigs[lastContig].size() != fields.fieldLength(0) ||
+            memcmp(contigs[lastContig].data(), fields.field(0), fields.fieldLength(0)) != 0) {
+        lastContig = intern(fields.field(0), fields.fieldLength(0), contigs, contigIndices);
+    }
+    hint.contig = lastContig;
+    hint.type = intern(fields.field(2), fields.fieldLength(2), types, typeIndices);
+    hint.start = fields.start();
+    hint.end = fields.end();
+    hint.strand = fields.strand();
+    hint.frame = fields.frame();
+
+    Entry & entry = find(hint);
+    entry.count++;
+    double score;
+    const char * scoreName;
+    if (fields.score(score, &scoreName)) {
+        entry.exonScore = strcmp(scoreName, "eScore") == 0;
+        if (entry.scored == 0 || score > entry.maxScore) {
+            entry.maxScore = score;
+        }
+        entry.scoreSum += score;
+        entry.scored++;
+    }
+    const char * value;
+    size_t valueLength;
+    if ((reducers & AGGREGATE_PROTEINS) &&
+            fields.attribute("prot", value, valueLength)) {
+        size_t capacity = entry.proteins.capacity();
+        if (!entry.proteins.empty()) {
+            entry.proteins.push_back(',');
+        }
+        entry.proteins.append(value, valueLength);
+        memoryUsed += entry.proteins.capacity() - capacity;
+    }
+
+    if (memoryLimit > 0 && memoryUsed > memoryLimit && !spill()) {
+        error = true;
+    }
+    return true;
+}
+
+void HintAggregator::line(const char * line, size_t length) {
+    add(line, length);
+}
+
+int HintAggregator::intern(const char * name, size_t length,
+                           vector<string> & names,
+                           unordered_map<string, int> & indices) {
+    string key(name, length);
+    unordered_map<string, int>::iterator it = indices.find(key);
+    if (it != indices.end()) {
+        return it->second;
+    }
+    int index = names.size();
+    names.push_back(key);
+    indices[key] = index;
+    return index;
+}
+
+uint64_t HintAggregator::hashKey(const Entry & entry) const {
+    uint64_t hash = hashCombine(entry.contig, entry.type);
+    hash = hashCombine(hash, entry.start);
+    hash = hashCombine(hash, entry.end);
+    return hashCombine(hash, entry.strand);
+}
+
+bool HintAggregator::sameKey(const Entry & a, const Entry & b) const {
+    return a.contig == b.contig && a.type == b.type && a.start == b.start &&
+            a.end == b.end && a.strand == b.strand;
+}
+
+bool HintAggregator::lessKey(const Entry & a, const Entry & b) const {
+    if (a.contig != b.contig) {
+        return contigs[a.contig] < contigs[b.contig];
+    }
+    if (a.start != b.start) {
+        return a.start < b.start;
+    }
+    if (a.end != b.end) {
+        return a.end < b.end;
+    }
+    if (a.type != b.type) {
+        return types[a.type] < types[b.type];
+    }
+    return a.strand < b.strand;
+}
+
+HintAggregator::Entry & HintAggregator::find(const Entry & key) {
+    size_t slot = hashKey(key) & mask;
+    while (slots[slot] >= 0) {
+        if (sameKey(entries[slots[slot]], key)) {
+            return entries[slots[slot]];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    slots[slot] = entries.size();
+    entries.push_back(key);
+    Entry & entry = entries.back();
+    entry.count = 0;
+    entry.scored = 0;
+    entry.maxScore = 0;
+    entry.scoreSum = 0;
+    entry.exonScore = false;
+    memoryUsed += sizeof (Entry);
+    // Keep the load factor at most one half
+    if (entries.size() * 2 > slots.size()) {
+        grow();
+        return entries.back();
+    }
+    return entry;
+}
+
+void HintAggregator::grow() {
+    memoryUsed += slots.size() * sizeof (int);
+    slots.assign(slots.size() * 2, -1);
+    mask = slots.size() - 1;
+    for (unsigned int i = 0; i < entries.size(); i++) {
+        size_t slot = hashKey(entries[i]) & mask;
+        while (slots[slot] >= 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = i;
+    }
+}
+
+void HintAggregator::clearTable() {
+    entries.clear();
+    slots.assign(AGGREGATE_INITIAL_SLOTS, -1);
+    mask = slots.size() - 1;
+    memoryUsed = slots.size() * sizeof (int);
+}
+
+void HintAggregator::sortEntries() {
+    sort(entries.begin(), entries.end(),
+         [this](const Entry & a, const Entry & b) {
+             return lessKey(a, b);
+         });
+}
+
+void HintAggregator::combine(Entry & target, const Entry & source) const {
+    target.count += source.count;
+    if (source.scored > 0 &&
+            (target.scored == 0 || source.maxScore > target.maxScore)) {
+        target.maxScore = source.maxScore;
+    }
+    if (source.scored > 0) {
+        target.exonScore = source.exonScore;
+    }
+    target.scored += source.scored;
+    target.scoreSum += source.scoreSum;
+    if (!source.proteins.empty()) {
+        if (!target.proteins.empty()) {
+            target.proteins.push_back(',');
+        }
+        target.proteins.append(source.proteins);
+    }
+}
+
+bool HintAggregator::writeEntry(FILE * file, const Entry & entry) {
+    uint32_t proteinsLength = entry.proteins.size();
+    return fwrite(&entry.contig, sizeof (entry.contig), 1, file) == 1 &&
+            fwrite(&entry.type, sizeof (entry.type), 1, file) == 1 &&
+            fwrite(&entry.start, sizeof (entry.start), 1, file) == 1 &&
+            fwrite(&entry.end, sizeof (entry.end), 1, file) == 1 &&
+            fwrite(&entry.strand, 1, 1, file) == 1 &&
+            fwrite(&entry.frame, 1, 1, file) == 1 &&
+            fwrite(&entry.count, sizeof (entry.count), 1, file) == 1 &&
+            fwrite(&entry.scored, sizeof (entry.scored), 1, file) == 1 &&
+            fwrite(&entry.maxScore, sizeof (entry.maxScore), 1, file) == 1 &&
+            fwrite(&entry.scoreSum, sizeof (entry.scoreSum), 1, file) == 1 &&
+            fwrite(&entry.exonScore, sizeof (entry.exonScore), 1, file) == 1 &&
+            fwrite(&proteinsLength, sizeof (proteinsLength), 1, file) == 1 &&
+            fwrite(entry.proteins.data(), 1, proteinsLength, file) == proteinsLength;
+}
+
+bool HintAggregator::readEntry(FILE * file, Entry & entry) {
+    uint32_t proteinsLength;
+    if (fread(&entry.contig, sizeof (entry.contig), 1, file) != 1 ||
+            fread(&entry.type, sizeof (entry.type), 1, file) != 1 ||
+            fread(&entry.start, sizeof (entry.start), 1, file) != 1 ||
+            fread(&entry.end, sizeof (entry.end), 1, file) != 1 ||
+            fread(&entry.strand, 1, 1, file) != 1 ||
+            fread(&entry.frame, 1, 1, file) != 1 ||
+            fread(&entry.count, sizeof (entry.count), 1, file) != 1 ||
+            fread(&entry.scored, sizeof (entry.scored), 1, file) != 1 ||
+            fread(&entry.maxScore, sizeof (entry.maxScore), 1, file) != 1 ||
+            fread(&entry.scoreSum, sizeof (entry.scoreSum), 1, file) != 1 ||
+            fread(&entry.exonScore, sizeof (entry.exonScore), 1, file) != 1 ||
+            fread(&proteinsLength, sizeof (proteinsLength), 1, file) != 1) {
+        return false;
+    }
+    entry.proteins.resize(proteinsLength);
+    return proteinsLength == 0 ||
+            fread(&entry.proteins[0], 1, proteinsLength, file) == proteinsLength;
+}
+
+bool HintAggregator::spill() {
+    if (entries.empty()) {
+        return true;
+    }
+    sortEntries();
+    stringstream name;
+    name << runPrefix << runs.size();
+    FILE * file = fopen(name.str().c_str(), "wb");
+    if (file == NULL) {
+        cerr << "error: Could not create aggregation run \"" << name.str() << "\"" << endl;
+        return false;
+    }
+    runs.push_back(name.str());
+    setvbuf(file, NULL, _IOFBF, AGGREGATE_RUN_BUFFER);
+    bool success = true;
+    for (unsigned int i = 0; i < entries.size() && success; i++) {
+        success = writeEntry(file, entries[i]);
+    }
+    success = fclose(file) == 0 && success;
+    if (!success) {
+        cerr << "error: Could not write aggregation run \"" << name.str() << "\"" << endl;
+    }
+    clearTable();
+    return success;
+}
+
+void HintAggregator::print(const Entry & entry, ostream & output) const {
+    output << contigs[entry.contig] << "\tSpaln_scorer\t" << types[entry.type] <<
+            "\t" << entry.start << "\t" << entry.end << "\t.\t" << entry.strand <<
+            "\t" << entry.frame << "\t";
+    const char * separator = "";
+    const char * scoreName = entry.exonScore ? "eScore" : "al_score";
+    if (reducers & AGGREGATE_COUNT) {
+        output << "mult=" << entry.count << ";";
+        separator = " ";
+    }
+    if ((reducers & AGGREGATE_MAX) && entry.scored > 0) {
+        output << separator << scoreName << "_max=" << entry.maxScore << ";";
+        separator = " ";
+    }
+    if ((reducers & AGGREGATE_MEAN) && entry.scored > 0) {
+        output << separator << scoreName << "_mean=" << entry.scoreSum / entry.scored << ";";
+        separator = " ";
+    }
+    if (reducers & AGGREGATE_PROTEINS) {
+        output << separator << "prots=" << entry.proteins << ";";
+    }
+    output << "\n";
+}
+
+bool HintAggregator::write(ostream & output) {
+    if (error) {
+        return false;
+    }
+    if (runs.empty()) {
+        sortEntries();
+        for (unsigned int i = 0; i < entries.size(); i++) {
+            print(entries[i], output);
+        }
+        clearTable();
+        return true;
+    }
+    // Runs are merged in the order in which they were spilled, which
+    // keeps the proteins in the input order
+    if (!spill()) {
+        return false;
+    }
+    bool success = merge(output);
+    for (unsigned int i = 0; i < runs.size(); i++) {
+        remove(runs[i].c_str());
+    }
+    runs.clear();
+    return success;
+}
+
+bool HintAggregator::merge(ostream & output) {
+    vector<FILE *> files;
+    vector<Entry> heads(runs.size());
+    // Heap of runs ordered by their head entries, earlier runs first
+    vector<int> heap;
+    bool success = true;
+    for (unsigned int i = 0; i < runs.size(); i++) {
+        FILE * file = fopen(runs[i].c_str(), "rb");
+        if (file == NULL) {
+            cerr << "error: Could not open aggregation run \"" << runs[i] << "\"" << endl;
+            success = false;
+            break;
+        }
+        setvbuf(file, NULL, _IOFBF, AGGREGATE_RUN_BUFFER);
+        files.push_back(file);
+        if (readEntry(file, heads[i])) {
+            heap.push_back(i);
+        }
+    }
+
+    auto later = [this, &heads](int a, int b) {
+        if (lessKey(heads[a], heads[b])) {
+            return false;
+        }
+        if (lessKey(heads[b], heads[a])) {
+            return true;
+        }
+        return a > b;
+    };
+    make_heap(heap.begin(), heap.end(), later);
+
+    Entry current;
+    bool pending = false;
+    while (success && !heap.empty()) {
+        pop_heap(heap.begin(), heap.end(), later);
+        int run = heap.back();
+        heap.pop_back();
+        if (pending && sameKey(current, heads[run])) {
+            combine(current, heads[run]);
+        } else {
+            if (pending) {
+                print(current, output);
+            }
+            current = heads[run];
+            pending = true;
+        }
+        if (readEntry(files[run], heads[run])) {
+            heap.push_back(run);
+            push_heap(heap.begin(), heap.end(), later);
+        }
+    }
+    if (pending && success) {
+        print(current, output);
+    }
+
+    for (unsigned int i = 0; i < files.size(); i++) {
+        if (ferror(files[i])) {
+            cerr << "error: Could not read aggregation run \"" << runs[i] << "\"" << endl;
+            success = false;
+        }
+        fclose(files[i]);
+    }
+    return success;
+}
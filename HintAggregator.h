@@ -0,0 +1,140 @@
+#ifndef HINT_AGGREGATOR_H
+#define HINT_AGGREGATOR_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <unordered_map>
+#include <cstdio>
+#include <stdint.h>
+#include "MappedFile.h"
+
+using namespace std;
+
+/// Reducers applied to hints with the same key
+#define AGGREGATE_COUNT 1
+#define AGGREGATE_MAX 2
+#define AGGREGATE_MEAN 4
+#define AGGREGATE_PROTEINS 8
+
+/// Collapses identical hints supported by many proteins into one
+
+/**
+ * Hints are keyed by (contig, type, start, end, strand) in an
+ * open-addressing hash table. The score of a hint is its al_score, or the
+ * eScore of CDS hints which have no al_score, and the reduced scores are
+ * named after it. Unrounded scores are taken from the exact_score
+ * attribute when the hints have one. When the table outgrows the
+ * memory limit, its entries are sorted and spilled into a run file next
+ * to the output, and all runs are merged when the result is written. The
+ * result is sorted by contig, start, end, type and strand.
+ */
+class HintAggregator : public LineListener {
+public:
+    HintAggregator();
+    ~HintAggregator();
+    /**
+     * @param reducers    Combination of the AGGREGATE_* flags
+     * @param memoryLimit Approximate memory used by the table before
+     *                    it is spilled, in bytes
+     * @param runPrefix   Prefix of the names of spilled run files
+     */
+    void setup(int reducers, unsigned long long memoryLimit, string runPrefix);
+    /**
+     * Add a single hint line in the format printed by Alignment, without
+     * the trailing newline
+     * @return False if the line is not a valid hint
+     */
+    bool add(const char * line, size_t length);
+    /**
+     * Add a hint line written to a LineOutputStream
+     */
+    void line(const char * line, size_t length);
+    /**
+     * Write the aggregated hints and remove the spilled runs
+     * @return Whether all runs could be written and read
+     */
+    bool write(ostream & output);
+    /**
+     * Parse a reducer list such as "count,max,proteins"
+     * @return Combination of the AGGREGATE_* flags, 0 if the list is invalid
+     */
+    static int parseReducers(string list);
+    /**
+     * @return Number of runs spilled to disk so far
+     */
+    int spills() const;
+private:
+    /// Aggregated values of one key
+    struct Entry {
+        int contig;
+        int type;
+        long long start;
+        long long end;
+        char strand;
+        char frame;
+        unsigned long long count;
+        /// Number of hints with a score
+        unsigned long long scored;
+        double maxScore;
+        double scoreSum;
+        /// Whether the scores are eScores instead of al_scores
+        bool exonScore;
+        /// Comma separated protein names
+        string proteins;
+    };
+
+    /**
+     * Find the entry with the key of the given hint, or insert a new one
+     */
+    Entry & find(const Entry & key);
+    uint64_t hashKey(const Entry & entry) const;
+    bool sameKey(const Entry & a, const Entry & b) const;
+    /**
+     * Order of the output: contig name, start, end, type name and strand
+     */
+    bool lessKey(const Entry & a, const Entry & b) const;
+    /**
+     * Combine the values of an entry with the same key into another
+     */
+    void combine(Entry & target, const Entry & source) const;
+    /**
+     * Look up or assign the index of a name
+     */
+    int intern(const char * name, size_t length, vector<string> & names,
+               unordered_map<string, int> & indices);
+    void grow();
+    /**
+     * Sort the table and write it into a new run file
+     */
+    bool spill();
+    void sortEntries();
+    void clearTable();
+    void print(const Entry & entry, ostream & output) const;
+    static bool writeEntry(FILE * file, const Entry & entry);
+    static bool readEntry(FILE * file, Entry & entry);
+    /**
+     * Merge all run files into the output
+     */
+    bool merge(ostream & output);
+
+    int reducers;
+    unsigned long long memoryLimit;
+    string runPrefix;
+    vector<string> runs;
+    vector<Entry> entries;
+    /// Open-addressing slots with indices into entries, -1 when empty
+    vector<int> slots;
+    size_t mask;
+    unsigned long long memoryUsed;
+    vector<string> contigs;
+    unordered_map<string, int> contigIndices;
+    vector<string> types;
+    unordered_map<string, int> typeIndices;
+    /// Index of the contig of the last hint, which usually repeats
+    int lastContig;
+    /// Whether spilling a run failed
+    bool error;
+};
+
+#endif /* HINT_AGGREGATOR_H */
@@ -0,0 +1,291 @@
+#include "HintFilter.h"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <strings.h>
+
+/// Depth of the evaluation stack, which is a 64-bit mask
+#define FILTER_MAX_DEPTH 64
+
+/// Names of the fields, in the order of HintRecord::Field
+static const char * FIELD_NAMES[] = {
+    "type", "contig", "prot", "strand", "splice_sites",
+    "start", "end", "frame", "initial", "intron_id", "exon_id", "al_score",
+    "LeScore", "ReScore", "LeNScore", "eScore", "eNScore"
+};
+
+static string lowercase(const string & text) {
+    string result = text;
+    for (unsigned int i = 0; i < result.size(); i++) {
+        result[i] = tolower(result[i]);
+    }
+    return result;
+}
+
+static bool sameText(const string & a, const string & b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+HintFilter::HintFilter() {
+    position = 0;
+    depth = 0;
+    maxDepth = 0;
+}
+
+bool HintFilter::isSet() const {
+    return !program.empty();
+}
+
+const string & HintFilter::source() const {
+    return expression;
+}
+
+bool HintFilter::compile(const string & expression) {
+    this->expression = expression;
+    program.clear();
+    position = 0;
+    depth = 0;
+    maxDepth = 0;
+    if (!parseDisjunction()) {
+        program.clear();
+        return false;
+    }
+    skipSpaces();
+    if (position != expression.size()) {
+        program.clear();
+        return fail("unexpected \"" + expression.substr(position) + "\"");
+    }
+    if (maxDepth > FILTER_MAX_DEPTH) {
+        program.clear();
+        return fail("the expression is too deeply nested");
+    }
+    return true;
+}
+
+bool HintFilter::fail(const string & message) {
+    cerr << "error: Invalid filter \"" << expression << "\": " << message << endl;
+    return false;
+}
+
+void HintFilter::skipSpaces() {
+    while (position < expression.size() && isspace(expression[position])) {
+        position++;
+    }
+}
+
+bool HintFilter::accept(const char * token) {
+    skipSpaces();
+    size_t length = strlen(token);
+    if (expression.compare(position, length, token) != 0) {
+        return false;
+    }
+    position += length;
+    return true;
+}
+
+bool HintFilter::parseName(string & name) {
+    skipSpaces();
+    size_t start = position;
+    while (position < expression.size() &&
+            (isalnum(expression[position]) || expression[position] == '_' ||
+            expression[position] == '.' || expression[position] == '-' ||
+            expression[position] == '+')) {
+        position++;
+    }
+    name = expression.substr(start, position - start);
+    return !name.empty();
+}
+
+bool HintFilter::parseValue(string & value) {
+    skipSpaces();
+    if (position < expression.size() &&
+            (expression[position] == '"' || expression[position] == '\'')) {
+        char quote = expression[position];
+        size_t end = expression.find(quote, position + 1);
+        if (end == string::npos) {
+            return fail("unterminated quote");
+        }
+        value = expression.substr(position + 1, end - position - 1);
+        position = end + 1;
+        return true;
+    }
+    if (!parseName(value)) {
+        return fail("value expected at \"" + expression.substr(position) + "\"");
+    }
+    return true;
+}
+
+bool HintFilter::parseDisjunction() {
+    if (!parseConjunction()) {
+        return false;
+    }
+    while (accept("||")) {
+        if (!parseConjunction()) {
+            return false;
+        }
+        Instruction instruction(OR);
+        program.push_back(instruction);
+        depth--;
+    }
+    return true;
+}
+
+bool HintFilter::parseConjunction() {
+    if (!parseNegation()) {
+        return false;
+    }
+    while (accept("&&")) {
+        if (!parseNegation()) {
+            return false;
+        }
+        Instruction instruction(AND);
+        program.push_back(instruction);
+        depth--;
+    }
+    return true;
+}
+
+bool HintFilter::parseNegation() {
+    skipSpaces();
+    if (expression.compare(position, 2, "!=") != 0 && accept("!")) {
+        if (!parseNegation()) {
+            return false;
+        }
+        Instruction instruction(NOT);
+        program.push_back(instruction);
+        return true;
+    }
+    if (accept("(")) {
+        if (!parseDisjunction()) {
+            return false;
+        }
+        if (!accept(")")) {
+            return fail("missing \")\"");
+        }
+        return true;
+    }
+    return parseComparison();
+}
+
+bool HintFilter::parseComparison() {
+    string name;
+    if (!parseName(name)) {
+        return fail("field expected at \"" + expression.substr(position) + "\"");
+    }
+    Instruction instruction(EQUAL);
+    int field = 0;
+    while (field < HintRecord::FIELD_COUNT && name != FIELD_NAMES[field]) {
+        field++;
+    }
+    if (field == HintRecord::FIELD_COUNT) {
+        return fail("unknown field \"" + name + "\"");
+    }
+    instruction.field = (HintRecord::Field) field;
+    bool text = field <= HintRecord::SPLICE_SITES;
+
+    // Longer operators first
+    const char * operators[] = {"==", "!=", "<=", ">=", "<", ">"};
+    Operation operations[] = {EQUAL, NOT_EQUAL, LESS_EQUAL, GREATER_EQUAL,
+        LESS, GREATER};
+    int i = 0;
+    while (i < 6 && !accept(operators[i])) {
+        i++;
+    }
+    string value;
+    if (i < 6) {
+        instruction.operation = operations[i];
+        if (!parseValue(value)) {
+            return false;
+        }
+        if (text) {
+            if (instruction.operation != EQUAL && instruction.operation != NOT_EQUAL) {
+                return fail("field \"" + name + "\" can only be compared with == and !=");
+            }
+            instruction.texts.push_back(lowercase(value));
+        } else {
+            char * end;
+            instruction.number = strtod(value.c_str(), &end);
+            if (*end != '\0') {
+                return fail("number expected instead of \"" + value + "\"");
+            }
+        }
+    } else {
+        string keyword;
+        size_t keywordStart = position;
+        if (!parseName(keyword) || keyword != "in") {
+            position = keywordStart;
+            return fail("operator expected after \"" + name + "\"");
+        }
+        if (!text) {
+            return fail("\"in\" can only be used with text fields");
+        }
+        instruction.operation = IN;
+        if (!accept("{")) {
+            return fail("\"{\" expected after \"in\"");
+        }
+        do {
+            if (!parseValue(value)) {
+                return false;
+            }
+            instruction.texts.push_back(lowercase(value));
+        } while (accept(","));
+        if (!accept("}")) {
+            return fail("missing \"}\"");
+        }
+    }
+    program.push_back(instruction);
+    depth++;
+    if (depth > maxDepth) {
+        maxDepth = depth;
+    }
+    return true;
+}
+
+bool HintFilter::accepts(const HintRecord & record) const {
+    // Stack of results, the top is the lowest bit
+    uint64_t stack = 0;
+    for (unsigned int i = 0; i < program.size(); i++) {
+        const Instruction & instruction = program[i];
+        bool result;
+        switch (instruction.operation) {
+            case AND:
+                result = (stack & 1) && (stack & 2);
+                stack >>= 2;
+                break;
+            case OR:
+                result = (stack & 1) || (stack & 2);
+                stack >>= 2;
+                break;
+            case NOT:
+                result = !(stack & 1);
+                stack >>= 1;
+                break;
+            default:
+                if (!(record.present & (1 << instruction.field))) {
+                    result = false;
+                } else if (instruction.field <= HintRecord::SPLICE_SITES) {
+                    const string & value = record.texts[instruction.field];
+                    result = false;
+                    for (unsigned int j = 0; j < instruction.texts.size() && !result; j++) {
+                        result = sameText(value, instruction.texts[j]);
+                    }
+                    if (instruction.operation == NOT_EQUAL) {
+                        result = !result;
+                    }
+                } else {
+                    double value = record.numbers[instruction.field];
+                    switch (instruction.operation) {
+                        case EQUAL: result = value == instruction.number; break;
+                        case NOT_EQUAL: result = value != instruction.number; break;
+                        case LESS: result = value < instruction.number; break;
+                        case LESS_EQUAL: result = value <= instruction.number; break;
+                        case GREATER: result = value > instruction.number; break;
+                        default: result = value >= instruction.number; break;
+                    }
+                }
+        }
+        stack = (stack << 1) | result;
+    }
+    return program.empty() || (stack & 1);
+}
@@ -0,0 +1,125 @@
+#ifndef HINT_FILTER_H
+#define HINT_FILTER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+/// Values of a scored hint, filled in before the hint is formatted
+
+struct HintRecord {
+    /// Fields of the filter expressions
+    enum Field {
+        // Text fields
+        TYPE, CONTIG, PROT, STRAND, SPLICE_SITES,
+        // Numeric fields
+        START, END, FRAME, INITIAL, INTRON_ID, EXON_ID, AL_SCORE, LE_SCORE,
+        RE_SCORE, LE_N_SCORE, E_SCORE, E_N_SCORE,
+        FIELD_COUNT
+    };
+
+    HintRecord() : present(0) {}
+
+    void setText(Field field, const char * value, size_t length) {
+        texts[field].assign(value, length);
+        present |= 1 << field;
+    }
+
+    void setNumber(Field field, double value) {
+        numbers[field] = value;
+        present |= 1 << field;
+    }
+
+    /**
+     * Forget all values, the record is reused for the next hint
+     */
+    void clear() {
+        present = 0;
+    }
+
+    string texts[SPLICE_SITES + 1];
+    double numbers[FIELD_COUNT];
+    /// Bit mask of the fields which the hint has
+    uint32_t present;
+};
+
+/// Filter expression evaluated on every hint before it is printed
+
+/**
+ * The expression is compiled once into a postfix program of comparisons
+ * and logical operators. Its grammar is
+ *
+ *     expression := conjunction ("||" conjunction)*
+ *     conjunction := negation ("&&" negation)*
+ *     negation := "!" negation | "(" expression ")" | comparison
+ *     comparison := field ("==" | "!=" | "<" | "<=" | ">" | ">=") value
+ *                 | field "in" "{" value ("," value)* "}"
+ *
+ * Fields are "type", "contig", "prot", "strand" and "splice_sites" with
+ * text values compared case-insensitively, and "start", "end", "frame",
+ * "initial", "intron_id", "exon_id", "al_score", "LeScore", "ReScore",
+ * "LeNScore", "eScore" and "eNScore" with numeric values. Text values may
+ * be quoted. Comparisons of fields which the hint does not have (e.g.
+ * al_score of a CDS) are false.
+ */
+class HintFilter {
+public:
+    HintFilter();
+    /**
+     * Compile an expression
+     * @return False if the expression is invalid, the error is printed
+     */
+    bool compile(const string & expression);
+    /**
+     * @return Whether an expression was compiled
+     */
+    bool isSet() const;
+    /**
+     * @return Source of the compiled expression
+     */
+    const string & source() const;
+    /**
+     * Evaluate the expression, safe to call from several threads
+     */
+    bool accepts(const HintRecord & record) const;
+private:
+    /// Instructions of the postfix program
+    enum Operation {
+        EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL, IN,
+        AND, OR, NOT
+    };
+
+    struct Instruction {
+        Instruction(Operation operation) :
+        operation(operation), field(HintRecord::TYPE), number(0) {}
+
+        Operation operation;
+        HintRecord::Field field;
+        double number;
+        /// Lowercase text values, one for comparisons and several for "in"
+        vector<string> texts;
+    };
+
+    /// Tokenizer and recursive descent parser state
+    bool parseDisjunction();
+    bool parseConjunction();
+    bool parseNegation();
+    bool parseComparison();
+    bool parseValue(string & value);
+    void skipSpaces();
+    bool accept(const char * token);
+    bool parseName(string & name);
+    bool fail(const string & message);
+
+    string expression;
+    vector<Instruction> program;
+    /// Parsed position in the expression
+    size_t position;
+    /// Stack depth needed by the program
+    int depth;
+    int maxDepth;
+};
+
+#endif /* HINT_FILTER_H */
@@ -0,0 +1,247 @@
+#include "HintIndex.h"
+#include "HintLine.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <sys/stat.h>
+
+using namespace std;
+
+/// Magic string, GFF size, GFF modification time in ns, contigs and hints
+#define HINT_INDEX_HEADER_SIZE (HINT_INDEX_MAGIC_SIZE + 4 * 8)
+
+/// Indexed line during the build
+struct IndexEntry {
+    int64_t start, end;
+    uint64_t offset;
+    uint32_t length;
+};
+
+static bool startsBefore(const IndexEntry & a, const IndexEntry & b) {
+    return a.start < b.start;
+}
+
+/**
+ * Get the size and the modification time (in ns) of a file
+ * @return False if the file does not exist
+ */
+static bool fileVersion(const string & filename, uint64_t & size, int64_t & time) {
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0) {
+        return false;
+    }
+    size = info.st_size;
+    time = (int64_t) info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+    return true;
+}
+
+static size_t padded(size_t length) {
+    return (length + 7) & ~(size_t) 7;
+}
+
+bool HintIndex::build(const string & gffFile, const string & indexFile) {
+    MappedFile gff;
+    uint64_t gffSize;
+    int64_t gffTime;
+    if (!fileVersion(gffFile, gffSize, gffTime) || !gff.map(gffFile)) {
+        cerr << "error: Could not read file \"" << gffFile << "\"" << endl;
+        return false;
+    }
+
+    // Lines grouped by contig, in the order in which contigs appear
+    vector<string> names;
+    vector<vector<IndexEntry> > entries;
+    unordered_map<string, size_t> ids;
+    const char * data = gff.data();
+    size_t size = gff.size();
+    size_t position = 0;
+    HintLine hint;
+    while (position < size) {
+        const char * newline = (const char *) memchr(data + position, '\n', size - position);
+        size_t lineEnd = newline != NULL ? newline - data : size;
+        if (hint.parse(data + position, lineEnd - position)) {
+            string contig(hint.field(0), hint.fieldLength(0));
+            unordered_map<string, size_t>::iterator it = ids.find(contig);
+            if (it == ids.end()) {
+                it = ids.insert(make_pair(contig, names.size())).first;
+                names.push_back(contig);
+                entries.push_back(vector<IndexEntry>());
+            }
+            IndexEntry entry;
+            entry.start = hint.start();
+            entry.end = hint.end();
+            entry.offset = position;
+            entry.length = lineEnd - position;
+            entries[it->second].push_back(entry);
+        }
+        position = lineEnd + 1;
+    }
+
+    // Header and contig table
+    uint64_t hints = 0;
+    vector<uint64_t> table;
+    uint64_t nameOffset = 0;
+    for (size_t i = 0; i < names.size(); i++) {
+        stable_sort(entries[i].begin(), entries[i].end(), startsBefore);
+        table.push_back(hints);
+        table.push_back(entries[i].size());
+        table.push_back(nameOffset);
+        table.push_back(names[i].size());
+        hints += entries[i].size();
+        nameOffset += names[i].size();
+    }
+    ofstream ofs(indexFile.c_str(), std::ofstream::binary);
+    if (!ofs) {
+        cerr << "error: Could not open output file \"" << indexFile << "\"" << endl;
+        return false;
+    }
+    uint64_t header[] = {gffSize, (uint64_t) gffTime, names.size(), hints};
+    ofs.write(HINT_INDEX_MAGIC, HINT_INDEX_MAGIC_SIZE);
+    ofs.write((const char *) header, sizeof (header));
+    ofs.write((const char *) table.data(), table.size() * sizeof (uint64_t));
+
+    // Columns of all hints, the maximum ends are computed per contig
+    vector<int64_t> column;
+    for (int field = 0; field < 4; field++) {
+        for (size_t i = 0; i < names.size(); i++) {
+            int64_t maxEnd = INT64_MIN;
+            for (size_t j = 0; j < entries[i].size(); j++) {
+                const IndexEntry & entry = entries[i][j];
+                maxEnd = max(maxEnd, entry.end);
+                int64_t values[] = {entry.start, maxEnd, entry.end, (int64_t) entry.offset};
+                column.push_back(values[field]);
+            }
+        }
+        ofs.write((const char *) column.data(), column.size() * sizeof (int64_t));
+        column.clear();
+    }
+    vector<uint32_t> lengths;
+    for (size_t i = 0; i < names.size(); i++) {
+        for (size_t j = 0; j < entries[i].size(); j++) {
+            lengths.push_back(entries[i][j].length);
+        }
+    }
+    if (lengths.size() % 2 != 0) {
+        lengths.push_back(0);
+    }
+    ofs.write((const char *) lengths.data(), lengths.size() * sizeof (uint32_t));
+    for (size_t i = 0; i < names.size(); i++) {
+        ofs.write(names[i].data(), names[i].size());
+    }
+    ofs.close();
+    if (!ofs) {
+        cerr << "error: Could not write output file \"" << indexFile << "\"" << endl;
+        return false;
+    }
+    return true;
+}
+
+bool HintIndex::open(const string & indexFile, const string & gffFile) {
+    contigIds.clear();
+    indexedSize = 0;
+    if (!file.map(indexFile)) {
+        cerr << "error: Could not read index \"" << indexFile << "\"" << endl;
+        return false;
+    }
+    const char * data = file.data();
+    size_t size = file.size();
+    uint64_t header[4];
+    if (size < HINT_INDEX_HEADER_SIZE ||
+            memcmp(data, HINT_INDEX_MAGIC, HINT_INDEX_MAGIC_SIZE) != 0) {
+        cerr << "error: \"" << indexFile << "\" is not a hint index" << endl;
+        return false;
+    }
+    memcpy(header, data + HINT_INDEX_MAGIC_SIZE, sizeof (header));
+    uint64_t gffSize;
+    int64_t gffTime;
+    if (!fileVersion(gffFile, gffSize, gffTime) || gffSize != header[0] ||
+            gffTime != (int64_t) header[1]) {
+        cerr << "error: Index \"" << indexFile << "\" is outdated, \"" <<
+                gffFile << "\" has changed since it was indexed" << endl;
+        return false;
+    }
+
+    indexedSize = gffSize;
+
+    // All arrays must fit into the file
+    uint64_t contigCount = header[2], hints = header[3];
+    size_t available = size - HINT_INDEX_HEADER_SIZE;
+    if (contigCount > available / sizeof (Contig) ||
+            hints > (available - contigCount * sizeof (Contig)) / (4 * 8 + 4)) {
+        cerr << "error: Index \"" << indexFile << "\" is truncated" << endl;
+        return false;
+    }
+    size_t position = HINT_INDEX_HEADER_SIZE;
+    contigs = (const Contig *) (data + position);
+    position += contigCount * sizeof (Contig);
+    starts = (const int64_t *) (data + position);
+    maxEnds = starts + hints;
+    ends = maxEnds + hints;
+    offsets = (const uint64_t *) (ends + hints);
+    lengths = (const uint32_t *) (offsets + hints);
+    position += hints * 4 * 8 + padded(hints * 4);
+    if (position > size) {
+        cerr << "error: Index \"" << indexFile << "\" is truncated" << endl;
+        return false;
+    }
+    const char * names = data + position;
+    for (uint64_t i = 0; i < contigCount; i++) {
+        const Contig & contig = contigs[i];
+        if (contig.first > hints || contig.count > hints - contig.first ||
+                contig.nameOffset > size - position ||
+                contig.nameLength > size - position - contig.nameOffset) {
+            cerr << "error: Index \"" << indexFile << "\" is truncated" << endl;
+            return false;
+        }
+        contigIds[string(names + contig.nameOffset, contig.nameLength)] = i;
+    }
+    return true;
+}
+
+void HintIndex::query(const string & contig, int64_t start, int64_t end,
+                      vector<pair<uint64_t, uint32_t> > & lines) const {
+    unordered_map<string, uint64_t>::const_iterator it = contigIds.find(contig);
+    if (it == contigIds.end()) {
+        return;
+    }
+    const Contig & table = contigs[it->second];
+    const int64_t * first = maxEnds + table.first;
+    const int64_t * last = first + table.count;
+    // Hints before the first one whose maximum end reaches the region all
+    // end before it
+    size_t from = lower_bound(first, last, start) - first;
+    const int64_t * contigStarts = starts + table.first;
+    size_t to = upper_bound(contigStarts + from, contigStarts + table.count, end) -
+            contigStarts;
+    for (size_t i = table.first + from; i < table.first + to; i++) {
+        // Lines of a damaged index outside of the GFF file are skipped
+        if (ends[i] >= start && offsets[i] <= indexedSize &&
+                lengths[i] <= indexedSize - offsets[i]) {
+            lines.push_back(make_pair(offsets[i], lengths[i]));
+        }
+    }
+}
+
+bool HintIndex::parseRegion(const string & region, string & contig,
+                            int64_t & start, int64_t & end) {
+    // Contig names may contain colons, the coordinates follow the last one
+    size_t colon = region.rfind(':');
+    size_t dash = colon != string::npos ? region.find('-', colon) : string::npos;
+    if (colon == string::npos || dash == string::npos) {
+        contig = region;
+        start = INT64_MIN;
+        end = INT64_MAX;
+        return !contig.empty();
+    }
+    contig = region.substr(0, colon);
+    string first = region.substr(colon + 1, dash - colon - 1);
+    string last = region.substr(dash + 1);
+    char * firstEnd;
+    char * lastEnd;
+    start = strtoll(first.c_str(), &firstEnd, 10);
+    end = strtoll(last.c_str(), &lastEnd, 10);
+    return !contig.empty() && !first.empty() && !last.empty() &&
+            *firstEnd == '\0' && *lastEnd == '\0' && start <= end;
+}
@@ -0,0 +1,79 @@
+#ifndef HINT_INDEX_H
+#define HINT_INDEX_H
+
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+using namespace std;
+
+/// Magic string at the start of hint index files
+#define HINT_INDEX_MAGIC "SPHIDX01"
+#define HINT_INDEX_MAGIC_SIZE 8
+/// Suffix appended to the name of an indexed GFF file
+#define HINT_INDEX_SUFFIX ".hidx"
+
+/// Interval index of the hints in a GFF file, for region queries
+
+/**
+ * The hints of every contig are sorted by start. Next to the starts, the
+ * index stores the maximum end of the hints up to every position, which
+ * never decreases. The hints overlapping a region are found with two binary
+ * searches, the first hint whose maximum end reaches the region and the
+ * first hint starting after it, and a scan between them, which skips only
+ * hints nested in a long hint before them.
+ *
+ * The index file is a header (magic string, size and modification time of
+ * the GFF file, number of contigs and hints), a table of contigs with their
+ * first hint and number of hints, fixed-width arrays of starts, maximum
+ * ends, ends, line offsets and line lengths of all hints, and the contig
+ * names. It is memory-mapped by the queries.
+ */
+class HintIndex {
+public:
+    /**
+     * Index all GFF lines of a file. Lines with fewer than nine columns
+     * (comments) are not indexed.
+     * @return Whether the index file was written
+     */
+    static bool build(const string & gffFile, const string & indexFile);
+    /**
+     * Map an index and check that it belongs to the current GFF file
+     * @return False if the index is invalid or outdated, the error is
+     *         printed
+     */
+    bool open(const string & indexFile, const string & gffFile);
+    /**
+     * Find the hints overlapping a region, in the order of their starts
+     * @param start,end 1-based inclusive coordinates
+     * @param lines     Offsets and lengths (without the newline) of the
+     *                  lines in the GFF file
+     */
+    void query(const string & contig, int64_t start, int64_t end,
+               vector<pair<uint64_t, uint32_t> > & lines) const;
+    /**
+     * Parse a region in the format contig:start-end or contig
+     * @return False if the region is invalid
+     */
+    static bool parseRegion(const string & region, string & contig,
+                            int64_t & start, int64_t & end);
+private:
+    struct Contig {
+        uint64_t first, count, nameOffset, nameLength;
+    };
+
+    MappedFile file;
+    /// Size of the GFF file
+    uint64_t indexedSize;
+    const Contig * contigs;
+    const int64_t * starts;
+    const int64_t * maxEnds;
+    const int64_t * ends;
+    const uint64_t * offsets;
+    const uint32_t * lengths;
+    unordered_map<string, uint64_t> contigIds;
+};
+
+#endif /* HINT_INDEX_H */
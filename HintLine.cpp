@@ -0,0 +1,80 @@
+#include "HintLine.h"
+#include <cstdlib>
+#include <cstring>
+
+bool HintLine::parse(const char * line, size_t length) {
+    const char * position = line;
+    lineEnd = line + length;
+    for (int i = 0; i < 9; i++) {
+        const char * tab = i < 8 ?
+                (const char *) memchr(position, '\t', lineEnd - position) : lineEnd;
+        if (tab == NULL) {
+            return false;
+        }
+        fields[i] = position;
+        lengths[i] = tab - position;
+        position = tab + 1;
+    }
+    return true;
+}
+
+long long HintLine::start() const {
+    return strtoll(fields[3], NULL, 10);
+}
+
+long long HintLine::end() const {
+    return strtoll(fields[4], NULL, 10);
+}
+
+char HintLine::strand() const {
+    return lengths[6] > 0 ? fields[6][0] : '.';
+}
+
+char HintLine::frame() const {
+    return lengths[7] > 0 ? fields[7][0] : '.';
+}
+
+bool HintLine::attribute(const char * name, const char * & value,
+                         size_t & length) const {
+    size_t nameLength = strlen(name);
+    const char * position = fields[8];
+    while (position < lineEnd) {
+        while (position < lineEnd && *position == ' ') {
+            position++;
+        }
+        const char * separator = (const char *) memchr(position, ';', lineEnd - position);
+        if (separator == NULL) {
+            separator = lineEnd;
+        }
+        if ((size_t) (separator - position) > nameLength &&
+                strncmp(position, name, nameLength) == 0 &&
+                position[nameLength] == '=') {
+            value = position + nameLength + 1;
+            length = separator - value;
+            return true;
+        }
+        position = separator + 1;
+    }
+    return false;
+}
+
+bool HintLine::score(double & score, const char ** name) const {
+    const char * value;
+    size_t length;
+    const char * found = "al_score";
+    if (!attribute(found, value, length)) {
+        found = "eScore";
+        if (!attribute(found, value, length)) {
+            return false;
+        }
+    }
+    if (name != NULL) {
+        *name = found;
+    }
+    const char * exact;
+    if (attribute("exact_score", exact, length)) {
+        value = exact;
+    }
+    score = strtod(value, NULL);
+    return true;
+}
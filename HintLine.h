@@ -0,0 +1,50 @@
+#ifndef HINT_LINE_H
+#define HINT_LINE_H
+
+#include <cstddef>
+
+using namespace std;
+
+/// Columns of a hint line in the GFF format printed by Alignment
+
+/**
+ * The columns point into the parsed line, which must stay valid while
+ * they are used.
+ */
+class HintLine {
+public:
+    /**
+     * Split a line without the trailing newline into the nine columns
+     * @return False if the line has fewer columns
+     */
+    bool parse(const char * line, size_t length);
+    const char * field(int column) const {
+        return fields[column];
+    }
+    size_t fieldLength(int column) const {
+        return lengths[column];
+    }
+    long long start() const;
+    long long end() const;
+    char strand() const;
+    char frame() const;
+    /**
+     * Find the value of an attribute in the last column
+     * @return False if the attribute is missing
+     */
+    bool attribute(const char * name, const char * & value, size_t & length) const;
+    /**
+     * The al_score of the hint, or the eScore of hints which have no
+     * al_score (CDS). The unrounded value of the exact_score attribute is
+     * used instead when the hint has one.
+     * @param name Receives "al_score" or "eScore" if not NULL
+     * @return False if the hint has neither
+     */
+    bool score(double & score, const char ** name = NULL) const;
+private:
+    const char * fields[9];
+    size_t lengths[9];
+    const char * lineEnd;
+};
+
+#endif /* HINT_LINE_H */
@@ -0,0 +1,98 @@
+#include "HintOutput.h"
+
+HintOutput::HintOutput() :
+aggregating(aggregator),
+sorting(sorter),
+selecting(selector),
+converting(columnarWriter) {
+    topK = 0;
+    aggregateReducers = 0;
+    sorted = false;
+    columnar = false;
+    output = NULL;
+}
+
+void HintOutput::setup(unsigned int topK, int aggregateReducers,
+                       unsigned long long aggregateMemory, bool sorted,
+                       unsigned long long sortMemory, const string & outputFile,
+                       bool columnar) {
+    this->topK = topK;
+    this->columnar = columnar;
+    this->aggregateReducers = aggregateReducers;
+    this->sorted = sorted;
+    if (topK > 0) {
+        selector.setup(topK);
+    }
+    if (aggregateReducers != 0) {
+        aggregator.setup(aggregateReducers, aggregateMemory, outputFile + ".run");
+    } else if (sorted) {
+        sorter.setup(sortMemory, outputFile + ".sortrun");
+    }
+}
+
+ostream & HintOutput::start(ostream & output) {
+    this->output = &output;
+    if (columnar) {
+        columnarWriter.start(output);
+        this->output = &converting;
+    }
+    if (topK > 0) {
+        return selecting;
+    }
+    if (aggregateReducers != 0) {
+        return aggregating;
+    }
+    if (sorted) {
+        return sorting;
+    }
+    return *this->output;
+}
+
+bool HintOutput::finish() {
+    if (!collect()) {
+        return false;
+    }
+    if (columnar) {
+        converting.flush();
+        return columnarWriter.finish();
+    }
+    return true;
+}
+
+bool HintOutput::collect() {
+    // Aggregated hints are always sorted
+    if (topK > 0) {
+        selecting.flush();
+        if (aggregateReducers != 0) {
+            selector.write(aggregating);
+        } else if (sorted) {
+            selector.write(sorting);
+        } else {
+            selector.write(*output);
+        }
+    }
+    if (aggregateReducers != 0) {
+        aggregating.flush();
+        return aggregator.write(*output);
+    }
+    if (sorted) {
+        sorting.flush();
+        return sorter.write(*output);
+    }
+    return true;
+}
+
+void TierSplitter::setOutputs(const vector<ostream *> & outputs) {
+    this->outputs = outputs;
+}
+
+void TierSplitter::line(const char * line, size_t length) {
+    ostream * output = outputs[0];
+    if (length >= 2 && line[0] == TIER_MARKER) {
+        output = outputs[(unsigned char) line[1]];
+        line += 2;
+        length -= 2;
+    }
+    output->write(line, length);
+    output->put('\n');
+}
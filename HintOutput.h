@@ -0,0 +1,93 @@
+#ifndef HINT_OUTPUT_H
+#define HINT_OUTPUT_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include "HintAggregator.h"
+#include "HintSorter.h"
+#include "HintSelector.h"
+#include "ColumnarFormat.h"
+#include "MappedFile.h"
+
+using namespace std;
+
+/// Starts the lines of hints printed for an extra threshold tier, followed
+/// by a byte with the index of the tier
+#define TIER_MARKER '\x1f'
+/// Maximum number of extra threshold tiers
+#define MAX_TIERS 100
+
+/// Post-processing of the hints written into one output file
+
+/**
+ * Hints written into stream() pass through the top-k selection, then the
+ * aggregation or sorting, all of which collect the hints and write them
+ * into the output in finish(). Without any post-processing, stream() is
+ * the output itself. In the columnar format, the lines which would be
+ * written into the output are converted by a ColumnarWriter instead.
+ */
+class HintOutput {
+public:
+    HintOutput();
+    /**
+     * @param topK              Number of hints kept per key, 0 for all
+     * @param aggregateReducers AGGREGATE_* flags, 0 disables aggregation
+     * @param aggregateMemory   Memory limit of the aggregation in bytes
+     * @param sorted            Whether the hints are sorted
+     * @param sortMemory        Memory limit of the sorting in bytes
+     * @param outputFile        Name of the output, temporary runs are
+     *                          created next to it
+     * @param columnar          Whether the output is in the columnar format
+     */
+    void setup(unsigned int topK, int aggregateReducers,
+               unsigned long long aggregateMemory, bool sorted,
+               unsigned long long sortMemory, const string & outputFile,
+               bool columnar);
+    /**
+     * Start writing hints into the output
+     * @return Stream which the hints are written into
+     */
+    ostream & start(ostream & output);
+    /**
+     * Write the collected hints into the output
+     * @return False if temporary runs could not be written or read
+     */
+    bool finish();
+private:
+    /**
+     * Write the hints collected by the post-processing into the output
+     */
+    bool collect();
+
+    unsigned int topK;
+    int aggregateReducers;
+    bool sorted;
+    bool columnar;
+    /// The output, or the conversion into the columnar format
+    ostream * output;
+    HintAggregator aggregator;
+    LineOutputStream aggregating;
+    HintSorter sorter;
+    LineOutputStream sorting;
+    HintSelector selector;
+    LineOutputStream selecting;
+    ColumnarWriter columnarWriter;
+    LineOutputStream converting;
+};
+
+/// Passes the lines of every threshold tier into the stream of the tier
+
+class TierSplitter : public LineListener {
+public:
+    /**
+     * @param outputs Streams of the tiers, unmarked lines of the main
+     *                output go into the first one
+     */
+    void setOutputs(const vector<ostream *> & outputs);
+    void line(const char * line, size_t length);
+private:
+    vector<ostream *> outputs;
+};
+
+#endif /* HINT_OUTPUT_H */
@@ -0,0 +1,195 @@
+#include "HintPartitioner.h"
+#include "HintLine.h"
+#include <iostream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+using namespace std;
+
+HintPartitioner::HintPartitioner() {
+    partitionBy = PARTITION_BY_CONTIG;
+    maxOpenFiles = 1;
+    buffered = 0;
+    openCount = 0;
+    error = false;
+}
+
+HintPartitioner::~HintPartitioner() {
+    close();
+    for (unordered_map<string, Partition *>::iterator it = partitionsByName.begin();
+            it != partitionsByName.end(); ++it) {
+        delete it->second;
+    }
+}
+
+void HintPartitioner::setup(int partitionBy, const string & pathTemplate,
+                            int maxOpenFiles) {
+    this->partitionBy = partitionBy;
+    this->pathTemplate = pathTemplate;
+    this->maxOpenFiles = maxOpenFiles > 0 ? maxOpenFiles : 1;
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        size_t available = limit.rlim_cur > 2 * PARTITION_RESERVED_FILES ?
+                limit.rlim_cur - PARTITION_RESERVED_FILES : limit.rlim_cur / 2;
+        if (this->maxOpenFiles > available) {
+            this->maxOpenFiles = available > 0 ? available : 1;
+        }
+    }
+}
+
+size_t HintPartitioner::partitions() const {
+    return partitionsByName.size();
+}
+
+unsigned long long HintPartitioner::opened() const {
+    return openCount;
+}
+
+HintPartitioner::Partition * HintPartitioner::partition(const char * line,
+                                                        size_t length) {
+    const char * key;
+    size_t keyLength;
+    if (partitionBy == PARTITION_BY_CONTIG) {
+        const char * tab = (const char *) memchr(line, '\t', length);
+        key = line;
+        keyLength = tab != NULL ? tab - line : length;
+    } else {
+        HintLine hint;
+        if (!hint.parse(line, length) || !hint.attribute("prot", key, keyLength)) {
+            return NULL;
+        }
+    }
+    string name(key, keyLength);
+    unordered_map<string, Partition *>::iterator it = partitionsByName.find(name);
+    if (it != partitionsByName.end()) {
+        return it->second;
+    }
+
+    Partition * partition = new Partition();
+    string fileName = name;
+    for (unsigned int i = 0; i < fileName.size(); i++) {
+        if (fileName[i] == '/') {
+            fileName[i] = '_';
+        }
+    }
+    if (fileName.empty() || fileName == "." || fileName == "..") {
+        fileName = "_" + fileName;
+    }
+    partition->path = pathTemplate;
+    size_t placeholder = partition->path.find(PARTITION_PLACEHOLDER);
+    partition->path.replace(placeholder, strlen(PARTITION_PLACEHOLDER), fileName);
+    partition->fd = -1;
+    partition->created = false;
+    partitionsByName[name] = partition;
+    return partition;
+}
+
+void HintPartitioner::line(const char * line, size_t length) {
+    Partition * partition = this->partition(line, length);
+    if (partition == NULL) {
+        if (!error) {
+            cerr << "error: Hint without a protein cannot be partitioned by "
+                    "gene: " << string(line, length) << endl;
+        }
+        error = true;
+        return;
+    }
+    partition->buffer.append(line, length);
+    partition->buffer.push_back('\n');
+    buffered += length + 1;
+    if (partition->buffer.size() >= PARTITION_BUFFER) {
+        flush(partition);
+    }
+    if (buffered >= PARTITION_MEMORY) {
+        flushAll();
+    }
+}
+
+bool HintPartitioner::open(Partition * partition) {
+    if (partition->fd >= 0) {
+        // Most recently used first
+        openFiles.splice(openFiles.begin(), openFiles, partition->recent);
+        return true;
+    }
+    if (openFiles.size() >= maxOpenFiles) {
+        closeFile(openFiles.back());
+    }
+    if (!partition->created) {
+        // Create missing directories of the path
+        for (size_t slash = partition->path.find('/', 1); slash != string::npos;
+                slash = partition->path.find('/', slash + 1)) {
+            mkdir(partition->path.substr(0, slash).c_str(), 0777);
+        }
+    }
+    int flags = O_WRONLY | O_CREAT | (partition->created ? O_APPEND : O_TRUNC);
+    partition->fd = ::open(partition->path.c_str(), flags, 0666);
+    if (partition->fd < 0) {
+        cerr << "error: Could not open output file \"" << partition->path <<
+                "\"" << endl;
+        return false;
+    }
+    partition->created = true;
+    openCount++;
+    openFiles.push_front(partition);
+    partition->recent = openFiles.begin();
+    return true;
+}
+
+void HintPartitioner::closeFile(Partition * partition) {
+    if (::close(partition->fd) != 0) {
+        error = true;
+    }
+    partition->fd = -1;
+    openFiles.erase(partition->recent);
+}
+
+bool HintPartitioner::flush(Partition * partition) {
+    if (partition->buffer.empty() || error) {
+        return !error;
+    }
+    if (!open(partition)) {
+        error = true;
+        return false;
+    }
+    const char * data = partition->buffer.data();
+    size_t length = partition->buffer.size();
+    size_t done = 0;
+    while (done < length) {
+        ssize_t bytes = write(partition->fd, data + done, length - done);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            cerr << "error: Could not write output file \"" << partition->path <<
+                    "\"" << endl;
+            error = true;
+            return false;
+        }
+        done += bytes;
+    }
+    buffered -= length;
+    partition->buffer.clear();
+    return true;
+}
+
+bool HintPartitioner::flushAll() {
+    for (unordered_map<string, Partition *>::iterator it = partitionsByName.begin();
+            it != partitionsByName.end(); ++it) {
+        flush(it->second);
+        string().swap(it->second->buffer);
+    }
+    buffered = 0;
+    return !error;
+}
+
+bool HintPartitioner::close() {
+    flushAll();
+    while (!openFiles.empty()) {
+        closeFile(openFiles.front());
+    }
+    return !error;
+}
@@ -0,0 +1,92 @@
+#ifndef HINT_PARTITIONER_H
+#define HINT_PARTITIONER_H
+
+#include "MappedFile.h"
+#include <string>
+#include <list>
+#include <unordered_map>
+
+using namespace std;
+
+/// Keys of the partitions
+#define PARTITION_BY_CONTIG 1
+#define PARTITION_BY_GENE 2
+/// Placeholder of the partition name in the path template
+#define PARTITION_PLACEHOLDER "{}"
+/// Buffered hints of a partition before they are written
+#define PARTITION_BUFFER (64 * 1024)
+/// Buffered hints of all partitions before all are written
+#define PARTITION_MEMORY (64 * 1024 * 1024)
+/// File descriptors kept free for the rest of the program
+#define PARTITION_RESERVED_FILES 64
+
+/// Splits hint lines into one file per contig or per gene
+
+/**
+ * The file of a partition is named by replacing PARTITION_PLACEHOLDER in
+ * the path template with the contig or protein (prot=) of the hint; "/" in
+ * names is replaced by "_" and missing directories are created. Hints are
+ * buffered per partition and appended to its file in the input order.
+ *
+ * Only a bounded number of files are open at once. When another file is
+ * needed, the least recently used one is closed and reopened in the append
+ * mode the next time it is written. Files are truncated when they are
+ * opened for the first time.
+ */
+class HintPartitioner : public LineListener {
+public:
+    HintPartitioner();
+    ~HintPartitioner();
+    /**
+     * @param partitionBy  PARTITION_BY_CONTIG or PARTITION_BY_GENE
+     * @param pathTemplate Path containing PARTITION_PLACEHOLDER
+     * @param maxOpenFiles Maximum number of open files, further limited by
+     *                     the limit of open files of the process
+     */
+    void setup(int partitionBy, const string & pathTemplate, int maxOpenFiles);
+    void line(const char * line, size_t length);
+    /**
+     * Write all buffered hints and close all files
+     * @return Whether all hints were written
+     */
+    bool close();
+    /**
+     * @return Number of partitions
+     */
+    size_t partitions() const;
+    /**
+     * @return Number of times any file was opened
+     */
+    unsigned long long opened() const;
+private:
+    struct Partition {
+        string path;
+        string buffer;
+        int fd;
+        /// Whether the file was already created (and truncated)
+        bool created;
+        /// Position in the list of open files
+        list<Partition *>::iterator recent;
+    };
+
+    Partition * partition(const char * line, size_t length);
+    bool flush(Partition * partition);
+    bool open(Partition * partition);
+    void closeFile(Partition * partition);
+    /**
+     * Write the hints of all partitions and release their buffers
+     */
+    bool flushAll();
+
+    int partitionBy;
+    string pathTemplate;
+    size_t maxOpenFiles;
+    unordered_map<string, Partition *> partitionsByName;
+    /// Open files, the most recently used first
+    list<Partition *> openFiles;
+    size_t buffered;
+    unsigned long long openCount;
+    bool error;
+};
+
+#endif /* HINT_PARTITIONER_H */
@@ -0,0 +1,81 @@
+#include "HintSelector.h"
+#include "HintLine.h"
+#include <algorithm>
+#include <limits>
+
+HintSelector::HintSelector() {
+    k = 1;
+    sequence = 0;
+}
+
+void HintSelector::setup(unsigned int k) {
+    this->k = k;
+}
+
+bool HintSelector::better(const Candidate & a, const Candidate & b) {
+    if (a.score != b.score) {
+        return a.score > b.score;
+    }
+    return a.sequence < b.sequence;
+}
+
+void HintSelector::line(const char * line, size_t length) {
+    Candidate candidate;
+    candidate.sequence = sequence++;
+    HintLine fields;
+    if (!fields.parse(line, length)) {
+        candidate.line.assign(line, length);
+        others.push_back(candidate);
+        return;
+    }
+    if (!fields.score(candidate.score)) {
+        candidate.score = -numeric_limits<double>::infinity();
+    }
+
+    key.clear();
+    int columns[] = {0, 2, 3, 4, 6};
+    for (int i = 0; i < 5; i++) {
+        key.append(fields.field(columns[i]), fields.fieldLength(columns[i]));
+        key.push_back('\t');
+    }
+    unordered_map<string, int>::iterator it = groupIndices.find(key);
+    if (it == groupIndices.end()) {
+        it = groupIndices.insert(make_pair(key, (int) groups.size())).first;
+        groups.push_back(vector<Candidate>());
+    }
+
+    vector<Candidate> & heap = groups[it->second];
+    if (heap.size() < k) {
+        candidate.line.assign(line, length);
+        heap.push_back(candidate);
+        push_heap(heap.begin(), heap.end(), better);
+    } else if (better(candidate, heap.front())) {
+        // Evict the worst kept hint and reuse its line
+        pop_heap(heap.begin(), heap.end(), better);
+        heap.back().score = candidate.score;
+        heap.back().sequence = candidate.sequence;
+        heap.back().line.assign(line, length);
+        push_heap(heap.begin(), heap.end(), better);
+    }
+}
+
+void HintSelector::write(ostream & output) {
+    vector<Candidate *> kept;
+    for (unsigned int i = 0; i < groups.size(); i++) {
+        for (unsigned int j = 0; j < groups[i].size(); j++) {
+            kept.push_back(&groups[i][j]);
+        }
+    }
+    for (unsigned int i = 0; i < others.size(); i++) {
+        kept.push_back(&others[i]);
+    }
+    sort(kept.begin(), kept.end(), [](const Candidate * a, const Candidate * b) {
+        return a->sequence < b->sequence;
+    });
+    for (unsigned int i = 0; i < kept.size(); i++) {
+        output << kept[i]->line << "\n";
+    }
+    groups.clear();
+    groupIndices.clear();
+    others.clear();
+}
@@ -0,0 +1,62 @@
+#ifndef HINT_SELECTOR_H
+#define HINT_SELECTOR_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <unordered_map>
+#include <stdint.h>
+#include "MappedFile.h"
+
+using namespace std;
+
+/// Keeps only the best scoring hints of every intron, exon, start and stop
+
+/**
+ * Hints are grouped by (contig, type, start, end, strand). Every group has
+ * a bounded min-heap with at most K hints ranked by their al_score (eScore
+ * for CDS), so a new hint either evicts the worst kept one right away or
+ * is dropped. Hints with equal scores are ranked by their input order.
+ * Only the kept hints are held in memory and they are written in the
+ * input order at the end. Lines which are not hints are kept.
+ */
+class HintSelector : public LineListener {
+public:
+    HintSelector();
+    /**
+     * @param k Number of hints kept per group
+     */
+    void setup(unsigned int k);
+    /**
+     * Add a single line without the trailing newline
+     */
+    void line(const char * line, size_t length);
+    /**
+     * Write the kept hints in the input order
+     */
+    void write(ostream & output);
+private:
+    struct Candidate {
+        double score;
+        /// Position in the input
+        uint64_t sequence;
+        string line;
+    };
+
+    /**
+     * Order of the heaps, the worst candidate is on the top
+     */
+    static bool better(const Candidate & a, const Candidate & b);
+
+    unsigned int k;
+    uint64_t sequence;
+    /// Heaps of the groups
+    vector<vector<Candidate> > groups;
+    unordered_map<string, int> groupIndices;
+    /// Lines which are not hints
+    vector<Candidate> others;
+    /// Key of the last hint, keeps its capacity
+    string key;
+};
+
+#endif /* HINT_SELECTOR_H */
@@ -0,0 +1,364 @@
+#include "HintSorter.h"
+#include "LoserTree.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+
+/// Buffer of the run files and merged inputs
+#define SORT_RUN_BUFFER (1024 * 1024)
+
+/// Sorted sequence of lines read one at a time during a merge
+
+class SortSource {
+public:
+    SortSource() {
+        file = NULL;
+        key.contig = NULL;
+        key.contigLength = 0;
+        key.start = 0;
+    }
+
+    virtual ~SortSource() {
+        if (file != NULL) {
+            fclose(file);
+        }
+    }
+
+    bool open(const string & name, const char * mode) {
+        this->name = name;
+        file = fopen(name.c_str(), mode);
+        if (file == NULL) {
+            return false;
+        }
+        setvbuf(file, NULL, _IOFBF, SORT_RUN_BUFFER);
+        return true;
+    }
+
+    /**
+     * Read the next line into head
+     * @return False at the end of the source or on an error
+     */
+    virtual bool next() = 0;
+
+    /**
+     * @return Whether the source could not be read
+     */
+    virtual bool failed() const {
+        return ferror(file) != 0;
+    }
+
+    string name;
+    string head;
+    HintSorter::Key key;
+protected:
+    FILE * file;
+};
+
+/// Run spilled by HintSorter, records with the key and the line
+
+class RunSource : public SortSource {
+public:
+    bool next() {
+        int64_t start;
+        uint32_t contigLength, length;
+        if (fread(&start, sizeof (start), 1, file) != 1 ||
+                fread(&contigLength, sizeof (contigLength), 1, file) != 1 ||
+                fread(&length, sizeof (length), 1, file) != 1) {
+            return false;
+        }
+        head.resize(length);
+        if (length > 0 && fread(&head[0], 1, length, file) != length) {
+            return false;
+        }
+        key.contig = head.data();
+        key.contigLength = contigLength;
+        key.start = start;
+        return true;
+    }
+};
+
+/// Text file which must already be sorted
+
+class TextSource : public SortSource {
+public:
+    TextSource() {
+        unsorted = false;
+    }
+
+    bool next() {
+        // The key of the previous line points into it
+        previous.swap(head);
+        HintSorter::Key previousKey = key;
+        previousKey.contig = previous.data();
+
+        head.clear();
+        int c;
+        while ((c = getc_unlocked(file)) != EOF && c != '\n') {
+            head.push_back((char) c);
+        }
+        if (c == EOF && head.empty()) {
+            return false;
+        }
+        key = HintSorter::key(head.data(), head.size());
+        if (previousKey.contigLength + previous.size() > 0 &&
+                HintSorter::less(key, previousKey)) {
+            unsorted = true;
+            return false;
+        }
+        return true;
+    }
+
+    bool failed() const {
+        return unsorted || SortSource::failed();
+    }
+
+    bool unsorted;
+private:
+    string previous;
+};
+
+/**
+ * Merge the sources, which have their first heads read, into the output
+ * @return False if a source could not be read
+ */
+static bool mergeSources(vector<SortSource *> & sources, ostream & output) {
+    auto less = [&sources](int a, int b) {
+        return HintSorter::less(sources[a]->key, sources[b]->key);
+    };
+    vector<bool> empty(sources.size());
+    for (unsigned int i = 0; i < sources.size(); i++) {
+        empty[i] = sources[i]->key.contig == NULL;
+    }
+    LoserTree<decltype(less)> tree(less);
+    tree.build(empty);
+    while (!tree.empty()) {
+        SortSource * source = sources[tree.winner()];
+        output.write(source->head.data(), source->head.size());
+        output.put('\n');
+        if (source->next()) {
+            tree.replay();
+        } else {
+            tree.finish();
+        }
+    }
+
+    bool success = true;
+    for (unsigned int i = 0; i < sources.size(); i++) {
+        if (sources[i]->failed()) {
+            TextSource * text = dynamic_cast<TextSource *> (sources[i]);
+            if (text != NULL && text->unsorted) {
+                cerr << "error: File \"" << sources[i]->name << "\" is not "
+                        "sorted by contig and start" << endl;
+            } else {
+                cerr << "error: Could not read \"" << sources[i]->name << "\"" << endl;
+            }
+            success = false;
+        }
+    }
+    return success && output.good();
+}
+
+/**
+ * Read the first heads of the sources, empty sources are marked by a NULL
+ * contig
+ */
+static void startSources(vector<SortSource *> & sources) {
+    for (unsigned int i = 0; i < sources.size(); i++) {
+        if (!sources[i]->next()) {
+            sources[i]->head.clear();
+            sources[i]->key.contig = NULL;
+        }
+    }
+}
+
+HintSorter::HintSorter() {
+    memoryLimit = 0;
+    error = false;
+}
+
+HintSorter::~HintSorter() {
+    for (unsigned int i = 0; i < runs.size(); i++) {
+        remove(runs[i].c_str());
+    }
+}
+
+void HintSorter::setup(unsigned long long memoryLimit, string runPrefix) {
+    this->memoryLimit = memoryLimit;
+    this->runPrefix = runPrefix;
+}
+
+HintSorter::Key HintSorter::key(const char * line, size_t length) {
+    Key key;
+    key.contig = line;
+    key.start = 0;
+    const char * end = line + length;
+    const char * tab = (const char *) memchr(line, '\t', length);
+    key.contigLength = tab == NULL ? length : tab - line;
+    // Skip to the fourth column
+    for (int column = 1; column < 4 && tab != NULL; column++) {
+        const char * field = tab + 1;
+        tab = column < 3 ? (const char *) memchr(field, '\t', end - field) : field;
+    }
+    if (tab == NULL) {
+        return key;
+    }
+    const char * c = tab;
+    bool negative = c < end && *c == '-';
+    if (negative) {
+        c++;
+    }
+    while (c < end && *c >= '0' && *c <= '9') {
+        key.start = key.start * 10 + (*c - '0');
+        c++;
+    }
+    if (negative) {
+        key.start = -key.start;
+    }
+    return key;
+}
+
+bool HintSorter::less(const Key & a, const Key & b) {
+    int order = memcmp(a.contig, b.contig, min(a.contigLength, b.contigLength));
+    if (order != 0) {
+        return order < 0;
+    }
+    if (a.contigLength != b.contigLength) {
+        return a.contigLength < b.contigLength;
+    }
+    return a.start < b.start;
+}
+
+HintSorter::Key HintSorter::key(const Record & record) const {
+    Key key;
+    key.contig = arena.data() + record.offset;
+    key.contigLength = record.contigLength;
+    key.start = record.start;
+    return key;
+}
+
+void HintSorter::line(const char * line, size_t length) {
+    Key lineKey = key(line, length);
+    Record record;
+    record.offset = arena.size();
+    record.length = length;
+    record.contigLength = lineKey.contigLength;
+    record.start = lineKey.start;
+    arena.append(line, length);
+    records.push_back(record);
+    if (memoryLimit > 0 && arena.size() + records.size() * sizeof (Record) > memoryLimit &&
+            !spill()) {
+        error = true;
+    }
+}
+
+void HintSorter::sortRecords() {
+    stable_sort(records.begin(), records.end(),
+                [this](const Record & a, const Record & b) {
+                    return less(key(a), key(b));
+                });
+}
+
+bool HintSorter::spill() {
+    if (records.empty()) {
+        return true;
+    }
+    sortRecords();
+    stringstream name;
+    name << runPrefix << runs.size();
+    FILE * file = fopen(name.str().c_str(), "wb");
+    if (file == NULL) {
+        cerr << "error: Could not create sort run \"" << name.str() << "\"" << endl;
+        return false;
+    }
+    runs.push_back(name.str());
+    setvbuf(file, NULL, _IOFBF, SORT_RUN_BUFFER);
+    bool success = true;
+    for (unsigned int i = 0; i < records.size() && success; i++) {
+        int64_t start = records[i].start;
+        success = fwrite(&start, sizeof (start), 1, file) == 1 &&
+                fwrite(&records[i].contigLength, sizeof (uint32_t), 1, file) == 1 &&
+                fwrite(&records[i].length, sizeof (uint32_t), 1, file) == 1 &&
+                fwrite(arena.data() + records[i].offset, 1, records[i].length, file) ==
+                records[i].length;
+    }
+    success = fclose(file) == 0 && success;
+    if (!success) {
+        cerr << "error: Could not write sort run \"" << name.str() << "\"" << endl;
+    }
+    arena.clear();
+    records.clear();
+    return success;
+}
+
+bool HintSorter::write(ostream & output) {
+    if (error) {
+        return false;
+    }
+    if (runs.empty()) {
+        sortRecords();
+        for (unsigned int i = 0; i < records.size(); i++) {
+            output.write(arena.data() + records[i].offset, records[i].length);
+            output.put('\n');
+        }
+        arena.clear();
+        records.clear();
+        return true;
+    }
+    // Earlier runs win ties, which keeps equal keys in the input order
+    if (!spill()) {
+        return false;
+    }
+    bool success = mergeRuns(output);
+    for (unsigned int i = 0; i < runs.size(); i++) {
+        remove(runs[i].c_str());
+    }
+    runs.clear();
+    return success;
+}
+
+bool HintSorter::mergeRuns(ostream & output) {
+    vector<SortSource *> sources;
+    bool success = true;
+    for (unsigned int i = 0; i < runs.size(); i++) {
+        sources.push_back(new RunSource());
+        if (!sources.back()->open(runs[i], "rb")) {
+            cerr << "error: Could not open sort run \"" << runs[i] << "\"" << endl;
+            success = false;
+            break;
+        }
+    }
+    if (success) {
+        startSources(sources);
+        success = mergeSources(sources, output);
+    }
+    for (unsigned int i = 0; i < sources.size(); i++) {
+        delete sources[i];
+    }
+    return success;
+}
+
+bool HintSorter::merge(const vector<string> & files, ostream & output) {
+    vector<SortSource *> sources;
+    bool success = true;
+    for (unsigned int i = 0; i < files.size(); i++) {
+        sources.push_back(new TextSource());
+        if (!sources.back()->open(files[i], "r")) {
+            cerr << "error: Could not open \"" << files[i] << "\"" << endl;
+            success = false;
+            break;
+        }
+    }
+    if (success) {
+        startSources(sources);
+        success = mergeSources(sources, output);
+    }
+    for (unsigned int i = 0; i < sources.size(); i++) {
+        delete sources[i];
+    }
+    return success;
+}
+
+int HintSorter::spills() const {
+    return runs.size();
+}
@@ -0,0 +1,92 @@
+#ifndef HINT_SORTER_H
+#define HINT_SORTER_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdio>
+#include <stdint.h>
+#include "MappedFile.h"
+
+using namespace std;
+
+/// Sorts hint lines by contig and start coordinate
+
+/**
+ * Lines are kept in an arena until they outgrow the memory limit, then
+ * they are sorted and spilled into a binary run file next to the output.
+ * At the end all runs are merged with a loser tree. Contig names are
+ * compared bytewise and the sort is stable, so the result is the same as
+ * with "LC_ALL=C sort -s -t TAB -k1,1 -k4,4n".
+ */
+class HintSorter : public LineListener {
+public:
+    HintSorter();
+    ~HintSorter();
+    /**
+     * @param memoryLimit Approximate memory used by the lines before they
+     *                    are spilled, in bytes, 0 for no limit
+     * @param runPrefix   Prefix of the names of spilled run files
+     */
+    void setup(unsigned long long memoryLimit, string runPrefix);
+    /**
+     * Add a single line without the trailing newline
+     */
+    void line(const char * line, size_t length);
+    /**
+     * Write all lines in the sorted order and remove the spilled runs
+     * @return Whether all runs could be written and read
+     */
+    bool write(ostream & output);
+    /**
+     * @return Number of runs spilled to disk so far
+     */
+    int spills() const;
+    /**
+     * Merge files which are already sorted, e.g. outputs of several runs
+     * with --sorted, into one sorted output
+     * @return False if a file cannot be read or is not sorted
+     */
+    static bool merge(const vector<string> & files, ostream & output);
+
+    /// Sort key of a line
+    struct Key {
+        const char * contig;
+        uint32_t contigLength;
+        long long start;
+    };
+
+    /**
+     * Read the contig (first column) and the start (fourth column) of a
+     * line. Lines with fewer columns sort with start 0.
+     */
+    static Key key(const char * line, size_t length);
+    static bool less(const Key & a, const Key & b);
+
+private:
+    /// Line stored in the arena
+    struct Record {
+        size_t offset;
+        uint32_t length;
+        uint32_t contigLength;
+        long long start;
+    };
+
+    Key key(const Record & record) const;
+    void sortRecords();
+    /**
+     * Sort the lines in memory and write them into a new run file
+     */
+    bool spill();
+    bool mergeRuns(ostream & output);
+
+    unsigned long long memoryLimit;
+    string runPrefix;
+    vector<string> runs;
+    string arena;
+    vector<Record> records;
+    /// Whether spilling a run failed
+    bool error;
+};
+
+#endif /* HINT_SORTER_H */
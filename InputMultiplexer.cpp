@@ -0,0 +1,152 @@
+#include "InputMultiplexer.h"
+#include <iostream>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+
+InputMultiplexer::InputMultiplexer() : buffer(MULTIPLEX_READ_SIZE) {
+    epollFd = -1;
+    nextRegular = 0;
+    regularTurn = false;
+    openInputs = 0;
+    openRegular = 0;
+    error = false;
+}
+
+InputMultiplexer::~InputMultiplexer() {
+    close();
+}
+
+bool InputMultiplexer::open(const vector<string> & filenames) {
+    close();
+    epollFd = epoll_create1(0);
+    if (epollFd < 0) {
+        cerr << "error: Could not create an epoll instance" << endl;
+        return false;
+    }
+
+    for (unsigned int i = 0; i < filenames.size(); i++) {
+        Input input;
+        input.name = filenames[i];
+        input.fd = ::open(filenames[i].c_str(), O_RDONLY | O_NONBLOCK);
+        if (input.fd < 0) {
+            cerr << "error: Could not open input file \"" << filenames[i] << "\"" << endl;
+            close();
+            return false;
+        }
+        input.open = true;
+
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        input.regular = false;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, input.fd, &event) != 0) {
+            if (errno != EPERM) {
+                cerr << "error: Could not watch input file \"" << filenames[i] << "\"" << endl;
+                ::close(input.fd);
+                close();
+                return false;
+            }
+            // Regular files are always ready
+            input.regular = true;
+            openRegular++;
+        }
+        inputs.push_back(input);
+        openInputs++;
+    }
+    return true;
+}
+
+bool InputMultiplexer::next(int & input, const char * & data, size_t & length) {
+    while (openInputs > 0) {
+        while (!ready.empty()) {
+            input = ready.back();
+            ready.pop_back();
+            if (inputs[input].open && read(input, data, length)) {
+                return true;
+            }
+        }
+
+        // One block of the next regular file after every epoll round
+        if (regularTurn) {
+            regularTurn = false;
+            for (size_t k = 0; k < inputs.size(); k++) {
+                input = (nextRegular + k) % inputs.size();
+                if (inputs[input].regular && inputs[input].open) {
+                    nextRegular = input + 1;
+                    read(input, data, length);
+                    return true;
+                }
+            }
+        }
+
+        if (openInputs > openRegular) {
+            // Do not block while regular files are waiting to be read
+            struct epoll_event events[MULTIPLEX_EVENTS];
+            int count = epoll_wait(epollFd, events, MULTIPLEX_EVENTS,
+                                   openRegular > 0 ? 0 : -1);
+            if (count < 0 && errno != EINTR) {
+                cerr << "error: Waiting for the inputs failed" << endl;
+                error = true;
+                return false;
+            }
+            for (int i = 0; i < count; i++) {
+                ready.push_back(events[i].data.u32);
+            }
+        }
+        regularTurn = openRegular > 0;
+    }
+    return false;
+}
+
+bool InputMultiplexer::read(int input, const char * & data, size_t & length) {
+    ssize_t bytes = ::read(inputs[input].fd, buffer.data(), buffer.size());
+    if (bytes < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return false;
+        }
+        cerr << "error: Could not read input file \"" << inputs[input].name << "\"" << endl;
+        error = true;
+        bytes = 0;
+    }
+    data = buffer.data();
+    length = bytes;
+    if (bytes == 0) {
+        finish(input);
+    }
+    return true;
+}
+
+void InputMultiplexer::finish(int input) {
+    if (!inputs[input].regular) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, inputs[input].fd, NULL);
+    } else {
+        openRegular--;
+    }
+    ::close(inputs[input].fd);
+    inputs[input].open = false;
+    openInputs--;
+}
+
+bool InputMultiplexer::failed() const {
+    return error;
+}
+
+void InputMultiplexer::close() {
+    for (unsigned int i = 0; i < inputs.size(); i++) {
+        if (inputs[i].open) {
+            ::close(inputs[i].fd);
+        }
+    }
+    inputs.clear();
+    ready.clear();
+    if (epollFd >= 0) {
+        ::close(epollFd);
+        epollFd = -1;
+    }
+    nextRegular = 0;
+    regularTurn = false;
+    openInputs = 0;
+    openRegular = 0;
+}
@@ -0,0 +1,75 @@
+#ifndef INPUT_MULTIPLEXER_H
+#define INPUT_MULTIPLEXER_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/// Size of a single read from one input
+#define MULTIPLEX_READ_SIZE (256 * 1024)
+/// Maximum number of epoll events handled at once
+#define MULTIPLEX_EVENTS 64
+
+/// Reads several files and FIFOs concurrently with epoll
+
+/**
+ * Every input is read as soon as it has data, so that a slow producer
+ * does not hold up the others. Inputs are opened non-blocking; FIFOs whose
+ * writers did not start yet simply produce no data until they do. Regular
+ * files cannot be watched by epoll and are treated as always ready.
+ */
+class InputMultiplexer {
+public:
+    InputMultiplexer();
+    ~InputMultiplexer();
+    /**
+     * Open all inputs
+     * @return False when an input could not be opened
+     */
+    bool open(const vector<string> & filenames);
+    /**
+     * Wait for the next block of any input. The block stays valid until
+     * the following call. An empty block reports the end of the input.
+     * @return False when all inputs ended
+     */
+    bool next(int & input, const char * & data, size_t & length);
+    /**
+     * @return Whether reading any of the inputs failed
+     */
+    bool failed() const;
+    void close();
+private:
+    struct Input {
+        string name;
+        int fd;
+        /// Regular file, read without waiting for epoll
+        bool regular;
+        bool open;
+    };
+
+    /**
+     * Read one block from an input which is ready
+     * @return False when no data are available yet
+     */
+    bool read(int input, const char * & data, size_t & length);
+    /**
+     * Close an ended input
+     */
+    void finish(int input);
+
+    int epollFd;
+    vector<Input> inputs;
+    /// Inputs reported as ready and not read yet
+    vector<int> ready;
+    /// Position of the next regular file to read, rotates for fairness
+    size_t nextRegular;
+    /// Whether a regular file is read before the next epoll round
+    bool regularTurn;
+    int openInputs;
+    int openRegular;
+    bool error;
+    vector<char> buffer;
+};
+
+#endif /* INPUT_MULTIPLEXER_H */
@@ -4,8 +4,22 @@
 
 using namespace std;
 
+Kernel::Kernel() {
+    width = 0;
+}
+
 void Kernel::setWidth(int width) {
     this->width = width;
+    weights.resize(width);
+    fixedWeights.resize(width);
+    for (int i = 0; i < width; i++) {
+        weights[i] = getWeight(i);
+        fixedWeights[i] = (int32_t) floor(weights[i] * KERNEL_FIXED_ONE + 0.5);
+    }
+}
+
+int Kernel::getWidth() const {
+    return width;
 }
 
 double Kernel::weightSum() {
@@ -16,6 +30,30 @@ double Kernel::weightSum() {
     return weightSum;
 }
 
+int32_t Kernel::getFixedWeight(int offset) const {
+    offset = abs(offset);
+    if (offset < (int) fixedWeights.size()) {
+        return fixedWeights[offset];
+    }
+    return 0;
+}
+
+int32_t Kernel::fixedWeightSum() const {
+    int32_t weightSum = 0;
+    for (unsigned int i = 0; i < fixedWeights.size(); i++) {
+        weightSum += fixedWeights[i];
+    }
+    return weightSum;
+}
+
+const double * Kernel::getWeights() const {
+    return weights.data();
+}
+
+const int32_t * Kernel::getFixedWeights() const {
+    return fixedWeights.data();
+}
+
 double BoxKernel::getWeight(int offset) {
     offset = abs(offset);
     if (offset < width) {
@@ -1,9 +1,18 @@
 #ifndef KERNEL_H
 #define KERNEL_H
 
+#include <vector>
+#include <stdint.h>
+
+/// Number of fractional bits of fixed-point kernel weights
+#define KERNEL_FIXED_SHIFT 14
+/// Fixed-point representation of weight 1
+#define KERNEL_FIXED_ONE (1 << KERNEL_FIXED_SHIFT)
+
 /// Abstract Kernel class
 class Kernel {
 public:
+    Kernel();
     /**
      * Return weight at OFFSET amino acids away from the boundary
      * @param offset Distance from the boundary (in amino acids).
@@ -15,13 +24,38 @@ public:
      * Set scoring window width
      */
     virtual void setWidth(int width);
+    /**
+     * @return Scoring window width
+     */
+    int getWidth() const;
     /**
      * Sum of all kernel weights within a window, are under kernel
      */
     virtual double weightSum();
+    /**
+     * Return weight at OFFSET amino acids away from the boundary, quantized
+     * to a fixed-point number with KERNEL_FIXED_SHIFT fractional bits
+     */
+    int32_t getFixedWeight(int offset) const;
+    /**
+     * Sum of all quantized kernel weights within a window
+     */
+    int32_t fixedWeightSum() const;
+    /**
+     * @return Weights at offsets 0 to width - 1, precomputed when the width
+     *         is set
+     */
+    const double * getWeights() const;
+    /**
+     * @return Quantized weights at offsets 0 to width - 1
+     */
+    const int32_t * getFixedWeights() const;
     virtual ~Kernel() {}
 protected:
     int width;
+    /// Weights precomputed when the width is set
+    std::vector<double> weights;
+    std::vector<int32_t> fixedWeights;
 };
 
 /// Box Kernel
@@ -0,0 +1,116 @@
+#ifndef LOSER_TREE_H
+#define LOSER_TREE_H
+
+#include <vector>
+
+using namespace std;
+
+/// Tournament tree selecting the smallest head of k sorted sources
+
+/**
+ * Internal nodes keep the loser of the match played in them and node 0
+ * keeps the overall winner. When the head of the winning source changes,
+ * only the path from its leaf to the root is replayed, which takes
+ * log2(k) comparisons against the stored losers, half of what a binary
+ * heap needs. Sources with equal heads are taken in the order of their
+ * indices, so merging runs of a stable sort stays stable.
+ *
+ * Less is a function object where less(a, b) tells whether the head of
+ * source a is smaller than the head of source b.
+ */
+template<class Less>
+class LoserTree {
+public:
+    LoserTree(Less less) : less(less), sources(0) {}
+
+    /**
+     * Play the initial tournament
+     * @param empty Sources which have no head, the heads of all others must
+     *              be available
+     */
+    void build(const vector<bool> & empty) {
+        sources = empty.size();
+        exhausted = empty;
+        tree.assign(sources > 0 ? sources : 1, 0);
+        vector<int> winners(tree.size(), 0);
+        for (int node = sources - 1; node >= 1; node--) {
+            int a = contestant(2 * node, winners);
+            int b = contestant(2 * node + 1, winners);
+            if (precedes(b, a)) {
+                winners[node] = b;
+                tree[node] = a;
+            } else {
+                winners[node] = a;
+                tree[node] = b;
+            }
+        }
+        tree[0] = sources > 1 ? winners[1] : 0;
+    }
+
+    /**
+     * @return Index of the source with the smallest head
+     */
+    int winner() const {
+        return tree[0];
+    }
+
+    /**
+     * @return Whether all sources are exhausted
+     */
+    bool empty() const {
+        return sources == 0 || exhausted[tree[0]];
+    }
+
+    /**
+     * Update the tree after the head of the winning source has changed
+     */
+    void replay() {
+        replay(tree[0]);
+    }
+
+    /**
+     * Mark the winning source as exhausted and update the tree
+     */
+    void finish() {
+        exhausted[tree[0]] = true;
+        replay(tree[0]);
+    }
+
+private:
+    int contestant(int node, const vector<int> & winners) const {
+        return node >= sources ? node - sources : winners[node];
+    }
+
+    bool precedes(int a, int b) const {
+        if (exhausted[a] || exhausted[b]) {
+            return !exhausted[a] || (exhausted[b] && a < b);
+        }
+        if (less(a, b)) {
+            return true;
+        }
+        return !less(b, a) && a < b;
+    }
+
+    void replay(int source) {
+        if (sources == 0) {
+            return;
+        }
+        int winner = source;
+        for (int node = (source + sources) / 2; node >= 1; node /= 2) {
+            if (precedes(tree[node], winner)) {
+                int loser = winner;
+                winner = tree[node];
+                tree[node] = loser;
+            }
+        }
+        tree[0] = winner;
+    }
+
+    Less less;
+    int sources;
+    /// Losers of the matches in the internal nodes, tree[0] is the winner
+    vector<int> tree;
+    vector<bool> exhausted;
+};
+
+#endif /* LOSER_TREE_H */
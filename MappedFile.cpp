@@ -0,0 +1,167 @@
+#include "MappedFile.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+/// Put area of a LineStreamBuffer
+#define LINE_STREAM_BUFFER (64 * 1024)
+
+MappedFile::MappedFile() {
+    mapping = NULL;
+    mappingLength = 0;
+    startOffset = 0;
+}
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+bool MappedFile::map(int fd) {
+    unmap();
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+    off_t position = lseek(fd, 0, SEEK_CUR);
+    if (position < 0 || position > info.st_size) {
+        return false;
+    }
+    startOffset = position;
+    mappingLength = info.st_size;
+    if (mappingLength == 0) {
+        // Nothing to map, an empty input is still valid
+        return true;
+    }
+
+    void * result = mmap(NULL, mappingLength, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (result == MAP_FAILED) {
+        mappingLength = 0;
+        return false;
+    }
+    mapping = (char *) result;
+    madvise(mapping, mappingLength, MADV_SEQUENTIAL);
+    return true;
+}
+
+bool MappedFile::map(string filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool result = map(fd);
+    close(fd);
+    return result;
+}
+
+void MappedFile::unmap() {
+    if (mapping != NULL) {
+        munmap(mapping, mappingLength);
+    }
+    mapping = NULL;
+    mappingLength = 0;
+    startOffset = 0;
+}
+
+const char * MappedFile::data() const {
+    if (mapping == NULL) {
+        return "";
+    }
+    return mapping + startOffset;
+}
+
+const char * MappedFile::fileData() const {
+    if (mapping == NULL) {
+        return "";
+    }
+    return mapping;
+}
+
+size_t MappedFile::size() const {
+    return mappingLength - startOffset;
+}
+
+size_t MappedFile::offset() const {
+    return startOffset;
+}
+
+MemoryStreamBuffer::MemoryStreamBuffer(const char * data, size_t length) {
+    char * begin = const_cast<char *> (data);
+    setg(begin, begin, begin + length);
+}
+
+MemoryStream::MemoryStream(const char * data, size_t length) :
+istream(NULL),
+buffer(data, length) {
+    rdbuf(&buffer);
+}
+
+StringStreamBuffer::StringStreamBuffer(string & target) : target(target) {
+}
+
+int StringStreamBuffer::overflow(int c) {
+    if (c != EOF) {
+        target.push_back((char) c);
+    }
+    return c;
+}
+
+streamsize StringStreamBuffer::xsputn(const char * data, streamsize length) {
+    target.append(data, length);
+    return length;
+}
+
+StringOutputStream::StringOutputStream(string & target) :
+ostream(NULL),
+buffer(target) {
+    rdbuf(&buffer);
+}
+
+LineStreamBuffer::LineStreamBuffer(LineListener & listener) :
+listener(listener), buffer(LINE_STREAM_BUFFER) {
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+int LineStreamBuffer::overflow(int c) {
+    sync();
+    if (c != EOF) {
+        *pptr() = (char) c;
+        pbump(1);
+    }
+    return c == EOF ? 0 : c;
+}
+
+int LineStreamBuffer::sync() {
+    passLines(pbase(), pptr() - pbase());
+    setp(buffer.data(), buffer.data() + buffer.size());
+    return 0;
+}
+
+void LineStreamBuffer::passLines(const char * data, size_t length) {
+    const char * end = data + length;
+    while (data < end) {
+        const char * newline = (const char *) memchr(data, '\n', end - data);
+        if (newline == NULL) {
+            partial.append(data, end - data);
+            return;
+        }
+        if (partial.empty()) {
+            listener.line(data, newline - data);
+        } else {
+            partial.append(data, newline - data);
+            listener.line(partial.data(), partial.size());
+            partial.clear();
+        }
+        data = newline + 1;
+    }
+}
+
+LineOutputStream::LineOutputStream(LineListener & listener) :
+ostream(NULL),
+buffer(listener) {
+    rdbuf(&buffer);
+}
@@ -0,0 +1,130 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <streambuf>
+
+using namespace std;
+
+/// Read-only memory mapping of a regular file
+
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+    /**
+     * Map the contents of an open file descriptor, starting at the
+     * current file offset. Only regular files can be mapped.
+     * @return Whether the mapping succeeded
+     */
+    bool map(int fd);
+    /**
+     * Map the contents of a file
+     * @return Whether the mapping succeeded
+     */
+    bool map(string filename);
+    void unmap();
+    /**
+     * @return Pointer to the first mapped byte (at the starting offset)
+     */
+    const char * data() const;
+    /**
+     * @return Pointer to the start of the file, regardless of the offset
+     */
+    const char * fileData() const;
+    /**
+     * @return Number of bytes available after the starting offset
+     */
+    size_t size() const;
+    /**
+     * @return File offset corresponding to data()
+     */
+    size_t offset() const;
+private:
+    char * mapping;
+    size_t mappingLength;
+    size_t startOffset;
+};
+
+/// Stream buffer reading directly from memory, without copying it
+
+class MemoryStreamBuffer : public streambuf {
+public:
+    MemoryStreamBuffer(const char * data, size_t length);
+};
+
+/// Input stream over a memory range
+
+class MemoryStream : public istream {
+public:
+    MemoryStream(const char * data, size_t length);
+private:
+    MemoryStreamBuffer buffer;
+};
+
+/// Stream buffer appending to a string, which keeps its capacity between uses
+
+class StringStreamBuffer : public streambuf {
+public:
+    StringStreamBuffer(string & target);
+protected:
+    int overflow(int c);
+    streamsize xsputn(const char * data, streamsize length);
+private:
+    string & target;
+};
+
+/// Output stream appending to a string
+
+class StringOutputStream : public ostream {
+public:
+    StringOutputStream(string & target);
+private:
+    StringStreamBuffer buffer;
+};
+
+/// Receives the lines written to a LineOutputStream
+
+class LineListener {
+public:
+    /**
+     * @param line Line without the newline, valid only during the call
+     */
+    virtual void line(const char * line, size_t length) = 0;
+    virtual ~LineListener() {}
+};
+
+/// Stream buffer passing every complete written line to a listener
+
+class LineStreamBuffer : public streambuf {
+public:
+    LineStreamBuffer(LineListener & listener);
+protected:
+    int overflow(int c);
+    /**
+     * Pass all complete lines written so far to the listener
+     */
+    int sync();
+private:
+    void passLines(const char * data, size_t length);
+
+    LineListener & listener;
+    vector<char> buffer;
+    /// Line which was not completed yet
+    string partial;
+};
+
+/// Output stream whose lines are consumed by a listener instead of a file
+
+class LineOutputStream : public ostream {
+public:
+    LineOutputStream(LineListener & listener);
+private:
+    LineStreamBuffer buffer;
+};
+
+#endif /* MAPPED_FILE_H */
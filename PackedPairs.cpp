@@ -0,0 +1,246 @@
+#include "PackedPairs.h"
+#include "ScoreMatrix.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <ctype.h>
+
+using namespace std;
+
+static const char NUCLEOTIDES[] = "ACGTN-";
+static const int NUCLEOTIDE_GAP = PACKED_NUCLEOTIDE_GAP;
+static const int NUCLEOTIDE_EXCEPTION = PACKED_NUCLEOTIDE_EXCEPTION;
+static const char AMINO_ACIDS[] = " -13ARNDCQEGHILKMFPSTWYVBZX*UOJ";
+
+/// Code lookup tables for all byte values
+struct CodeTables {
+    CodeTables() {
+        for (int i = 0; i < 256; i++) {
+            nucleotide[i] = NUCLEOTIDE_EXCEPTION;
+            aminoAcid[i] = PACKED_AA_EXCEPTION;
+        }
+        for (int i = 0; NUCLEOTIDES[i] != '\0'; i++) {
+            nucleotide[(unsigned char) NUCLEOTIDES[i]] = i;
+            nucleotide[(unsigned char) tolower(NUCLEOTIDES[i])] = i;
+        }
+        for (int i = 0; AMINO_ACIDS[i] != '\0'; i++) {
+            aminoAcid[(unsigned char) AMINO_ACIDS[i]] = i;
+        }
+    }
+    int nucleotide[256];
+    int aminoAcid[256];
+};
+
+static const CodeTables codes;
+
+void PackedPairs::reset(int dnaStart, bool forward) {
+    this->dnaStart = dnaStart;
+    this->forward = forward;
+    pairs.clear();
+    gaps.clear();
+    nucleotideExceptions.clear();
+    translatedExceptions.clear();
+    proteinExceptions.clear();
+}
+
+void PackedPairs::push(char translatedCodon, char nucleotide, char protein, char type) {
+    int i = pairs.size();
+    int nucleotideCode = codes.nucleotide[(unsigned char) nucleotide];
+    // Case of nucleotides is implied by the type, keep any other symbol
+    // as an exception
+    if (nucleotideCode != NUCLEOTIDE_GAP && nucleotideCode != NUCLEOTIDE_EXCEPTION &&
+            (islower(nucleotide) != 0) != (type == 'i')) {
+        nucleotideCode = NUCLEOTIDE_EXCEPTION;
+    }
+    if (nucleotideCode == NUCLEOTIDE_EXCEPTION) {
+        nucleotideExceptions.push_back(make_pair(i, nucleotide));
+    }
+
+    if (nucleotide == '-' || nucleotide == ' ') {
+        if (!gaps.empty() && gaps.back().end == i) {
+            gaps.back().end++;
+        } else {
+            GapRun run;
+            run.start = i;
+            run.end = i + 1;
+            run.gapsBefore = gaps.empty() ? 0 :
+                    gaps.back().gapsBefore + gaps.back().end - gaps.back().start;
+            gaps.push_back(run);
+        }
+    }
+
+    pairs.push_back(nucleotideCode << NUCLEOTIDE_SHIFT | (type == 'i') << TYPE_SHIFT);
+    setTranslatedCodon(i, translatedCodon);
+    setProtein(i, protein);
+}
+
+void PackedPairs::assign(int dnaStart, bool forward, Columns & columns) {
+    reset(dnaStart, forward);
+    pairs.swap(columns.pairs);
+    nucleotideExceptions.swap(columns.nucleotideExceptions);
+    translatedExceptions.swap(columns.translatedExceptions);
+    proteinExceptions.swap(columns.proteinExceptions);
+
+    int gapCount = 0;
+    for (int i = 0; i < (int) pairs.size(); i++) {
+        if (!isGap(pairs[i])) {
+            continue;
+        }
+        if (!gaps.empty() && gaps.back().end == i) {
+            gaps.back().end++;
+        } else {
+            GapRun run;
+            run.start = i;
+            run.end = i + 1;
+            run.gapsBefore = gapCount;
+            gaps.push_back(run);
+        }
+        gapCount++;
+    }
+}
+
+int PackedPairs::size() const {
+    return pairs.size();
+}
+
+char PackedPairs::nucleotide(int i) const {
+    int code = (pairs[i] >> NUCLEOTIDE_SHIFT) & 0x7;
+    if (code == NUCLEOTIDE_EXCEPTION) {
+        return exception(nucleotideExceptions, i);
+    }
+    if (code != NUCLEOTIDE_GAP && type(i) == 'i') {
+        return tolower(NUCLEOTIDES[code]);
+    }
+    return NUCLEOTIDES[code];
+}
+
+char PackedPairs::translatedCodon(int i) const {
+    int code = (pairs[i] >> TRANSLATED_SHIFT) & 0x1F;
+    if (code == PACKED_AA_EXCEPTION) {
+        return exception(translatedExceptions, i);
+    }
+    return AMINO_ACIDS[code];
+}
+
+char PackedPairs::protein(int i) const {
+    int code = (pairs[i] >> PROTEIN_SHIFT) & 0x1F;
+    if (code == PACKED_AA_EXCEPTION) {
+        return exception(proteinExceptions, i);
+    }
+    return AMINO_ACIDS[code];
+}
+
+char PackedPairs::type(int i) const {
+    return (pairs[i] >> TYPE_SHIFT) & 1 ? 'i' : 'e';
+}
+
+void PackedPairs::setTranslatedCodon(int i, char symbol) {
+    setAminoAcid(i, TRANSLATED_SHIFT, translatedExceptions, symbol);
+}
+
+void PackedPairs::setProtein(int i, char symbol) {
+    setAminoAcid(i, PROTEIN_SHIFT, proteinExceptions, symbol);
+}
+
+void PackedPairs::setAminoAcid(int i, int shift, Exceptions & exceptions, char symbol) {
+    int code = codes.aminoAcid[(unsigned char) symbol];
+    if (code == PACKED_AA_EXCEPTION) {
+        setException(exceptions, i, symbol);
+    }
+    pairs[i] = (pairs[i] & ~(0x1F << shift)) | code << shift;
+}
+
+int PackedPairs::realPosition(int i) const {
+    // Count gaps up to and including position i
+    int gapCount = 0;
+    int low = 0, high = gaps.size();
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (gaps[middle].start <= i) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low > 0) {
+        const GapRun & run = gaps[low - 1];
+        gapCount = run.gapsBefore + min(i + 1, run.end) - run.start;
+    }
+
+    int nucleotides = i + 1 - gapCount;
+    if (forward) {
+        return dnaStart + nucleotides - 1;
+    }
+    return dnaStart - nucleotides + 1;
+}
+
+double PackedPairs::score(int i, const ScoreMatrix * scoreMatrix) const {
+    int translatedCode = (pairs[i] >> TRANSLATED_SHIFT) & 0x1F;
+    int proteinCode = (pairs[i] >> PROTEIN_SHIFT) & 0x1F;
+    if (translatedCode == PACKED_AA_EXCEPTION || proteinCode == PACKED_AA_EXCEPTION) {
+        return scoreMatrix->getScore(translatedCodon(i), protein(i));
+    }
+    return scoreMatrix->getCodeScore(translatedCode, proteinCode);
+}
+
+int PackedPairs::fixedScore(int i, const ScoreMatrix * scoreMatrix) const {
+    int translatedCode = (pairs[i] >> TRANSLATED_SHIFT) & 0x1F;
+    int proteinCode = (pairs[i] >> PROTEIN_SHIFT) & 0x1F;
+    if (translatedCode == PACKED_AA_EXCEPTION || proteinCode == PACKED_AA_EXCEPTION) {
+        return (int) scoreMatrix->getScore(translatedCodon(i), protein(i));
+    }
+    return scoreMatrix->getFixedCodeScore(translatedCode, proteinCode);
+}
+
+int PackedPairs::exonWindow(int start, int step, int width) const {
+    int size = pairs.size();
+    if (start < 0 || start >= size) {
+        return 0;
+    }
+    int count;
+    if (step > 0) {
+        count = (size - 1 - start) / step + 1;
+    } else {
+        count = start / -step + 1;
+    }
+    return CpuFeatures::kernels()->exonRun(pairs.data() + start, step,
+                                           min(count, width));
+}
+
+const uint16_t * PackedPairs::data() const {
+    return pairs.data();
+}
+
+bool PackedPairs::hasAminoAcidExceptions() const {
+    return !translatedExceptions.empty() || !proteinExceptions.empty();
+}
+
+int PackedPairs::nucleotideCode(char symbol) {
+    return codes.nucleotide[(unsigned char) symbol];
+}
+
+int PackedPairs::aminoAcidCode(char symbol) {
+    return codes.aminoAcid[(unsigned char) symbol];
+}
+
+char PackedPairs::aminoAcid(int code) {
+    return AMINO_ACIDS[code];
+}
+
+char PackedPairs::exception(const Exceptions & exceptions, int i) const {
+    Exceptions::const_iterator found = lower_bound(exceptions.begin(),
+            exceptions.end(), make_pair(i, (char) -128));
+    if (found == exceptions.end() || found->first != i) {
+        return ' ';
+    }
+    return found->second;
+}
+
+void PackedPairs::setException(Exceptions & exceptions, int i, char symbol) {
+    Exceptions::iterator found = lower_bound(exceptions.begin(),
+            exceptions.end(), make_pair(i, (char) -128));
+    if (found != exceptions.end() && found->first == i) {
+        found->second = symbol;
+    } else {
+        exceptions.insert(found, make_pair(i, symbol));
+    }
+}
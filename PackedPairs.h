@@ -0,0 +1,189 @@
+#ifndef PACKED_PAIRS_H
+#define PACKED_PAIRS_H
+
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+using namespace std;
+
+class ScoreMatrix;
+
+/// Number of symbols in the 5-bit amino acid alphabet (including exception)
+#define PACKED_AA_CODES 32
+/// Amino acid code marking a symbol stored in the exception list
+#define PACKED_AA_EXCEPTION 31
+/// Nucleotide code of gaps
+#define PACKED_NUCLEOTIDE_GAP 5
+/// Nucleotide code marking a symbol stored in the exception list
+#define PACKED_NUCLEOTIDE_EXCEPTION 6
+/// Bit of a packed pair marking intron positions
+#define PACKED_INTRON_BIT (1 << 13)
+/// Position of the translated codon code, followed by the protein code
+#define PACKED_SCORE_SHIFT 3
+/// Position of the protein code
+#define PACKED_PROTEIN_SHIFT (PACKED_SCORE_SHIFT + 5)
+/// Number of entries of score tables indexed by scoreIndex()
+#define PACKED_SCORE_TABLE_SIZE (PACKED_AA_CODES * PACKED_AA_CODES)
+
+/// Bit-packed nucleotide/amino acid pairs of an alignment
+
+/**
+ * Each alignment column is stored in 16 bits: 3 bits for the nucleotide
+ * (ACGTN, gap or exception), 5 bits for each of the translated codon and
+ * protein symbols (amino acids, gaps, spaces and the '1'/'3' codon
+ * placeholders) and 1 bit for the intron/exon type. Symbols which do not
+ * fit into the alphabets are kept in short exception lists. The case of
+ * nucleotides is given by the type bit (introns are lowercase). Genomic
+ * positions are not stored, they are reconstructed from runs of gaps.
+ */
+class PackedPairs {
+public:
+    /// Symbols which do not fit into the codes, sorted by column
+    typedef vector<pair<int, char> > Exceptions;
+    /// Columns packed outside of this class, e.g. decoded from a binary file
+    struct Columns {
+        /// One packed value per column, see pack()
+        vector<uint16_t> pairs;
+        Exceptions nucleotideExceptions;
+        Exceptions translatedExceptions;
+        Exceptions proteinExceptions;
+    };
+
+    /**
+     * Remove all pairs
+     * @param dnaStart Position of the first nucleotide
+     * @param forward  Whether positions increase along the alignment
+     */
+    void reset(int dnaStart, bool forward);
+    /**
+     * Append a single column
+     */
+    void push(char translatedCodon, char nucleotide, char protein, char type);
+    /**
+     * Replace all pairs by already packed columns, which are swapped into
+     * this object. Runs of gaps are rebuilt from the nucleotide codes.
+     */
+    void assign(int dnaStart, bool forward, Columns & columns);
+    int size() const;
+    char nucleotide(int i) const;
+    char translatedCodon(int i) const;
+    char protein(int i) const;
+    /**
+     * @return 'i' for intron and 'e' for exon
+     */
+    char type(int i) const;
+    void setTranslatedCodon(int i, char symbol);
+    void setProtein(int i, char symbol);
+    /**
+     * Set the code of a translated codon, which must not be an exception
+     */
+    void setTranslatedCode(int i, int code) {
+        pairs[i] = (pairs[i] & ~(0x1F << TRANSLATED_SHIFT)) | code << TRANSLATED_SHIFT;
+    }
+    /**
+     * Set the code of a protein symbol, which must not be an exception
+     */
+    void setProteinCode(int i, int code) {
+        pairs[i] = (pairs[i] & ~(0x1F << PROTEIN_SHIFT)) | code << PROTEIN_SHIFT;
+    }
+    /**
+     * Return position of a nucleotide relative to the gene start. Gaps
+     * share the position of the closest preceding nucleotide.
+     */
+    int realPosition(int i) const;
+    /**
+     * Return amino acid score of a column, computed directly from the
+     * amino acid codes
+     */
+    double score(int i, const ScoreMatrix * scoreMatrix) const;
+    /**
+     * Return integer amino acid score of a column, the matrix must be
+     * integer-valued
+     */
+    int fixedScore(int i, const ScoreMatrix * scoreMatrix) const;
+    /**
+     * Return number of positions START, START + STEP, ... which are inside
+     * the alignment and in an exon, up to WIDTH positions
+     */
+    int exonWindow(int start, int step, int width) const;
+    /**
+     * @return Packed pairs, one 16-bit value per column
+     */
+    const uint16_t * data() const;
+    /**
+     * @return Whether any amino acid symbol is stored as an exception. Such
+     *         pairs can not be scored through scoreIndex() tables.
+     */
+    bool hasAminoAcidExceptions() const;
+    /**
+     * @return Index of a packed pair into score tables, the translated
+     *         codon code plus 32 times the protein code
+     */
+    static int scoreIndex(uint16_t pair) {
+        return (pair >> PACKED_SCORE_SHIFT) & (PACKED_SCORE_TABLE_SIZE - 1);
+    }
+    /**
+     * @return Translated codon code of a packed pair
+     */
+    static int translatedCode(uint16_t pair) {
+        return (pair >> PACKED_SCORE_SHIFT) & (PACKED_AA_CODES - 1);
+    }
+    /**
+     * @return Protein code of a packed pair
+     */
+    static int proteinCode(uint16_t pair) {
+        return (pair >> PACKED_PROTEIN_SHIFT) & (PACKED_AA_CODES - 1);
+    }
+    /**
+     * @return Whether the nucleotide of a packed pair is a gap
+     */
+    static bool isGap(uint16_t pair) {
+        return (pair & 0x7) == PACKED_NUCLEOTIDE_GAP;
+    }
+    /**
+     * Pack a single column from its codes
+     */
+    static uint16_t pack(int nucleotideCode, int translatedCode, int proteinCode,
+                         bool intron) {
+        return nucleotideCode | translatedCode << PACKED_SCORE_SHIFT |
+                proteinCode << PACKED_PROTEIN_SHIFT | (intron ? PACKED_INTRON_BIT : 0);
+    }
+    /**
+     * @return 3-bit code of a DNA row symbol, the case is ignored
+     */
+    static int nucleotideCode(char symbol);
+    /**
+     * @return 5-bit code of an amino acid row symbol
+     */
+    static int aminoAcidCode(char symbol);
+    /**
+     * @return Amino acid row symbol of a 5-bit code
+     */
+    static char aminoAcid(int code);
+private:
+    /// Run of gaps in the DNA row
+    struct GapRun {
+        int start, end;
+        /// Number of gaps before the run
+        int gapsBefore;
+    };
+    char exception(const Exceptions & exceptions, int i) const;
+    void setException(Exceptions & exceptions, int i, char symbol);
+    void setAminoAcid(int i, int shift, Exceptions & exceptions, char symbol);
+
+    vector<uint16_t> pairs;
+    vector<GapRun> gaps;
+    Exceptions nucleotideExceptions;
+    Exceptions translatedExceptions;
+    Exceptions proteinExceptions;
+    int dnaStart;
+    bool forward;
+
+    static const int NUCLEOTIDE_SHIFT = 0;
+    static const int TRANSLATED_SHIFT = PACKED_SCORE_SHIFT;
+    static const int PROTEIN_SHIFT = PACKED_PROTEIN_SHIFT;
+    static const int TYPE_SHIFT = 13;
+};
+
+#endif /* PACKED_PAIRS_H */
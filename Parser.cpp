@@ -1,44 +1,1138 @@
 #include "Parser.h"
+#include "RecordScanner.h"
+#include "Hash.h"
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 using namespace std;
 
 Parser::Parser() {
     windowLength = 10;
     scoreMatrix = NULL;
+    kernel = NULL;
+    filter = NULL;
     processReverse = false;
+    threads = 1;
+    checkpointInterval = 60;
+    resume = false;
+    cacheSize = 0;
+    cacheParameters = 0;
+    integerScoring = false;
+    shardedOutput = false;
+    tagSources = false;
+    aggregateReducers = 0;
+    aggregateMemory = 0;
+    sorted = false;
+    sortMemory = 0;
+    topK = 0;
+    columnarOutput = false;
+    compression = COMPRESSION_AUTO;
+    partitionBy = 0;
+    maxPartitionFiles = 0;
+    flushAlignments = 0;
+    flushInterval = 0;
+    unflushed = 0;
+    finalOutput = NULL;
+    streamedOutput = NULL;
+    compressedStream = NULL;
 }
 
 int Parser::parse(string outputFile) {
-    // Restart output file
-    ofstream ofs(outputFile.c_str());
-    ofs.close();
+    this->outputFile = outputFile;
+    position = Checkpoint();
+    lastCheckpoint = time(NULL);
 
-    int status = parseNext();
+    int status = prepareScoring();
+    if (status != READ_SUCCESS) {
+        return status;
+    }
+    if (!checkpointFile.empty()) {
+        position.parameters = hashParameters();
+        position.inputSize = inputSize();
+    }
+
+    inputSkip = 0;
+    if (resume) {
+        status = resumeRun(outputFile);
+        if (status != READ_SUCCESS) {
+            return status;
+        }
+    }
+
+    // Sharded output is written by the workers with pwrite, other outputs
+    // are written behind by a dedicated thread, compressed ones after they
+    // are compressed by a pool of threads
+    ofstream ofs;
+    AsyncOutputStream asyncOutput;
+    CompressedOutputStream compressedOutput;
+    HintPartitioner partitioner;
+    LineOutputStream partitioning(partitioner);
+    ostream * output = &asyncOutput;
+    if (partitionBy != 0) {
+        // The output file name is the template of the partition files
+        partitioner.setup(partitionBy, outputFile, maxPartitionFiles);
+        output = &partitioning;
+    } else if (shardedOutput) {
+        if (resume) {
+            // Not opened in append mode, which would not report the length
+            ofs.open(outputFile.c_str(), std::ofstream::in | std::ofstream::out);
+            ofs.seekp(0, std::ofstream::end);
+        } else {
+            // Restart output file
+            ofs.open(outputFile.c_str());
+        }
+        output = &ofs;
+    } else if (compressed(outputFile)) {
+        compressedOutput.open(outputFile, threads);
+        output = &compressedOutput;
+    } else {
+        asyncOutput.open(outputFile, resume);
+    }
+    if (!*output) {
+        cerr << "error: Could not open output file \"" << outputFile << "\"" << endl;
+        return OPEN_FAIL;
+    }
+    finalOutput = output;
+    streamedOutput = &asyncOutput;
+    compressedStream = &compressedOutput;
+    unflushed = 0;
+    lastFlush = chrono::steady_clock::now();
+
+    // Temporary runs of the standard output are named after the process
+    string runName = outputFile;
+    if (outputFile == STANDARD_OUTPUT) {
+        const char * directory = getenv("TMPDIR");
+        stringstream name;
+        name << (directory != NULL && directory[0] != '\0' ? directory : "/tmp") <<
+                "/spaln_boundary_scorer." << getpid();
+        runName = name.str();
+    }
+
+    // Selected, aggregated and sorted hints are collected and written at
+    // the end
+    HintOutput mainHints;
+    mainHints.setup(topK, aggregateReducers, aggregateMemory, sorted,
+                    sortMemory, runName, columnarOutput);
+    ostream * hints = &mainHints.start(*output);
+
+    // Hints of the tiers are split from the main output before it is
+    // post-processed
+    vector<TierOutput *> tierOutputs;
+    TierSplitter splitter;
+    LineOutputStream splitting(splitter);
+    if (!tiers.empty()) {
+        vector<ostream *> streams(1, hints);
+        for (unsigned int i = 0; i < tiers.size(); i++) {
+            TierOutput * tier = new TierOutput();
+            tierOutputs.push_back(tier);
+            ostream * file = &tier->file;
+            if (compressed(tiers[i].outputFile)) {
+                tier->compressed.open(tiers[i].outputFile, threads);
+                file = &tier->compressed;
+            } else {
+                tier->file.open(tiers[i].outputFile.c_str(), std::ofstream::binary);
+            }
+            if (!*file) {
+                cerr << "error: Could not open output file \"" <<
+                        tiers[i].outputFile << "\"" << endl;
+                closeTiers(tierOutputs);
+                return OPEN_FAIL;
+            }
+            tier->hints.setup(topK, aggregateReducers, aggregateMemory, sorted,
+                              sortMemory, tiers[i].outputFile, columnarOutput);
+            streams.push_back(&tier->hints.start(*file));
+        }
+        splitter.setOutputs(streams);
+        hints = &splitting;
+    }
+
+    MappedFile input;
+    bool mapped = inputs.empty() && input.map(STDIN_FILENO);
+    if (!inputs.empty()) {
+        status = parseMultiplexed(*hints);
+    } else if (mapped && BinaryReader::isBinary(input.fileData(), input.offset() + input.size())) {
+        status = parseMapped(input, *hints, true);
+    } else if (mapped && BinaryReader::isOutdated(input.fileData(), input.offset() + input.size())) {
+        cerr << "error: The binary input was written by an older version, "
+                "convert the Spaln output again" << endl;
+        status = FORMAT_FAIL;
+    } else if (mapped && threads > 1) {
+        status = parseMapped(input, *hints, false);
+    } else {
+        // Streamed inputs are read ahead by a dedicated thread
+        AsyncReader reader;
+        reader.start(STDIN_FILENO, inputSkip);
+        LineReader lines(reader);
+        if (threads > 1) {
+            status = parsePipelined(lines, *hints);
+        } else {
+            status = parseStream(lines, *hints);
+        }
+        if (reader.failed()) {
+            if (!reader.skipped()) {
+                cerr << "error: Input is shorter than the checkpointed offset" << endl;
+            } else {
+                cerr << "error: Could not read the input" << endl;
+            }
+            status = FORMAT_FAIL;
+        }
+    }
+
+    if (!tiers.empty()) {
+        splitting.flush();
+    }
+    if (!mainHints.finish() && status == READ_SUCCESS && !outputClosed()) {
+        status = OPEN_FAIL;
+    }
+    for (unsigned int i = 0; i < tierOutputs.size(); i++) {
+        if (!tierOutputs[i]->hints.finish() && status == READ_SUCCESS) {
+            status = OPEN_FAIL;
+        }
+        bool closed = tierOutputs[i]->compressed.close();
+        if (tierOutputs[i]->file.is_open()) {
+            tierOutputs[i]->file.close();
+            closed = !tierOutputs[i]->file.fail();
+        }
+        if (!closed && status == READ_SUCCESS) {
+            cerr << "error: Could not write output file \"" <<
+                    tiers[i].outputFile << "\"" << endl;
+            status = OPEN_FAIL;
+        }
+    }
+    closeTiers(tierOutputs);
+    if (partitionBy != 0) {
+        partitioning.flush();
+        if (!partitioner.close() && status == READ_SUCCESS) {
+            status = OPEN_FAIL;
+        }
+    }
+    if (!checkpointFile.empty() && status != FORMAT_FAIL) {
+        checkpoint(position.inputOffset, *output, true);
+    }
+    bool closed = compressedOutput.close();
+    closed = (shardedOutput || asyncOutput.close()) && closed;
+    // A closed pipe of the standard output only ends the run early
+    if (!closed && !outputClosed() && status == READ_SUCCESS) {
+        cerr << "error: Could not write output file \"" << outputFile << "\"" << endl;
+        status = OPEN_FAIL;
+    }
+    finalOutput = NULL;
+    streamedOutput = NULL;
+    compressedStream = NULL;
+    cache.close();
+    return status;
+}
+
+int Parser::prepareScoring() {
+    // Set the kernel up before it is shared by worker threads
+    if (kernel != NULL) {
+        kernel->setWidth(windowLength);
+    }
+    if (integerScoring && !checkIntegerScoring()) {
+        return FORMAT_FAIL;
+    }
+
+    if (!cacheFile.empty() && !cache.isOpen()) {
+        if (!cache.open(cacheFile, cacheSize)) {
+            return OPEN_FAIL;
+        }
+        cacheParameters = hashParameters();
+    }
+    return READ_SUCCESS;
+}
+
+void Parser::scoreRecord(const char * record, size_t length, string & hints) {
+    StringOutputStream output(hints);
+    processRecord(record, length, false, alignment, output);
+}
+
+uint64_t Parser::hashParameters() {
+    uint64_t hash = hashCombine(CACHE_VERSION, windowLength);
+    for (int i = 0; i < windowLength; i++) {
+        double weight = kernel->getWeight(i);
+        hash = hash64(&weight, sizeof (weight), hash);
+    }
+    double thresholds[] = {minExonScore, minInitialExonScore, minInitialIntronScore};
+    hash = hash64(thresholds, sizeof (thresholds), hash);
+    if (filter != NULL) {
+        hash = hash64(filter->source().data(), filter->source().size(), hash);
+    }
+    for (unsigned int i = 0; i < tiers.size(); i++) {
+        double tierThresholds[] = {tiers[i].minExonScore, tiers[i].minInitialExonScore,
+            tiers[i].minInitialIntronScore};
+        hash = hash64(tierThresholds, sizeof (tierThresholds), hash);
+    }
+    // Binary records carry the strand filter after the cache lookup
+    hash = hashCombine(hash, processReverse);
+    hash = hashCombine(hash, integerScoring);
+    hash = hashCombine(hash, aggregateReducers != 0);
+    return hashCombine(hash, scoreMatrix->fingerprint());
+}
+
+unsigned long long Parser::inputSize() {
+    struct stat info;
+    if (fstat(STDIN_FILENO, &info) != 0 || !S_ISREG(info.st_mode)) {
+        return 0;
+    }
+    return info.st_size;
+}
+
+bool Parser::checkIntegerScoring() {
+    if (!scoreMatrix->isInteger()) {
+        cerr << "error: Integer scoring requires a matrix with integer scores" << endl;
+        return false;
+    }
+    long long maxAbsScore = -UNKNOWN_SCORE;
+    for (int i = 0; i < PACKED_AA_CODES; i++) {
+        for (int j = 0; j < PACKED_AA_CODES; j++) {
+            maxAbsScore = max(maxAbsScore,
+                    (long long) abs(scoreMatrix->getFixedCodeScore(i, j)));
+        }
+    }
+    if (maxAbsScore * KERNEL_FIXED_ONE * windowLength > INT32_MAX) {
+        cerr << "error: Scoring window is too wide for integer scoring" << endl;
+        return false;
+    }
+    return true;
+}
+
+int Parser::resumeRun(string outputFile) {
+    if (checkpointFile.empty()) {
+        cerr << "error: Resuming a run requires a checkpoint file" << endl;
+        return OPEN_FAIL;
+    }
+    if (access(checkpointFile.c_str(), F_OK) != 0) {
+        cerr << "warning: Checkpoint \"" << checkpointFile << "\" does not "
+                "exist, starting from the beginning" << endl;
+        // Start with an empty output, as if the run was not resumed
+        ofstream ofs(outputFile.c_str());
+        return READ_SUCCESS;
+    }
+    Checkpoint saved;
+    if (!saved.load(checkpointFile)) {
+        return FORMAT_FAIL;
+    }
+    // Joining outputs of different settings or inputs would go unnoticed
+    if (saved.parameters != position.parameters) {
+        cerr << "error: Checkpoint \"" << checkpointFile << "\" was written "
+                "with different scoring options" << endl;
+        return FORMAT_FAIL;
+    }
+    if (saved.inputSize != position.inputSize) {
+        cerr << "error: Checkpoint \"" << checkpointFile << "\" was written "
+                "for a different input" << endl;
+        return FORMAT_FAIL;
+    }
+    position = saved;
+
+    struct stat outputInfo;
+    if (stat(outputFile.c_str(), &outputInfo) != 0 ||
+            (unsigned long long) outputInfo.st_size < position.outputLength ||
+            truncate(outputFile.c_str(), position.outputLength) != 0) {
+        cerr << "error: Output file \"" << outputFile << "\" does not match "
+                "the checkpoint" << endl;
+        return OPEN_FAIL;
+    }
+
+    // Seek within regular files, the input reader skips the processed
+    // bytes otherwise
+    if (lseek(STDIN_FILENO, position.inputOffset, SEEK_CUR) < 0) {
+        inputSkip = position.inputOffset;
+    }
+
+    cerr << "Resuming after " << position.alignments << " alignments at "
+            "input offset " << position.inputOffset << endl;
+    return READ_SUCCESS;
+}
+
+void Parser::checkpoint(unsigned long long inputOffset, ostream & output,
+                        bool force) {
+    time_t now = time(NULL);
+    if (!force && now - lastCheckpoint < checkpointInterval) {
+        return;
+    }
+
+    output.flush();
+    // Make sure the output reaches the disk before the checkpoint does
+    int fd = open(outputFile.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+
+    position.inputOffset = inputOffset;
+    position.outputLength = output.tellp();
+    position.save(checkpointFile);
+    lastCheckpoint = now;
+}
 
-    while (status != NO_MORE_ALIGNMENTS) {
-        alignment.scoreHints(windowLength, scoreMatrix, kernel);
-        alignment.printHints(outputFile, minExonScore, minInitialExonScore,
-                             minInitialIntronScore);
-        status = parseNext();
+void Parser::flushOutput(ostream & output, unsigned long long alignments,
+                         bool idle) {
+    if (flushAlignments == 0 && flushInterval == 0) {
+        return;
+    }
+    unflushed += alignments;
+    if (unflushed == 0) {
+        return;
+    }
+    bool due = flushAlignments > 0 && unflushed >= flushAlignments;
+    chrono::steady_clock::time_point now;
+    if (flushInterval > 0) {
+        now = chrono::steady_clock::now();
+        due = due || idle || now - lastFlush >= chrono::milliseconds(flushInterval);
+    }
+    if (!due) {
+        return;
+    }
+    // Hints split into tiers pass through their own stream first
+    output.flush();
+    if (finalOutput != &output) {
+        finalOutput->flush();
     }
+    unflushed = 0;
+    lastFlush = flushInterval > 0 ? now : chrono::steady_clock::now();
+}
+
+bool Parser::outputClosed() const {
+    return (streamedOutput != NULL && streamedOutput->broken()) ||
+            (compressedStream != NULL && compressedStream->broken());
+}
 
+int Parser::parseStream(LineReader & input, ostream & output) {
+    RecordScanner scanner(processReverse);
+    const char * line;
+    size_t length;
+    bool newline;
+    string record;
+    unsigned long long inputOffset = position.inputOffset;
+
+    while (true) {
+        // Hints of finished alignments are not held back while the input
+        // is waited for
+        if (flushInterval > 0 && unflushed > 0 && input.waiting()) {
+            flushOutput(output, 0, true);
+        }
+        if (!input.next(line, length, newline)) {
+            break;
+        }
+        inputOffset += length + newline;
+        int state = scanner.feed(line, length);
+        if (state == SCAN_OUTSIDE) {
+            continue;
+        }
+        if (state == SCAN_START || state == SCAN_SINGLE) {
+            record.clear();
+        }
+        record.append(line, length);
+        record.push_back('\n');
+        if (state == SCAN_END || state == SCAN_SINGLE) {
+            processRecord(record.data(), record.size(), false, alignment, output);
+            position.alignments++;
+            if (!checkpointFile.empty()) {
+                checkpoint(inputOffset, output, false);
+            }
+            flushOutput(output, 1, false);
+            if (outputClosed()) {
+                break;
+            }
+        }
+    }
+
+    // Let the alignment parser report a truncated record
+    if (scanner.insideRecord()) {
+        processRecord(record.data(), record.size(), false, alignment, output);
+        position.alignments++;
+    }
+
+    position.inputOffset = inputOffset;
     return READ_SUCCESS;
 }
 
-int Parser::parseNext() {
+Parser::Pipeline::Pipeline(int slices) :
+slices(slices),
+free(slices),
+parsed(slices + 1),
+scored(slices + 1) {
+    for (int i = 0; i < slices; i++) {
+        this->slices[i].source = -1;
+        free.push(&this->slices[i]);
+    }
+}
+
+int Parser::parsePipelined(LineReader & input, ostream & output) {
+    Pipeline pipeline(threads * SLICES_PER_THREAD);
+    vector<thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(thread(&Parser::scoreSlices, this, &pipeline));
+    }
+    thread writer(&Parser::writeSlices, this, &pipeline, &output);
+
+    RecordScanner scanner(processReverse);
+    unsigned long long inputOffset = position.inputOffset;
+    unsigned long long sequence = 0;
+    Slice * slice = NULL;
+    size_t recordStart = 0;
+    const char * line;
+    size_t lineLength;
+    bool newline;
+
+    while (true) {
+        if (flushInterval > 0 && slice != NULL && !slice->recordEnds.empty() &&
+                input.waiting()) {
+            // Score the finished records while the input is waited for, an
+            // unfinished one moves into the next slice
+            string unfinished = slice->records.substr(recordStart);
+            slice->records.resize(recordStart);
+            slice->idle = true;
+            slice->sequence = sequence++;
+            pipeline.parsed.push(slice);
+            slice = NULL;
+            if (!unfinished.empty()) {
+                pipeline.free.pop(slice);
+                slice->records.swap(unfinished);
+                slice->recordEnds.clear();
+                slice->idle = false;
+                recordStart = 0;
+            }
+        }
+        if (!input.next(line, lineLength, newline)) {
+            break;
+        }
+        inputOffset += lineLength + newline;
+        int state = scanner.feed(line, lineLength);
+        if (state == SCAN_OUTSIDE) {
+            continue;
+        }
+        if (slice == NULL) {
+            pipeline.free.pop(slice);
+            slice->records.clear();
+            slice->recordEnds.clear();
+            slice->idle = false;
+            recordStart = 0;
+        }
+        if (state == SCAN_START || state == SCAN_SINGLE) {
+            // Drop an unfinished record, the same as the sequential parser
+            slice->records.resize(recordStart);
+        }
+        slice->records.append(line, lineLength);
+        slice->records.push_back('\n');
+        if (state == SCAN_END || state == SCAN_SINGLE) {
+            recordStart = slice->records.size();
+            slice->recordEnds.push_back(recordStart);
+            slice->inputOffset = inputOffset;
+            // Slices are cut early when the output is flushed
+            if (slice->recordEnds.size() == SLICE_RECORDS ||
+                    slice->records.size() >= SLICE_SIZE ||
+                    slice->recordEnds.size() == flushAlignments) {
+                slice->sequence = sequence++;
+                pipeline.parsed.push(slice);
+                slice = NULL;
+            }
+            if (outputClosed()) {
+                break;
+            }
+        }
+    }
+    if (slice != NULL) {
+        // Let the alignment parser report a truncated record
+        if (scanner.insideRecord()) {
+            slice->recordEnds.push_back(slice->records.size());
+        }
+        // Even a slice without records passes through all stages, only the
+        // writer returns slices into the free ring
+        slice->inputOffset = inputOffset;
+        slice->sequence = sequence++;
+        pipeline.parsed.push(slice);
+    }
+    for (int i = 0; i < threads; i++) {
+        pipeline.parsed.push(NULL);
+    }
+
+    for (int i = 0; i < threads; i++) {
+        workers[i].join();
+    }
+    writer.join();
+    position.inputOffset = inputOffset;
+    return READ_SUCCESS;
+}
+
+int Parser::parseMultiplexed(ostream & output) {
+    InputMultiplexer multiplexer;
+    if (!multiplexer.open(inputs)) {
+        return OPEN_FAIL;
+    }
+
+    Pipeline pipeline(threads * SLICES_PER_THREAD);
+    vector<thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(thread(&Parser::scoreSlices, this, &pipeline));
+    }
+    thread writer(&Parser::writeSlices, this, &pipeline, &output);
+
+    unsigned long long sequence = 0;
+    vector<InputSlicer> slicers(inputs.size());
+    vector<RecordAssembler> assemblers;
+    for (unsigned int i = 0; i < inputs.size(); i++) {
+        slicers[i].pipeline = &pipeline;
+        slicers[i].source = i;
+        slicers[i].sequence = &sequence;
+        slicers[i].slice = NULL;
+        assemblers.push_back(RecordAssembler(processReverse, &slicers[i]));
+    }
+
+    int source;
+    const char * data;
+    size_t length;
+    while (multiplexer.next(source, data, length)) {
+        if (length > 0) {
+            assemblers[source].feed(data, length);
+        } else {
+            assemblers[source].finish();
+        }
+        // Records completed by this block are scored together, the next
+        // block may take a while to arrive
+        Slice * & slice = slicers[source].slice;
+        if (slice != NULL) {
+            slice->sequence = sequence++;
+            slice->idle = true;
+            pipeline.parsed.push(slice);
+            slice = NULL;
+        }
+        if (outputClosed()) {
+            break;
+        }
+    }
+    for (int i = 0; i < threads; i++) {
+        pipeline.parsed.push(NULL);
+    }
+
+    for (int i = 0; i < threads; i++) {
+        workers[i].join();
+    }
+    writer.join();
+    return multiplexer.failed() ? FORMAT_FAIL : READ_SUCCESS;
+}
+
+void Parser::InputSlicer::record(const char * record, size_t length) {
+    if (slice == NULL) {
+        pipeline->free.pop(slice);
+        slice->records.clear();
+        slice->recordEnds.clear();
+        slice->idle = false;
+        slice->source = source;
+    }
+    slice->records.append(record, length);
+    slice->recordEnds.push_back(slice->records.size());
+    if (slice->recordEnds.size() == SLICE_RECORDS ||
+            slice->records.size() >= SLICE_SIZE) {
+        slice->sequence = (*sequence)++;
+        pipeline->parsed.push(slice);
+        slice = NULL;
+    }
+}
+
+void Parser::tagHints(string & hints, int source) {
+    string tag = " source=" + inputs[source] + ";";
+    string tagged;
+    tagged.reserve(hints.size() + hints.size() / 8);
+    size_t start = 0;
+    size_t newline;
+    while ((newline = hints.find('\n', start)) != string::npos) {
+        tagged.append(hints, start, newline - start);
+        tagged.append(tag);
+        tagged.push_back('\n');
+        start = newline + 1;
+    }
+    hints.swap(tagged);
+}
+
+void Parser::scoreSlices(Pipeline * pipeline) {
+    RecordBatch batch;
+    batch.scoring.setup(windowLength, scoreMatrix, kernel, integerScoring);
+    Slice * slice;
+    while (true) {
+        pipeline->parsed.pop(slice);
+        if (slice == NULL) {
+            break;
+        }
+        slice->hints.clear();
+        StringOutputStream hints(slice->hints);
+        size_t start = 0;
+        for (unsigned int i = 0; i < slice->recordEnds.size(); i++) {
+            queueRecord(slice->records.data() + start,
+                        slice->recordEnds[i] - start, false, batch, hints);
+            start = slice->recordEnds[i];
+        }
+        flushBatch(batch, hints);
+        if (tagSources && slice->source >= 0) {
+            tagHints(slice->hints, slice->source);
+        }
+        pipeline->scored.push(slice);
+    }
+    pipeline->scored.push(NULL);
+}
+
+void Parser::writeSlices(Pipeline * pipeline, ostream * output) {
+    // Slices waiting for their predecessors, at most all slices of the pool
+    vector<Slice *> waiting(pipeline->slices.size(), NULL);
+    unsigned long long next = 0;
+    int stopped = 0;
+    while (stopped < threads) {
+        Slice * slice;
+        pipeline->scored.pop(slice);
+        if (slice == NULL) {
+            stopped++;
+            continue;
+        }
+        waiting[slice->sequence % waiting.size()] = slice;
+
+        while ((slice = waiting[next % waiting.size()]) != NULL &&
+                slice->sequence == next) {
+            waiting[next % waiting.size()] = NULL;
+            output->write(slice->hints.data(), slice->hints.size());
+            position.alignments += slice->recordEnds.size();
+            if (!checkpointFile.empty()) {
+                checkpoint(slice->inputOffset, *output, false);
+            }
+            flushOutput(*output, slice->recordEnds.size(), slice->idle);
+            pipeline->free.push(slice);
+            next++;
+        }
+    }
+}
+
+int Parser::convert(string outputFile) {
+    BinaryWriter writer;
+    if (!writer.open(outputFile)) {
+        cerr << "error: Could not open output file \"" << outputFile << "\"" << endl;
+        return OPEN_FAIL;
+    }
+
+    // Both strands are kept, the strand is filtered when scoring
+    RecordScanner scanner(true);
+    Alignment::Rows rows;
     string line;
-    while (getline(cin, line)) {
-        if (line.substr(0,1) == ">") {
-            return alignment.parse(cin, line, true);
-        } else if (processReverse && line.substr(0,1) == "<") {
-            return alignment.parse(cin, line, false);
+    string record;
+
+    while (true) {
+        bool more = (bool) getline(cin, line);
+        int state = SCAN_OUTSIDE;
+        if (more) {
+            state = scanner.feed(line.data(), line.size());
+            if (state == SCAN_START || state == SCAN_SINGLE) {
+                record.clear();
+            }
+            if (state != SCAN_OUTSIDE) {
+                record.append(line);
+                record.push_back('\n');
+            }
+        } else if (!scanner.insideRecord()) {
+            break;
+        }
+
+        // Truncated records are passed to the parser to report them
+        if (state == SCAN_END || state == SCAN_SINGLE || !more) {
+            MemoryStream stream(record.data(), record.size());
+            string headerLine;
+            getline(stream, headerLine);
+            if (alignment.parse(stream, headerLine, headerLine[0] == '>') == READ_SUCCESS) {
+                alignment.getRows(rows);
+                writer.write(rows);
+            }
+        }
+        if (!more) {
+            break;
         }
     }
 
-    return NO_MORE_ALIGNMENTS;
+    if (!writer.close()) {
+        cerr << "error: Could not write output file \"" << outputFile << "\"" << endl;
+        return OPEN_FAIL;
+    }
+    return READ_SUCCESS;
+}
+
+int Parser::parseMapped(const MappedFile & input, ostream & output, bool binary) {
+    size_t length = input.size();
+    int chunkCount = threads * CHUNKS_PER_THREAD;
+    if (length / MAX_CHUNK_SIZE > (size_t) chunkCount) {
+        chunkCount = length / MAX_CHUNK_SIZE;
+    }
+
+    ChunkJob job;
+    job.data = input.data();
+    job.binary = binary;
+    job.boundaries.resize(chunkCount + 1);
+    job.boundaries[0] = 0;
+    job.boundaries[chunkCount] = length;
+    job.results.resize(chunkCount);
+    job.alignments.resize(chunkCount);
+    job.done.resize(chunkCount, false);
+    job.outputFd = -1;
+    job.sized = 0;
+    job.allocated = 0;
+    job.writeFailed = false;
+    if (shardedOutput) {
+        output.flush();
+        job.outputFd = open(outputFile.c_str(), O_WRONLY);
+        if (job.outputFd < 0) {
+            cerr << "error: Could not open output file \"" << outputFile << "\"" << endl;
+            return OPEN_FAIL;
+        }
+        job.offsets.resize(chunkCount + 1);
+        job.offsets[0] = output.tellp();
+        job.allocated = job.offsets[0];
+        job.written.resize(chunkCount, false);
+    }
+    unsigned long long inputOffset = position.inputOffset;
+
+    vector<thread> workers;
+    if (binary) {
+        // Binary records can only be found by following their lengths,
+        // which is cheap enough to be done sequentially
+        size_t position = input.offset() == 0 ? BINARY_MAGIC_SIZE : 0;
+        for (int i = 0; i < chunkCount; i++) {
+            size_t target = (length / chunkCount) * i;
+            while (position < target) {
+                position = BinaryReader::recordEnd(job.data, length, position);
+            }
+            job.boundaries[i] = min(position, length);
+        }
+    } else {
+        for (int i = 0; i < threads; i++) {
+            workers.push_back(thread(&Parser::findBoundaries, this, &job, length, i + 1));
+        }
+        for (int i = 0; i < threads; i++) {
+            workers[i].join();
+        }
+    }
+
+    // Chunk sizes estimate the work, chunks holding giant records are
+    // started first
+    WorkScheduler scheduler(threads, threads * REORDER_WINDOW_PER_THREAD);
+    for (int i = 0; i < chunkCount; i++) {
+        scheduler.add(job.boundaries[i + 1] - job.boundaries[i]);
+    }
+    job.scheduler = &scheduler;
+
+    workers.clear();
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(thread(&Parser::processChunks, this, &job, i));
+    }
+
+    // Stitch chunk results together in the input order. Sharded results
+    // are written by the workers, only wait for them.
+    for (int i = 0; i < chunkCount; i++) {
+        string result;
+        {
+            unique_lock<mutex> lock(job.lock);
+            while (shardedOutput ? !job.written[i] : !job.done[i]) {
+                job.chunkDone.wait(lock);
+            }
+            result.swap(job.results[i]);
+        }
+        scheduler.consumed(i + 1);
+        if (shardedOutput) {
+            output.seekp(job.offsets[i + 1]);
+        } else {
+            output << result;
+        }
+        position.alignments += job.alignments[i];
+        if (!checkpointFile.empty()) {
+            checkpoint(inputOffset + job.boundaries[i + 1], output, false);
+        }
+        flushOutput(output, job.alignments[i], false);
+    }
+    position.inputOffset = inputOffset + length;
+
+    for (int i = 0; i < threads; i++) {
+        workers[i].join();
+    }
+
+    if (shardedOutput) {
+        // Drop the preallocated space after the last result
+        if (ftruncate(job.outputFd, job.offsets[chunkCount]) != 0) {
+            job.writeFailed = true;
+        }
+        close(job.outputFd);
+        if (job.writeFailed) {
+            cerr << "error: Could not write output file \"" << outputFile << "\"" << endl;
+            return OPEN_FAIL;
+        }
+    }
+    return READ_SUCCESS;
+}
+
+void Parser::findBoundaries(ChunkJob * job, size_t length, int first) {
+    int chunkCount = job->results.size();
+    for (int i = first; i < chunkCount; i += threads) {
+        job->boundaries[i] = RecordScanner::nextHeader(job->data, length,
+                (length / chunkCount) * i, processReverse);
+    }
+}
+
+void Parser::processChunks(ChunkJob * job, int worker) {
+    RecordBatch batch;
+    batch.scoring.setup(windowLength, scoreMatrix, kernel, integerScoring);
+    int i;
+    while (job->scheduler->next(worker, i)) {
+        if (outputClosed()) {
+            // Nobody reads the results anymore
+            string nothing;
+            finishChunk(job, i, nothing, 0);
+            continue;
+        }
+        ostringstream result;
+        const char * chunk = job->data + job->boundaries[i];
+        size_t length = job->boundaries[i + 1] - job->boundaries[i];
+        int alignments;
+        if (job->binary) {
+            alignments = processBinaryChunk(chunk, length, batch, result);
+        } else {
+            alignments = processChunk(chunk, length, batch, result);
+        }
+
+        string hints = result.str();
+        finishChunk(job, i, hints, alignments);
+    }
+}
+
+void Parser::finishChunk(ChunkJob * job, int chunk, string & result,
+                         int alignments) {
+    int first, last;
+    {
+        unique_lock<mutex> lock(job->lock);
+        job->results[chunk].swap(result);
+        job->alignments[chunk] = alignments;
+        job->done[chunk] = true;
+        job->chunkDone.notify_all();
+        if (!shardedOutput) {
+            return;
+        }
+
+        // Prefix sum of the result sizes in the input order
+        first = job->sized;
+        int chunkCount = job->results.size();
+        while (job->sized < chunkCount && job->done[job->sized]) {
+            job->offsets[job->sized + 1] = job->offsets[job->sized] +
+                    job->results[job->sized].size();
+            job->sized++;
+        }
+        last = job->sized;
+
+        unsigned long long end = job->offsets[last];
+        if (end > job->allocated) {
+            unsigned long long length = max(end - job->allocated,
+                                            OUTPUT_PREALLOCATION);
+            // Not supported by all file systems, writes extend the file anyway
+            posix_fallocate(job->outputFd, job->allocated, length);
+            job->allocated += length;
+        }
+    }
+
+    // Chunks which got their offsets are written by this worker, results
+    // are not modified until the chunks are marked as written
+    for (int i = first; i < last; i++) {
+        bool success = writeChunk(job, i);
+        unique_lock<mutex> lock(job->lock);
+        job->writeFailed = job->writeFailed || !success;
+        job->written[i] = true;
+        job->chunkDone.notify_all();
+    }
+}
+
+bool Parser::writeChunk(ChunkJob * job, int chunk) {
+    const string & result = job->results[chunk];
+    size_t done = 0;
+    while (done < result.size()) {
+        ssize_t bytes = pwrite(job->outputFd, result.data() + done,
+                               result.size() - done, job->offsets[chunk] + done);
+        if (bytes <= 0) {
+            return false;
+        }
+        done += bytes;
+    }
+    return true;
+}
+
+int Parser::processChunk(const char * data, size_t length,
+                         RecordBatch & batch, ostream & output) {
+    RecordScanner scanner(processReverse);
+    int records = 0;
+    const char * end = data + length;
+    const char * record = data;
+    const char * line = data;
+
+    while (line < end) {
+        const char * newline = (const char *) memchr(line, '\n', end - line);
+        const char * next = newline == NULL ? end : newline + 1;
+        int state = scanner.feed(line, (newline == NULL ? end : newline) - line);
+        if (state == SCAN_START || state == SCAN_SINGLE) {
+            record = line;
+        }
+        if (state == SCAN_END || state == SCAN_SINGLE) {
+            queueRecord(record, next - record, false, batch, output);
+            records++;
+        }
+        line = next;
+    }
+
+    if (scanner.insideRecord()) {
+        queueRecord(record, end - record, false, batch, output);
+        records++;
+    }
+    flushBatch(batch, output);
+    return records;
+}
+
+int Parser::processBinaryChunk(const char * data, size_t length,
+                               RecordBatch & batch, ostream & output) {
+    int records = 0;
+    size_t position = 0;
+    while (position < length) {
+        size_t next = BinaryReader::recordEnd(data, length, position);
+        queueRecord(data + position, next - position, true, batch, output);
+        position = next;
+        records++;
+    }
+    flushBatch(batch, output);
+    return records;
+}
+
+void Parser::processRecord(const char * record, size_t length, bool binary,
+                           Alignment & alignment, ostream & output) {
+    ResultCache::Key key;
+    if (cache.isOpen()) {
+        key = ResultCache::makeKey(record, length, cacheParameters);
+        string cached;
+        if (cache.lookup(key, cached)) {
+            output << cached;
+            return;
+        }
+    }
+
+    if (!loadRecord(record, length, binary, alignment)) {
+        return;
+    }
+    alignment.scoreHints(windowLength, scoreMatrix, kernel, integerScoring);
+    printRecord(alignment, key, output);
+}
+
+void Parser::queueRecord(const char * record, size_t length, bool binary,
+                         RecordBatch & batch, ostream & output) {
+    PendingRecord pending;
+    pending.alignment = -1;
+    if (cache.isOpen()) {
+        pending.key = ResultCache::makeKey(record, length, cacheParameters);
+        if (cache.lookup(pending.key, pending.cached)) {
+            if (batch.pending.empty()) {
+                output << pending.cached;
+            } else {
+                batch.pending.push_back(pending);
+            }
+            return;
+        }
+    }
+
+    int index = batch.scoring.size();
+    if (index == (int) batch.alignments.size()) {
+        batch.alignments.emplace_back();
+    }
+    Alignment & alignment = batch.alignments[index];
+    if (!loadRecord(record, length, binary, alignment)) {
+        return;
+    }
+    batch.scoring.add(alignment);
+    pending.alignment = index;
+    batch.pending.push_back(pending);
+
+    if (batch.scoring.size() == BATCH_SIZE) {
+        flushBatch(batch, output);
+    }
+}
+
+void Parser::flushBatch(RecordBatch & batch, ostream & output) {
+    batch.scoring.score();
+    for (unsigned int i = 0; i < batch.pending.size(); i++) {
+        const PendingRecord & pending = batch.pending[i];
+        if (pending.alignment < 0) {
+            output << pending.cached;
+        } else {
+            printRecord(batch.alignments[pending.alignment], pending.key,
+                        output);
+        }
+    }
+    batch.pending.clear();
+}
+
+bool Parser::loadRecord(const char * record, size_t length, bool binary,
+                        Alignment & alignment) {
+    int status;
+    if (binary) {
+        Alignment::Rows header;
+        PackedPairs::Columns columns;
+        if (!BinaryReader::decode(record, length, header, columns)) {
+            cerr << "error: Corrupted binary alignment record" << endl;
+            return false;
+        }
+        if (!header.forward && !processReverse) {
+            return false;
+        }
+        status = alignment.load(header, columns);
+    } else {
+        MemoryStream stream(record, length);
+        string headerLine;
+        getline(stream, headerLine);
+        status = alignment.parse(stream, headerLine, headerLine[0] == '>');
+    }
+    return status == READ_SUCCESS;
+}
+
+void Parser::printRecord(Alignment & alignment, const ResultCache::Key & key,
+                         ostream & output) {
+    if (cache.isOpen()) {
+        ostringstream hints;
+        printTiers(alignment, hints);
+        string result = hints.str();
+        output << result;
+        cache.insert(key, result);
+    } else {
+        printTiers(alignment, output);
+    }
+}
+
+void Parser::printTiers(Alignment & alignment, ostream & output) {
+    // The aggregation combines the unrounded scores
+    bool exactScores = aggregateReducers != 0;
+    alignment.printHints(output, minExonScore, minInitialExonScore,
+                         minInitialIntronScore, filter, exactScores);
+    if (tiers.empty()) {
+        return;
+    }
+    string hints;
+    for (unsigned int i = 0; i < tiers.size(); i++) {
+        hints.clear();
+        StringOutputStream stream(hints);
+        alignment.printHints(stream, tiers[i].minExonScore,
+                             tiers[i].minInitialExonScore,
+                             tiers[i].minInitialIntronScore, filter, exactScores);
+        size_t start = 0;
+        size_t newline;
+        while ((newline = hints.find('\n', start)) != string::npos) {
+            output << TIER_MARKER << (char) (i + 1);
+            output.write(hints.data() + start, newline + 1 - start);
+            start = newline + 1;
+        }
+    }
 }
 
 double Parser::maxScore() {
@@ -61,6 +1155,10 @@ void Parser::setKernel(Kernel* kernel) {
     this->kernel = kernel;
 }
 
+void Parser::setFilter(const HintFilter * filter) {
+    this->filter = filter;
+}
+
 void Parser::setMinExonScore(double minExonScore) {
     this->minExonScore = minExonScore;
 }
@@ -76,4 +1174,93 @@ void Parser::setMinInitialIntronScore(double minInitialIntronScore) {
 
 void Parser::setProcessReverse(bool processReverse) {
     this->processReverse = processReverse;
-}
\ No newline at end of file
+}
+
+bool Parser::getProcessReverse() const {
+    return processReverse;
+}
+
+void Parser::setThreads(int threads) {
+    this->threads = threads;
+}
+
+void Parser::setCheckpoint(string checkpointFile) {
+    this->checkpointFile = checkpointFile;
+}
+
+void Parser::setCheckpointInterval(int seconds) {
+    checkpointInterval = seconds;
+}
+
+void Parser::setResume(bool resume) {
+    this->resume = resume;
+}
+
+void Parser::setCache(string cacheFile, unsigned long long maxSize) {
+    this->cacheFile = cacheFile;
+    cacheSize = maxSize;
+}
+
+void Parser::setIntegerScoring(bool integerScoring) {
+    this->integerScoring = integerScoring;
+}
+
+void Parser::setShardedOutput(bool shardedOutput) {
+    this->shardedOutput = shardedOutput;
+}
+
+void Parser::setInputs(const vector<string> & inputs) {
+    this->inputs = inputs;
+}
+
+void Parser::setTagSources(bool tagSources) {
+    this->tagSources = tagSources;
+}
+
+void Parser::setAggregation(int reducers, unsigned long long memoryLimit) {
+    aggregateReducers = reducers;
+    aggregateMemory = memoryLimit;
+}
+
+void Parser::setSorting(bool sorted, unsigned long long memoryLimit) {
+    this->sorted = sorted;
+    sortMemory = memoryLimit;
+}
+
+void Parser::setTopK(unsigned int k) {
+    topK = k;
+}
+
+void Parser::setTiers(const vector<Tier> & tiers) {
+    this->tiers = tiers;
+}
+
+void Parser::setColumnarOutput(bool columnar) {
+    columnarOutput = columnar;
+}
+
+void Parser::setCompression(int compression) {
+    this->compression = compression;
+}
+
+bool Parser::compressed(const string & filename) const {
+    return compression == COMPRESSION_BGZF ||
+            (compression == COMPRESSION_AUTO && compressedName(filename));
+}
+
+void Parser::setPartitioning(int partitionBy, int maxOpenFiles) {
+    this->partitionBy = partitionBy;
+    maxPartitionFiles = maxOpenFiles;
+}
+
+void Parser::setFlushPolicy(unsigned int alignments, unsigned int milliseconds) {
+    flushAlignments = alignments;
+    flushInterval = milliseconds;
+}
+
+void Parser::closeTiers(vector<TierOutput *> & tierOutputs) {
+    for (unsigned int i = 0; i < tierOutputs.size(); i++) {
+        delete tierOutputs[i];
+    }
+    tierOutputs.clear();
+}
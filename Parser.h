@@ -4,7 +4,26 @@
 #include "Alignment.h"
 #include "ScoreMatrix.h"
 #include "Kernel.h"
+#include "MappedFile.h"
+#include "Checkpoint.h"
+#include "ResultCache.h"
+#include "BinaryFormat.h"
+#include "ScoringBatch.h"
+#include "WorkScheduler.h"
+#include "RingBuffer.h"
+#include "AsyncFile.h"
+#include "InputMultiplexer.h"
+#include "RecordScanner.h"
+#include "HintOutput.h"
+#include "CompressedOutput.h"
+#include "HintPartitioner.h"
 #include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <ctime>
+#include <chrono>
 
 #define READ_SUCCESS 0
 #define OPEN_FAIL 1
@@ -17,12 +36,28 @@ using namespace std;
 
 class Parser {
 public:
+    /// Score thresholds of an extra set of hints written into its own file
+    struct Tier {
+        string name;
+        double minExonScore;
+        double minInitialExonScore;
+        double minInitialIntronScore;
+        string outputFile;
+    };
+
     Parser();
     /**
      * Parse the alignment file
      * @param outputFile Name of the gff output file
      */
     int parse(string outputFile);
+    /**
+     * Convert Spaln alignments from stdin into the compact binary format.
+     * Scoring a binary file (instead of Spaln text) on stdin skips
+     * all text parsing.
+     * @param outputFile Name of the binary output file
+     */
+    int convert(string outputFile);
     /**
      * Set how scores from left and right intron boundary are combined
      */
@@ -39,6 +74,11 @@ public:
      * Set which kernel will be used for scoring
      */
     void setKernel(Kernel * kernel);
+    /**
+     * Print only hints accepted by this filter expression, in addition to
+     * the score thresholds
+     */
+    void setFilter(const HintFilter * filter);
     /**
     * Set minimum exon score
     */
@@ -55,13 +95,361 @@ public:
     * Set whether alignments on the reverse strand are processed
     */
     void setProcessReverse(bool processReverse);
+    /**
+    * @return Whether alignments on the reverse strand are processed
+    */
+    bool getProcessReverse() const;
+    /**
+    * Set number of worker threads. Regular input files are split into
+    * chunks which are parsed and scored in parallel.
+    */
+    void setThreads(int threads);
+    /**
+    * Periodically save run position into the given checkpoint file
+    */
+    void setCheckpoint(string checkpointFile);
+    /**
+    * Set minimum number of seconds between two checkpoints. With zero,
+    * a checkpoint is saved after every alignment.
+    */
+    void setCheckpointInterval(int seconds);
+    /**
+    * Continue the run from the last checkpoint, if there is one
+    */
+    void setResume(bool resume);
+    /**
+    * Reuse formatted hints from a persistent cache file, and store newly
+    * scored hints there
+    * @param cacheFile Cache file shared across runs and processes
+    * @param maxSize   Size cap of the cache file in bytes
+    */
+    void setCache(string cacheFile, unsigned long long maxSize);
+    /**
+    * Score with integer matrix values and quantized kernel weights
+    * instead of floating point arithmetic
+    */
+    void setIntegerScoring(bool integerScoring);
+    /**
+    * Let the workers write their hints directly into the output file at
+    * offsets given by the sizes of the preceding hints, instead of passing
+    * them to a single writer. Used for memory mapped inputs.
+    */
+    void setShardedOutput(bool shardedOutput);
+    /**
+    * Read the alignments from these files or FIFOs, concurrently, instead
+    * of stdin. Records of all inputs are scored by a shared pool of
+    * worker threads.
+    */
+    void setInputs(const vector<string> & inputs);
+    /**
+    * Append the name of the input file to every hint read from several
+    * inputs
+    */
+    void setTagSources(bool tagSources);
+    /**
+    * Collapse hints with the same contig, type, coordinates and strand
+    * into one hint, see HintAggregator. Not used with sharded output.
+    * @param reducers    Combination of the AGGREGATE_* flags, 0 disables
+    *                    the aggregation
+    * @param memoryLimit Memory of the aggregation table in bytes before it
+    *                    is spilled to disk
+    */
+    void setAggregation(int reducers, unsigned long long memoryLimit);
+    /**
+    * Sort the hints by contig and start coordinate before they are
+    * written, see HintSorter. Aggregated hints are always sorted. Not used
+    * with sharded output.
+    * @param memoryLimit Memory of the hints in bytes before they are
+    *                    spilled to disk
+    */
+    void setSorting(bool sorted, unsigned long long memoryLimit);
+    /**
+    * Keep only the k best scoring hints with the same contig, type,
+    * coordinates and strand, see HintSelector. The selection is done before
+    * the aggregation and sorting. Not used with sharded output.
+    * @param k Number of kept hints, 0 keeps all hints
+    */
+    void setTopK(unsigned int k);
+    /**
+    * Print the hints of every alignment once more for each tier, with the
+    * thresholds of the tier, into the output file of the tier. Alignments
+    * are scored only once. The tier outputs are post-processed in the same
+    * way as the main output. Not used with sharded output or checkpoints.
+    */
+    void setTiers(const vector<Tier> & tiers);
+    /**
+    * Write the main and tier outputs in the columnar binary format instead
+    * of GFF, see ColumnarWriter. Not used with sharded output or
+    * checkpoints.
+    */
+    void setColumnarOutput(bool columnar);
+    /**
+    * Compress the main and tier outputs into BGZF on the worker threads,
+    * see CompressedWriteBuffer. Not used with sharded output or
+    * checkpoints.
+    * @param compression COMPRESSION_NONE, COMPRESSION_BGZF, or
+    *                    COMPRESSION_AUTO to compress files named *.gz
+    *                    and *.bgz
+    */
+    void setCompression(int compression);
+    /**
+    * Write the main output into one file per contig or gene instead of
+    * a single file, see HintPartitioner. The output file name passed to
+    * parse() is then the path template of the partitions. Not used with
+    * sharded output, checkpoints, columnar or compressed output.
+    * @param partitionBy  PARTITION_BY_CONTIG, PARTITION_BY_GENE, or 0 for
+    *                     a single output file
+    * @param maxOpenFiles Maximum number of partition files open at once
+    */
+    void setPartitioning(int partitionBy, int maxOpenFiles);
+    /**
+    * Flush the main output regularly, so that a program reading it from
+    * a pipe sees the hints soon after their alignments arrive. Hints
+    * collected by the selection, aggregation or sorting are only written
+    * at the end and are not affected.
+    * @param alignments   Flush after this many alignments, 0 disables it
+    * @param milliseconds Flush when this time passed since the last flush,
+    *                     and whenever the input has to be waited for, 0
+    *                     disables it
+    */
+    void setFlushPolicy(unsigned int alignments, unsigned int milliseconds);
+    /**
+     * Prepare the settings for scoring single records with scoreRecord().
+     * parse() does this itself.
+     * @return READ_SUCCESS, or an error code for invalid settings
+     */
+    int prepareScoring();
+    /**
+     * Score a single raw Spaln record and append its formatted hints.
+     * Not safe for concurrent calls, see PushParser.
+     */
+    void scoreRecord(const char * record, size_t length, string & hints);
 
 private:
+    /// Record waiting for its alignment to be scored in a batch
+    struct PendingRecord {
+        /// Index of the queued alignment, -1 for cached records
+        int alignment;
+        string cached;
+        ResultCache::Key key;
+    };
+    /// Alignments of a single worker which are scored together
+    struct RecordBatch {
+        ScoringBatch scoring;
+        /// Reused alignments, a deque keeps them in place while queued
+        deque<Alignment> alignments;
+        /// Queued and cached records in the input order
+        vector<PendingRecord> pending;
+    };
+    /// Records of a streamed input passed between the pipeline stages
+    struct Slice {
+        /// Index of the slice in the input order
+        unsigned long long sequence;
+        /// Input of the records when reading several inputs, -1 otherwise
+        int source;
+        /// Raw records, record k ends at recordEnds[k]
+        string records;
+        vector<size_t> recordEnds;
+        /// Input offset after the last record
+        unsigned long long inputOffset;
+        /// Formatted hints of all records
+        string hints;
+        /// Whether the input had to be waited for after the slice
+        bool idle;
+    };
+    /// Stages of the streamed input pipeline. Slices are recycled through
+    /// the free ring, a NULL slice tells the next stage to stop.
+    struct Pipeline {
+        Pipeline(int slices);
+        vector<Slice> slices;
+        /// Slices returned by the writer to the reader, the writer is its
+        /// only producer
+        SpscRing<Slice *> free;
+        /// Slices filled by the reader for the scoring workers
+        MpmcRing<Slice *> parsed;
+        /// Slices scored by the workers for the writer
+        MpmcRing<Slice *> scored;
+    };
+    /// Passes the records of one of several concurrently read inputs to
+    /// the slice being filled for that input
+    struct InputSlicer : public RecordListener {
+        void record(const char * record, size_t length);
+        Pipeline * pipeline;
+        int source;
+        unsigned long long * sequence;
+        Slice * slice;
+    };
+    /// State shared by workers processing a memory mapped input
+    struct ChunkJob {
+        const char * data;
+        /// Whether the input is in the binary format
+        bool binary;
+        /// Chunk k spans [boundaries[k], boundaries[k + 1])
+        vector<size_t> boundaries;
+        vector<string> results;
+        /// Number of alignment records in each chunk
+        vector<int> alignments;
+        vector<bool> done;
+        /// Hands out chunks to the workers, largest first
+        WorkScheduler * scheduler;
+        /// Sharded output: output descriptor, file offsets of the chunk
+        /// results (known for chunks before sized) and preallocated length
+        int outputFd;
+        vector<unsigned long long> offsets;
+        int sized;
+        unsigned long long allocated;
+        vector<bool> written;
+        bool writeFailed;
+        mutex lock;
+        condition_variable chunkDone;
+    };
+    /**
+     * Parse and score all alignments read line by line from a stream
+     */
+    int parseStream(LineReader & input, ostream & output);
+    /**
+     * Parse and score alignments read from a stream with several threads.
+     * The reading thread passes slices of records to the scoring workers
+     * and a writer thread prints their hints in the input order.
+     */
+    int parsePipelined(LineReader & input, ostream & output);
+    /**
+     * Parse alignments from several files or FIFOs as their data arrive.
+     * Every input is split into records separately, complete records
+     * are scored by the pipeline workers and printed in the order in
+     * which they were completed.
+     */
+    int parseMultiplexed(ostream & output);
+    /**
+     * Append the tag of the source input to every hint line
+     */
+    void tagHints(string & hints, int source);
+    /**
+     * Score slices of a streamed input until the reader stops
+     */
+    void scoreSlices(Pipeline * pipeline);
+    /**
+     * Print scored slices in the input order and recycle them
+     */
+    void writeSlices(Pipeline * pipeline, ostream * output);
+    /**
+     * Parse and score all alignments in a memory mapped input. The input
+     * is split into chunks at record boundaries, chunks are processed
+     * in parallel and their results are written in the input order.
+     */
+    int parseMapped(const MappedFile & input, ostream & output, bool binary);
+    /**
+     * Find record boundaries of chunks assigned to a single thread
+     */
+    void findBoundaries(ChunkJob * job, size_t length, int first);
+    /**
+     * Process chunks of a mapped input until there are none left
+     * @param worker Index of the worker
+     */
+    void processChunks(ChunkJob * job, int worker);
+    /**
+     * Save the result of a chunk. With sharded output, offsets are assigned
+     * to all chunks whose predecessors are finished and the results of
+     * these chunks are written.
+     */
+    void finishChunk(ChunkJob * job, int chunk, string & result, int alignments);
+    /**
+     * Write a chunk result at its offset of the output file
+     */
+    bool writeChunk(ChunkJob * job, int chunk);
+    /**
+     * Parse, score and print all records inside a memory range
+     * @return Number of records processed
+     */
+    int processChunk(const char * data, size_t length,
+                     RecordBatch & batch, ostream & output);
+    /**
+     * Score and print all binary records inside a memory range
+     * @return Number of records processed
+     */
+    int processBinaryChunk(const char * data, size_t length,
+                           RecordBatch & batch, ostream & output);
+    /**
+     * Parse, score and print a single raw alignment record
+     * @param binary Whether the record is in the binary format
+     */
+    void processRecord(const char * record, size_t length, bool binary,
+                       Alignment & alignment, ostream & output);
+    /**
+     * Parse a single raw alignment record and queue it for batch scoring.
+     * Hints are printed when the batch is full or when it is flushed.
+     */
+    void queueRecord(const char * record, size_t length, bool binary,
+                     RecordBatch & batch, ostream & output);
+    /**
+     * Score all queued alignments and print hints of all pending records
+     */
+    void flushBatch(RecordBatch & batch, ostream & output);
+    /**
+     * Parse or decode a single raw alignment record
+     * @return Whether the alignment is ready to be scored
+     */
+    bool loadRecord(const char * record, size_t length, bool binary,
+                    Alignment & alignment);
+    /**
+     * Print hints of a scored alignment and save them in the cache
+     */
+    void printRecord(Alignment & alignment, const ResultCache::Key & key,
+                     ostream & output);
+    /// Output file of a tier and its post-processing
+    struct TierOutput {
+        ofstream file;
+        CompressedOutputStream compressed;
+        HintOutput hints;
+    };
+    void closeTiers(vector<TierOutput *> & tierOutputs);
+    /**
+     * @return Whether an output file is compressed
+     */
+    bool compressed(const string & filename) const;
+    /**
+     * Print the hints of the main output and of all tiers, the lines of
+     * the tiers are marked with TIER_MARKER
+     */
+    void printTiers(Alignment & alignment, ostream & output);
+    /**
+     * Hash all settings which influence the printed hints
+     */
+    uint64_t hashParameters();
+    /**
+     * @return Size of the standard input, 0 when it is not a regular file
+     */
+    unsigned long long inputSize();
+    /**
+     * Check that the matrix and window allow integer scoring without
+     * overflowing 32-bit sums
+     */
+    bool checkIntegerScoring();
+    /**
+     * Restore the run position from the checkpoint file. The output
+     * is truncated to the checkpointed length and the input is advanced
+     * to the checkpointed offset, or the offset is left to be skipped by
+     * the input reader.
+     */
+    int resumeRun(string outputFile);
+    /**
+     * Save a checkpoint if enough time passed since the last one
+     * @param inputOffset Input offset of a record boundary
+     * @param force       Save regardless of the checkpoint interval
+     */
+    void checkpoint(unsigned long long inputOffset, ostream & output,
+                    bool force);
+    /**
+     * Flush the output if the flush policy asks for it
+     * @param alignments Number of alignments written since the last call
+     * @param idle       Whether the input has to be waited for
+     */
+    void flushOutput(ostream & output, unsigned long long alignments, bool idle);
     /**
-     * Parse next alignment in the input file.
-     * The alignment is stored in the "alignment" class variable
+     * @return Whether the program reading the main output closed its pipe,
+     *         the run then ends early
      */
-    int parseNext();
+    bool outputClosed() const;
     /**
      * Return maximum possible score for an intron, depending
      * on a scoring matrix used
@@ -74,10 +462,70 @@ private:
     int windowLength;
     const ScoreMatrix * scoreMatrix;
     Kernel * kernel;
+    const HintFilter * filter;
     double minExonScore;
     double minInitialExonScore;
     double minInitialIntronScore;
     bool processReverse;
+    int threads;
+    string outputFile;
+    string checkpointFile;
+    int checkpointInterval;
+    bool resume;
+    /// Current position of the run
+    Checkpoint position;
+    /// Bytes of a resumed input that could not be skipped by seeking
+    unsigned long long inputSkip;
+    time_t lastCheckpoint;
+    string cacheFile;
+    unsigned long long cacheSize;
+    ResultCache cache;
+    bool integerScoring;
+    bool shardedOutput;
+    vector<string> inputs;
+    bool tagSources;
+    int aggregateReducers;
+    unsigned long long aggregateMemory;
+    bool sorted;
+    unsigned long long sortMemory;
+    unsigned int topK;
+    vector<Tier> tiers;
+    bool columnarOutput;
+    int compression;
+    int partitionBy;
+    int maxPartitionFiles;
+    unsigned int flushAlignments;
+    unsigned int flushInterval;
+    /// Alignments written since the last flush
+    unsigned long long unflushed;
+    chrono::steady_clock::time_point lastFlush;
+    /// Main output of the current run
+    ostream * finalOutput;
+    /// Writers of the main output which can report a closed pipe
+    const AsyncOutputStream * streamedOutput;
+    const CompressedOutputStream * compressedStream;
+    /// Hash of the current settings, part of the cache keys
+    uint64_t cacheParameters;
+    /// Increase whenever the format of printed hints changes
+    static const uint64_t CACHE_VERSION = 1;
+    /// Number of chunks created per thread for mapped inputs
+    static const int CHUNKS_PER_THREAD = 16;
+    /// Number of chunks per thread scheduled ahead of the first chunk
+    /// whose result was not written yet
+    static const int REORDER_WINDOW_PER_THREAD = 32;
+    /// Maximum chunk size, larger inputs are split into more chunks so that
+    /// the threads share the work in units of at most this size
+    static const size_t MAX_CHUNK_SIZE = 4 * 1024 * 1024;
+    /// Number of alignments scored together by a chunk worker
+    static const int BATCH_SIZE = 64;
+    /// Maximum number of records in a slice of a streamed input
+    static const size_t SLICE_RECORDS = BATCH_SIZE;
+    /// Slices larger than this do not take more records
+    static const size_t SLICE_SIZE = 1024 * 1024;
+    /// Number of slices per thread in the streamed input pipeline
+    static const int SLICES_PER_THREAD = 4;
+    /// Minimum size by which a sharded output file is preallocated
+    static const unsigned long long OUTPUT_PREALLOCATION = 64 * 1024 * 1024;
 };
 
 
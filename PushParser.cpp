@@ -0,0 +1,31 @@
+#include "PushParser.h"
+
+PushParser::PushParser(Parser & parser, HintListener * listener) :
+parser(parser),
+assembler(parser.getProcessReverse(), this) {
+    this->listener = listener;
+    completed = 0;
+}
+
+int PushParser::start() {
+    return parser.prepareScoring();
+}
+
+int PushParser::feed(const char * data, size_t length) {
+    completed = 0;
+    assembler.feed(data, length);
+    return completed;
+}
+
+int PushParser::finish() {
+    completed = 0;
+    assembler.finish();
+    return completed;
+}
+
+void PushParser::record(const char * record, size_t length) {
+    hints.clear();
+    parser.scoreRecord(record, length, hints);
+    completed++;
+    listener->hints(hints);
+}
@@ -0,0 +1,69 @@
+#ifndef PUSH_PARSER_H
+#define PUSH_PARSER_H
+
+#include "Parser.h"
+#include "RecordScanner.h"
+#include <string>
+
+using namespace std;
+
+/// Receives the hints of every alignment completed by a PushParser
+
+class HintListener {
+public:
+    /**
+     * @param hints Formatted hints of one alignment, empty if none of its
+     *              hints passed the filters. Valid only during the call.
+     */
+    virtual void hints(const string & hints) = 0;
+    virtual ~HintListener() {}
+};
+
+/// Incremental parser fed with chunks of Spaln output
+
+/**
+ * Unlike Parser::parse, which pulls the input from stdin, the caller pushes
+ * chunks of any size (split in the middle of a line or a record) as they
+ * arrive, e.g. from an event loop. Partial records are kept internally and
+ * every alignment is scored and passed to the listener as soon as its
+ * record is complete. The scoring settings are taken from a configured
+ * Parser, several push parsers can share one Parser as long as they are
+ * fed from the same thread.
+ */
+class PushParser : private RecordListener {
+public:
+    /**
+     * @param parser   Parser with the scoring settings, configured before
+     *                 the push parser is created
+     * @param listener Receives the hints of completed alignments
+     */
+    PushParser(Parser & parser, HintListener * listener);
+    /**
+     * Check the scoring settings of the parser
+     * @return READ_SUCCESS, or an error code for invalid settings
+     */
+    int start();
+    /**
+     * Feed the next chunk of the input
+     * @return Number of alignments completed by the chunk
+     */
+    int feed(const char * data, size_t length);
+    /**
+     * Signal the end of the input. A truncated last record is passed to
+     * the alignment parser, which reports it. The parser can be reused for
+     * another input afterwards.
+     * @return Number of alignments completed at the end of the input
+     */
+    int finish();
+private:
+    void record(const char * record, size_t length);
+
+    Parser & parser;
+    HintListener * listener;
+    RecordAssembler assembler;
+    /// Hints of the last scored alignment, keeps its capacity
+    string hints;
+    int completed;
+};
+
+#endif /* PUSH_PARSER_H */
@@ -0,0 +1,177 @@
+#include "RecordScanner.h"
+#include "Alignment.h"
+#include <cstring>
+#include <algorithm>
+
+/**
+ * Check whether a line starts with the ALIGNMENT keyword
+ */
+static bool isAlignmentKeyword(const char * line, size_t length) {
+    return length >= 9 && strncmp(line, "ALIGNMENT", 9) == 0;
+}
+
+RecordScanner::RecordScanner(bool processReverse) {
+    this->processReverse = processReverse;
+    reset();
+}
+
+void RecordScanner::reset() {
+    state = SEEK_HEADER;
+    blockLine = 0;
+}
+
+bool RecordScanner::insideRecord() const {
+    return state != SEEK_HEADER;
+}
+
+bool RecordScanner::isHeader(const char * line, size_t length,
+                             bool processReverse) {
+    return length > 0 && (line[0] == '>' || (processReverse && line[0] == '<'));
+}
+
+int RecordScanner::feed(const char * line, size_t length) {
+    switch (state) {
+        case SEEK_HEADER:
+            if (!isHeader(line, length, processReverse)) {
+                return SCAN_OUTSIDE;
+            }
+            if (!Alignment::validHeader(line, length)) {
+                // Alignment::parse gives up on this record right away
+                return SCAN_SINGLE;
+            }
+            state = SEEK_ALIGNMENT;
+            return SCAN_START;
+        case SEEK_ALIGNMENT:
+            if (isAlignmentKeyword(line, length)) {
+                state = EXPECT_EMPTY;
+            }
+            return SCAN_INSIDE;
+        case EXPECT_EMPTY:
+            if (length != 0) {
+                // Alignment::parse gives up on this record here
+                reset();
+                return SCAN_END;
+            }
+            state = BLOCK;
+            blockLine = 0;
+            return SCAN_INSIDE;
+        case BLOCK:
+            if (length <= (size_t) Alignment::BLOCK_OFFSET ||
+                    ++blockLine == Alignment::BLOCK_ITEMS_CNT) {
+                reset();
+                return SCAN_END;
+            }
+            return SCAN_INSIDE;
+    }
+    return SCAN_OUTSIDE;
+}
+
+size_t RecordScanner::nextBlockEnd(const char * data, size_t length,
+                                   size_t position) {
+    // Lines of the block matched so far: the keyword, the empty line and
+    // the alignment lines. Only the keyword line may be longer than the
+    // position column and start with a header marker.
+    int matched = 0;
+    while (position < length) {
+        const char * newline = (const char *) memchr(data + position, '\n',
+                                                     length - position);
+        size_t lineEnd = newline == NULL ? length : newline - data;
+        const char * line = data + position;
+        size_t lineLength = lineEnd - position;
+        if (matched == 1 && lineLength == 0) {
+            matched = 2;
+        } else if (matched >= 2 && lineLength > (size_t) Alignment::BLOCK_OFFSET &&
+                   line[0] != '>' && line[0] != '<') {
+            if (++matched == 2 + Alignment::BLOCK_ITEMS_CNT) {
+                return std::min(lineEnd + 1, length);
+            }
+        } else {
+            matched = isAlignmentKeyword(line, lineLength) ? 1 : 0;
+        }
+        position = lineEnd + 1;
+    }
+    return length;
+}
+
+size_t RecordScanner::nextHeader(const char * data, size_t length,
+                                 size_t position, bool processReverse) {
+    // Move to the start of a line
+    if (position > 0 && position < length && data[position - 1] != '\n') {
+        const char * newline = (const char *) memchr(data + position, '\n',
+                                                     length - position);
+        if (newline == NULL) {
+            return length;
+        }
+        position = newline - data + 1;
+    }
+    // A header may be a part of an unfinished record, its state is only
+    // known after a complete block
+    if (position > 0) {
+        position = nextBlockEnd(data, length, position);
+    }
+
+    RecordScanner scanner(processReverse);
+    while (position < length) {
+        const char * newline = (const char *) memchr(data + position, '\n',
+                                                     length - position);
+        size_t lineEnd = newline == NULL ? length : newline - data;
+        int state = scanner.feed(data + position, lineEnd - position);
+        if (state == SCAN_START || state == SCAN_SINGLE) {
+            return position;
+        }
+        position = lineEnd + 1;
+    }
+    return length;
+}
+
+RecordAssembler::RecordAssembler(bool processReverse, RecordListener * listener) :
+scanner(processReverse) {
+    this->listener = listener;
+}
+
+void RecordAssembler::feed(const char * data, size_t length) {
+    const char * end = data + length;
+    while (data < end) {
+        const char * newline = (const char *) memchr(data, '\n', end - data);
+        if (newline == NULL) {
+            line.append(data, end - data);
+            return;
+        }
+        if (line.empty()) {
+            feedLine(data, newline - data);
+        } else {
+            line.append(data, newline - data);
+            feedLine(line.data(), line.size());
+            line.clear();
+        }
+        data = newline + 1;
+    }
+}
+
+void RecordAssembler::finish() {
+    if (!line.empty()) {
+        // Last line without a newline
+        feedLine(line.data(), line.size());
+        line.clear();
+    }
+    if (scanner.insideRecord()) {
+        listener->record(record.data(), record.size());
+    }
+    scanner.reset();
+    record.clear();
+}
+
+void RecordAssembler::feedLine(const char * line, size_t length) {
+    int state = scanner.feed(line, length);
+    if (state == SCAN_OUTSIDE) {
+        return;
+    }
+    if (state == SCAN_START || state == SCAN_SINGLE) {
+        record.clear();
+    }
+    record.append(line, length);
+    record.push_back('\n');
+    if (state == SCAN_END || state == SCAN_SINGLE) {
+        listener->record(record.data(), record.size());
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef RECORD_SCANNER_H
+#define RECORD_SCANNER_H
+
+#include <cstddef>
+#include <string>
+
+#define SCAN_OUTSIDE 0
+#define SCAN_START 1
+#define SCAN_INSIDE 2
+#define SCAN_END 3
+#define SCAN_SINGLE 4
+
+/// Line-level state machine delimiting single alignment records
+
+/**
+ * The scanner mirrors the way Alignment::parse consumes its input: a record
+ * starts with a header line, continues until the ALIGNMENT keyword, one
+ * empty line and the three alignment block lines. Lines outside of records
+ * are skipped, exactly as in the sequential parser. A header rejected by
+ * Alignment::parse is a record on its own, the parser reports it and
+ * continues with the next line. This allows raw records to be cut out of
+ * a memory buffer and parsed independently.
+ */
+class RecordScanner {
+public:
+    RecordScanner(bool processReverse);
+    /**
+     * Classify the next input line
+     * @param line   Line content, without the trailing newline
+     * @param length Line length
+     * @return SCAN_OUTSIDE if the line is not a part of any record,
+     *         SCAN_START if the line is a record header, SCAN_INSIDE
+     *         for lines inside a record, SCAN_END for the last line of
+     *         a record and SCAN_SINGLE for an invalid header, which is
+     *         both the first and the last line of its record.
+     */
+    int feed(const char * line, size_t length);
+    /**
+     * @return Whether the last fed line left the scanner inside a record
+     */
+    bool insideRecord() const;
+    /**
+     * Forget any partially scanned record
+     */
+    void reset();
+    /**
+     * Check whether a line is a record header
+     */
+    static bool isHeader(const char * line, size_t length, bool processReverse);
+    /**
+     * Find the first record starting at or after the given position, the
+     * same record a sequential scan of the whole data would start there.
+     * Headers swallowed by a preceding unfinished record are skipped.
+     * Positions inside a line are moved to the start of the next line.
+     * @return Offset of the record header or LENGTH if there is none
+     */
+    static size_t nextHeader(const char * data, size_t length,
+                             size_t position, bool processReverse);
+private:
+    /**
+     * Find the end of the first complete alignment block starting at or
+     * after a line start. The sequential scanner waits for a header there
+     * whatever its state before the block was.
+     * @return Offset of the line following the block or LENGTH
+     */
+    static size_t nextBlockEnd(const char * data, size_t length, size_t position);
+
+    enum State {
+        SEEK_HEADER,
+        SEEK_ALIGNMENT,
+        EXPECT_EMPTY,
+        BLOCK
+    };
+    State state;
+    int blockLine;
+    bool processReverse;
+};
+
+/// Receives the records completed by a RecordAssembler
+
+class RecordListener {
+public:
+    /**
+     * @param record Raw record including its trailing newline, valid only
+     *               during the call
+     */
+    virtual void record(const char * record, size_t length) = 0;
+    virtual ~RecordListener() {}
+};
+
+/// Cuts complete records out of input chunks split at arbitrary positions
+
+/**
+ * Lines and records split between chunks are kept until the rest arrives,
+ * so the input can be fed as it is received, without blocking for the
+ * next line.
+ */
+class RecordAssembler {
+public:
+    RecordAssembler(bool processReverse, RecordListener * listener);
+    /**
+     * Feed the next chunk of the input. The listener is called for every
+     * record completed by the chunk.
+     */
+    void feed(const char * data, size_t length);
+    /**
+     * Signal the end of the input. A last line without a newline is
+     * scanned, and a truncated record is passed to the listener so that
+     * the alignment parser reports it. The assembler can be reused.
+     */
+    void finish();
+private:
+    void feedLine(const char * line, size_t length);
+
+    RecordScanner scanner;
+    RecordListener * listener;
+    /// Line split between two chunks
+    std::string line;
+    /// Record being read
+    std::string record;
+};
+
+#endif /* RECORD_SCANNER_H */
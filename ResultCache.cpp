@@ -0,0 +1,294 @@
+#include "ResultCache.h"
+#include "Hash.h"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+bool ResultCache::Key::operator==(const Key & other) const {
+    return high == other.high && low == other.low;
+}
+
+size_t ResultCache::KeyHash::operator()(const Key & key) const {
+    return key.low;
+}
+
+ResultCache::ResultCache() {
+    fd = -1;
+    inode = 0;
+    scanned = 0;
+    maxSize = 0;
+    lastRefresh = 0;
+}
+
+ResultCache::~ResultCache() {
+    close();
+}
+
+bool ResultCache::open(string filename, unsigned long long maxSize) {
+    this->filename = filename;
+    this->maxSize = maxSize;
+    if (!reopen()) {
+        cerr << "error: Could not open cache file \"" << filename << "\"" << endl;
+        return false;
+    }
+    flock(fd, LOCK_SH);
+    scan();
+    flock(fd, LOCK_UN);
+    lastRefresh = time(NULL);
+    return true;
+}
+
+void ResultCache::close() {
+    if (fd < 0) {
+        return;
+    }
+    flush();
+    ::close(fd);
+    fd = -1;
+    index.clear();
+}
+
+bool ResultCache::isOpen() const {
+    return fd >= 0;
+}
+
+ResultCache::Key ResultCache::makeKey(const char * record, size_t length,
+                                      uint64_t parameters) {
+    Key key;
+    key.high = hash64(record, length, parameters);
+    key.low = hash64(record, length, ~parameters);
+    return key;
+}
+
+bool ResultCache::reopen() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    index.clear();
+    scanned = 0;
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    fstat(fd, &info);
+    inode = info.st_ino;
+    return true;
+}
+
+void ResultCache::scan() {
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        return;
+    }
+    off_t size = info.st_size;
+
+    vector<char> buffer(SCAN_BUFFER_SIZE);
+    off_t bufferStart = 0;
+    off_t bufferEnd = 0;
+    EntryHeader header;
+
+    while (scanned + (off_t) sizeof (header) <= size) {
+        if (scanned < bufferStart || scanned + (off_t) sizeof (header) > bufferEnd) {
+            ssize_t bytes = pread(fd, &buffer[0], buffer.size(), scanned);
+            if (bytes < (ssize_t) sizeof (header)) {
+                break;
+            }
+            bufferStart = scanned;
+            bufferEnd = scanned + bytes;
+        }
+        memcpy(&header, &buffer[scanned - bufferStart], sizeof (header));
+
+        // Stop at entries which are being written or were torn by a crash
+        off_t payload = scanned + sizeof (header);
+        if (header.magic != ENTRY_MAGIC || payload + header.length > size) {
+            break;
+        }
+        Location location;
+        location.offset = payload;
+        location.length = header.length;
+        index[header.key] = location;
+        scanned = payload + header.length;
+    }
+}
+
+void ResultCache::refresh() {
+    time_t now = time(NULL);
+    if (now == lastRefresh) {
+        return;
+    }
+    lastRefresh = now;
+
+    // Follow a replacement of the file after an eviction
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0 || info.st_ino != inode) {
+        if (!reopen()) {
+            return;
+        }
+    }
+    flock(fd, LOCK_SH);
+    scan();
+    flock(fd, LOCK_UN);
+}
+
+bool ResultCache::lookup(const Key & key, string & result) {
+    lock_guard<mutex> guard(lock);
+    if (fd < 0) {
+        return false;
+    }
+
+    unordered_map<Key, Location, KeyHash>::iterator entry = index.find(key);
+    if (entry == index.end()) {
+        // Entries might have been added by other processes
+        refresh();
+        entry = index.find(key);
+        if (entry == index.end()) {
+            return false;
+        }
+    }
+
+    EntryHeader header;
+    string entryData(entry->second.length + sizeof (header), '\0');
+    if (pread(fd, &entryData[0], entryData.size(), entry->second.offset - sizeof (header)) !=
+            (ssize_t) entryData.size()) {
+        return false;
+    }
+    memcpy(&header, entryData.data(), sizeof (header));
+    if (!(header.key == key) || header.checksum !=
+            hash64(entryData.data() + sizeof (header), header.length, key.low)) {
+        index.erase(entry);
+        return false;
+    }
+    result.assign(entryData, sizeof (header), string::npos);
+    return true;
+}
+
+void ResultCache::insert(const Key & key, const string & result) {
+    lock_guard<mutex> guard(lock);
+    if (fd < 0) {
+        return;
+    }
+
+    EntryHeader header;
+    header.magic = ENTRY_MAGIC;
+    header.length = result.size();
+    header.key = key;
+    header.checksum = hash64(result.data(), result.size(), key.low);
+    pending.append((const char *) &header, sizeof (header));
+    pending.append(result);
+
+    if (pending.size() >= FLUSH_SIZE) {
+        flush();
+    }
+}
+
+bool ResultCache::lockExclusive() {
+    while (true) {
+        if (flock(fd, LOCK_EX) != 0) {
+            return false;
+        }
+        struct stat locked, current;
+        if (fstat(fd, &locked) == 0 && stat(filename.c_str(), &current) == 0 &&
+                locked.st_ino == current.st_ino) {
+            return true;
+        }
+        // Another process replaced the file while we were waiting
+        flock(fd, LOCK_UN);
+        if (!reopen()) {
+            return false;
+        }
+    }
+}
+
+void ResultCache::flush() {
+    if (pending.empty() || !lockExclusive()) {
+        return;
+    }
+
+    scan();
+    // Nobody else is writing now, anything after the last valid entry
+    // is a leftover of a crashed writer
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > scanned) {
+        if (ftruncate(fd, scanned) != 0) {
+            flock(fd, LOCK_UN);
+            return;
+        }
+    }
+
+    if (pwrite(fd, pending.data(), pending.size(), scanned) == (ssize_t) pending.size()) {
+        scan();
+    } else {
+        cerr << "warning: Could not write into cache file \"" << filename << "\"" << endl;
+    }
+    pending.clear();
+
+    if ((unsigned long long) scanned > maxSize) {
+        evict();
+    }
+    flock(fd, LOCK_UN);
+}
+
+void ResultCache::evict() {
+    // Keep the newest entries which fit into half of the size cap
+    vector<Location> entries;
+    for (unordered_map<Key, Location, KeyHash>::iterator it = index.begin();
+            it != index.end(); ++it) {
+        entries.push_back(it->second);
+    }
+    sort(entries.begin(), entries.end(), newerFirst);
+
+    unsigned long long kept = 0;
+    size_t count = 0;
+    while (count < entries.size() &&
+            kept + entries[count].length + sizeof (EntryHeader) <= maxSize / 2) {
+        kept += entries[count].length + sizeof (EntryHeader);
+        count++;
+    }
+    entries.resize(count);
+    reverse(entries.begin(), entries.end());
+
+    char suffix[32];
+    sprintf(suffix, ".tmp.%d", (int) getpid());
+    string temporary = filename + suffix;
+    int output = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (output < 0) {
+        return;
+    }
+
+    string entry;
+    off_t written = 0;
+    bool success = true;
+    for (size_t i = 0; i < entries.size() && success; i++) {
+        entry.resize(entries[i].length + sizeof (EntryHeader));
+        off_t start = entries[i].offset - sizeof (EntryHeader);
+        success = pread(fd, &entry[0], entry.size(), start) == (ssize_t) entry.size() &&
+                pwrite(output, entry.data(), entry.size(), written) == (ssize_t) entry.size();
+        written += entry.size();
+    }
+    success = fsync(output) == 0 && success;
+    ::close(output);
+
+    if (!success || rename(temporary.c_str(), filename.c_str()) != 0) {
+        remove(temporary.c_str());
+        return;
+    }
+
+    // The old file (and its lock) is released here
+    if (reopen()) {
+        scan();
+    }
+}
+
+bool ResultCache::newerFirst(const Location & a, const Location & b) {
+    return a.offset > b.offset;
+}
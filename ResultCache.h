@@ -0,0 +1,123 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <stdint.h>
+#include <ctime>
+#include <sys/types.h>
+
+using namespace std;
+
+/// Persistent on-disk cache of formatted hints, shared by processes
+
+/**
+ * The cache is an append-only log of entries keyed by a 128-bit hash of
+ * a raw alignment record and of all scoring parameters. Appends are
+ * serialized with an exclusive flock, so several scorer processes can use
+ * the same cache file. When the file grows over the size cap, the oldest
+ * entries are evicted by rewriting the newest ones into a new file which
+ * atomically replaces the old one.
+ */
+class ResultCache {
+public:
+    /// Cache key
+    struct Key {
+        uint64_t high, low;
+        bool operator==(const Key & other) const;
+    };
+
+    ResultCache();
+    ~ResultCache();
+    /**
+     * Open (or create) the cache file and index its entries
+     * @param filename Cache file
+     * @param maxSize  Size cap of the cache file in bytes
+     * @return Whether the cache was opened
+     */
+    bool open(string filename, unsigned long long maxSize);
+    /**
+     * Write buffered entries and close the cache file
+     */
+    void close();
+    bool isOpen() const;
+    /**
+     * Compute a key of a raw record for the given parameter hash
+     */
+    static Key makeKey(const char * record, size_t length, uint64_t parameters);
+    /**
+     * Look up cached hints
+     * @param key    Record key
+     * @param result Cached hints, if found
+     * @return Whether the key was found
+     */
+    bool lookup(const Key & key, string & result);
+    /**
+     * Add new hints to the cache. Entries are buffered and appended in
+     * batches.
+     */
+    void insert(const Key & key, const string & result);
+private:
+    struct KeyHash {
+        size_t operator()(const Key & key) const;
+    };
+    /// Location of a cached payload in the cache file
+    struct Location {
+        off_t offset;
+        uint32_t length;
+    };
+    /// Entry header stored in front of each payload
+    struct EntryHeader {
+        uint32_t magic;
+        uint32_t length;
+        Key key;
+        uint64_t checksum;
+    };
+
+    /**
+     * Open the cache file at its path and index it from the beginning
+     */
+    bool reopen();
+    /**
+     * Index entries appended since the last scan
+     */
+    void scan();
+    /**
+     * Pick up entries added (or evicted) by other processes. Runs at most
+     * once per second.
+     */
+    void refresh();
+    /**
+     * Lock the cache file exclusively, following replacements of the file
+     * by other processes
+     */
+    bool lockExclusive();
+    /**
+     * Append buffered entries to the cache file
+     */
+    void flush();
+    /**
+     * Replace the cache file with its newest entries
+     */
+    void evict();
+    static bool newerFirst(const Location & a, const Location & b);
+
+    string filename;
+    unsigned long long maxSize;
+    int fd;
+    ino_t inode;
+    /// End of the last valid entry seen in the file
+    off_t scanned;
+    unordered_map<Key, Location, KeyHash> index;
+    /// Serialized entries waiting to be appended
+    string pending;
+    time_t lastRefresh;
+    mutex lock;
+
+    static const uint32_t ENTRY_MAGIC = 0x53424331;
+    static const size_t FLUSH_SIZE = 1024 * 1024;
+    static const size_t SCAN_BUFFER_SIZE = 1024 * 1024;
+};
+
+#endif /* RESULT_CACHE_H */
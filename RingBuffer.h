@@ -0,0 +1,226 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <stddef.h>
+
+using namespace std;
+
+/// Lock-free bounded queues for passing pointers between pipeline stages
+
+/**
+ * Both rings only hold trivially copyable values (in practice pointers to
+ * recycled buffers) and never allocate after construction. The capacity is
+ * rounded up to a power of two. tryPush() and tryPop() never block; push()
+ * and pop() retry until they succeed, see RingBackoff.
+ */
+
+/// Size of a cache line, counters written by different threads are kept apart
+#define RING_CACHE_LINE 64
+/// Number of immediate retries of a blocked push or pop
+#define RING_SPINS 64
+/// Number of retries after yielding the processor
+#define RING_YIELDS 64
+/// Sleep between the following retries, in microseconds
+#define RING_SLEEP 50
+
+/// Wait strategy of a blocked stage: spin, then yield, then sleep
+
+/**
+ * Spinning keeps the handoff latency low when the other stage is about to
+ * catch up, sleeping stops idle stages from taking the processor away from
+ * the busy ones when there are more threads than cores.
+ */
+class RingBackoff {
+public:
+    RingBackoff() {
+        attempts = 0;
+    }
+
+    void wait() {
+        if (attempts < RING_SPINS) {
+            attempts++;
+        } else if (attempts < RING_SPINS + RING_YIELDS) {
+            attempts++;
+            this_thread::yield();
+        } else {
+            this_thread::sleep_for(chrono::microseconds(RING_SLEEP));
+        }
+    }
+private:
+    int attempts;
+};
+
+/**
+ * Round up to a power of two
+ */
+inline size_t ringCapacity(size_t capacity) {
+    size_t result = 2;
+    while (result < capacity) {
+        result *= 2;
+    }
+    return result;
+}
+
+/// Ring with a single producer thread and a single consumer thread
+
+template <typename T>
+class SpscRing {
+public:
+    SpscRing(size_t capacity) : slots(ringCapacity(capacity)) {
+        mask = slots.size() - 1;
+        head = 0;
+        tail = 0;
+    }
+
+    bool tryPush(const T & value) {
+        size_t position = tail.load(memory_order_relaxed);
+        if (position - head.load(memory_order_acquire) == slots.size()) {
+            return false;
+        }
+        slots[position & mask] = value;
+        tail.store(position + 1, memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T & value) {
+        size_t position = head.load(memory_order_relaxed);
+        if (position == tail.load(memory_order_acquire)) {
+            return false;
+        }
+        value = slots[position & mask];
+        head.store(position + 1, memory_order_release);
+        return true;
+    }
+
+    void push(const T & value) {
+        RingBackoff backoff;
+        while (!tryPush(value)) {
+            backoff.wait();
+        }
+    }
+
+    void pop(T & value) {
+        RingBackoff backoff;
+        while (!tryPop(value)) {
+            backoff.wait();
+        }
+    }
+
+    size_t capacity() const {
+        return slots.size();
+    }
+
+    /**
+     * @return Whether there is nothing to pop, only exact for the consumer
+     */
+    bool empty() const {
+        return head.load(memory_order_relaxed) == tail.load(memory_order_acquire);
+    }
+private:
+    vector<T> slots;
+    size_t mask;
+    /// Next position to pop, written by the consumer
+    alignas(RING_CACHE_LINE) atomic<size_t> head;
+    /// Next position to push, written by the producer
+    alignas(RING_CACHE_LINE) atomic<size_t> tail;
+};
+
+/// Ring with any number of producer and consumer threads
+
+/**
+ * Every slot carries a sequence number telling whether it is free for the
+ * producer of a given lap or filled for the consumer of that lap, so that
+ * producers and consumers only contend on their own position counter.
+ */
+template <typename T>
+class MpmcRing {
+public:
+    MpmcRing(size_t capacity) : slots(ringCapacity(capacity)) {
+        mask = slots.size() - 1;
+        for (size_t i = 0; i < slots.size(); i++) {
+            slots[i].sequence.store(i, memory_order_relaxed);
+        }
+        head = 0;
+        tail = 0;
+    }
+
+    bool tryPush(const T & value) {
+        size_t position = tail.load(memory_order_relaxed);
+        while (true) {
+            Slot & slot = slots[position & mask];
+            size_t sequence = slot.sequence.load(memory_order_acquire);
+            ptrdiff_t difference = (ptrdiff_t) sequence - (ptrdiff_t) position;
+            if (difference == 0) {
+                if (tail.compare_exchange_weak(position, position + 1,
+                                               memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.sequence.store(position + 1, memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                // The slot was not consumed yet, the ring is full
+                return false;
+            } else {
+                position = tail.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T & value) {
+        size_t position = head.load(memory_order_relaxed);
+        while (true) {
+            Slot & slot = slots[position & mask];
+            size_t sequence = slot.sequence.load(memory_order_acquire);
+            ptrdiff_t difference = (ptrdiff_t) sequence - (ptrdiff_t) (position + 1);
+            if (difference == 0) {
+                if (head.compare_exchange_weak(position, position + 1,
+                                               memory_order_relaxed)) {
+                    value = slot.value;
+                    slot.sequence.store(position + mask + 1,
+                                        memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                // The slot was not filled yet, the ring is empty
+                return false;
+            } else {
+                position = head.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    void push(const T & value) {
+        RingBackoff backoff;
+        while (!tryPush(value)) {
+            backoff.wait();
+        }
+    }
+
+    void pop(T & value) {
+        RingBackoff backoff;
+        while (!tryPop(value)) {
+            backoff.wait();
+        }
+    }
+
+    size_t capacity() const {
+        return slots.size();
+    }
+private:
+    struct Slot {
+        atomic<size_t> sequence;
+        T value;
+    };
+    vector<Slot> slots;
+    size_t mask;
+    /// Next position to pop, shared by consumers
+    alignas(RING_CACHE_LINE) atomic<size_t> head;
+    /// Next position to push, shared by producers
+    alignas(RING_CACHE_LINE) atomic<size_t> tail;
+};
+
+#endif /* RING_BUFFER_H */
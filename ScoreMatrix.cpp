@@ -1,9 +1,12 @@
 #include "ScoreMatrix.h"
+#include "Hash.h"
+#include "BuiltinMatrices.h"
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <float.h>
+#include <cmath>
 
 using namespace std;
 
@@ -37,10 +40,41 @@ double ScoreMatrix::getScore(char a, char b) const {
     return UNKNOWN_SCORE;
 }
 
+double ScoreMatrix::getCodeScore(int a, int b) const {
+    return pairScores[a + PACKED_AA_CODES * b];
+}
+
+int16_t ScoreMatrix::getFixedCodeScore(int a, int b) const {
+    return fixedPairScores[a + PACKED_AA_CODES * b];
+}
+
+const double * ScoreMatrix::getPairScores() const {
+    return pairScores;
+}
+
+const int16_t * ScoreMatrix::getFixedPairScores() const {
+    return fixedPairScores;
+}
+
+bool ScoreMatrix::isInteger() const {
+    return integer;
+}
+
 double ScoreMatrix::getMaxScore() const{
     return maxScore;
 }
 
+uint64_t ScoreMatrix::fingerprint() const {
+    uint64_t hash = hash64(&columnHeaders[0], columnHeaders.size(), size);
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            double score = matrix.at(columnHeaders[i]).at(columnHeaders[j]);
+            hash = hash64(&score, sizeof (score), hash);
+        }
+    }
+    return hash;
+}
+
 void ScoreMatrix::computeMaxScore() {
     maxScore = -1 * DBL_MAX;
     for (int i = 0; i < size; i++) {
@@ -53,6 +87,35 @@ void ScoreMatrix::computeMaxScore() {
     }
 }
 
+void ScoreMatrix::computeCodeScores() {
+    for (int i = 0; i < PACKED_AA_CODES; i++) {
+        for (int j = 0; j < PACKED_AA_CODES; j++) {
+            double & score = pairScores[i + PACKED_AA_CODES * j];
+            if (i == PACKED_AA_EXCEPTION || j == PACKED_AA_EXCEPTION) {
+                score = UNKNOWN_SCORE;
+            } else {
+                score = getScore(PackedPairs::aminoAcid(i),
+                                 PackedPairs::aminoAcid(j));
+            }
+        }
+    }
+
+    integer = true;
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            double score = matrix.at(columnHeaders[i]).at(columnHeaders[j]);
+            if (score != floor(score) || score < INT16_MIN || score > INT16_MAX) {
+                integer = false;
+            }
+        }
+    }
+    for (int i = 0; i < PACKED_SCORE_TABLE_SIZE; i++) {
+        fixedPairScores[i] = integer ? (int16_t) pairScores[i] : 0;
+    }
+    fixedPairScores[PACKED_SCORE_TABLE_SIZE] = 0;
+    fixedPairScores[PACKED_SCORE_TABLE_SIZE + 1] = 0;
+}
+
 bool ScoreMatrix::loadFromFile(string filename) {
     size = 0;
     inputStream.open(filename.c_str());
@@ -74,6 +137,32 @@ bool ScoreMatrix::loadFromFile(string filename) {
 
     inputStream.close();
     computeMaxScore();
+    computeCodeScores();
+    return true;
+}
+
+bool ScoreMatrix::loadBuiltin(string name) {
+    const BuiltinMatrix * builtin = findBuiltinMatrix(name);
+    if (builtin == NULL) {
+        cerr << "error: Unknown built-in matrix \"" << name << "\". Available "
+                "matrices are: " << builtinMatrixNames() << endl;
+        return false;
+    }
+
+    size = BUILTIN_ALPHABET_SIZE;
+    columnHeaders.clear();
+    matrix.clear();
+    for (int i = 0; i < size; i++) {
+        columnHeaders.push_back(tolower(BUILTIN_ALPHABET[i]));
+    }
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            matrix[columnHeaders[i]][columnHeaders[j]] = builtin->scores[i][j];
+        }
+    }
+
+    computeMaxScore();
+    computeCodeScores();
     return true;
 }
 
@@ -5,6 +5,8 @@
 #include <fstream>
 #include <map>
 #include <vector>
+#include <stdint.h>
+#include "PackedPairs.h"
 
 #define UNKNOWN_SCORE -4
 
@@ -18,14 +20,45 @@ public:
      * Load scoring matrix from a file in csv format
      */
     bool loadFromFile(string filename);
+    /**
+     * Load one of the matrices compiled into the program
+     * @param name Matrix name, see builtinMatrixNames()
+     */
+    bool loadBuiltin(string name);
     /**
      * Return score of a specified amino acid pair
      */
     double getScore(char a, char b) const;
+    /**
+     * Return score of an amino acid pair given by PackedPairs codes
+     */
+    double getCodeScore(int a, int b) const;
+    /**
+     * Return integer score of an amino acid pair given by PackedPairs
+     * codes. Only valid for integer matrices, see isInteger().
+     */
+    int16_t getFixedCodeScore(int a, int b) const;
+    /**
+     * @return Table of scores indexed by PackedPairs::scoreIndex()
+     */
+    const double * getPairScores() const;
+    /**
+     * @return Table of integer scores indexed by PackedPairs::scoreIndex(),
+     *         padded so that it can be read in 32-bit words
+     */
+    const int16_t * getFixedPairScores() const;
+    /**
+     * Return whether all scores are integers representable in 16 bits
+     */
+    bool isInteger() const;
     /**
      * Return maximum score of an amino acid pair in the matrix
      */
     double getMaxScore() const;
+    /**
+     * Return a hash of the matrix contents
+     */
+    uint64_t fingerprint() const;
     void print() const;
 private:
     map<char, map<char, double> > matrix;
@@ -36,7 +69,15 @@ private:
     bool readRow();
     void processLine(string & line);
     void computeMaxScore();
+    /**
+     * Precompute scores of all pairs of amino acid codes
+     */
+    void computeCodeScores();
     double maxScore;
+    /// Scores of translated codon code a and protein code b at a + 32 * b
+    double pairScores[PACKED_SCORE_TABLE_SIZE];
+    int16_t fixedPairScores[PACKED_SCORE_TABLE_SIZE + 2];
+    bool integer;
 };
 
 #endif /* SCORE_MATRIX_H */
@@ -0,0 +1,130 @@
+#include "ScoringBatch.h"
+#include "Alignment.h"
+#include "ScoreMatrix.h"
+#include "Kernel.h"
+#include "CpuFeatures.h"
+
+ScoringBatch::ScoringBatch() {
+    windowWidth = 0;
+    scoreMatrix = NULL;
+    kernel = NULL;
+    integerScoring = false;
+}
+
+void ScoringBatch::setup(int windowWidth, const ScoreMatrix * scoreMatrix,
+                         Kernel * kernel, bool integerScoring) {
+    this->windowWidth = windowWidth;
+    this->scoreMatrix = scoreMatrix;
+    this->kernel = kernel;
+    this->integerScoring = integerScoring;
+}
+
+void ScoringBatch::add(Alignment & alignment) {
+    alignment.queueWindows(*this, windowWidth, scoreMatrix, kernel,
+                           integerScoring);
+    alignments.push_back(&alignment);
+}
+
+void ScoringBatch::addWindow(const PackedPairs & pairs, int start, int step,
+                             double * target) {
+    Window window;
+    window.pairs = &pairs;
+    window.start = start;
+    window.step = step;
+    window.target = target;
+    windows.push_back(window);
+}
+
+void ScoringBatch::score() {
+    const SimdKernels * simd = CpuFeatures::kernels();
+    int count = windows.size();
+    if (count > 0) {
+        if (integerScoring) {
+            gatherFixed();
+            fixedResults.resize(count);
+            simd->fixedBatchDotProducts(fixedScores.data(), count, windowWidth,
+                                        kernel->getFixedWeights(),
+                                        fixedResults.data());
+            for (int j = 0; j < count; j++) {
+                *windows[j].target = fixedResults[j];
+            }
+        } else {
+            gather();
+            results.resize(count);
+            simd->batchDotProducts(scores.data(), count, windowWidth,
+                                   kernel->getWeights(), results.data());
+            for (int j = 0; j < count; j++) {
+                *windows[j].target = results[j];
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < alignments.size(); i++) {
+        alignments[i]->finishScoring();
+    }
+    clear();
+}
+
+void ScoringBatch::gather() {
+    int count = windows.size();
+    const double * table = scoreMatrix->getPairScores();
+    scores.assign((size_t) windowWidth * count, 0);
+    for (int j = 0; j < count; j++) {
+        const Window & window = windows[j];
+        const PackedPairs & pairs = *window.pairs;
+        int length = pairs.exonWindow(window.start, window.step, windowWidth);
+        if (length == 0) {
+            continue;
+        }
+        const uint16_t * data = pairs.data() + window.start;
+        bool exceptions = pairs.hasAminoAcidExceptions();
+        for (int k = 0; k < length; k++) {
+            double score;
+            if (exceptions) {
+                score = pairs.score(window.start + k * window.step, scoreMatrix);
+            } else {
+                score = table[PackedPairs::scoreIndex(data[k * window.step])];
+            }
+            scores[(size_t) k * count + j] = score;
+        }
+    }
+}
+
+void ScoringBatch::gatherFixed() {
+    int count = windows.size();
+    const int16_t * table = scoreMatrix->getFixedPairScores();
+    fixedScores.assign((size_t) windowWidth * count, 0);
+    for (int j = 0; j < count; j++) {
+        const Window & window = windows[j];
+        const PackedPairs & pairs = *window.pairs;
+        int length = pairs.exonWindow(window.start, window.step, windowWidth);
+        if (length == 0) {
+            continue;
+        }
+        const uint16_t * data = pairs.data() + window.start;
+        bool exceptions = pairs.hasAminoAcidExceptions();
+        for (int k = 0; k < length; k++) {
+            int32_t score;
+            if (exceptions) {
+                score = pairs.fixedScore(window.start + k * window.step,
+                                         scoreMatrix);
+            } else {
+                score = table[PackedPairs::scoreIndex(data[k * window.step])];
+            }
+            fixedScores[(size_t) k * count + j] = score;
+        }
+    }
+}
+
+int ScoringBatch::size() const {
+    return alignments.size();
+}
+
+int ScoringBatch::windowCount() const {
+    return windows.size();
+}
+
+void ScoringBatch::clear() {
+    alignments.clear();
+    windows.clear();
+}
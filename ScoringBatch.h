@@ -0,0 +1,89 @@
+#ifndef SCORING_BATCH_H
+#define SCORING_BATCH_H
+
+#include <vector>
+#include <stdint.h>
+#include "PackedPairs.h"
+
+using namespace std;
+
+class Alignment;
+class ScoreMatrix;
+class Kernel;
+
+/// Scores boundary windows of many alignments together
+
+/**
+ * Every alignment has only a few introns, so scoring its windows one by one
+ * leaves the vector units mostly idle. The batch collects the intron, start
+ * and stop windows of many alignments into one work array, with the scores
+ * of all windows at the same offset stored next to each other, and computes
+ * the kernel weighted sums of all windows in a single pass vectorized across
+ * the windows. The results are identical to Alignment::scoreHints().
+ */
+class ScoringBatch {
+public:
+    ScoringBatch();
+    /**
+     * Set the scoring parameters used for all alignments in the batch
+     */
+    void setup(int windowWidth, const ScoreMatrix * scoreMatrix,
+               Kernel * kernel, bool integerScoring);
+    /**
+     * Score exons of a parsed alignment and queue its boundary windows. The
+     * alignment must not be modified until the batch is scored.
+     */
+    void add(Alignment & alignment);
+    /**
+     * Queue a single window, used by Alignment::queueWindows()
+     * @param start  First scored position
+     * @param step   3 for scoring downstream, -3 for scoring upstream
+     * @param target Where the weighted window score is saved
+     */
+    void addWindow(const PackedPairs & pairs, int start, int step,
+                   double * target);
+    /**
+     * Score all queued windows, finish scoring of all queued alignments
+     * and empty the batch
+     */
+    void score();
+    /**
+     * @return Number of queued alignments
+     */
+    int size() const;
+    /**
+     * @return Number of queued windows
+     */
+    int windowCount() const;
+    /**
+     * Remove all queued alignments and windows without scoring them
+     */
+    void clear();
+private:
+    struct Window {
+        const PackedPairs * pairs;
+        int start;
+        int step;
+        double * target;
+    };
+    /**
+     * Fill the work array with the window scores, windows shorter than
+     * the kernel are padded with zeros
+     */
+    void gather();
+    void gatherFixed();
+
+    int windowWidth;
+    const ScoreMatrix * scoreMatrix;
+    Kernel * kernel;
+    bool integerScoring;
+    vector<Alignment *> alignments;
+    vector<Window> windows;
+    /// Score of window j at offset k is at k * windows.size() + j
+    vector<double> scores;
+    vector<int32_t> fixedScores;
+    vector<double> results;
+    vector<int32_t> fixedResults;
+};
+
+#endif /* SCORING_BATCH_H */
@@ -0,0 +1,272 @@
+#include "SimdKernels.h"
+#include <immintrin.h>
+
+// GCC 12 reports false positives inside the intrinsic headers
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+// Compiled with -mavx2, only called when the CPU supports AVX2
+
+/**
+ * Load score indices of 8 strided pairs
+ */
+static inline __m256i loadIndices(const uint16_t * pairs, int stride) {
+    if (stride == 1) {
+        __m256i values = _mm256_cvtepu16_epi32(
+                _mm_loadu_si128((const __m128i *) pairs));
+        return _mm256_and_si256(_mm256_srli_epi32(values, PACKED_SCORE_SHIFT),
+                                _mm256_set1_epi32(PACKED_SCORE_TABLE_SIZE - 1));
+    }
+    return _mm256_setr_epi32(
+            pairScoreIndex(pairs[0]), pairScoreIndex(pairs[stride]),
+            pairScoreIndex(pairs[2 * stride]), pairScoreIndex(pairs[3 * stride]),
+            pairScoreIndex(pairs[4 * stride]), pairScoreIndex(pairs[5 * stride]),
+            pairScoreIndex(pairs[6 * stride]), pairScoreIndex(pairs[7 * stride]));
+}
+
+static void classifyNucleotides(const char * dna, int length, uint8_t * classes) {
+    int i = 0;
+    const __m256i beforeA = _mm256_set1_epi8('a' - 1);
+    const __m256i afterZ = _mm256_set1_epi8('z' + 1);
+    const __m256i gap = _mm256_set1_epi8('-');
+    const __m256i lowercaseFlag = _mm256_set1_epi8(CLASS_LOWERCASE);
+    const __m256i gapFlag = _mm256_set1_epi8(CLASS_GAP);
+    for (; i + 32 <= length; i += 32) {
+        __m256i symbols = _mm256_loadu_si256((const __m256i *) (dna + i));
+        __m256i lowercase = _mm256_and_si256(_mm256_cmpgt_epi8(symbols, beforeA),
+                                             _mm256_cmpgt_epi8(afterZ, symbols));
+        __m256i gaps = _mm256_cmpeq_epi8(symbols, gap);
+        __m256i result = _mm256_or_si256(_mm256_and_si256(lowercase, lowercaseFlag),
+                                         _mm256_and_si256(gaps, gapFlag));
+        _mm256_storeu_si256((__m256i *) (classes + i), result);
+    }
+    for (; i < length; i++) {
+        if (dna[i] >= 'a' && dna[i] <= 'z') {
+            classes[i] = CLASS_LOWERCASE;
+        } else if (dna[i] == '-') {
+            classes[i] = CLASS_GAP;
+        } else {
+            classes[i] = 0;
+        }
+    }
+}
+
+static int exonRun(const uint16_t * pairs, int stride, int count) {
+    int k = 0;
+    for (; k + 8 <= count; k += 8) {
+        const uint16_t * p = pairs + k * stride;
+        __m256i values = _mm256_setr_epi32(p[0], p[stride], p[2 * stride],
+                p[3 * stride], p[4 * stride], p[5 * stride], p[6 * stride],
+                p[7 * stride]);
+        __m256i introns = _mm256_and_si256(values, _mm256_set1_epi32(PACKED_INTRON_BIT));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(
+                _mm256_cmpeq_epi32(introns, _mm256_setzero_si256())));
+        if (mask != 0xFF) {
+            return k + __builtin_ctz(~mask);
+        }
+    }
+    for (; k < count; k++) {
+        if (pairs[k * stride] & PACKED_INTRON_BIT) {
+            return k;
+        }
+    }
+    return count;
+}
+
+static void gatherScores(const uint16_t * pairs, int stride, int count,
+                         const double * table, double * scores) {
+    int k = 0;
+    for (; k + 8 <= count; k += 8) {
+        __m256i indices = loadIndices(pairs + k * stride, stride);
+        _mm256_storeu_pd(scores + k, _mm256_i32gather_pd(table,
+                _mm256_castsi256_si128(indices), 8));
+        _mm256_storeu_pd(scores + k + 4, _mm256_i32gather_pd(table,
+                _mm256_extracti128_si256(indices, 1), 8));
+    }
+    for (; k < count; k++) {
+        scores[k] = table[pairScoreIndex(pairs[k * stride])];
+    }
+}
+
+static void gatherFixedScores(const uint16_t * pairs, int stride, int count,
+                              const int16_t * table, int32_t * scores) {
+    int k = 0;
+    for (; k + 8 <= count; k += 8) {
+        __m256i indices = loadIndices(pairs + k * stride, stride);
+        // 32-bit loads of 16-bit entries, tables are padded at the end
+        __m256i values = _mm256_i32gather_epi32((const int *) table, indices, 2);
+        values = _mm256_srai_epi32(_mm256_slli_epi32(values, 16), 16);
+        _mm256_storeu_si256((__m256i *) (scores + k), values);
+    }
+    for (; k < count; k++) {
+        scores[k] = table[pairScoreIndex(pairs[k * stride])];
+    }
+}
+
+static double dotProduct(const double * a, const double * b, int count) {
+    double products[4];
+    double sum = 0;
+    int k = 0;
+    for (; k + 4 <= count; k += 4) {
+        _mm256_storeu_pd(products, _mm256_mul_pd(_mm256_loadu_pd(a + k),
+                                                 _mm256_loadu_pd(b + k)));
+        sum += products[0];
+        sum += products[1];
+        sum += products[2];
+        sum += products[3];
+    }
+    for (; k < count; k++) {
+        sum += a[k] * b[k];
+    }
+    return sum;
+}
+
+static int32_t horizontalSum(__m256i values) {
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(values),
+                                _mm256_extracti128_si256(values, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+
+static int32_t fixedDotProduct(const int32_t * a, const int32_t * b, int count) {
+    __m256i sums = _mm256_setzero_si256();
+    int k = 0;
+    for (; k + 8 <= count; k += 8) {
+        sums = _mm256_add_epi32(sums, _mm256_mullo_epi32(
+                _mm256_loadu_si256((const __m256i *) (a + k)),
+                _mm256_loadu_si256((const __m256i *) (b + k))));
+    }
+    int32_t sum = horizontalSum(sums);
+    for (; k < count; k++) {
+        sum += a[k] * b[k];
+    }
+    return sum;
+}
+
+static void batchDotProducts(const double * scores, int windows, int width,
+                             const double * weights, double * results) {
+    int j = 0;
+    for (; j + 4 <= windows; j += 4) {
+        __m256d sums = _mm256_setzero_pd();
+        for (int k = 0; k < width; k++) {
+            // Separate multiply and add, the same rounding as the scalar sum
+            const double * row = scores + (size_t) k * windows;
+            sums = _mm256_add_pd(sums, _mm256_mul_pd(_mm256_loadu_pd(row + j),
+                                               _mm256_set1_pd(weights[k])));
+        }
+        _mm256_storeu_pd(results + j, sums);
+    }
+    for (; j < windows; j++) {
+        double sum = 0;
+        for (int k = 0; k < width; k++) {
+            sum += scores[(size_t) k * windows + j] * weights[k];
+        }
+        results[j] = sum;
+    }
+}
+
+static void fixedBatchDotProducts(const int32_t * scores, int windows,
+                                  int width, const int32_t * weights,
+                                  int32_t * results) {
+    int j = 0;
+    for (; j + 8 <= windows; j += 8) {
+        __m256i sums = _mm256_setzero_si256();
+        for (int k = 0; k < width; k++) {
+            const int32_t * row = scores + (size_t) k * windows;
+            sums = _mm256_add_epi32(sums, _mm256_mullo_epi32(
+                    _mm256_loadu_si256((const __m256i *) (row + j)),
+                    _mm256_set1_epi32(weights[k])));
+        }
+        _mm256_storeu_si256((__m256i *) (results + j), sums);
+    }
+    for (; j < windows; j++) {
+        int32_t sum = 0;
+        for (int k = 0; k < width; k++) {
+            sum += scores[(size_t) k * windows + j] * weights[k];
+        }
+        results[j] = sum;
+    }
+}
+
+/**
+ * Select 8 consecutive pairs whose protein code is in the mask
+ */
+static inline __m256i selectProteins(const uint16_t * pairs, uint32_t proteins) {
+    __m256i values = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) pairs));
+    __m256i codes = _mm256_and_si256(
+            _mm256_srli_epi32(values, PACKED_PROTEIN_SHIFT),
+            _mm256_set1_epi32(PACKED_AA_CODES - 1));
+    __m256i bits = _mm256_and_si256(
+            _mm256_srlv_epi32(_mm256_set1_epi32(proteins), codes),
+            _mm256_set1_epi32(1));
+    return _mm256_cmpeq_epi32(bits, _mm256_set1_epi32(1));
+}
+
+static double maskedSum(const uint16_t * pairs, int count, const double * table,
+                        uint32_t proteins, int * selected) {
+    double scores[8];
+    double sum = 0;
+    *selected = 0;
+    int k = 0;
+    for (; k + 8 <= count; k += 8) {
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(
+                selectProteins(pairs + k, proteins)));
+        if (mask == 0) {
+            continue;
+        }
+        gatherScores(pairs + k, 1, 8, table, scores);
+        for (int j = 0; j < 8; j++) {
+            if (mask >> j & 1) {
+                sum += scores[j];
+            }
+        }
+        *selected += __builtin_popcount(mask);
+    }
+    for (; k < count; k++) {
+        if (proteins >> pairProteinCode(pairs[k]) & 1) {
+            sum += table[pairScoreIndex(pairs[k])];
+            (*selected)++;
+        }
+    }
+    return sum;
+}
+
+static int32_t fixedMaskedSum(const uint16_t * pairs, int count,
+                              const int16_t * table, uint32_t proteins,
+                              int * selected) {
+    __m256i sums = _mm256_setzero_si256();
+    __m256i counts = _mm256_setzero_si256();
+    int32_t scores[8];
+    int k = 0;
+    for (; k + 8 <= count; k += 8) {
+        __m256i mask = selectProteins(pairs + k, proteins);
+        gatherFixedScores(pairs + k, 1, 8, table, scores);
+        sums = _mm256_add_epi32(sums, _mm256_and_si256(mask,
+                _mm256_loadu_si256((const __m256i *) scores)));
+        counts = _mm256_sub_epi32(counts, mask);
+    }
+    int32_t sum = horizontalSum(sums);
+    *selected = horizontalSum(counts);
+    for (; k < count; k++) {
+        if (proteins >> pairProteinCode(pairs[k]) & 1) {
+            sum += table[pairScoreIndex(pairs[k])];
+            (*selected)++;
+        }
+    }
+    return sum;
+}
+
+extern const SimdKernels AVX2_KERNELS = {
+    "avx2",
+    classifyNucleotides,
+    exonRun,
+    gatherScores,
+    gatherFixedScores,
+    dotProduct,
+    fixedDotProduct,
+    batchDotProducts,
+    fixedBatchDotProducts,
+    maskedSum,
+    fixedMaskedSum
+};
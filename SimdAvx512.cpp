@@ -0,0 +1,259 @@
+#include "SimdKernels.h"
+#include <immintrin.h>
+
+// GCC 12 reports false positives inside the intrinsic headers
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+// Compiled with -mavx512f -mavx512bw, only called when the CPU supports both
+
+/**
+ * Load score indices of 16 strided pairs
+ */
+static inline __m512i loadIndices(const uint16_t * pairs, int stride) {
+    __m512i values;
+    if (stride == 1) {
+        values = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *) pairs));
+    } else {
+        int32_t strided[16];
+        for (int j = 0; j < 16; j++) {
+            strided[j] = pairs[j * stride];
+        }
+        values = _mm512_loadu_si512(strided);
+    }
+    return _mm512_and_si512(_mm512_srli_epi32(values, PACKED_SCORE_SHIFT),
+                            _mm512_set1_epi32(PACKED_SCORE_TABLE_SIZE - 1));
+}
+
+static void classifyNucleotides(const char * dna, int length, uint8_t * classes) {
+    int i = 0;
+    const __m512i lowerA = _mm512_set1_epi8('a');
+    const __m512i lowerZ = _mm512_set1_epi8('z');
+    const __m512i gap = _mm512_set1_epi8('-');
+    const __m512i lowercaseFlag = _mm512_set1_epi8(CLASS_LOWERCASE);
+    const __m512i gapFlag = _mm512_set1_epi8(CLASS_GAP);
+    for (; i + 64 <= length; i += 64) {
+        __m512i symbols = _mm512_loadu_si512(dna + i);
+        __mmask64 lowercase = _mm512_cmpge_epi8_mask(symbols, lowerA) &
+                _mm512_cmple_epi8_mask(symbols, lowerZ);
+        __mmask64 gaps = _mm512_cmpeq_epi8_mask(symbols, gap);
+        __m512i result = _mm512_or_si512(_mm512_maskz_mov_epi8(lowercase, lowercaseFlag),
+                                         _mm512_maskz_mov_epi8(gaps, gapFlag));
+        _mm512_storeu_si512(classes + i, result);
+    }
+    for (; i < length; i++) {
+        if (dna[i] >= 'a' && dna[i] <= 'z') {
+            classes[i] = CLASS_LOWERCASE;
+        } else if (dna[i] == '-') {
+            classes[i] = CLASS_GAP;
+        } else {
+            classes[i] = 0;
+        }
+    }
+}
+
+static int exonRun(const uint16_t * pairs, int stride, int count) {
+    int k = 0;
+    for (; k + 16 <= count; k += 16) {
+        const uint16_t * p = pairs + k * stride;
+        int32_t strided[16];
+        for (int j = 0; j < 16; j++) {
+            strided[j] = p[j * stride];
+        }
+        __mmask16 introns = _mm512_test_epi32_mask(_mm512_loadu_si512(strided),
+                _mm512_set1_epi32(PACKED_INTRON_BIT));
+        if (introns != 0) {
+            return k + __builtin_ctz(introns);
+        }
+    }
+    for (; k < count; k++) {
+        if (pairs[k * stride] & PACKED_INTRON_BIT) {
+            return k;
+        }
+    }
+    return count;
+}
+
+static void gatherScores(const uint16_t * pairs, int stride, int count,
+                         const double * table, double * scores) {
+    int k = 0;
+    for (; k + 16 <= count; k += 16) {
+        __m512i indices = loadIndices(pairs + k * stride, stride);
+        _mm512_storeu_pd(scores + k, _mm512_i32gather_pd(
+                _mm512_castsi512_si256(indices), table, 8));
+        _mm512_storeu_pd(scores + k + 8, _mm512_i32gather_pd(
+                _mm512_extracti64x4_epi64(indices, 1), table, 8));
+    }
+    for (; k < count; k++) {
+        scores[k] = table[pairScoreIndex(pairs[k * stride])];
+    }
+}
+
+static void gatherFixedScores(const uint16_t * pairs, int stride, int count,
+                              const int16_t * table, int32_t * scores) {
+    int k = 0;
+    for (; k + 16 <= count; k += 16) {
+        __m512i indices = loadIndices(pairs + k * stride, stride);
+        // 32-bit loads of 16-bit entries, tables are padded at the end
+        __m512i values = _mm512_i32gather_epi32(indices, table, 2);
+        values = _mm512_srai_epi32(_mm512_slli_epi32(values, 16), 16);
+        _mm512_storeu_si512(scores + k, values);
+    }
+    for (; k < count; k++) {
+        scores[k] = table[pairScoreIndex(pairs[k * stride])];
+    }
+}
+
+static double dotProduct(const double * a, const double * b, int count) {
+    double products[8];
+    double sum = 0;
+    int k = 0;
+    for (; k + 8 <= count; k += 8) {
+        _mm512_storeu_pd(products, _mm512_mul_pd(_mm512_loadu_pd(a + k),
+                                                 _mm512_loadu_pd(b + k)));
+        for (int j = 0; j < 8; j++) {
+            sum += products[j];
+        }
+    }
+    for (; k < count; k++) {
+        sum += a[k] * b[k];
+    }
+    return sum;
+}
+
+static int32_t fixedDotProduct(const int32_t * a, const int32_t * b, int count) {
+    __m512i sums = _mm512_setzero_si512();
+    int k = 0;
+    for (; k + 16 <= count; k += 16) {
+        sums = _mm512_add_epi32(sums, _mm512_mullo_epi32(
+                _mm512_loadu_si512(a + k), _mm512_loadu_si512(b + k)));
+    }
+    int32_t sum = _mm512_reduce_add_epi32(sums);
+    for (; k < count; k++) {
+        sum += a[k] * b[k];
+    }
+    return sum;
+}
+
+static void batchDotProducts(const double * scores, int windows, int width,
+                             const double * weights, double * results) {
+    int j = 0;
+    for (; j + 8 <= windows; j += 8) {
+        __m512d sums = _mm512_setzero_pd();
+        for (int k = 0; k < width; k++) {
+            // Separate multiply and add, the same rounding as the scalar sum
+            const double * row = scores + (size_t) k * windows;
+            sums = _mm512_add_pd(sums, _mm512_mul_pd(_mm512_loadu_pd(row + j),
+                                               _mm512_set1_pd(weights[k])));
+        }
+        _mm512_storeu_pd(results + j, sums);
+    }
+    for (; j < windows; j++) {
+        double sum = 0;
+        for (int k = 0; k < width; k++) {
+            sum += scores[(size_t) k * windows + j] * weights[k];
+        }
+        results[j] = sum;
+    }
+}
+
+static void fixedBatchDotProducts(const int32_t * scores, int windows,
+                                  int width, const int32_t * weights,
+                                  int32_t * results) {
+    int j = 0;
+    for (; j + 16 <= windows; j += 16) {
+        __m512i sums = _mm512_setzero_si512();
+        for (int k = 0; k < width; k++) {
+            const int32_t * row = scores + (size_t) k * windows;
+            sums = _mm512_add_epi32(sums, _mm512_mullo_epi32(
+                    _mm512_loadu_si512((const __m512i *) (row + j)),
+                    _mm512_set1_epi32(weights[k])));
+        }
+        _mm512_storeu_si512((__m512i *) (results + j), sums);
+    }
+    for (; j < windows; j++) {
+        int32_t sum = 0;
+        for (int k = 0; k < width; k++) {
+            sum += scores[(size_t) k * windows + j] * weights[k];
+        }
+        results[j] = sum;
+    }
+}
+
+/**
+ * Select 16 consecutive pairs whose protein code is in the mask
+ */
+static inline __mmask16 selectProteins(const uint16_t * pairs, uint32_t proteins) {
+    __m512i values = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *) pairs));
+    __m512i codes = _mm512_and_si512(
+            _mm512_srli_epi32(values, PACKED_PROTEIN_SHIFT),
+            _mm512_set1_epi32(PACKED_AA_CODES - 1));
+    return _mm512_test_epi32_mask(
+            _mm512_srlv_epi32(_mm512_set1_epi32(proteins), codes),
+            _mm512_set1_epi32(1));
+}
+
+static double maskedSum(const uint16_t * pairs, int count, const double * table,
+                        uint32_t proteins, int * selected) {
+    double scores[16];
+    double sum = 0;
+    *selected = 0;
+    int k = 0;
+    for (; k + 16 <= count; k += 16) {
+        __mmask16 mask = selectProteins(pairs + k, proteins);
+        if (mask == 0) {
+            continue;
+        }
+        gatherScores(pairs + k, 1, 16, table, scores);
+        for (int j = 0; j < 16; j++) {
+            if (mask >> j & 1) {
+                sum += scores[j];
+            }
+        }
+        *selected += __builtin_popcount(mask);
+    }
+    for (; k < count; k++) {
+        if (proteins >> pairProteinCode(pairs[k]) & 1) {
+            sum += table[pairScoreIndex(pairs[k])];
+            (*selected)++;
+        }
+    }
+    return sum;
+}
+
+static int32_t fixedMaskedSum(const uint16_t * pairs, int count,
+                              const int16_t * table, uint32_t proteins,
+                              int * selected) {
+    __m512i sums = _mm512_setzero_si512();
+    int32_t scores[16];
+    *selected = 0;
+    int k = 0;
+    for (; k + 16 <= count; k += 16) {
+        __mmask16 mask = selectProteins(pairs + k, proteins);
+        gatherFixedScores(pairs + k, 1, 16, table, scores);
+        sums = _mm512_mask_add_epi32(sums, mask, sums, _mm512_loadu_si512(scores));
+        *selected += __builtin_popcount(mask);
+    }
+    int32_t sum = _mm512_reduce_add_epi32(sums);
+    for (; k < count; k++) {
+        if (proteins >> pairProteinCode(pairs[k]) & 1) {
+            sum += table[pairScoreIndex(pairs[k])];
+            (*selected)++;
+        }
+    }
+    return sum;
+}
+
+extern const SimdKernels AVX512_KERNELS = {
+    "avx512",
+    classifyNucleotides,
+    exonRun,
+    gatherScores,
+    gatherFixedScores,
+    dotProduct,
+    fixedDotProduct,
+    batchDotProducts,
+    fixedBatchDotProducts,
+    maskedSum,
+    fixedMaskedSum
+};
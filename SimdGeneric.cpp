@@ -0,0 +1,120 @@
+#include "SimdKernels.h"
+
+static void classifyNucleotides(const char * dna, int length, uint8_t * classes) {
+    for (int i = 0; i < length; i++) {
+        if (dna[i] >= 'a' && dna[i] <= 'z') {
+            classes[i] = CLASS_LOWERCASE;
+        } else if (dna[i] == '-') {
+            classes[i] = CLASS_GAP;
+        } else {
+            classes[i] = 0;
+        }
+    }
+}
+
+static int exonRun(const uint16_t * pairs, int stride, int count) {
+    for (int k = 0; k < count; k++) {
+        if (pairs[k * stride] & PACKED_INTRON_BIT) {
+            return k;
+        }
+    }
+    return count;
+}
+
+static void gatherScores(const uint16_t * pairs, int stride, int count,
+                         const double * table, double * scores) {
+    for (int k = 0; k < count; k++) {
+        scores[k] = table[pairScoreIndex(pairs[k * stride])];
+    }
+}
+
+static void gatherFixedScores(const uint16_t * pairs, int stride, int count,
+                              const int16_t * table, int32_t * scores) {
+    for (int k = 0; k < count; k++) {
+        scores[k] = table[pairScoreIndex(pairs[k * stride])];
+    }
+}
+
+static double dotProduct(const double * a, const double * b, int count) {
+    double sum = 0;
+    for (int k = 0; k < count; k++) {
+        sum += a[k] * b[k];
+    }
+    return sum;
+}
+
+static int32_t fixedDotProduct(const int32_t * a, const int32_t * b, int count) {
+    int32_t sum = 0;
+    for (int k = 0; k < count; k++) {
+        sum += a[k] * b[k];
+    }
+    return sum;
+}
+
+static void batchDotProducts(const double * scores, int windows, int width,
+                             const double * weights, double * results) {
+    for (int j = 0; j < windows; j++) {
+        results[j] = 0;
+    }
+    for (int k = 0; k < width; k++) {
+        const double * row = scores + (size_t) k * windows;
+        for (int j = 0; j < windows; j++) {
+            results[j] += row[j] * weights[k];
+        }
+    }
+}
+
+static void fixedBatchDotProducts(const int32_t * scores, int windows,
+                                  int width, const int32_t * weights,
+                                  int32_t * results) {
+    for (int j = 0; j < windows; j++) {
+        results[j] = 0;
+    }
+    for (int k = 0; k < width; k++) {
+        const int32_t * row = scores + (size_t) k * windows;
+        for (int j = 0; j < windows; j++) {
+            results[j] += row[j] * weights[k];
+        }
+    }
+}
+
+static double maskedSum(const uint16_t * pairs, int count, const double * table,
+                        uint32_t proteins, int * selected) {
+    double sum = 0;
+    *selected = 0;
+    for (int k = 0; k < count; k++) {
+        if (proteins >> pairProteinCode(pairs[k]) & 1) {
+            sum += table[pairScoreIndex(pairs[k])];
+            (*selected)++;
+        }
+    }
+    return sum;
+}
+
+static int32_t fixedMaskedSum(const uint16_t * pairs, int count,
+                              const int16_t * table, uint32_t proteins,
+                              int * selected) {
+    int32_t sum = 0;
+    *selected = 0;
+    for (int k = 0; k < count; k++) {
+        if (proteins >> pairProteinCode(pairs[k]) & 1) {
+            sum += table[pairScoreIndex(pairs[k])];
+            (*selected)++;
+        }
+    }
+    return sum;
+}
+
+extern const SimdKernels GENERIC_KERNELS = {
+    "generic",
+    classifyNucleotides,
+    exonRun,
+    gatherScores,
+    gatherFixedScores,
+    dotProduct,
+    fixedDotProduct,
+    batchDotProducts,
+    fixedBatchDotProducts,
+    maskedSum,
+    fixedMaskedSum
+};
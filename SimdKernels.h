@@ -0,0 +1,93 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <stdint.h>
+#include "PackedPairs.h"
+
+/// Nucleotide class flag of lowercase (intron) letters
+#define CLASS_LOWERCASE 1
+/// Nucleotide class flag of gaps
+#define CLASS_GAP 2
+
+/// Hot loops of parsing and scoring, implemented for several instruction sets
+
+/**
+ * Every variant is compiled in its own translation unit with the matching
+ * target flags and must give bit-identical results: floating point sums are
+ * always accumulated in the order of the input. See CpuFeatures.h for the
+ * selection of a variant.
+ *
+ * Pairs are PackedPairs columns, score tables are indexed by
+ * PackedPairs::scoreIndex().
+ */
+struct SimdKernels {
+    /// Name of the variant
+    const char * name;
+    /**
+     * Classify DNA row symbols into CLASS_LOWERCASE ('a'-'z'), CLASS_GAP
+     * ('-') or 0 (anything else)
+     */
+    void (*classifyNucleotides)(const char * dna, int length, uint8_t * classes);
+    /**
+     * Count exon pairs in pairs[0], pairs[stride], ... up to the first
+     * intron pair or COUNT pairs
+     */
+    int (*exonRun)(const uint16_t * pairs, int stride, int count);
+    /**
+     * Look up scores of pairs[0], pairs[stride], ...
+     */
+    void (*gatherScores)(const uint16_t * pairs, int stride, int count,
+                         const double * table, double * scores);
+    void (*gatherFixedScores)(const uint16_t * pairs, int stride, int count,
+                              const int16_t * table, int32_t * scores);
+    /**
+     * @return Sum of a[k] * b[k], accumulated from k = 0
+     */
+    double (*dotProduct)(const double * a, const double * b, int count);
+    int32_t (*fixedDotProduct)(const int32_t * a, const int32_t * b, int count);
+    /**
+     * Dot products of many windows with the same weights, vectorized across
+     * the windows
+     * @param scores Scores of window j at offset k at scores[k * windows + j]
+     * @param results Sum of scores[k * windows + j] * weights[k] for every
+     *                window j, accumulated from k = 0
+     */
+    void (*batchDotProducts)(const double * scores, int windows, int width,
+                             const double * weights, double * results);
+    void (*fixedBatchDotProducts)(const int32_t * scores, int windows,
+                                  int width, const int32_t * weights,
+                                  int32_t * results);
+    /**
+     * Sum scores of consecutive pairs whose protein code is in the
+     * PROTEINS bit mask, accumulated in the order of the pairs
+     * @param selected Number of summed pairs
+     */
+    double (*maskedSum)(const uint16_t * pairs, int count, const double * table,
+                        uint32_t proteins, int * selected);
+    int32_t (*fixedMaskedSum)(const uint16_t * pairs, int count,
+                              const int16_t * table, uint32_t proteins,
+                              int * selected);
+};
+
+// The helpers below have internal linkage on purpose, so that no copy
+// compiled with wider instruction sets is shared with other variants
+
+/**
+ * @return Score table index of a packed pair, see PackedPairs::scoreIndex()
+ */
+static inline int pairScoreIndex(uint16_t pair) {
+    return (pair >> PACKED_SCORE_SHIFT) & (PACKED_SCORE_TABLE_SIZE - 1);
+}
+
+/**
+ * @return Protein code of a packed pair
+ */
+static inline int pairProteinCode(uint16_t pair) {
+    return (pair >> PACKED_PROTEIN_SHIFT) & (PACKED_AA_CODES - 1);
+}
+
+extern const SimdKernels GENERIC_KERNELS;
+extern const SimdKernels AVX2_KERNELS;
+extern const SimdKernels AVX512_KERNELS;
+
+#endif /* SIMD_KERNELS_H */
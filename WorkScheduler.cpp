@@ -0,0 +1,134 @@
+#include "WorkScheduler.h"
+
+WorkScheduler::WorkScheduler(int workers, int window) : queues(workers) {
+    for (int i = 0; i < workers; i++) {
+        queues[i].load = 0;
+    }
+    this->window = window;
+    admitted = 0;
+    consumedTasks = 0;
+    queued = 0;
+    stolen = 0;
+}
+
+void WorkScheduler::add(size_t estimate) {
+    estimates.push_back(estimate);
+}
+
+bool WorkScheduler::next(int worker, int & task) {
+    {
+        unique_lock<mutex> lock(stateLock);
+        admit();
+        while (queued == 0) {
+            if (admitted == (int) estimates.size()) {
+                return false;
+            }
+            available.wait(lock);
+        }
+        // Reserve one of the queued tasks, so that it is certainly found
+        // below even if other workers are taking tasks at the same time
+        queued--;
+    }
+
+    Task taken;
+    while (!pop(worker, taken)) {
+        if (steal(worker, taken)) {
+            unique_lock<mutex> lock(stateLock);
+            stolen++;
+            break;
+        }
+    }
+    task = taken.index;
+    return true;
+}
+
+void WorkScheduler::consumed(int consumed) {
+    unique_lock<mutex> lock(stateLock);
+    consumedTasks = consumed;
+    admit();
+}
+
+int WorkScheduler::steals() {
+    unique_lock<mutex> lock(stateLock);
+    return stolen;
+}
+
+void WorkScheduler::admit() {
+    int admittedBefore = admitted;
+    while (admitted < (int) estimates.size() &&
+            admitted < consumedTasks + window) {
+        Task task;
+        task.index = admitted;
+        task.estimate = estimates[admitted];
+
+        // Give the task to the worker with the least queued work
+        int target = 0;
+        size_t minLoad = 0;
+        for (unsigned int i = 0; i < queues.size(); i++) {
+            unique_lock<mutex> lock(queues[i].lock);
+            if (i == 0 || queues[i].load < minLoad) {
+                minLoad = queues[i].load;
+                target = i;
+            }
+        }
+
+        WorkerQueue & queue = queues[target];
+        unique_lock<mutex> lock(queue.lock);
+        // Keep the deque sorted from the largest task, equal tasks in
+        // the input order
+        deque<Task>::iterator position = queue.tasks.begin();
+        while (position != queue.tasks.end() &&
+                position->estimate >= task.estimate) {
+            position++;
+        }
+        queue.tasks.insert(position, task);
+        queue.load += task.estimate;
+        admitted++;
+        queued++;
+    }
+    if (admitted != admittedBefore) {
+        available.notify_all();
+    }
+}
+
+bool WorkScheduler::pop(int worker, Task & task) {
+    WorkerQueue & queue = queues[worker];
+    unique_lock<mutex> lock(queue.lock);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = queue.tasks.front();
+    queue.tasks.pop_front();
+    queue.load -= task.estimate;
+    return true;
+}
+
+bool WorkScheduler::steal(int worker, Task & task) {
+    // Find the victim with the most queued work
+    int victim = -1;
+    size_t maxLoad = 0;
+    for (unsigned int i = 0; i < queues.size(); i++) {
+        if ((int) i == worker) {
+            continue;
+        }
+        unique_lock<mutex> lock(queues[i].lock);
+        if (!queues[i].tasks.empty() &&
+                (victim == -1 || queues[i].load > maxLoad)) {
+            maxLoad = queues[i].load;
+            victim = i;
+        }
+    }
+    if (victim == -1) {
+        return false;
+    }
+
+    WorkerQueue & queue = queues[victim];
+    unique_lock<mutex> lock(queue.lock);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    queue.load -= task.estimate;
+    return true;
+}
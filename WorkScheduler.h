@@ -0,0 +1,89 @@
+#ifndef WORK_SCHEDULER_H
+#define WORK_SCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <stddef.h>
+
+using namespace std;
+
+/// Size-aware work-stealing scheduler of tasks whose results are consumed in order
+
+/**
+ * Tasks are numbered in the input order and carry an estimate of their
+ * cost (the byte length of their records). Only tasks inside a sliding
+ * window starting at the first unconsumed task are scheduled, which bounds
+ * the number of finished results waiting to be consumed in order.
+ *
+ * Every worker has its own deque kept sorted from the largest task. A newly
+ * admitted task is given to the worker with the least queued work. Workers
+ * start their largest task first, so a giant record does not end up behind
+ * the small ones, and a worker with an empty deque steals the smallest task
+ * of the worker with the most queued work.
+ */
+class WorkScheduler {
+public:
+    /**
+     * @param workers Number of workers
+     * @param window  Maximum number of tasks scheduled ahead of the first
+     *                unconsumed task
+     */
+    WorkScheduler(int workers, int window);
+    /**
+     * Add a task. Tasks must be added before any worker asks for them.
+     * @param estimate Estimated cost of the task
+     */
+    void add(size_t estimate);
+    /**
+     * Wait for a task
+     * @param worker Index of the asking worker
+     * @param task   Index of the task in the order of add() calls
+     * @return False when there are no tasks left
+     */
+    bool next(int worker, int & task);
+    /**
+     * Let the scheduler know that results of all tasks before CONSUMED
+     * were consumed, which moves the scheduling window forward
+     */
+    void consumed(int consumed);
+    /**
+     * @return Number of tasks stolen from other workers
+     */
+    int steals();
+private:
+    struct Task {
+        int index;
+        size_t estimate;
+    };
+    struct WorkerQueue {
+        /// Tasks sorted from the largest estimate
+        deque<Task> tasks;
+        /// Sum of estimates of the queued tasks
+        size_t load;
+        mutex lock;
+    };
+    /**
+     * Queue tasks which entered the scheduling window. Called with
+     * the state lock held.
+     */
+    void admit();
+    bool pop(int worker, Task & task);
+    bool steal(int worker, Task & task);
+
+    vector<WorkerQueue> queues;
+    vector<size_t> estimates;
+    int window;
+    /// Tasks before this one were queued
+    int admitted;
+    /// Tasks before this one were consumed
+    int consumedTasks;
+    /// Number of queued tasks not taken by workers yet
+    int queued;
+    int stolen;
+    mutex stateLock;
+    condition_variable available;
+};
+
+#endif /* WORK_SCHEDULER_H */
@@ -0,0 +1,160 @@
+/*
+ * Compare scoring of Spaln text input with scoring of the same alignments
+ * converted into the binary format. The input is replicated into a larger
+ * file, converted by the scorer and both files are scored with a single
+ * thread, both strands included.
+ *
+ * Usage: binary_input scorer alignment_file matrix_file [copies] [runs]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+
+using namespace std;
+
+#define DEFAULT_COPIES 100
+#define DEFAULT_RUNS 5
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Save COPIES copies of the whole input
+ */
+bool writeLargeInput(string input, string output, int copies) {
+    ifstream ifs(input.c_str(), ifstream::binary);
+    string data((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+    ofstream ofs(output.c_str(), ofstream::binary);
+    for (int i = 0; i < copies; i++) {
+        ofs << data;
+    }
+    return !data.empty() && ofs.good();
+}
+
+off_t fileSize(string file) {
+    struct stat info;
+    if (stat(file.c_str(), &info) != 0) {
+        return -1;
+    }
+    return info.st_size;
+}
+
+/**
+ * Run the scorer with INPUT as its standard input
+ * @return Seconds of the run, negative on failure
+ */
+double run(string input, const vector<string> & arguments) {
+    vector<char *> argv;
+    for (unsigned int i = 0; i < arguments.size(); i++) {
+        argv.push_back((char *) arguments[i].c_str());
+    }
+    argv.push_back(NULL);
+
+    double start = now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd = open(input.c_str(), O_RDONLY);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(fd, STDIN_FILENO);
+        dup2(null, STDERR_FILENO);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return -1;
+    }
+    return now() - start;
+}
+
+void report(string label, vector<double> & times) {
+    sort(times.begin(), times.end());
+    double sum = 0;
+    for (unsigned int i = 0; i < times.size(); i++) {
+        sum += times[i];
+    }
+    cout << label << "\tmin_ms=" << times.front() * 1000 <<
+            "\tmedian_ms=" << times[times.size() / 2] * 1000 <<
+            "\tmean_ms=" << sum / times.size() * 1000 << endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        cerr << "Usage: " << argv[0] << " scorer alignment_file matrix_file [copies] [runs]" << endl;
+        return 1;
+    }
+    string scorer = argv[1];
+    int copies = argc > 4 ? atoi(argv[4]) : DEFAULT_COPIES;
+    int runs = argc > 5 ? atoi(argv[5]) : DEFAULT_RUNS;
+
+    char directory[] = "/tmp/binary_inputXXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        cerr << "error: Could not create a temporary directory" << endl;
+        return 1;
+    }
+    string text = string(directory) + "/input.ali";
+    string binary = string(directory) + "/input.bin";
+    string output = string(directory) + "/output.gff";
+    vector<string> convert;
+    convert.push_back(scorer);
+    convert.push_back("convert");
+    convert.push_back("-o");
+    convert.push_back(binary);
+    if (!writeLargeInput(argv[2], text, copies) || run(text, convert) < 0) {
+        cerr << "error: Could not prepare the benchmark input" << endl;
+        return 1;
+    }
+    cout << "size\ttext_bytes=" << fileSize(text) << "\tbinary_bytes=" <<
+            fileSize(binary) << "\tratio=" <<
+            (double) fileSize(text) / fileSize(binary) << endl;
+
+    vector<string> score;
+    score.push_back(scorer);
+    score.push_back("-o");
+    score.push_back(output);
+    score.push_back("-s");
+    score.push_back(argv[3]);
+    score.push_back("-r");
+    score.push_back("-t");
+    score.push_back("1");
+
+    // Alternate the inputs so that both see the same machine state
+    string inputs[] = {text, binary};
+    string labels[] = {"text", "binary"};
+    vector<double> times[2];
+    int result = 0;
+    for (int i = 0; i < runs && result == 0; i++) {
+        for (int j = 0; j < 2; j++) {
+            double elapsed = run(inputs[j], score);
+            if (elapsed < 0) {
+                cerr << "error: The scorer failed with the " << labels[j] << " input" << endl;
+                result = 1;
+                break;
+            }
+            times[j].push_back(elapsed);
+        }
+    }
+    if (result == 0) {
+        report("text_input", times[0]);
+        report("binary_input", times[1]);
+    }
+
+    unlink(text.c_str());
+    unlink(binary.c_str());
+    unlink(output.c_str());
+    rmdir(directory);
+    return result;
+}
@@ -0,0 +1,174 @@
+/*
+ * Measure the cost of passing work between pipeline stages. The first part
+ * passes pointers between two threads through the lock-free rings and
+ * through a mutex/condition variable queue. The second part pipes many
+ * copies of a tiny alignment into the scorer, where the handoff cost is
+ * significant compared to the few microseconds spent scoring a record.
+ *
+ * Usage: pipeline_handoff scorer alignment_file matrix_file [copies]
+ */
+
+#include "../RingBuffer.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+
+using namespace std;
+
+#define HANDOFFS 1000000
+#define QUEUE_CAPACITY 64
+#define DEFAULT_COPIES 20000
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/// Bounded queue guarded by a mutex, the alternative to the rings
+
+class LockedQueue {
+public:
+    void push(int * value) {
+        unique_lock<mutex> guard(lock);
+        while (items.size() == QUEUE_CAPACITY) {
+            notFull.wait(guard);
+        }
+        items.push_back(value);
+        notEmpty.notify_one();
+    }
+
+    void pop(int * & value) {
+        unique_lock<mutex> guard(lock);
+        while (items.empty()) {
+            notEmpty.wait(guard);
+        }
+        value = items.front();
+        items.pop_front();
+        notFull.notify_one();
+    }
+private:
+    deque<int *> items;
+    mutex lock;
+    condition_variable notEmpty, notFull;
+};
+
+/**
+ * Pass HANDOFFS pointers from a producer thread to a consumer thread
+ * @return Nanoseconds per handoff
+ */
+template <typename Queue>
+double measureHandoff(Queue & queue) {
+    int value = 0;
+    double start = now();
+    thread producer([&queue, &value]() {
+        for (int i = 0; i < HANDOFFS; i++) {
+            queue.push(&value);
+        }
+    });
+    int * received;
+    for (int i = 0; i < HANDOFFS; i++) {
+        queue.pop(received);
+    }
+    producer.join();
+    return (now() - start) / HANDOFFS * 1e9;
+}
+
+/**
+ * Save COPIES copies of the first alignment record of the input
+ */
+bool writeTinyInput(string input, string output, int copies) {
+    ifstream ifs(input.c_str());
+    string line, record;
+    int headers = 0;
+    while (getline(ifs, line)) {
+        if (!line.empty() && line[0] == '>' && ++headers == 2) {
+            break;
+        }
+        record += line + "\n";
+    }
+    ofstream ofs(output.c_str());
+    for (int i = 0; i < copies; i++) {
+        ofs << record;
+    }
+    return headers > 0 && ofs.good();
+}
+
+/**
+ * Run the scorer with its input supplied through a pipe
+ * @return Seconds of the run, negative on failure
+ */
+double measureScorer(string scorer, string input, string matrix, string output,
+                     string threads) {
+    double start = now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        // cat keeps the input a pipe, which is not memory mapped
+        string command = "cat '" + input + "' | '" + scorer + "' -o '" + output +
+                "' -s '" + matrix + "' -t " + threads + " 2> /dev/null";
+        execl("/bin/sh", "sh", "-c", command.c_str(), (char *) NULL);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return -1;
+    }
+    return now() - start;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        cerr << "Usage: " << argv[0] << " scorer alignment_file matrix_file [copies]" << endl;
+        return 1;
+    }
+    int copies = argc > 4 ? atoi(argv[4]) : DEFAULT_COPIES;
+
+    SpscRing<int *> spsc(QUEUE_CAPACITY);
+    MpmcRing<int *> mpmc(QUEUE_CAPACITY);
+    LockedQueue locked;
+    cout << "handoff\tspsc_ring_ns=" << measureHandoff(spsc) <<
+            "\tmpmc_ring_ns=" << measureHandoff(mpmc) <<
+            "\tmutex_queue_ns=" << measureHandoff(locked) << endl;
+
+    char directory[] = "/tmp/pipeline_handoffXXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        cerr << "error: Could not create a temporary directory" << endl;
+        return 1;
+    }
+    string input = string(directory) + "/tiny.ali";
+    string output = string(directory) + "/output.gff";
+    if (!writeTinyInput(argv[2], input, copies)) {
+        cerr << "error: Could not prepare the benchmark input" << endl;
+        return 1;
+    }
+
+    int result = 0;
+    string threads[] = {"1", "2", "4"};
+    for (int i = 0; i < 3; i++) {
+        double elapsed = measureScorer(argv[1], input, argv[3], output, threads[i]);
+        if (elapsed < 0) {
+            cerr << "error: The scorer failed with " << threads[i] << " threads" << endl;
+            result = 1;
+            continue;
+        }
+        cout << "tiny_alignments\tthreads=" << threads[i] << "\tus_per_alignment=" <<
+                elapsed / copies * 1e6 << endl;
+    }
+
+    unlink(input.c_str());
+    unlink(output.c_str());
+    rmdir(directory);
+    return result;
+}
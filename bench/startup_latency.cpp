@@ -0,0 +1,135 @@
+/*
+ * Measure the time from exec to the first byte of output of the scorer
+ * for a tiny input, with a matrix loaded from a file and with a built-in
+ * matrix.
+ *
+ * Usage: startup_latency scorer alignment_file matrix_file [runs]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+
+using namespace std;
+
+#define DEFAULT_RUNS 200
+
+/**
+ * Save the first alignment record of the input into a separate file
+ */
+bool writeTinyInput(string input, string output) {
+    ifstream ifs(input.c_str());
+    ofstream ofs(output.c_str());
+    string line;
+    int headers = 0;
+    while (getline(ifs, line)) {
+        if (!line.empty() && line[0] == '>' && ++headers == 2) {
+            break;
+        }
+        ofs << line << "\n";
+    }
+    return headers > 0 && ofs.good();
+}
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Run the scorer once
+ * @return Seconds from fork to the first output byte (or to the end of
+ *         the run if nothing is printed), negative on failure
+ */
+double measure(string scorer, string input, string matrix, string fifo) {
+    double start = now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd = open(input.c_str(), O_RDONLY);
+        dup2(fd, STDIN_FILENO);
+        execl(scorer.c_str(), scorer.c_str(), "-o", fifo.c_str(),
+              "-s", matrix.c_str(), (char *) NULL);
+        _exit(127);
+    }
+
+    int fd = open(fifo.c_str(), O_RDONLY);
+    char c;
+    ssize_t bytes = read(fd, &c, 1);
+    double elapsed = now() - start;
+    // Drain the rest so that the scorer is not blocked
+    char buffer[4096];
+    while (bytes > 0 && read(fd, buffer, sizeof (buffer)) > 0) {
+    }
+    close(fd);
+
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return -1;
+    }
+    return elapsed;
+}
+
+void report(string label, vector<double> & times) {
+    sort(times.begin(), times.end());
+    double sum = 0;
+    for (unsigned int i = 0; i < times.size(); i++) {
+        sum += times[i];
+    }
+    cout << label << "\tmin_ms=" << times.front() * 1000 <<
+            "\tmedian_ms=" << times[times.size() / 2] * 1000 <<
+            "\tmean_ms=" << sum / times.size() * 1000 << endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        cerr << "Usage: " << argv[0] << " scorer alignment_file matrix_file [runs]" << endl;
+        return 1;
+    }
+    string scorer = argv[1];
+    int runs = argc > 4 ? atoi(argv[4]) : DEFAULT_RUNS;
+
+    char directory[] = "/tmp/startup_latencyXXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        cerr << "error: Could not create a temporary directory" << endl;
+        return 1;
+    }
+    string input = string(directory) + "/tiny.ali";
+    string fifo = string(directory) + "/output";
+    if (!writeTinyInput(argv[2], input) || mkfifo(fifo.c_str(), 0600) != 0) {
+        cerr << "error: Could not prepare the benchmark input" << endl;
+        return 1;
+    }
+
+    string matrices[] = {argv[3], "builtin:blosum62"};
+    int result = 0;
+    for (int m = 0; m < 2; m++) {
+        vector<double> times;
+        for (int i = 0; i < runs; i++) {
+            double elapsed = measure(scorer, input, matrices[m], fifo);
+            if (elapsed < 0) {
+                cerr << "error: The scorer failed with " << matrices[m] << endl;
+                result = 1;
+                break;
+            }
+            times.push_back(elapsed);
+        }
+        if (!times.empty()) {
+            report(matrices[m], times);
+        }
+    }
+
+    unlink(input.c_str());
+    unlink(fifo.c_str());
+    rmdir(directory);
+    return result;
+}
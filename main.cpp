@@ -1,11 +1,21 @@
 #include "Parser.h"
 #include "ScoreMatrix.h"
 #include "Kernel.h"
+#include "BuiltinMatrices.h"
+#include "CpuFeatures.h"
+#include "HintSorter.h"
+#include "ColumnarFormat.h"
+#include "HintIndex.h"
 
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <vector>
 #include <unistd.h>
+#include <getopt.h>
 #include <stdlib.h>
+#include <string.h>
+#include <signal.h>
 
 using namespace std;
 
@@ -14,17 +24,110 @@ using namespace std;
 #define DEFAULT_EXON_SCORE 25
 #define DEFAULT_INITIAL_EXON_SCORE 25
 #define DEFAULT_INITIAL_INTRON_SCORE 0
+#define DEFAULT_THREADS 1
+#define DEFAULT_CHECKPOINT_INTERVAL 60
+#define DEFAULT_CACHE_SIZE 1024
+#define DEFAULT_AGGREGATE_MEMORY 1024
+#define DEFAULT_SORT_MEMORY 1024
+#define DEFAULT_PARTITION_FILES 256
+#define BUILTIN_PREFIX "builtin:"
+
+#define OPT_CHECKPOINT 1000
+#define OPT_CHECKPOINT_INTERVAL 1001
+#define OPT_RESUME 1002
+#define OPT_CACHE 1003
+#define OPT_CACHE_SIZE 1004
+#define OPT_INTEGER_SCORING 1005
+#define OPT_CPU_FEATURES 1006
+#define OPT_SIMD 1007
+#define OPT_SHARDED_OUTPUT 1008
+#define OPT_TAG_SOURCES 1009
+#define OPT_AGGREGATE 1010
+#define OPT_AGGREGATE_MEMORY 1011
+#define OPT_SORTED 1012
+#define OPT_SORT_MEMORY 1013
+#define OPT_TOP_K 1014
+#define OPT_FILTER 1015
+#define OPT_TIER 1016
+#define OPT_OUTPUT_FORMAT 1017
+#define OPT_INDEX 1018
+#define OPT_OUT_COMPRESS 1019
+#define OPT_PARTITION_BY 1020
+#define OPT_PARTITION_FILES 1021
+#define OPT_FLUSH_EVERY 1022
+
+static struct option longOptions[] = {
+    {"checkpoint", required_argument, NULL, OPT_CHECKPOINT},
+    {"checkpoint-interval", required_argument, NULL, OPT_CHECKPOINT_INTERVAL},
+    {"resume", no_argument, NULL, OPT_RESUME},
+    {"cache", required_argument, NULL, OPT_CACHE},
+    {"cache-size", required_argument, NULL, OPT_CACHE_SIZE},
+    {"integer-scoring", no_argument, NULL, OPT_INTEGER_SCORING},
+    {"cpu-features", no_argument, NULL, OPT_CPU_FEATURES},
+    {"simd", required_argument, NULL, OPT_SIMD},
+    {"sharded-output", no_argument, NULL, OPT_SHARDED_OUTPUT},
+    {"tag-sources", no_argument, NULL, OPT_TAG_SOURCES},
+    {"aggregate", required_argument, NULL, OPT_AGGREGATE},
+    {"aggregate-memory", required_argument, NULL, OPT_AGGREGATE_MEMORY},
+    {"sorted", no_argument, NULL, OPT_SORTED},
+    {"sort-memory", required_argument, NULL, OPT_SORT_MEMORY},
+    {"top-k", required_argument, NULL, OPT_TOP_K},
+    {"filter", required_argument, NULL, OPT_FILTER},
+    {"tier", required_argument, NULL, OPT_TIER},
+    {"output-format", required_argument, NULL, OPT_OUTPUT_FORMAT},
+    {"index", no_argument, NULL, OPT_INDEX},
+    {"out-compress", required_argument, NULL, OPT_OUT_COMPRESS},
+    {"partition-by", required_argument, NULL, OPT_PARTITION_BY},
+    {"partition-files", required_argument, NULL, OPT_PARTITION_FILES},
+    {"flush-every", required_argument, NULL, OPT_FLUSH_EVERY},
+    {NULL, 0, NULL, 0}
+};
 
 void printUsage(char * name) {
     cout << "Usage: " << name << " < input -o output_file -s matrix_file "
-            "[-w integer] [-k kernel] [-e min_exon_score] [-x min_initial_exon_score] [-i min_initial_intron_score] [-r]" << endl << endl;
+            "[-w integer] [-k kernel] [-e min_exon_score] [-x min_initial_exon_score] [-i min_initial_intron_score] [-r] [-t threads]\n"
+            "       [--checkpoint file [--checkpoint-interval seconds] [--resume]]\n"
+            "       [--cache file [--cache-size MB]] [--integer-scoring] [--simd variant]\n"
+            "       [--sharded-output] [--aggregate reducers [--aggregate-memory MB]]\n"
+            "       [--sorted [--sort-memory MB]] [--top-k K] [--filter expression]\n"
+            "       [--tier name:e:x:i:output_file ...] [--output-format format]\n"
+            "       [--index] [--out-compress method]\n"
+            "       [--partition-by key [--partition-files N]] [--flush-every N|Nms]\n"
+            "       " << name << " -o output_file -s matrix_file [options] [--tag-sources] input ...\n"
+            "       " << name << " --cpu-features" << endl << endl;
     cout << "The program can parse multiple separate alignments saved in the same\n"
             "input. The input is read from stdin. Each input alignment is assumed\n"
             "to be on a single line (number of characters per line, controlled\n"
             "by -l option in Spaln, is larger than the alignment length)." << endl << endl;
+    cout << "When input files are listed after the options, they are read\n"
+            "concurrently instead of stdin, as soon as their data arrive. This\n"
+            "is useful for scoring the outputs of several Spaln processes\n"
+            "written into FIFOs. Alignments of all inputs are scored by the\n"
+            "-t threads and printed in the order in which they were read." << endl << endl;
+    cout << "       " << name << " convert < input -o binary_file" << endl << endl;
+    cout << "The convert command parses the Spaln input once and saves it in a\n"
+            "compact binary format. When the binary file is used as the input\n"
+            "(it must be a regular file), the text parsing is skipped. This is\n"
+            "useful when the same alignments are scored repeatedly." << endl << endl;
+    cout << "       " << name << " merge -o output_file sorted_file ..." << endl << endl;
+    cout << "The merge command merges outputs sorted with --sorted (e.g. of\n"
+            "several shards of the input) into one sorted output." << endl << endl;
+    cout << "       " << name << " dump -o output_file columnar_file" << endl << endl;
+    cout << "The dump command prints an output written with --output-format\n"
+            "columnar in the GFF format." << endl << endl;
+    cout << "       " << name << " index gff_file" << endl;
+    cout << "       " << name << " query gff_file contig:start-end ..." << endl << endl;
+    cout << "The index command builds an interval index of a GFF output in\n"
+            "gff_file" HINT_INDEX_SUFFIX ". The query command uses it to print the hints\n"
+            "overlapping the regions (1-based, inclusive) or whole contigs,\n"
+            "ordered by start within each region." << endl << endl;
     cout << "Options:" << endl;
-    cout << "   -o Where to save output file" << endl;
-    cout << "   -s Path to amino acid scoring matrix" << endl;
+    cout << "   -o Where to save output file, \"" STANDARD_OUTPUT "\" writes the hints into\n"
+            "      the standard output. The run ends early, without an error, when\n"
+            "      the program reading the output closes it." << endl;
+    cout << "   -s Path to amino acid scoring matrix, or \"builtin:NAME\" for\n"
+            "      a matrix compiled into the program. Built-in matrices are:\n"
+            "      " << builtinMatrixNames() << endl;
     cout << "   -w Width of a scoring window around introns. Default = " <<
             DEFAULT_WINDOW_WIDTH << endl;
     cout << "   -k Specify type of weighting kernel used. Available opti-\n"
@@ -50,9 +153,365 @@ void printUsage(char * name) {
     cout << "   -r Process alignments on the reverse DNA strand (which are\n"
             "      ignored by default). This option might not be working properly\n"
             "      in this version!" << endl;
+    cout << "   -t Number of threads. When the input is a regular file, it is\n"
+            "      split into chunks which are parsed and scored in parallel.\n"
+            "      Other inputs are read by one thread and scored by the\n"
+            "      others. Default = " << DEFAULT_THREADS << endl;
+    cout << "   --checkpoint file\n"
+            "      Periodically record the input offset, number of alignments\n"
+            "      and output length at an alignment boundary into this file.\n"
+            "      The file is replaced atomically." << endl;
+    cout << "   --checkpoint-interval seconds\n"
+            "      Minimum time between two checkpoints. With 0, a checkpoint is\n"
+            "      saved after every alignment. Default = " <<
+            DEFAULT_CHECKPOINT_INTERVAL << endl;
+    cout << "   --resume\n"
+            "      Continue an interrupted run from the --checkpoint file. The\n"
+            "      output is truncated to the checkpointed length and the input\n"
+            "      (the same as in the interrupted run) is read from the\n"
+            "      checkpointed offset. Without a checkpoint file, the run starts\n"
+            "      from the beginning. A checkpoint written with different scoring\n"
+            "      options or for an input of a different size is refused." << endl;
+    cout << "   --cache file\n"
+            "      Persistent cache of scored hints. Alignments already scored\n"
+            "      with the same settings and matrix (in this or earlier runs)\n"
+            "      are not parsed or scored again. The cache can be shared by\n"
+            "      concurrently running processes." << endl;
+    cout << "   --cache-size MB\n"
+            "      Size cap of the cache file. The oldest entries are evicted\n"
+            "      when the cap is exceeded. Default = " << DEFAULT_CACHE_SIZE << endl;
+    cout << "   --integer-scoring\n"
+            "      Score with 16-bit integer matrix values, fixed-point kernel\n"
+            "      weights and 32-bit integer sums, which are only converted to\n"
+            "      floating point for the output. The scores are reproducible\n"
+            "      across compilers but may differ slightly from the default\n"
+            "      scoring (see README). Requires an integer-valued matrix." << endl;
+    cout << "   --simd variant\n"
+            "      Use the \"generic\", \"avx2\" or \"avx512\" implementation of\n"
+            "      the parsing and scoring kernels instead of the best one\n"
+            "      supported by the CPU. All variants give identical results." << endl;
+    cout << "   --sharded-output\n"
+            "      With -t, let every thread write its hints directly into the\n"
+            "      output file at offsets computed from the sizes of the hints\n"
+            "      before them, instead of passing them to a single writer.\n"
+            "      Only used when the input is a regular file. The output is\n"
+            "      identical." << endl;
+    cout << "   --tag-sources\n"
+            "      With input files, append \"source=FILE;\" with the name of\n"
+            "      the input file to the attributes of every hint." << endl;
+    cout << "   --aggregate reducers\n"
+            "      Collapse hints with the same contig, type, coordinates and\n"
+            "      strand, which are supported by several proteins, into one\n"
+            "      hint. The output is sorted by contig and coordinates.\n"
+            "      Reducers are a comma separated list of \"count\" (mult=),\n"
+            "      \"max\" and \"mean\" of the al_score (al_score_max=,\n"
+            "      al_score_mean=) or of the eScore of CDS (eScore_max=,\n"
+            "      eScore_mean=) and \"proteins\" (prots=)." << endl;
+    cout << "   --aggregate-memory MB\n"
+            "      Memory used by the aggregated hints before they are\n"
+            "      spilled into temporary files next to the output, which\n"
+            "      are merged at the end. Default = " << DEFAULT_AGGREGATE_MEMORY << endl;
+    cout << "   --sorted\n"
+            "      Sort the output by contig and start coordinate. Hints with\n"
+            "      the same contig and start keep their input order." << endl;
+    cout << "   --sort-memory MB\n"
+            "      Memory used by the hints before they are sorted and spilled\n"
+            "      into temporary files next to the output, which are merged\n"
+            "      at the end. Default = " << DEFAULT_SORT_MEMORY << endl;
+    cout << "   --top-k K\n"
+            "      Of the hints with the same contig, type, coordinates and\n"
+            "      strand (e.g. the same intron supported by many proteins),\n"
+            "      keep only the K hints with the highest al_score (eScore for\n"
+            "      CDS). The kept hints are printed in the input order, before\n"
+            "      --aggregate and --sorted are applied." << endl;
+    cout << "   --filter expression\n"
+            "      Print only hints for which the expression is true, e.g.\n"
+            "      'type==Intron && splice_sites in {GT_AG,GC_AG} && al_score>0.2'.\n"
+            "      Fields are type, contig, prot, strand, splice_sites (compared\n"
+            "      case-insensitively with ==, != and in {...}), start, end,\n"
+            "      frame, initial, intron_id, exon_id, al_score, LeScore,\n"
+            "      ReScore, LeNScore, eScore and eNScore (compared with ==, !=,\n"
+            "      <, <=, > and >=). Comparisons are combined with &&, || and !\n"
+            "      and grouped with parentheses. Comparisons of fields which the\n"
+            "      hint does not have are false." << endl;
+    cout << "   --tier name:e:x:i:output_file\n"
+            "      Also print the hints with the thresholds -e, -x and -i given\n"
+            "      by e, x and i into output_file. The option can be repeated\n"
+            "      to produce several hint sets, e.g. strict and permissive\n"
+            "      ones, while scoring every alignment only once." << endl;
+    cout << "   --output-format format\n"
+            "      \"gff\" or \"columnar\". The columnar format is binary, with\n"
+            "      fixed-width columns of coordinates, scores and dictionary IDs\n"
+            "      of names (see README). It is used for the -o and --tier\n"
+            "      outputs and can be printed as GFF with the dump command.\n"
+            "      Default = gff" << endl;
+    cout << "   --index\n"
+            "      At the end of the run, build the interval index of the GFF\n"
+            "      output (and of the --tier outputs) for the query command,\n"
+            "      as the index command would." << endl;
+    cout << "   --out-compress method\n"
+            "      \"auto\", \"none\" or \"bgzf\" (\"gzip\" is the same). BGZF\n"
+            "      is gzip made of independent blocks, which are compressed in\n"
+            "      parallel on -t threads. Sorted BGZF output can be indexed by\n"
+            "      tabix. With \"auto\", the -o and --tier outputs whose names\n"
+            "      end with .gz or .bgz are compressed. Default = auto" << endl;
+    cout << "   --partition-by key\n"
+            "      Write the hints of every \"contig\" or \"gene\" (protein) into\n"
+            "      a separate file, in the input order. The -o output is then\n"
+            "      a path template where " PARTITION_PLACEHOLDER " is replaced by the contig or\n"
+            "      protein name, e.g. -o parts/" PARTITION_PLACEHOLDER ".gff. Missing directories\n"
+            "      are created." << endl;
+    cout << "   --partition-files N\n"
+            "      Maximum number of partition files open at once, the least\n"
+            "      recently written one is closed when another is needed. It\n"
+            "      is also kept below the limit of open files (ulimit -n).\n"
+            "      Default = " << DEFAULT_PARTITION_FILES << endl;
+    cout << "   --flush-every N|Nms\n"
+            "      Flush the output after every N alignments, or at most N\n"
+            "      milliseconds after an alignment is scored and whenever the\n"
+            "      input has to be waited for. Useful when the output is read\n"
+            "      by another program while Spaln is still running. By default,\n"
+            "      the output is written in large blocks." << endl;
+    cout << "   --cpu-features\n"
+            "      Print the detected CPU features and the selected kernels." << endl;
+}
+
+/**
+ * Parse a flush policy, a number of alignments or milliseconds ending
+ * with "ms"
+ * @return False if the policy is invalid
+ */
+bool parseFlushPolicy(string text, unsigned int & alignments,
+                      unsigned int & milliseconds) {
+    char * end;
+    long value = strtol(text.c_str(), &end, 10);
+    if (end == text.c_str() || value <= 0) {
+        return false;
+    }
+    alignments = 0;
+    milliseconds = 0;
+    if (*end == '\0') {
+        alignments = value;
+        return true;
+    }
+    if (string(end) == "ms") {
+        milliseconds = value;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Parse a tier in the format name:e:x:i:output_file
+ * @return False if the tier is invalid
+ */
+bool parseTier(string text, Parser::Tier & tier) {
+    vector<string> parts;
+    size_t start = 0;
+    for (int i = 0; i < 4; i++) {
+        size_t colon = text.find(':', start);
+        if (colon == string::npos) {
+            return false;
+        }
+        parts.push_back(text.substr(start, colon - start));
+        start = colon + 1;
+    }
+    tier.name = parts[0];
+    tier.outputFile = text.substr(start);
+    double * thresholds[] = {&tier.minExonScore, &tier.minInitialExonScore,
+        &tier.minInitialIntronScore};
+    for (int i = 0; i < 3; i++) {
+        char * end;
+        *thresholds[i] = strtod(parts[i + 1].c_str(), &end);
+        if (parts[i + 1].empty() || *end != '\0') {
+            return false;
+        }
+    }
+    return !tier.name.empty() && !tier.outputFile.empty();
+}
+
+int convert(int argc, char** argv) {
+    int opt;
+    string output;
+    while ((opt = getopt(argc, argv, "o:")) != EOF) {
+        switch (opt) {
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (output.size() == 0) {
+        cerr << "error: Output file not specified" << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Parser fileParser;
+    return fileParser.convert(output);
+}
+
+int merge(int argc, char** argv) {
+    int opt;
+    string output;
+    while ((opt = getopt(argc, argv, "o:")) != EOF) {
+        switch (opt) {
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (output.size() == 0) {
+        cerr << "error: Output file not specified" << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (optind == argc) {
+        cerr << "error: No files to merge" << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    ofstream ofs(output.c_str());
+    if (!ofs) {
+        cerr << "error: Could not open output file \"" << output << "\"" << endl;
+        return OPEN_FAIL;
+    }
+    vector<string> files(argv + optind, argv + argc);
+    if (!HintSorter::merge(files, ofs)) {
+        return FORMAT_FAIL;
+    }
+    ofs.close();
+    if (!ofs) {
+        cerr << "error: Could not write output file \"" << output << "\"" << endl;
+        return OPEN_FAIL;
+    }
+    return READ_SUCCESS;
+}
+
+int dump(int argc, char** argv) {
+    int opt;
+    string output;
+    while ((opt = getopt(argc, argv, "o:")) != EOF) {
+        switch (opt) {
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (output.size() == 0) {
+        cerr << "error: Output file not specified" << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (optind != argc - 1) {
+        cerr << "error: Exactly one columnar file must be dumped" << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    ColumnarReader reader;
+    if (!reader.open(argv[optind])) {
+        cerr << "error: \"" << argv[optind] << "\" is not a valid columnar "
+                "file" << endl;
+        return FORMAT_FAIL;
+    }
+    ofstream ofs(output.c_str());
+    if (!ofs) {
+        cerr << "error: Could not open output file \"" << output << "\"" << endl;
+        return OPEN_FAIL;
+    }
+    reader.dump(ofs);
+    ofs.close();
+    if (!ofs) {
+        cerr << "error: Could not write output file \"" << output << "\"" << endl;
+        return OPEN_FAIL;
+    }
+    return READ_SUCCESS;
+}
+
+int index(int argc, char** argv) {
+    if (argc != 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    string gffFile = argv[1];
+    if (!HintIndex::build(gffFile, gffFile + HINT_INDEX_SUFFIX)) {
+        return OPEN_FAIL;
+    }
+    return READ_SUCCESS;
+}
+
+int query(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    string gffFile = argv[1];
+    HintIndex hintIndex;
+    MappedFile gff;
+    if (!hintIndex.open(gffFile + HINT_INDEX_SUFFIX, gffFile)) {
+        return FORMAT_FAIL;
+    }
+    if (!gff.map(gffFile)) {
+        cerr << "error: Could not read file \"" << gffFile << "\"" << endl;
+        return OPEN_FAIL;
+    }
+    vector<pair<uint64_t, uint32_t> > lines;
+    for (int i = 2; i < argc; i++) {
+        string contig;
+        int64_t start, end;
+        if (!HintIndex::parseRegion(argv[i], contig, start, end)) {
+            cerr << "error: Invalid region \"" << argv[i] << "\". The format "
+                    "is contig:start-end or contig." << endl;
+            return 1;
+        }
+        lines.clear();
+        hintIndex.query(contig, start, end, lines);
+        for (unsigned int j = 0; j < lines.size(); j++) {
+            if (lines[j].first + lines[j].second <= gff.size()) {
+                cout.write(gff.data() + lines[j].first, lines[j].second);
+                cout.put('\n');
+            }
+        }
+    }
+    cout.flush();
+    return cout ? READ_SUCCESS : OPEN_FAIL;
 }
 
 int main(int argc, char** argv) {
+    if (argc > 1 && string(argv[1]) == "convert") {
+        argv[1] = argv[0];
+        return convert(argc - 1, argv + 1);
+    }
+    if (argc > 1 && string(argv[1]) == "merge") {
+        argv[1] = argv[0];
+        return merge(argc - 1, argv + 1);
+    }
+    if (argc > 1 && string(argv[1]) == "dump") {
+        argv[1] = argv[0];
+        return dump(argc - 1, argv + 1);
+    }
+    if (argc > 1 && string(argv[1]) == "index") {
+        argv[1] = argv[0];
+        return index(argc - 1, argv + 1);
+    }
+    if (argc > 1 && string(argv[1]) == "query") {
+        argv[1] = argv[0];
+        return query(argc - 1, argv + 1);
+    }
+
     int opt;
     int windowWidth = DEFAULT_WINDOW_WIDTH;
     string output;
@@ -62,8 +521,32 @@ int main(int argc, char** argv) {
     double minInitialIntronScore = DEFAULT_INITIAL_INTRON_SCORE;
     double minInitialExonScore = DEFAULT_INITIAL_EXON_SCORE;
     bool processReverse = false;
+    int threads = DEFAULT_THREADS;
+    string checkpointFile;
+    int checkpointInterval = DEFAULT_CHECKPOINT_INTERVAL;
+    bool resume = false;
+    string cacheFile;
+    unsigned long long cacheSize = DEFAULT_CACHE_SIZE;
+    bool integerScoring = false;
+    bool shardedOutput = false;
+    bool tagSources = false;
+    int aggregateReducers = 0;
+    unsigned long long aggregateMemory = DEFAULT_AGGREGATE_MEMORY;
+    bool sorted = false;
+    unsigned long long sortMemory = DEFAULT_SORT_MEMORY;
+    int topK = 0;
+    HintFilter filter;
+    vector<Parser::Tier> tiers;
+    bool columnarOutput = false;
+    bool buildIndex = false;
+    int compression = COMPRESSION_AUTO;
+    int partitionBy = 0;
+    int partitionFiles = DEFAULT_PARTITION_FILES;
+    unsigned int flushAlignments = 0;
+    unsigned int flushMilliseconds = 0;
 
-    while ((opt = getopt(argc, argv, "o:w:s:k:e:i:x:r")) != EOF) {
+    while ((opt = getopt_long(argc, argv, "o:w:s:k:e:i:x:rt:", longOptions,
+                              NULL)) != EOF) {
         switch (opt) {
             case 'o':
                 output = optarg;
@@ -89,6 +572,133 @@ int main(int argc, char** argv) {
             case 'r':
                 processReverse = true;
                 break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case OPT_CHECKPOINT:
+                checkpointFile = optarg;
+                break;
+            case OPT_CHECKPOINT_INTERVAL:
+                checkpointInterval = atoi(optarg);
+                break;
+            case OPT_RESUME:
+                resume = true;
+                break;
+            case OPT_CACHE:
+                cacheFile = optarg;
+                break;
+            case OPT_CACHE_SIZE:
+                cacheSize = strtoull(optarg, NULL, 10);
+                break;
+            case OPT_INTEGER_SCORING:
+                integerScoring = true;
+                break;
+            case OPT_SHARDED_OUTPUT:
+                shardedOutput = true;
+                break;
+            case OPT_TAG_SOURCES:
+                tagSources = true;
+                break;
+            case OPT_AGGREGATE:
+                aggregateReducers = HintAggregator::parseReducers(optarg);
+                if (aggregateReducers == 0) {
+                    cerr << "error: Invalid reducers \"" << optarg << "\". Valid "
+                            "reducers are \"count\", \"max\", \"mean\" and "
+                            "\"proteins\"." << endl;
+                    return 1;
+                }
+                break;
+            case OPT_AGGREGATE_MEMORY:
+                aggregateMemory = strtoull(optarg, NULL, 10);
+                break;
+            case OPT_SORTED:
+                sorted = true;
+                break;
+            case OPT_SORT_MEMORY:
+                sortMemory = strtoull(optarg, NULL, 10);
+                break;
+            case OPT_TIER: {
+                Parser::Tier tier;
+                if (!parseTier(optarg, tier)) {
+                    cerr << "error: Invalid tier \"" << optarg << "\". The format "
+                            "is name:e:x:i:output_file." << endl;
+                    return 1;
+                }
+                tiers.push_back(tier);
+                break;
+            }
+            case OPT_OUTPUT_FORMAT:
+                if (string(optarg) != "gff" && string(optarg) != "columnar") {
+                    cerr << "error: Invalid output format \"" << optarg << "\". "
+                            "Valid formats are \"gff\" and \"columnar\"." << endl;
+                    return 1;
+                }
+                columnarOutput = string(optarg) == "columnar";
+                break;
+            case OPT_OUT_COMPRESS:
+                if (string(optarg) == "auto") {
+                    compression = COMPRESSION_AUTO;
+                } else if (string(optarg) == "none") {
+                    compression = COMPRESSION_NONE;
+                } else if (string(optarg) == "bgzf" || string(optarg) == "gzip") {
+                    compression = COMPRESSION_BGZF;
+                } else {
+                    cerr << "error: Invalid compression \"" << optarg << "\". "
+                            "Valid methods are \"auto\", \"none\" and \"bgzf\"." << endl;
+                    return 1;
+                }
+                break;
+            case OPT_PARTITION_BY:
+                if (string(optarg) == "contig") {
+                    partitionBy = PARTITION_BY_CONTIG;
+                } else if (string(optarg) == "gene") {
+                    partitionBy = PARTITION_BY_GENE;
+                } else {
+                    cerr << "error: Invalid partition key \"" << optarg << "\". "
+                            "Valid keys are \"contig\" and \"gene\"." << endl;
+                    return 1;
+                }
+                break;
+            case OPT_PARTITION_FILES:
+                partitionFiles = atoi(optarg);
+                if (partitionFiles <= 0) {
+                    cerr << "error: --partition-files must be a positive number." << endl;
+                    return 1;
+                }
+                break;
+            case OPT_FLUSH_EVERY:
+                if (!parseFlushPolicy(optarg, flushAlignments, flushMilliseconds)) {
+                    cerr << "error: Invalid --flush-every \"" << optarg << "\". Use "
+                            "a number of alignments, or of milliseconds such "
+                            "as 100ms." << endl;
+                    return 1;
+                }
+                break;
+            case OPT_INDEX:
+                buildIndex = true;
+                break;
+            case OPT_FILTER:
+                if (!filter.compile(optarg)) {
+                    return 1;
+                }
+                break;
+            case OPT_TOP_K:
+                topK = atoi(optarg);
+                if (topK <= 0) {
+                    cerr << "error: --top-k must be a positive number." << endl;
+                    return 1;
+                }
+                break;
+            case OPT_CPU_FEATURES:
+                CpuFeatures::print(cout);
+                return 0;
+            case OPT_SIMD:
+                if (!CpuFeatures::select(CpuFeatures::level(optarg))) {
+                    cerr << "error: Kernel variant \"" << optarg << "\" is not "
+                            "supported by this CPU. See --cpu-features." << endl;
+                    return 1;
+                }
+                break;
             case '?':
                 printUsage(argv[0]);
                 return 1;
@@ -117,6 +727,158 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    for (unsigned int i = 0; i < tiers.size(); i++) {
+        if (tiers[i].minInitialExonScore > tiers[i].minExonScore) {
+            cerr << "error: Minimum initial exon score must be lower than "
+                    "minimum exon score in tier \"" << tiers[i].name << "\"." << endl;
+            return 1;
+        }
+        if (tiers[i].outputFile == STANDARD_OUTPUT) {
+            cerr << "error: Tier \"" << tiers[i].name << "\" cannot be written "
+                    "into the standard output." << endl;
+            return 1;
+        }
+        if (tiers[i].outputFile == output) {
+            cerr << "error: Tier \"" << tiers[i].name << "\" must be written "
+                    "into a separate output file." << endl;
+            return 1;
+        }
+        for (unsigned int j = 0; j < i; j++) {
+            if (tiers[j].name == tiers[i].name || tiers[j].outputFile == tiers[i].outputFile) {
+                cerr << "error: Tiers \"" << tiers[j].name << "\" and \"" <<
+                        tiers[i].name << "\" must have different names and "
+                        "output files." << endl;
+                return 1;
+            }
+        }
+    }
+    if (tiers.size() > MAX_TIERS) {
+        cerr << "error: At most " << MAX_TIERS << " tiers are supported." << endl;
+        return 1;
+    }
+
+    if (!tiers.empty() && (!checkpointFile.empty() || shardedOutput)) {
+        cerr << "error: --tier cannot be used with --checkpoint or "
+                "--sharded-output." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (threads < 1) {
+        cerr << "error: Number of threads must be a positive integer." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (resume && checkpointFile.empty()) {
+        cerr << "error: --resume requires a --checkpoint file." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    vector<string> inputs(argv + optind, argv + argc);
+    if (!inputs.empty() && !checkpointFile.empty()) {
+        cerr << "error: --checkpoint cannot be used with input files." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (tagSources && inputs.empty()) {
+        cerr << "error: --tag-sources requires input files." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (aggregateReducers != 0 && (!checkpointFile.empty() || shardedOutput)) {
+        cerr << "error: --aggregate cannot be used with --checkpoint or "
+                "--sharded-output." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (sorted && (!checkpointFile.empty() || shardedOutput)) {
+        cerr << "error: --sorted cannot be used with --checkpoint or "
+                "--sharded-output." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (partitionBy != 0) {
+        if (output.find(PARTITION_PLACEHOLDER) == string::npos) {
+            cerr << "error: With --partition-by, the output file must be a "
+                    "template containing \"" PARTITION_PLACEHOLDER "\"." << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (!checkpointFile.empty() || shardedOutput || columnarOutput ||
+                buildIndex || compression == COMPRESSION_BGZF ||
+                (compression == COMPRESSION_AUTO && compressedName(output))) {
+            cerr << "error: --partition-by cannot be used with --checkpoint, "
+                    "--sharded-output, --output-format columnar, --index or "
+                    "compressed output." << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (partitionBy == PARTITION_BY_GENE && aggregateReducers != 0) {
+            cerr << "error: Aggregated hints have no protein and cannot be "
+                    "partitioned by gene." << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    bool compressed = compression == COMPRESSION_BGZF ||
+            (compression == COMPRESSION_AUTO && compressedName(output));
+    for (unsigned int i = 0; i < tiers.size(); i++) {
+        compressed = compressed ||
+                (compression == COMPRESSION_AUTO && compressedName(tiers[i].outputFile));
+    }
+    if (compressed && (!checkpointFile.empty() || shardedOutput || buildIndex ||
+            columnarOutput)) {
+        cerr << "error: Compressed output cannot be used with --checkpoint, "
+                "--sharded-output, --index or --output-format columnar." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (output == STANDARD_OUTPUT && (!checkpointFile.empty() || shardedOutput ||
+            buildIndex || partitionBy != 0)) {
+        cerr << "error: The standard output cannot be used with --checkpoint, "
+                "--sharded-output, --index or --partition-by." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if ((flushAlignments > 0 || flushMilliseconds > 0) && (shardedOutput ||
+            aggregateReducers != 0 || sorted || topK > 0 || columnarOutput ||
+            partitionBy != 0)) {
+        cerr << "error: --flush-every cannot be used with --sharded-output, "
+                "--aggregate, --sorted, --top-k, --output-format columnar or "
+                "--partition-by, which write the hints at the end." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (buildIndex && columnarOutput) {
+        cerr << "error: --index cannot be used with --output-format columnar." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (columnarOutput && (!checkpointFile.empty() || shardedOutput)) {
+        cerr << "error: --output-format columnar cannot be used with "
+                "--checkpoint or --sharded-output." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (topK > 0 && (!checkpointFile.empty() || shardedOutput)) {
+        cerr << "error: --top-k cannot be used with --checkpoint or "
+                "--sharded-output." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
     if (kernelType != "triangular" && kernelType != "box" &&
             kernelType != "parabolic" && kernelType != "triweight") {
         cerr << "error: Invalid kernel. Valid options are \"box\","
@@ -126,13 +888,26 @@ int main(int argc, char** argv) {
     }
 
     ScoreMatrix * scoreMatrix = new ScoreMatrix();
-    if (!scoreMatrix->loadFromFile(matrixFile)) {
+    bool matrixLoaded;
+    if (matrixFile.compare(0, strlen(BUILTIN_PREFIX), BUILTIN_PREFIX) == 0) {
+        matrixLoaded = scoreMatrix->loadBuiltin(matrixFile.substr(strlen(BUILTIN_PREFIX)));
+    } else {
+        matrixLoaded = scoreMatrix->loadFromFile(matrixFile);
+    }
+    if (!matrixLoaded) {
         cerr << "error: Could not load scoring matrix" << endl;
         printUsage(argv[0]);
         return 1;
     }
 
-    Kernel * kernel;
+    if (integerScoring && !scoreMatrix->isInteger()) {
+        cerr << "error: --integer-scoring requires a matrix with integer "
+                "scores." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Kernel * kernel = NULL;
     if (kernelType == "triangular") {
         kernel = new TriangularKernel();
     } else if (kernelType == "box") {
@@ -147,12 +922,43 @@ int main(int argc, char** argv) {
     fileParser.setWindowLegth(windowWidth);
     fileParser.setScoringMatrix(scoreMatrix);
     fileParser.setKernel(kernel);
+    fileParser.setFilter(&filter);
     fileParser.setMinExonScore(minExonScore);
     fileParser.setMinInitialExonScore(minInitialExonScore);
     fileParser.setMinInitialIntronScore(minInitialIntronScore);
     fileParser.setProcessReverse(processReverse);
+    fileParser.setThreads(threads);
+    fileParser.setCheckpoint(checkpointFile);
+    fileParser.setCheckpointInterval(checkpointInterval);
+    fileParser.setResume(resume);
+    fileParser.setCache(cacheFile, cacheSize * 1024 * 1024);
+    fileParser.setIntegerScoring(integerScoring);
+    fileParser.setShardedOutput(shardedOutput);
+    fileParser.setInputs(inputs);
+    fileParser.setTagSources(tagSources);
+    fileParser.setAggregation(aggregateReducers, aggregateMemory * 1024 * 1024);
+    fileParser.setSorting(sorted, sortMemory * 1024 * 1024);
+    fileParser.setTopK(topK);
+    fileParser.setTiers(tiers);
+    fileParser.setColumnarOutput(columnarOutput);
+    fileParser.setCompression(compression);
+    fileParser.setPartitioning(partitionBy, partitionFiles);
+    fileParser.setFlushPolicy(flushAlignments, flushMilliseconds);
 
+    // A closed output pipe is reported by the failed write instead
+    signal(SIGPIPE, SIG_IGN);
     int result = fileParser.parse(output);
+    if (buildIndex && result == READ_SUCCESS) {
+        if (!HintIndex::build(output, output + HINT_INDEX_SUFFIX)) {
+            result = OPEN_FAIL;
+        }
+        for (unsigned int i = 0; i < tiers.size() && result == READ_SUCCESS; i++) {
+            if (!HintIndex::build(tiers[i].outputFile,
+                                  tiers[i].outputFile + HINT_INDEX_SUFFIX)) {
+                result = OPEN_FAIL;
+            }
+        }
+    }
 
     delete scoreMatrix;
     delete kernel;
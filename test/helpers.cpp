@@ -0,0 +1,39 @@
+#include "common.h"
+#include "helpers.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+StandardParser::StandardParser() {
+    scoreMatrix.loadFromFile(ROOT_PATH + "/test_files/blosum62_1.csv");
+    setWindowLegth(10);
+    setScoringMatrix(&scoreMatrix);
+    setKernel(&kernel);
+    setMinExonScore(25);
+    setMinInitialExonScore(25);
+    setMinInitialIntronScore(0);
+    setProcessReverse(true);
+}
+
+void redirectInput(string filename) {
+    freopen(filename.c_str(), "r", stdin);
+    std::cin.clear();
+}
+
+string readFile(string filename) {
+    ifstream ifs(filename.c_str(), ios::binary);
+    stringstream content;
+    content << ifs.rdbuf();
+    return content.str();
+}
+
+vector<string> readLines(string filename) {
+    ifstream ifs(filename.c_str());
+    vector<string> lines;
+    string line;
+    while (getline(ifs, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
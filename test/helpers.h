@@ -0,0 +1,45 @@
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include "../Parser.h"
+#include "../ScoreMatrix.h"
+#include "../Kernel.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/// Parser set up with the settings synthetic.gff was scored with
+
+/**
+ * BLOSUM62, a triangular kernel over a window of 10, minimal exon and
+ * initial exon scores of 25 and both strands. The matrix and the kernel
+ * are owned by the parser, tests only change the settings they check.
+ */
+class StandardParser : public Parser {
+public:
+    StandardParser();
+private:
+    ScoreMatrix scoreMatrix;
+    TriangularKernel kernel;
+};
+
+/**
+ * Compare a test output with an expected file in test_files
+ * @return 0 when the files are identical
+ */
+int returnDiff(string expected, string result);
+/**
+ * Read the standard input from a file
+ */
+void redirectInput(string filename);
+/**
+ * Read a whole file
+ */
+string readFile(string filename);
+/**
+ * Read all lines of a file, without the newline characters
+ */
+vector<string> readLines(string filename);
+
+#endif /* TEST_HELPERS_H */
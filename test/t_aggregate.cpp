@@ -0,0 +1,124 @@
+#include "common.h"
+#include "catch.hpp"
+#include "helpers.h"
+#include "../HintAggregator.h"
+#include "../HintLine.h"
+#include <string>
+#include <vector>
+#include <sstream>
+#include <unistd.h>
+#include <cstdlib>
+
+using namespace std;
+
+static string aggregate(const vector<string> & lines, int reducers,
+                        unsigned long long memoryLimit, int & spills) {
+    HintAggregator aggregator;
+    aggregator.setup(reducers, memoryLimit, ROOT_PATH + "/test_files/test_aggregate_run");
+    for (unsigned int i = 0; i < lines.size(); i++) {
+        aggregator.add(lines[i].data(), lines[i].size());
+    }
+    spills = aggregator.spills();
+    stringstream output;
+    CHECK(aggregator.write(output));
+    return output.str();
+}
+
+TEST_CASE("Identical hints are collapsed by the reducers") {
+    vector<string> lines;
+    lines.push_back("ctg2\tSpaln_scorer\tIntron\t200\t300\t.\t+\t.\tprot=p1; intron_id=1; al_score=0.5; LeScore=10;");
+    lines.push_back("ctg1\tSpaln_scorer\tstop_codon\t50\t52\t.\t-\t0\tprot=p1; al_score=0.25; eScore=40;");
+    lines.push_back("ctg2\tSpaln_scorer\tIntron\t200\t300\t.\t+\t.\tprot=p2; intron_id=3; al_score=0.75; LeScore=12;");
+    lines.push_back("ctg2\tSpaln_scorer\tIntron\t200\t300\t.\t-\t.\tprot=p3; intron_id=1; al_score=0.1; LeScore=12;");
+    lines.push_back("ctg2\tSpaln_scorer\tCDS\t100\t199\t.\t+\t2\tprot=p2; exon_id=1; initial=1; eScore=30; eNScore=1;");
+    lines.push_back("ctg2\tSpaln_scorer\tIntron\t200\t300\t.\t+\t.\tprot=p4; intron_id=2; al_score=1; LeScore=12;");
+
+    int spills;
+    string result = aggregate(lines, AGGREGATE_COUNT | AGGREGATE_MAX |
+                              AGGREGATE_MEAN | AGGREGATE_PROTEINS, 0, spills);
+    CHECK(spills == 0);
+    CHECK(result ==
+          "ctg1\tSpaln_scorer\tstop_codon\t50\t52\t.\t-\t0\tmult=1; al_score_max=0.25; al_score_mean=0.25; prots=p1;\n"
+          "ctg2\tSpaln_scorer\tCDS\t100\t199\t.\t+\t2\tmult=1; eScore_max=30; eScore_mean=30; prots=p2;\n"
+          "ctg2\tSpaln_scorer\tIntron\t200\t300\t.\t+\t.\tmult=3; al_score_max=1; al_score_mean=0.75; prots=p1,p2,p4;\n"
+          "ctg2\tSpaln_scorer\tIntron\t200\t300\t.\t-\t.\tmult=1; al_score_max=0.1; al_score_mean=0.1; prots=p3;\n");
+
+    result = aggregate(lines, AGGREGATE_COUNT, 0, spills);
+    CHECK(result.find("\tmult=3;\n") != string::npos);
+
+    CHECK(HintAggregator::parseReducers("count,max,mean,proteins") ==
+          (AGGREGATE_COUNT | AGGREGATE_MAX | AGGREGATE_MEAN | AGGREGATE_PROTEINS));
+    CHECK(HintAggregator::parseReducers("max") == AGGREGATE_MAX);
+    CHECK(HintAggregator::parseReducers("count,median") == 0);
+}
+
+TEST_CASE("Exact scores are aggregated instead of the rounded ones") {
+    vector<string> lines;
+    lines.push_back("ctg1\tSpaln_scorer\tIntron\t200\t300\t.\t+\t.\tprot=p1; al_score=0.333333; exact_score=0x1.5555555555555p-2;");
+    lines.push_back("ctg1\tSpaln_scorer\tIntron\t200\t300\t.\t+\t.\tprot=p2; al_score=0.666667; exact_score=0x1.5555555555555p-1;");
+    // The mean of the rounded scores would be 15.5834
+    lines.push_back("ctg1\tSpaln_scorer\tCDS\t100\t199\t.\t+\t0\tprot=p1; eScore=10.4454; eNScore=1; exact_score=0x1.4e409ca50930dp+3;");
+    lines.push_back("ctg1\tSpaln_scorer\tCDS\t100\t199\t.\t+\t0\tprot=p2; eScore=20.7215; eNScore=1; exact_score=0x1.4b8b6d8f831dep+4;");
+
+    int spills;
+    string result = aggregate(lines, AGGREGATE_MAX | AGGREGATE_MEAN, 0, spills);
+    CHECK(result ==
+          "ctg1\tSpaln_scorer\tCDS\t100\t199\t.\t+\t0\teScore_max=20.7215; eScore_mean=15.5835;\n"
+          "ctg1\tSpaln_scorer\tIntron\t200\t300\t.\t+\t.\tal_score_max=0.666667; al_score_mean=0.5;\n");
+}
+
+TEST_CASE("Scorer hints carry exact scores only when aggregated") {
+    StandardParser parser;
+    REQUIRE(parser.prepareScoring() == READ_SUCCESS);
+
+    string input = readFile(ROOT_PATH + "/test_files/synthetic.ali");
+    string record = input.substr(0, input.find("\n>", 1) + 1);
+    string plain, exact;
+    parser.scoreRecord(record.data(), record.size(), plain);
+    parser.setAggregation(AGGREGATE_MEAN, 0);
+    parser.scoreRecord(record.data(), record.size(), exact);
+    REQUIRE(!plain.empty());
+    CHECK(plain.find("exact_score=") == string::npos);
+
+    // Each line differs only by its exact score, which rounds to the
+    // printed score
+    stringstream plainLines(plain), exactLines(exact);
+    string plainLine, exactLine;
+    while (getline(plainLines, plainLine)) {
+        REQUIRE(getline(exactLines, exactLine));
+        size_t position = exactLine.find(" exact_score=");
+        REQUIRE(position != string::npos);
+        CHECK(exactLine.substr(0, position) == plainLine);
+        HintLine rounded, unrounded;
+        REQUIRE(rounded.parse(plainLine.data(), plainLine.size()));
+        REQUIRE(unrounded.parse(exactLine.data(), exactLine.size()));
+        double roundedScore, unroundedScore;
+        REQUIRE(rounded.score(roundedScore));
+        REQUIRE(unrounded.score(unroundedScore));
+        stringstream printed;
+        printed << unroundedScore;
+        CHECK(strtod(printed.str().c_str(), NULL) == roundedScore);
+    }
+    CHECK(!getline(exactLines, exactLine));
+}
+
+TEST_CASE("Spilled aggregation runs are merged into the same result") {
+    vector<string> hints = readLines(ROOT_PATH + "/test_files/synthetic.gff");
+    REQUIRE(hints.size() > 100);
+    // Every hint is supported by three proteins, arriving in separate rounds
+    vector<string> lines;
+    for (int round = 0; round < 3; round++) {
+        for (unsigned int i = 0; i < hints.size(); i++) {
+            lines.push_back(hints[i]);
+        }
+    }
+
+    int reducers = AGGREGATE_COUNT | AGGREGATE_MAX | AGGREGATE_PROTEINS;
+    int spills;
+    string expected = aggregate(lines, reducers, 0, spills);
+    CHECK(spills == 0);
+    string spilled = aggregate(lines, reducers, 16 * 1024, spills);
+    CHECK(spills > 2);
+    CHECK(spilled == expected);
+    CHECK(access((ROOT_PATH + "/test_files/test_aggregate_run0").c_str(), F_OK) != 0);
+}
@@ -0,0 +1,222 @@
+#include "common.h"
+#include "catch.hpp"
+#include "../AsyncFile.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+
+using namespace std;
+
+/**
+ * Save text into a file and open it for reading
+ */
+static int openText(string filename, const string & text) {
+    ofstream ofs(filename.c_str(), ios::binary);
+    ofs << text;
+    ofs.close();
+    return open(filename.c_str(), O_RDONLY);
+}
+
+/**
+ * Read all lines of a file with the async reader
+ */
+static vector<string> readLines(int fd, unsigned long long skip,
+                                bool & lastNewline, bool & failed) {
+    AsyncReader reader;
+    reader.start(fd, skip);
+    LineReader lines(reader);
+    vector<string> result;
+    const char * line;
+    size_t length;
+    lastNewline = true;
+    while (lines.next(line, length, lastNewline)) {
+        result.push_back(string(line, length));
+    }
+    failed = reader.failed();
+    return result;
+}
+
+TEST_CASE("Lines are read ahead across block boundaries") {
+    string filename = ROOT_PATH + "/test_files/test_async_input";
+    // Lines of varying lengths, some longer than a block
+    vector<string> expected;
+    string text;
+    for (int i = 0; i < 40; i++) {
+        size_t length = (i * 7919) % 50000 + (i % 9 == 0 ? ASYNC_BLOCK_SIZE + 3 : 0);
+        expected.push_back(string(length, 'A' + i % 26));
+        text += expected.back() + "\n";
+    }
+    expected.push_back("");
+    text += "\n";
+    expected.push_back("last");
+    text += "last";
+
+    bool newline, failed;
+    int fd = openText(filename, text);
+    REQUIRE(fd >= 0);
+    vector<string> lines = readLines(fd, 0, newline, failed);
+    close(fd);
+    CHECK_FALSE(failed);
+    CHECK_FALSE(newline);
+    CHECK(lines == expected);
+
+    // Skip the first two lines
+    fd = openText(filename, text);
+    lines = readLines(fd, expected[0].size() + expected[1].size() + 2, newline, failed);
+    close(fd);
+    CHECK_FALSE(failed);
+    CHECK(lines == vector<string>(expected.begin() + 2, expected.end()));
+
+    // Skip more than the whole input
+    fd = openText(filename, text);
+    lines = readLines(fd, text.size() + 1, newline, failed);
+    close(fd);
+    CHECK(failed);
+    CHECK(lines.empty());
+
+    remove(filename.c_str());
+}
+
+TEST_CASE("Output written behind matches the written data") {
+    string filename = ROOT_PATH + "/test_files/test_async_output";
+    stringstream expected;
+
+    AsyncOutputStream output;
+    REQUIRE(output.open(filename, false));
+    for (int i = 0; i < 300000; i++) {
+        output << "line " << i << "\n";
+        expected << "line " << i << "\n";
+    }
+    output.flush();
+    CHECK((long long) output.tellp() == (long long) expected.str().size());
+    CHECK(output.close());
+
+    AsyncOutputStream appended;
+    REQUIRE(appended.open(filename, true));
+    appended << "appended\n";
+    expected << "appended\n";
+    CHECK((long long) appended.tellp() == (long long) expected.str().size());
+    CHECK(appended.close());
+
+    ifstream ifs(filename.c_str(), ios::binary);
+    stringstream result;
+    result << ifs.rdbuf();
+    CHECK(result.str() == expected.str());
+    remove(filename.c_str());
+
+    AsyncOutputStream missing;
+    CHECK_FALSE(missing.open(ROOT_PATH + "/missing_directory/output", false));
+    CHECK_FALSE(missing);
+}
+
+/**
+ * Open the standard output stream while the standard output is the write
+ * end of a pipe
+ * @return Read end of the pipe
+ */
+static int openPipedOutput(AsyncOutputStream & output) {
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    int saved = dup(STDOUT_FILENO);
+    dup2(fds[1], STDOUT_FILENO);
+    bool opened = output.open(STANDARD_OUTPUT, false);
+    // The stream keeps its own copy of the descriptor
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    close(fds[1]);
+    REQUIRE(opened);
+    return fds[0];
+}
+
+TEST_CASE("Standard output is written into the pipe and reports its closing") {
+    AsyncOutputStream output;
+    int input = openPipedOutput(output);
+    output << "first\nsecond\n";
+    CHECK(output.close());
+    char data[64];
+    ssize_t length = read(input, data, sizeof (data));
+    CHECK(string(data, length > 0 ? length : 0) == "first\nsecond\n");
+    close(input);
+
+    AsyncOutputStream closed;
+    close(openPipedOutput(closed));
+    void (*handler)(int) = signal(SIGPIPE, SIG_IGN);
+    closed << string(ASYNC_BLOCK_SIZE + 1, 'x');
+    closed.flush();
+    CHECK_FALSE(closed.close());
+    CHECK(closed.broken());
+    signal(SIGPIPE, handler);
+}
+
+TEST_CASE("Lines tell when the input has to be waited for") {
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    REQUIRE(write(fds[1], "a\nb", 3) == 3);
+    AsyncReader reader;
+    reader.start(fds[0]);
+    LineReader lines(reader);
+    const char * line;
+    size_t length;
+    bool newline;
+    REQUIRE(lines.next(line, length, newline));
+    CHECK(string(line, length) == "a");
+    // The unfinished line waits for the rest
+    while (!lines.waiting()) {
+        usleep(1000);
+    }
+
+    close(fds[1]);
+    REQUIRE(lines.next(line, length, newline));
+    CHECK(string(line, length) == "b");
+    CHECK_FALSE(lines.next(line, length, newline));
+    CHECK_FALSE(lines.waiting());
+    close(fds[0]);
+}
+
+/**
+ * Read the first line of a pipe whose upstream then stays idle and release
+ * the reader while its thread waits for more input
+ */
+static void readFirstLine(int fd, atomic<bool> & first, atomic<bool> & released) {
+    {
+        AsyncReader reader;
+        reader.start(fd);
+        LineReader lines(reader);
+        const char * line;
+        size_t length;
+        bool newline;
+        first = lines.next(line, length, newline) && string(line, length) == "a";
+        // The thread now waits in the read of the idle pipe
+        while (!lines.waiting()) {
+            usleep(1000);
+        }
+        usleep(10000);
+    }
+    released = true;
+}
+
+TEST_CASE("Stopping does not wait for an idle upstream") {
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    REQUIRE(write(fds[1], "a\n", 2) == 2);
+    atomic<bool> first(false);
+    atomic<bool> released(false);
+    thread reading(readFirstLine, fds[0], ref(first), ref(released));
+    // The write end of the pipe is closed only after the deadline so that
+    // a blocked read fails the test instead of hanging it
+    for (int i = 0; i < 2000 && !released; i++) {
+        usleep(1000);
+    }
+    CHECK(released);
+    close(fds[1]);
+    reading.join();
+    CHECK(first);
+    close(fds[0]);
+}
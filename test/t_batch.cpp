@@ -0,0 +1,91 @@
+#include "common.h"
+#include "catch.hpp"
+#include "../Parser.h"
+#include "../ScoringBatch.h"
+#include "../RecordScanner.h"
+#include "../CpuFeatures.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+/**
+ * Split an alignment file into raw records
+ */
+static vector<string> readRecords(string filename) {
+    ifstream ifs(filename.c_str());
+    RecordScanner scanner(true);
+    vector<string> records;
+    string line;
+    while (getline(ifs, line)) {
+        int state = scanner.feed(line.data(), line.size());
+        if (state == SCAN_START || state == SCAN_SINGLE) {
+            records.push_back("");
+        }
+        if (state != SCAN_OUTSIDE) {
+            records.back() += line + "\n";
+        }
+    }
+    return records;
+}
+
+static bool parseRecord(const string & record, Alignment & alignment) {
+    istringstream stream(record);
+    string headerLine;
+    getline(stream, headerLine);
+    return alignment.parse(stream, headerLine, headerLine[0] == '>') ==
+            READ_SUCCESS;
+}
+
+static string hints(Alignment & alignment) {
+    ostringstream output;
+    alignment.printHints(output, 0, 0, 0);
+    return output.str();
+}
+
+TEST_CASE("Batch scoring gives the same hints as scoring alignments one by one") {
+    vector<string> records = readRecords(ROOT_PATH + "/test_files/synthetic.ali");
+    REQUIRE(records.size() > 1);
+    ScoreMatrix matrix;
+    REQUIRE(matrix.loadFromFile(ROOT_PATH + "/test_files/blosum62_1.csv"));
+    TriangularKernel kernel;
+
+    for (int level = 0; level < SIMD_LEVELS; level++) {
+        if (!CpuFeatures::select(level)) {
+            WARN("Kernel level " << level << " is not supported by the CPU");
+            continue;
+        }
+        for (int integer = 0; integer < 2; integer++) {
+            INFO("Kernels: " << CpuFeatures::kernels()->name
+                 << ", integer scoring: " << integer);
+            ScoringBatch batch;
+            batch.setup(10, &matrix, &kernel, integer);
+            deque<Alignment> alignments;
+            vector<string> expected;
+            for (unsigned int i = 0; i < records.size(); i++) {
+                Alignment single;
+                if (!parseRecord(records[i], single)) {
+                    continue;
+                }
+                single.scoreHints(10, &matrix, &kernel, integer);
+                expected.push_back(hints(single));
+
+                alignments.emplace_back();
+                REQUIRE(parseRecord(records[i], alignments.back()));
+                batch.add(alignments.back());
+            }
+            CHECK(batch.size() == (int) alignments.size());
+            CHECK(batch.windowCount() > batch.size());
+            batch.score();
+            CHECK(batch.size() == 0);
+
+            for (unsigned int i = 0; i < alignments.size(); i++) {
+                CHECK(hints(alignments[i]) == expected[i]);
+            }
+        }
+    }
+    CpuFeatures::select(CpuFeatures::detect());
+}
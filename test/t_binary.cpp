@@ -0,0 +1,79 @@
+#include "common.h"
+#include "catch.hpp"
+#include "helpers.h"
+#include "../BinaryFormat.h"
+#include "../MappedFile.h"
+#include <stdio.h>
+#include <string>
+
+TEST_CASE("Binary records preserve alignment rows") {
+    string binaryFile = ROOT_PATH + "/test_files/test_binary_rows";
+    Alignment::Rows rows;
+    rows.gene = "contig_1";
+    rows.protein = "protein_1";
+    rows.forward = false;
+    rows.dnaStart = 123456;
+    rows.proteinStart = 7;
+    rows.lines.push_back(" M  K  *  J  x  -  ");
+    rows.lines.push_back("ATGAAAgtnnagTAA---tag");
+    rows.lines.push_back(" M  K  -  .  1  3  ");
+    rows.lines[0] += "  ";
+    rows.lines[2] += "  ";
+
+    // Amino acids off the codon middles are kept as well
+    Alignment::Rows shifted = rows;
+    shifted.lines[0] = "M  K  *     J x - A  ";
+    shifted.lines[2] = "      M  K-         3";
+
+    BinaryWriter writer;
+    REQUIRE(writer.open(binaryFile));
+    writer.write(rows);
+    writer.write(shifted);
+    REQUIRE(writer.close());
+
+    MappedFile input;
+    REQUIRE(input.map(binaryFile));
+    REQUIRE(BinaryReader::isBinary(input.data(), input.size()));
+    CHECK_FALSE(BinaryReader::isOutdated(input.data(), input.size()));
+    CHECK(BinaryReader::isOutdated("SBSALN01", BINARY_MAGIC_SIZE));
+    size_t position = BINARY_MAGIC_SIZE;
+    const Alignment::Rows * expected[] = {&rows, &shifted};
+    for (int i = 0; i < 2; i++) {
+        size_t end = BinaryReader::recordEnd(input.data(), input.size(), position);
+        Alignment::Rows decoded;
+        REQUIRE(BinaryReader::decode(input.data() + position, end - position, decoded));
+        CHECK(decoded.gene == expected[i]->gene);
+        CHECK(decoded.protein == expected[i]->protein);
+        CHECK(decoded.forward == expected[i]->forward);
+        CHECK(decoded.dnaStart == expected[i]->dnaStart);
+        CHECK(decoded.proteinStart == expected[i]->proteinStart);
+        CHECK(decoded.lines == expected[i]->lines);
+        position = end;
+    }
+    CHECK(position == input.size());
+    remove(binaryFile.c_str());
+}
+
+TEST_CASE("Scoring converted binary input matches scoring Spaln text") {
+    string inputFile = ROOT_PATH + "/test_files/synthetic.ali";
+    string binaryFile = ROOT_PATH + "/test_files/test_binary_input";
+    string output = ROOT_PATH + "/test_files/test_binary_result";
+
+    Parser converter;
+    redirectInput(inputFile);
+    REQUIRE(converter.convert(binaryFile) == READ_SUCCESS);
+
+    StandardParser fileParser;
+
+    int threads[] = {1, 3};
+    for (int i = 0; i < 2; i++) {
+        INFO("Threads: " << threads[i]);
+        redirectInput(binaryFile);
+        fileParser.setThreads(threads[i]);
+        fileParser.parse(output);
+        CHECK(returnDiff("synthetic.gff", output) == 0);
+    }
+
+    remove(output.c_str());
+    remove(binaryFile.c_str());
+}
@@ -0,0 +1,81 @@
+#include "common.h"
+#include "catch.hpp"
+#include "helpers.h"
+#include "../ResultCache.h"
+#include <stdio.h>
+#include <string>
+#include <sys/stat.h>
+
+TEST_CASE("Cached entries survive reopening and are evicted over the cap") {
+    string cacheFile = ROOT_PATH + "/test_files/test_cache";
+    remove(cacheFile.c_str());
+
+    ResultCache cache;
+    REQUIRE(cache.open(cacheFile, 1024 * 1024));
+    ResultCache::Key first = ResultCache::makeKey("record", 6, 1);
+    ResultCache::Key second = ResultCache::makeKey("record", 6, 2);
+    cache.insert(first, "hints\n");
+    cache.close();
+
+    string result;
+    REQUIRE(cache.open(cacheFile, 1024 * 1024));
+    CHECK(cache.lookup(first, result));
+    CHECK(result == "hints\n");
+    CHECK_FALSE(cache.lookup(second, result));
+    cache.close();
+
+    // Fill a small cache well over its cap
+    REQUIRE(cache.open(cacheFile, 64 * 1024));
+    string payload(1000, 'x');
+    ResultCache::Key last;
+    for (int i = 0; i < 5000; i++) {
+        last = ResultCache::makeKey((const char *) &i, sizeof (i), 3);
+        cache.insert(last, payload);
+    }
+    cache.close();
+
+    struct stat info;
+    stat(cacheFile.c_str(), &info);
+    CHECK(info.st_size <= 64 * 1024);
+    REQUIRE(cache.open(cacheFile, 64 * 1024));
+    CHECK(cache.lookup(last, result));
+    CHECK(result == payload);
+    CHECK_FALSE(cache.lookup(first, result));
+    cache.close();
+    remove(cacheFile.c_str());
+}
+
+TEST_CASE("Runs using a result cache produce the same output") {
+    string inputFile = ROOT_PATH + "/test_files/synthetic.ali";
+    string output = ROOT_PATH + "/test_files/test_cache_result";
+    string expected = ROOT_PATH + "/test_files/test_cache_expected";
+    string cacheFile = ROOT_PATH + "/test_files/test_cache";
+    remove(cacheFile.c_str());
+
+    StandardParser fileParser;
+    fileParser.setCache(cacheFile, 1024 * 1024 * 1024);
+
+    // Cold and warm cache
+    for (int i = 0; i < 2; i++) {
+        redirectInput(inputFile);
+        fileParser.parse(output);
+        CHECK(returnDiff("synthetic.gff", output) == 0);
+    }
+
+    // Different settings must not reuse the cached hints
+    fileParser.setMinExonScore(0);
+    fileParser.setMinInitialExonScore(0);
+    fileParser.setCache("", 0);
+    redirectInput(inputFile);
+    fileParser.parse(expected);
+
+    fileParser.setCache(cacheFile, 1024 * 1024 * 1024);
+    fileParser.setThreads(3);
+    redirectInput(inputFile);
+    fileParser.parse(output);
+    CHECK(system(("diff " + expected + " " + output + " >/dev/null").c_str()) == 0);
+
+    remove(output.c_str());
+    remove(expected.c_str());
+    remove(cacheFile.c_str());
+}
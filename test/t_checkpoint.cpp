@@ -0,0 +1,114 @@
+#include "common.h"
+#include "catch.hpp"
+#include "helpers.h"
+#include "../RecordScanner.h"
+#include <stdio.h>
+#include <string>
+#include <fstream>
+
+TEST_CASE("Resumed run produces the same output as an uninterrupted run") {
+    string inputFile = ROOT_PATH + "/test_files/synthetic.ali";
+    string partialInput = ROOT_PATH + "/test_files/test_checkpoint_input";
+    string output = ROOT_PATH + "/test_files/test_checkpoint_result";
+    string checkpointFile = ROOT_PATH + "/test_files/test_checkpoint";
+
+    // Simulate a run killed in the middle of the input
+    string input = readFile(inputFile);
+    size_t cut = RecordScanner::nextHeader(input.data(), input.size(),
+                                           input.size() / 3, true);
+    ofstream partial(partialInput.c_str());
+    partial << input.substr(0, cut);
+    partial.close();
+
+    int threads[] = {1, 4};
+    for (int i = 0; i < 2; i++) {
+        INFO("Threads: " << threads[i]);
+        remove(checkpointFile.c_str());
+
+        StandardParser fileParser;
+        fileParser.setThreads(threads[i]);
+        fileParser.setCheckpoint(checkpointFile);
+        fileParser.setCheckpointInterval(0);
+
+        redirectInput(partialInput);
+        fileParser.parse(output);
+
+        Checkpoint saved;
+        REQUIRE(saved.load(checkpointFile));
+        CHECK(saved.inputOffset == cut);
+        CHECK(saved.inputSize == cut);
+        // The partial input stands for the full input read until the run
+        // was killed
+        saved.inputSize = input.size();
+        REQUIRE(saved.save(checkpointFile));
+
+        // Output written after the last checkpoint is discarded
+        ofstream garbage(output.c_str(), std::ofstream::app);
+        garbage << "unfinished line";
+        garbage.close();
+
+        redirectInput(inputFile);
+        fileParser.setResume(true);
+        fileParser.parse(output);
+        CHECK(returnDiff("synthetic.gff", output) == 0);
+
+        REQUIRE(saved.load(checkpointFile));
+        CHECK(saved.inputOffset == input.size());
+    }
+
+    remove(output.c_str());
+    remove(partialInput.c_str());
+    remove(checkpointFile.c_str());
+}
+
+TEST_CASE("Run is not resumed with different options or input") {
+    string inputFile = ROOT_PATH + "/test_files/synthetic.ali";
+    string otherInput = ROOT_PATH + "/test_files/test_checkpoint_other_input";
+    string output = ROOT_PATH + "/test_files/test_checkpoint_mismatch_result";
+    string checkpointFile = ROOT_PATH + "/test_files/test_checkpoint_mismatch";
+    remove(checkpointFile.c_str());
+
+    StandardParser fileParser;
+    fileParser.setCheckpoint(checkpointFile);
+    fileParser.setCheckpointInterval(0);
+    redirectInput(inputFile);
+    REQUIRE(fileParser.parse(output) == READ_SUCCESS);
+    Checkpoint saved;
+    REQUIRE(saved.load(checkpointFile));
+
+    // A different window
+    fileParser.setResume(true);
+    fileParser.setWindowLegth(12);
+    redirectInput(inputFile);
+    CHECK(fileParser.parse(output) == FORMAT_FAIL);
+    fileParser.setWindowLegth(10);
+
+    // A different strand selection
+    fileParser.setProcessReverse(false);
+    redirectInput(inputFile);
+    CHECK(fileParser.parse(output) == FORMAT_FAIL);
+    fileParser.setProcessReverse(true);
+
+    // A different input
+    ofstream other(otherInput.c_str());
+    other << "unrelated input\n";
+    other.close();
+    redirectInput(otherInput);
+    CHECK(fileParser.parse(output) == FORMAT_FAIL);
+
+    // Refused runs leave the output and the checkpoint alone
+    CHECK(returnDiff("synthetic.gff", output) == 0);
+    Checkpoint kept;
+    REQUIRE(kept.load(checkpointFile));
+    CHECK(kept.inputOffset == saved.inputOffset);
+    CHECK(kept.outputLength == saved.outputLength);
+
+    // The same options and input are resumed
+    redirectInput(inputFile);
+    CHECK(fileParser.parse(output) == READ_SUCCESS);
+    CHECK(returnDiff("synthetic.gff", output) == 0);
+
+    remove(output.c_str());
+    remove(otherInput.c_str());
+    remove(checkpointFile.c_str());
+}
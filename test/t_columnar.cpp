@@ -0,0 +1,95 @@
+#include "common.h"
+#include "catch.hpp"
+#include "helpers.h"
+#include "../ColumnarFormat.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+
+using namespace std;
+
+static void writeColumnar(const vector<string> & lines, string filename) {
+    ofstream ofs(filename.c_str(), std::ofstream::binary);
+    ColumnarWriter writer;
+    writer.start(ofs);
+    LineOutputStream stream(writer);
+    for (unsigned int i = 0; i < lines.size(); i++) {
+        stream << lines[i] << "\n";
+    }
+    stream.flush();
+    CHECK(writer.finish());
+}
+
+TEST_CASE("Columnar hints are dumped as the original GFF") {
+    vector<string> lines = readLines(ROOT_PATH + "/test_files/synthetic.gff");
+    REQUIRE(lines.size() > 100);
+    // Extra attributes and lines of other layouts are kept as they were
+    lines.push_back(lines[0] + " source=a.ali;");
+    lines.push_back("ctg1\tSpaln_scorer\tCDS\t5\t9\t.\t+\t0\tmult=2; prots=x,y;");
+    lines.push_back("not a hint");
+    string expected;
+    for (unsigned int i = 0; i < lines.size(); i++) {
+        expected += lines[i] + "\n";
+    }
+    string filename = ROOT_PATH + "/test_files/test_columnar";
+    writeColumnar(lines, filename);
+
+    ColumnarReader reader;
+    REQUIRE(reader.open(filename));
+    REQUIRE(reader.blockCount() == 1);
+    REQUIRE(reader.rows(0) == lines.size());
+    stringstream dumped;
+    reader.dump(dumped);
+    CHECK(dumped.str() == expected);
+
+    // ctg10 Intron 539962 540000 + prot1 intron_id=1 initial=1 gt_ac
+    const int64_t * starts = reader.values<int64_t>(0, Columnar::START);
+    const double * alScores = reader.values<double>(0, Columnar::AL_SCORE);
+    const double * eScores = reader.values<double>(0, Columnar::E_SCORE);
+    const uint32_t * spliceSites = reader.values<uint32_t>(0, Columnar::SPLICE_SITES);
+    CHECK(reader.name(reader.values<uint32_t>(0, Columnar::CONTIG)[0]) == "ctg10");
+    CHECK(reader.name(reader.values<uint32_t>(0, Columnar::PROTEIN)[0]) == "prot1");
+    CHECK(reader.values<uint8_t>(0, Columnar::TYPE)[0] == COLUMNAR_TYPE_INTRON);
+    CHECK(reader.values<int8_t>(0, Columnar::INITIAL)[0] == 1);
+    CHECK(starts[0] == 539962);
+    CHECK(reader.values<int64_t>(0, Columnar::END)[0] == 540000);
+    CHECK(spliceSites[0] == ('g' | 't' << 8 | 'a' << 16 | 'c' << 24));
+    CHECK(alScores[0] == Approx(0.523698));
+    CHECK(std::isnan(eScores[0]));
+
+    // Raw lines still have their coordinates
+    size_t aggregated = lines.size() - 2;
+    CHECK(reader.values<uint32_t>(0, Columnar::RAW)[aggregated] != 0);
+    CHECK(reader.values<uint8_t>(0, Columnar::TYPE)[aggregated] == COLUMNAR_TYPE_CDS);
+    CHECK(starts[aggregated] == 5);
+    remove(filename.c_str());
+}
+
+TEST_CASE("Columnar hints are split into blocks and invalid files are rejected") {
+    vector<string> lines = readLines(ROOT_PATH + "/test_files/synthetic.gff");
+    REQUIRE(lines.size() > 100);
+    vector<string> many;
+    while (many.size() <= COLUMNAR_BLOCK_ROWS) {
+        many.insert(many.end(), lines.begin(), lines.end());
+    }
+    string filename = ROOT_PATH + "/test_files/test_columnar";
+    writeColumnar(many, filename);
+
+    ColumnarReader reader;
+    REQUIRE(reader.open(filename));
+    REQUIRE(reader.blockCount() == 2);
+    CHECK(reader.rows(0) == COLUMNAR_BLOCK_ROWS);
+    CHECK(reader.rows(1) == many.size() - COLUMNAR_BLOCK_ROWS);
+    stringstream row;
+    reader.print(1, 0, row);
+    CHECK(row.str() == many[COLUMNAR_BLOCK_ROWS] + "\n");
+
+    // Truncated file
+    string data = readFile(filename);
+    ofstream(filename.c_str(), std::ofstream::binary) << data.substr(0, data.size() - 1);
+    CHECK_FALSE(reader.open(filename));
+    CHECK_FALSE(reader.open(ROOT_PATH + "/test_files/synthetic.gff"));
+    remove(filename.c_str());
+}
@@ -0,0 +1,86 @@
+#include "common.h"
+#include "catch.hpp"
+#include "../CompressedOutput.h"
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <zlib.h>
+
+using namespace std;
+
+/**
+ * Decompress a BGZF file block by block
+ * @return False if a block is not valid BGZF
+ */
+static bool readBgzf(string filename, string & text, int & blocks) {
+    ifstream ifs(filename.c_str(), std::ifstream::binary);
+    string data((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+    text.clear();
+    blocks = 0;
+    size_t position = 0;
+    while (position < data.size()) {
+        const unsigned char * block = (const unsigned char *) data.data() + position;
+        if (data.size() - position < 28 || block[0] != 0x1f || block[1] != 0x8b ||
+                block[12] != 'B' || block[13] != 'C') {
+            return false;
+        }
+        size_t size = (block[16] | block[17] << 8) + 1;
+        string inflated(BGZF_BLOCK_INPUT, '\0');
+        z_stream stream;
+        memset(&stream, 0, sizeof (stream));
+        inflateInit2(&stream, -15);
+        stream.next_in = (Bytef *) block + 18;
+        stream.avail_in = size - 26;
+        stream.next_out = (Bytef *) &inflated[0];
+        stream.avail_out = inflated.size();
+        int result = inflate(&stream, Z_FINISH);
+        inflated.resize(stream.total_out);
+        inflateEnd(&stream);
+        uint32_t crc = block[size - 8] | block[size - 7] << 8 |
+                block[size - 6] << 16 | (uint32_t) block[size - 5] << 24;
+        if (result != Z_STREAM_END ||
+                crc != crc32(0L, (const Bytef *) inflated.data(), inflated.size())) {
+            return false;
+        }
+        text += inflated;
+        position += size;
+        blocks++;
+    }
+    return true;
+}
+
+TEST_CASE("Output is compressed into BGZF blocks in order") {
+    string filename = ROOT_PATH + "/test_files/test_compress.gz";
+    stringstream expected;
+    CompressedOutputStream output;
+    REQUIRE(output.open(filename, 3));
+    for (int i = 0; i < 100000; i++) {
+        stringstream line;
+        line << "ctg" << i % 7 << "\tSpaln_scorer\tCDS\t" << i << "\t" << i * 3 <<
+                "\t.\t+\t0\tprot=prot" << i << ";\n";
+        output << line.str();
+        expected << line.str();
+        if (i == 10) {
+            // A flushed block is shorter
+            output.flush();
+        }
+    }
+    CHECK(output.close());
+
+    string text;
+    int blocks;
+    REQUIRE(readBgzf(filename, text, blocks));
+    CHECK(text == expected.str());
+    // The data, the block cut by the flush and the empty end of file block
+    CHECK(blocks == (int) (expected.str().size() / BGZF_BLOCK_INPUT) + 3);
+    remove(filename.c_str());
+}
+
+TEST_CASE("Compressed outputs are recognized by their names") {
+    CHECK(compressedName("hints.gff.gz"));
+    CHECK(compressedName("hints.bgz"));
+    CHECK_FALSE(compressedName("hints.gff"));
+    CHECK_FALSE(compressedName(".gz"));
+    CHECK_FALSE(compressedName("hints.gz.gff"));
+}
@@ -0,0 +1,100 @@
+#include "common.h"
+#include "catch.hpp"
+#include "../HintFilter.h"
+#include "../HintLine.h"
+#include "helpers.h"
+#include "../PushParser.h"
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+/// Collects the hints of all completed alignments
+class FilteredListener : public HintListener {
+public:
+    void hints(const string & hints) {
+        result += hints;
+    }
+
+    string result;
+};
+
+static HintRecord intronRecord(const char * spliceSites, double score) {
+    HintRecord record;
+    record.setText(HintRecord::TYPE, "Intron", 6);
+    record.setText(HintRecord::STRAND, "+", 1);
+    record.setText(HintRecord::SPLICE_SITES, spliceSites, strlen(spliceSites));
+    record.setNumber(HintRecord::START, 100);
+    record.setNumber(HintRecord::AL_SCORE, score);
+    return record;
+}
+
+TEST_CASE("Filter expressions are compiled and evaluated") {
+    HintFilter filter;
+    REQUIRE(filter.compile("type==Intron && splice_sites in {GT_AG, \"gc_ag\"} && al_score>0.2"));
+    CHECK(filter.accepts(intronRecord("gt_ag", 0.5)));
+    CHECK(filter.accepts(intronRecord("GC_AG", 0.25)));
+    CHECK_FALSE(filter.accepts(intronRecord("at_ac", 0.5)));
+    CHECK_FALSE(filter.accepts(intronRecord("gt_ag", 0.2)));
+
+    REQUIRE(filter.compile("!(strand == -) && (start < 50 || al_score >= 0.5)"));
+    CHECK(filter.accepts(intronRecord("gt_ag", 0.5)));
+    CHECK_FALSE(filter.accepts(intronRecord("gt_ag", 0.4)));
+
+    // Fields which the hint does not have fail every comparison
+    REQUIRE(filter.compile("eScore > 0 || eScore <= 0"));
+    CHECK_FALSE(filter.accepts(intronRecord("gt_ag", 0.5)));
+    REQUIRE(filter.compile("prot != p1"));
+    CHECK_FALSE(filter.accepts(intronRecord("gt_ag", 0.5)));
+
+    CHECK_FALSE(filter.compile("al_score >"));
+    CHECK_FALSE(filter.compile("score > 1"));
+    CHECK_FALSE(filter.compile("type > CDS"));
+    CHECK_FALSE(filter.compile("al_score > high"));
+    CHECK_FALSE(filter.compile("(type == CDS"));
+    CHECK_FALSE(filter.compile("type == CDS extra"));
+    CHECK_FALSE(filter.isSet());
+}
+
+TEST_CASE("Hints rejected by the filter are not printed") {
+    string input = readFile(ROOT_PATH + "/test_files/synthetic.ali");
+
+    HintFilter filter;
+    REQUIRE(filter.compile("type==Intron && splice_sites in {GT_AG,GC_AG} && al_score>0.2"));
+    StandardParser parser;
+
+    FilteredListener all;
+    PushParser allParser(parser, &all);
+    REQUIRE(allParser.start() == READ_SUCCESS);
+    allParser.feed(input.data(), input.size());
+    allParser.finish();
+
+    parser.setFilter(&filter);
+    FilteredListener filtered;
+    PushParser filteredParser(parser, &filtered);
+    REQUIRE(filteredParser.start() == READ_SUCCESS);
+    filteredParser.feed(input.data(), input.size());
+    filteredParser.finish();
+
+    // The same selection done on the printed hints
+    stringstream lines(all.result);
+    string line, expected;
+    while (getline(lines, line)) {
+        HintLine fields;
+        REQUIRE(fields.parse(line.data(), line.size()));
+        const char * value;
+        size_t length;
+        double score;
+        if (string(fields.field(2), fields.fieldLength(2)) == "Intron" &&
+                fields.attribute("splice_sites", value, length) &&
+                (string(value, length) == "gt_ag" || string(value, length) == "gc_ag") &&
+                fields.score(score) && score > 0.2) {
+            expected += line + "\n";
+        }
+    }
+    CHECK(!expected.empty());
+    CHECK(expected.size() < all.result.size());
+    CHECK(filtered.result == expected);
+}
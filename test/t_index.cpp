@@ -0,0 +1,102 @@
+#include "common.h"
+#include "catch.hpp"
+#include "../HintIndex.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace std;
+
+struct Hint {
+    string contig;
+    int64_t start, end;
+    size_t line;
+};
+
+static bool hintBefore(const Hint & a, const Hint & b) {
+    return a.start < b.start || (a.start == b.start && a.line < b.line);
+}
+
+TEST_CASE("Region queries return the overlapping hints") {
+    string gffFile = ROOT_PATH + "/test_files/test_index.gff";
+    string indexFile = gffFile + HINT_INDEX_SUFFIX;
+    // Long hints hide shorter ones in the maximum ends, hints of contigs
+    // are interleaved and there is a comment
+    vector<Hint> hints;
+    vector<string> lines;
+    srand(7);
+    ofstream ofs(gffFile.c_str());
+    ofs << "# comment\n";
+    for (size_t i = 0; i < 2000; i++) {
+        Hint hint;
+        hint.contig = i % 3 == 0 ? "ctg1" : "ctg:2";
+        hint.start = rand() % 100000 + 1;
+        hint.end = hint.start + (i % 50 == 0 ? 20000 : rand() % 300);
+        hint.line = i;
+        hints.push_back(hint);
+        stringstream line;
+        line << hint.contig << "\tSpaln_scorer\tCDS\t" << hint.start << "\t" <<
+                hint.end << "\t.\t+\t0\tprot=prot" << i << ";";
+        lines.push_back(line.str());
+        ofs << lines.back() << "\n";
+    }
+    ofs.close();
+
+    REQUIRE(HintIndex::build(gffFile, indexFile));
+    HintIndex index;
+    REQUIRE(index.open(indexFile, gffFile));
+    ifstream ifs(gffFile.c_str());
+    string data((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+
+    sort(hints.begin(), hints.end(), hintBefore);
+    string regions[] = {"ctg1:1-100000", "ctg:2:500-700", "ctg:2:30000-30000",
+        "ctg1:99000-200000", "ctg1:100500-200000", "ctg:2", "ctg3:1-10"};
+    for (int i = 0; i < 7; i++) {
+        string contig;
+        int64_t start, end;
+        REQUIRE(HintIndex::parseRegion(regions[i], contig, start, end));
+        vector<pair<uint64_t, uint32_t> > found;
+        index.query(contig, start, end, found);
+        vector<string> result, expected;
+        for (unsigned int j = 0; j < found.size(); j++) {
+            result.push_back(data.substr(found[j].first, found[j].second));
+        }
+        for (unsigned int j = 0; j < hints.size(); j++) {
+            if (hints[j].contig == contig && hints[j].start <= end &&
+                    hints[j].end >= start) {
+                expected.push_back(lines[hints[j].line]);
+            }
+        }
+        CHECK(result == expected);
+    }
+    remove(gffFile.c_str());
+    remove(indexFile.c_str());
+}
+
+TEST_CASE("Invalid regions and outdated indices are rejected") {
+    string contig;
+    int64_t start, end;
+    CHECK(HintIndex::parseRegion("ctg1:10-20", contig, start, end));
+    CHECK(contig == "ctg1");
+    CHECK(start == 10);
+    CHECK(end == 20);
+    CHECK_FALSE(HintIndex::parseRegion("ctg1:20-10", contig, start, end));
+    CHECK_FALSE(HintIndex::parseRegion("ctg1:a-10", contig, start, end));
+    CHECK_FALSE(HintIndex::parseRegion(":1-10", contig, start, end));
+
+    string gffFile = ROOT_PATH + "/test_files/test_index.gff";
+    string indexFile = gffFile + HINT_INDEX_SUFFIX;
+    ofstream(gffFile.c_str()) << "ctg1\tSpaln_scorer\tCDS\t5\t9\t.\t+\t0\tprot=x;\n";
+    REQUIRE(HintIndex::build(gffFile, indexFile));
+    ofstream(gffFile.c_str(), std::ofstream::app) <<
+            "ctg1\tSpaln_scorer\tCDS\t50\t90\t.\t+\t0\tprot=y;\n";
+    HintIndex index;
+    CHECK_FALSE(index.open(indexFile, gffFile));
+    CHECK_FALSE(index.open(gffFile, gffFile));
+    remove(gffFile.c_str());
+    remove(indexFile.c_str());
+}
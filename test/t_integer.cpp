@@ -0,0 +1,49 @@
+#include "common.h"
+#include "catch.hpp"
+#include "helpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <cmath>
+#include <string>
+#include <vector>
+
+/**
+ * Split the al_score value out of a hint line
+ */
+static double takeAlignmentScore(string & line) {
+    size_t start = line.find("al_score=");
+    if (start == string::npos) {
+        return 0;
+    }
+    start += 9;
+    size_t end = line.find(";", start);
+    double score = atof(line.substr(start, end - start).c_str());
+    line.erase(start, end - start);
+    return score;
+}
+
+TEST_CASE("Integer scoring stays close to the floating point scores") {
+    string inputFile = ROOT_PATH + "/test_files/synthetic.ali";
+    string output = ROOT_PATH + "/test_files/test_integer_result";
+
+    StandardParser fileParser;
+    fileParser.setIntegerScoring(true);
+
+    // Integer scoring is refused for matrices with fractional scores
+    redirectInput(inputFile);
+    REQUIRE(fileParser.parse(output) == READ_SUCCESS);
+
+    vector<string> expected = readLines(ROOT_PATH + "/test_files/synthetic.gff");
+    vector<string> result = readLines(output);
+    REQUIRE(result.size() == expected.size());
+    for (unsigned int i = 0; i < expected.size(); i++) {
+        double expectedScore = takeAlignmentScore(expected[i]);
+        double resultScore = takeAlignmentScore(result[i]);
+        // Exon scores are exact, only kernel weights are quantized
+        CHECK(result[i] == expected[i]);
+        CHECK(fabs(resultScore - expectedScore) < 0.001);
+    }
+    CHECK(expected.size() > 0);
+
+    remove(output.c_str());
+}
@@ -61,3 +61,36 @@ TEST_CASE("Check max value for AA") {
     s.loadFromFile(inputFile1);
     CHECK (s.getMaxScore() == 11);
 }
+
+TEST_CASE("Built-in BLOSUM62 matches the csv file") {
+    string inputFile = ROOT_PATH + "/test_files/blosum62_1.csv";
+    string aminoAcids = "ARNDCQEGHILKMFPSTWYVBZX*-13";
+
+    ScoreMatrix csv;
+    REQUIRE(csv.loadFromFile(inputFile));
+    ScoreMatrix builtin;
+    REQUIRE(builtin.loadBuiltin("blosum62"));
+
+    for (unsigned int i = 0; i < aminoAcids.size(); i++) {
+        for (unsigned int j = 0; j < aminoAcids.size(); j++) {
+            CHECK(csv.getScore(aminoAcids[i], aminoAcids[j]) ==
+                    builtin.getScore(aminoAcids[i], aminoAcids[j]));
+        }
+    }
+    CHECK(csv.getMaxScore() == builtin.getMaxScore());
+    CHECK(csv.fingerprint() == builtin.fingerprint());
+}
+
+TEST_CASE("Load all built-in matrices") {
+    string names[] = {"blosum45", "blosum50", "blosum62", "blosum80",
+                      "blosum90", "pam30", "pam70", "PAM250"};
+    for (int i = 0; i < 8; i++) {
+        ScoreMatrix s;
+        INFO("Matrix: " << names[i]);
+        CHECK(s.loadBuiltin(names[i]));
+        CHECK(s.isInteger());
+        CHECK(s.getScore('W', 'W') == s.getMaxScore());
+    }
+    ScoreMatrix s;
+    CHECK_FALSE(s.loadBuiltin("blosum100"));
+}
@@ -0,0 +1,85 @@
+#include "common.h"
+#include "catch.hpp"
+#include "helpers.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+
+using namespace std;
+
+/**
+ * Split a file into two parts at the header line closest to the middle
+ */
+static void splitInput(string filename, string & first, string & second) {
+    string text = readFile(filename);
+    size_t middle = text.find("\n>", text.size() / 2);
+    REQUIRE(middle != string::npos);
+    first = text.substr(0, middle + 1);
+    second = text.substr(middle + 1);
+}
+
+TEST_CASE("Alignments from several inputs are scored with their sources") {
+    string inputFile = ROOT_PATH + "/test_files/synthetic.ali";
+    string fifo = ROOT_PATH + "/test_files/test_multiplex_fifo";
+    string secondInput = ROOT_PATH + "/test_files/test_multiplex_input";
+    string output = ROOT_PATH + "/test_files/test_multiplex_result";
+
+    string first, second;
+    splitInput(inputFile, first, second);
+    ofstream(secondInput.c_str()) << second;
+    remove(fifo.c_str());
+    REQUIRE(mkfifo(fifo.c_str(), 0600) == 0);
+
+    StandardParser fileParser;
+    fileParser.setThreads(2);
+    vector<string> inputs;
+    inputs.push_back(fifo);
+    inputs.push_back(secondInput);
+    fileParser.setInputs(inputs);
+    fileParser.setTagSources(true);
+
+    // The first part arrives through the FIFO in small pieces
+    thread writer([fifo, first]() {
+        ofstream ofs(fifo.c_str());
+        for (size_t i = 0; i < first.size(); i += 1000) {
+            ofs << first.substr(i, 1000) << flush;
+            usleep(100);
+        }
+    });
+    CHECK(fileParser.parse(output) == READ_SUCCESS);
+    writer.join();
+
+    // Hints of every source keep the order of its input
+    ifstream result(output.c_str());
+    string line, firstHints, secondHints;
+    bool tagged = true;
+    while (getline(result, line)) {
+        string fifoTag = " source=" + fifo + ";";
+        string fileTag = " source=" + secondInput + ";";
+        if (line.size() > fifoTag.size() &&
+                line.compare(line.size() - fifoTag.size(), fifoTag.size(), fifoTag) == 0) {
+            firstHints += line.substr(0, line.size() - fifoTag.size()) + "\n";
+        } else if (line.size() > fileTag.size() &&
+                line.compare(line.size() - fileTag.size(), fileTag.size(), fileTag) == 0) {
+            secondHints += line.substr(0, line.size() - fileTag.size()) + "\n";
+        } else {
+            tagged = false;
+        }
+    }
+    CHECK(tagged);
+    CHECK_FALSE(firstHints.empty());
+    CHECK_FALSE(secondHints.empty());
+    CHECK(firstHints + secondHints == readFile(ROOT_PATH + "/test_files/synthetic.gff"));
+
+    inputs.push_back(ROOT_PATH + "/test_files/missing_input");
+    fileParser.setInputs(inputs);
+    CHECK(fileParser.parse(output) == OPEN_FAIL);
+
+    remove(fifo.c_str());
+    remove(secondInput.c_str());
+    remove(output.c_str());
+}
@@ -0,0 +1,72 @@
+#include "common.h"
+#include "catch.hpp"
+#include "../PackedPairs.h"
+#include "../ScoreMatrix.h"
+
+using namespace std;
+
+TEST_CASE("Packed pairs return the stored symbols") {
+    string translated = "1M3 *J-X1a3";
+    string dna =        "ATGgt--.NnCG";
+    string protein =    "1M3 ---U1O3";
+    string types =      "eeeii-eeeiee";
+    types[5] = 'i';
+
+    PackedPairs pairs;
+    pairs.reset(100, true);
+    for (unsigned int i = 0; i < dna.size(); i++) {
+        pairs.push(translated[i], dna[i], protein[i], types[i]);
+    }
+
+    REQUIRE(pairs.size() == (int) dna.size());
+    for (unsigned int i = 0; i < dna.size(); i++) {
+        CHECK(pairs.translatedCodon(i) == translated[i]);
+        CHECK(pairs.nucleotide(i) == dna[i]);
+        CHECK(pairs.protein(i) == protein[i]);
+        CHECK(pairs.type(i) == types[i]);
+    }
+
+    pairs.setProtein(3, '3');
+    pairs.setTranslatedCodon(3, '#');
+    CHECK(pairs.protein(3) == '3');
+    CHECK(pairs.translatedCodon(3) == '#');
+}
+
+TEST_CASE("Packed pairs reconstruct positions from gap runs") {
+    string dna = "-AC--G-T";
+    int forward[] = {99, 100, 101, 101, 101, 102, 102, 103};
+    int reverse[] = {101, 100, 99, 99, 99, 98, 98, 97};
+
+    PackedPairs pairs;
+    pairs.reset(100, true);
+    for (unsigned int i = 0; i < dna.size(); i++) {
+        pairs.push('A', dna[i], 'A', 'e');
+    }
+    for (unsigned int i = 0; i < dna.size(); i++) {
+        CHECK(pairs.realPosition(i) == forward[i]);
+    }
+
+    pairs.reset(100, false);
+    for (unsigned int i = 0; i < dna.size(); i++) {
+        pairs.push('A', dna[i], 'A', 'e');
+    }
+    for (unsigned int i = 0; i < dna.size(); i++) {
+        CHECK(pairs.realPosition(i) == reverse[i]);
+    }
+}
+
+TEST_CASE("Packed pair scores match the matrix") {
+    ScoreMatrix matrix;
+    REQUIRE(matrix.loadFromFile(ROOT_PATH + "/test_files/blosum62_1.csv"));
+    string symbols = "ARNDCQEGHILKMFPSTWYVBZX*-13 U#";
+
+    PackedPairs pairs;
+    pairs.reset(1, true);
+    for (unsigned int i = 0; i < symbols.size(); i++) {
+        for (unsigned int j = 0; j < symbols.size(); j++) {
+            pairs.push(symbols[i], 'A', symbols[j], 'e');
+            CHECK(pairs.score(pairs.size() - 1, &matrix) ==
+                    matrix.getScore(symbols[i], symbols[j]));
+        }
+    }
+}
@@ -0,0 +1,126 @@
+#include "common.h"
+#include "catch.hpp"
+#include "helpers.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <fstream>
+
+/**
+ * Save the input lines, LINES[k] is preceded by EXTRA[k] if present
+ */
+static void writeLines(string filename, const vector<string> & lines,
+                       const vector<string> & extra) {
+    ofstream ofs(filename.c_str());
+    for (unsigned int i = 0; i < lines.size(); i++) {
+        if (i < extra.size()) {
+            ofs << extra[i];
+        }
+        ofs << lines[i] << "\n";
+    }
+}
+
+/**
+ * Score an input file with the standard test settings
+ */
+static string scoreFile(string inputFile, string output, int threads) {
+    StandardParser fileParser;
+    fileParser.setThreads(threads);
+    redirectInput(inputFile);
+    fileParser.parse(output);
+
+    string result = readFile(output);
+    remove(output.c_str());
+    return result;
+}
+
+TEST_CASE("Parallel scoring of a mapped input matches the sequential run") {
+    string inputFile = ROOT_PATH + "/test_files/synthetic.ali";
+    string output = ROOT_PATH + "/test_files/test_parallel_result";
+    StandardParser fileParser;
+
+    int threads[] = {1, 2, 3, 8, 64};
+    for (int i = 0; i < 5; i++) {
+        redirectInput(inputFile);
+        fileParser.setThreads(threads[i]);
+        fileParser.parse(output);
+        INFO("Threads: " << threads[i]);
+        CHECK(returnDiff("synthetic.gff", output) == 0);
+    }
+
+    remove(output.c_str());
+}
+
+TEST_CASE("Sharded output of a mapped input matches the sequential run") {
+    string inputFile = ROOT_PATH + "/test_files/synthetic.ali";
+    string output = ROOT_PATH + "/test_files/test_sharded_result";
+    StandardParser fileParser;
+    fileParser.setShardedOutput(true);
+
+    int threads[] = {2, 3, 8, 64};
+    for (int i = 0; i < 4; i++) {
+        redirectInput(inputFile);
+        fileParser.setThreads(threads[i]);
+        fileParser.parse(output);
+        INFO("Threads: " << threads[i]);
+        CHECK(returnDiff("synthetic.gff", output) == 0);
+    }
+
+    remove(output.c_str());
+}
+
+TEST_CASE("Invalid headers between records do not swallow the next record") {
+    string inputFile = ROOT_PATH + "/test_files/test_stray_headers";
+    string output = ROOT_PATH + "/test_files/test_stray_headers_result";
+    // Headers without a protein are consumed alone, as by the sequential
+    // parser
+    vector<string> lines = readLines(ROOT_PATH + "/test_files/synthetic.ali");
+    vector<string> extra(lines.size());
+    for (unsigned int i = 0; i < lines.size(); i++) {
+        if (i > 0 && (lines[i][0] == '>' || lines[i][0] == '<')) {
+            extra[i] = i % 2 == 0 ? ">junkline\n" : "<x y\n";
+        }
+    }
+    writeLines(inputFile, lines, extra);
+    string expected = readFile(ROOT_PATH + "/test_files/synthetic.gff");
+
+    int threads[] = {1, 4};
+    for (int i = 0; i < 2; i++) {
+        INFO("Threads: " << threads[i]);
+        CHECK(scoreFile(inputFile, output, threads[i]) == expected);
+    }
+    remove(inputFile.c_str());
+}
+
+TEST_CASE("Chunks do not start at headers swallowed by a truncated record") {
+    string inputFile = ROOT_PATH + "/test_files/test_swallowed_headers";
+    string output = ROOT_PATH + "/test_files/test_swallowed_headers_result";
+    // Every third record is preceded by a record truncated after its
+    // ALIGNMENT keyword, which consumes the following header. The long
+    // lines make chunk boundaries fall into the truncated records.
+    vector<string> lines = readLines(ROOT_PATH + "/test_files/synthetic.ali");
+    vector<string> copies;
+    for (int copy = 0; copy < 20; copy++) {
+        copies.insert(copies.end(), lines.begin(), lines.end());
+    }
+    vector<string> extra(copies.size());
+    int headers = 0;
+    for (unsigned int i = 0; i < copies.size(); i++) {
+        if (copies[i][0] == '>' || copies[i][0] == '<') {
+            if (headers++ % 3 == 0) {
+                extra[i] = copies[i] + "\nScore " + string(20000, '1') +
+                        "\nALIGNMENT\n";
+            }
+        }
+    }
+    writeLines(inputFile, copies, extra);
+
+    string expected = scoreFile(inputFile, output, 1);
+    CHECK(!expected.empty());
+    int threads[] = {2, 4, 8};
+    for (int i = 0; i < 3; i++) {
+        INFO("Threads: " << threads[i]);
+        CHECK(scoreFile(inputFile, output, threads[i]) == expected);
+    }
+    remove(inputFile.c_str());
+}
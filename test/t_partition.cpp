@@ -0,0 +1,69 @@
+#include "common.h"
+#include "catch.hpp"
+#include "helpers.h"
+#include "../HintPartitioner.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+
+using namespace std;
+
+TEST_CASE("Hints are partitioned by contig into the template paths") {
+    string directory = ROOT_PATH + "/test_files/test_partition";
+    HintPartitioner partitioner;
+    partitioner.setup(PARTITION_BY_CONTIG, directory + "/" PARTITION_PLACEHOLDER ".gff", 2);
+    LineOutputStream stream(partitioner);
+    map<string, string> expected;
+    for (int i = 0; i < 500; i++) {
+        stringstream contig, line;
+        contig << "ctg" << (i * 7) % 5;
+        line << contig.str() << "\tSpaln_scorer\tCDS\t" << i << "\t" << i + 10 <<
+                "\t.\t+\t0\tprot=prot" << i << ";\n";
+        stream << line.str();
+        expected[contig.str()] += line.str();
+    }
+    stream << "a/b\tSpaln_scorer\tCDS\t1\t2\t.\t+\t0\tprot=x;\n";
+    expected["a_b"] = "a/b\tSpaln_scorer\tCDS\t1\t2\t.\t+\t0\tprot=x;\n";
+    stream.flush();
+    CHECK(partitioner.close());
+    CHECK(partitioner.partitions() == 6);
+
+    for (map<string, string>::iterator it = expected.begin(); it != expected.end(); ++it) {
+        string filename = directory + "/" + it->first + ".gff";
+        CHECK(readFile(filename) == it->second);
+        remove(filename.c_str());
+    }
+    remove(directory.c_str());
+}
+
+TEST_CASE("Least recently used partition files are closed and appended to") {
+    string directory = ROOT_PATH + "/test_files/test_partition";
+    HintPartitioner partitioner;
+    partitioner.setup(PARTITION_BY_GENE, directory + "/" PARTITION_PLACEHOLDER, 2);
+    // Buffers fill up, so every partition is written several times
+    string padding(PARTITION_BUFFER / 4, 'x');
+    map<string, string> expected;
+    string genes[] = {"g1", "g2", "g1", "g3", "g1", "g2"};
+    LineOutputStream stream(partitioner);
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 6; i++) {
+            string line = "ctg1\tSpaln_scorer\tCDS\t1\t2\t.\t+\t0\tprot=" + genes[i] +
+                    "; note=" + padding + ";\n";
+            stream << line;
+            expected[genes[i]] += line;
+        }
+    }
+    stream.flush();
+    CHECK(partitioner.close());
+    CHECK(partitioner.partitions() == 3);
+    // g1 stays open, g2 and g3 evict each other
+    CHECK(partitioner.opened() > 3);
+
+    for (map<string, string>::iterator it = expected.begin(); it != expected.end(); ++it) {
+        string filename = directory + "/" + it->first;
+        CHECK(readFile(filename) == it->second);
+        remove(filename.c_str());
+    }
+    remove(directory.c_str());
+}
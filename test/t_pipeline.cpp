@@ -0,0 +1,120 @@
+#include "common.h"
+#include "catch.hpp"
+#include "helpers.h"
+#include "../RingBuffer.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+TEST_CASE("Single producer single consumer ring keeps the order") {
+    SpscRing<int> ring(5);
+    CHECK(ring.capacity() == 8);
+    int value;
+    CHECK_FALSE(ring.tryPop(value));
+    for (int i = 0; i < 8; i++) {
+        CHECK(ring.tryPush(i));
+    }
+    CHECK_FALSE(ring.tryPush(8));
+
+    const int count = 100000;
+    thread producer([&ring]() {
+        for (int i = 8; i < count; i++) {
+            ring.push(i);
+        }
+    });
+    bool ordered = true;
+    for (int i = 0; i < count; i++) {
+        ring.pop(value);
+        ordered = ordered && value == i;
+    }
+    producer.join();
+    CHECK(ordered);
+    CHECK_FALSE(ring.tryPop(value));
+}
+
+TEST_CASE("Multi producer multi consumer ring passes every value once") {
+    MpmcRing<int> ring(16);
+    const int producers = 3, consumers = 3, count = 30000;
+    vector<vector<int> > received(consumers);
+    vector<thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.push_back(thread([&ring, p]() {
+            for (int i = p; i < count; i += producers) {
+                ring.push(i);
+            }
+        }));
+    }
+    for (int c = 0; c < consumers; c++) {
+        threads.push_back(thread([&ring, &received, c]() {
+            for (int i = 0; i < count / consumers; i++) {
+                int value;
+                ring.pop(value);
+                received[c].push_back(value);
+            }
+        }));
+    }
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+
+    vector<int> all;
+    for (int c = 0; c < consumers; c++) {
+        all.insert(all.end(), received[c].begin(), received[c].end());
+    }
+    sort(all.begin(), all.end());
+    bool complete = (int) all.size() == count;
+    for (int i = 0; complete && i < count; i++) {
+        complete = all[i] == i;
+    }
+    CHECK(complete);
+}
+
+/**
+ * Replace stdin with a pipe fed with the content of a file
+ */
+static thread pipeToStdin(string filename) {
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    dup2(fds[0], STDIN_FILENO);
+    close(fds[0]);
+    clearerr(stdin);
+    std::cin.clear();
+    int writeEnd = fds[1];
+    return thread([filename, writeEnd]() {
+        ifstream ifs(filename.c_str(), ios::binary);
+        char buffer[1000];
+        while (ifs.read(buffer, sizeof (buffer)) || ifs.gcount() > 0) {
+            if (write(writeEnd, buffer, ifs.gcount()) < 0) {
+                break;
+            }
+        }
+        close(writeEnd);
+    });
+}
+
+TEST_CASE("Pipelined scoring of a streamed input matches the sequential run") {
+    string inputFile = ROOT_PATH + "/test_files/synthetic.ali";
+    string output = ROOT_PATH + "/test_files/test_pipeline_result";
+    StandardParser fileParser;
+
+    int threads[] = {1, 2, 3, 8};
+    for (int i = 0; i < 4; i++) {
+        thread writer = pipeToStdin(inputFile);
+        fileParser.setThreads(threads[i]);
+        fileParser.parse(output);
+        writer.join();
+        INFO("Threads: " << threads[i]);
+        CHECK(returnDiff("synthetic.gff", output) == 0);
+    }
+
+    freopen(inputFile.c_str(), "r", stdin);
+    remove(output.c_str());
+}
@@ -0,0 +1,77 @@
+#include "common.h"
+#include "catch.hpp"
+#include "helpers.h"
+#include "../PushParser.h"
+#include <string>
+#include <algorithm>
+
+using namespace std;
+
+/// Collects the hints of all completed alignments
+class CollectingListener : public HintListener {
+public:
+    CollectingListener() {
+        alignments = 0;
+    }
+
+    void hints(const string & hints) {
+        result += hints;
+        alignments++;
+    }
+
+    string result;
+    int alignments;
+};
+
+TEST_CASE("Push parser scores chunks split at arbitrary positions") {
+    string input = readFile(ROOT_PATH + "/test_files/synthetic.ali");
+    string expected = readFile(ROOT_PATH + "/test_files/synthetic.gff");
+    StandardParser parser;
+
+    CollectingListener whole;
+    PushParser wholeParser(parser, &whole);
+    REQUIRE(wholeParser.start() == READ_SUCCESS);
+    int completed = wholeParser.feed(input.data(), input.size());
+    completed += wholeParser.finish();
+    CHECK(whole.result == expected);
+    CHECK(completed == whole.alignments);
+    CHECK(whole.alignments > 100);
+
+    size_t chunkSizes[] = {1, 7, 1000, 65536};
+    for (int i = 0; i < 4; i++) {
+        CollectingListener listener;
+        PushParser pushParser(parser, &listener);
+        REQUIRE(pushParser.start() == READ_SUCCESS);
+        completed = 0;
+        for (size_t start = 0; start < input.size(); start += chunkSizes[i]) {
+            size_t length = min(chunkSizes[i], input.size() - start);
+            completed += pushParser.feed(input.data() + start, length);
+        }
+        completed += pushParser.finish();
+        INFO("Chunk size: " << chunkSizes[i]);
+        CHECK(listener.result == expected);
+        CHECK(completed == whole.alignments);
+    }
+}
+
+TEST_CASE("Push parser passes a truncated record at the end of the input") {
+    string input = readFile(ROOT_PATH + "/test_files/synthetic.ali");
+    size_t second = input.find("\n>", 1);
+    REQUIRE(second != string::npos);
+    StandardParser parser;
+    parser.setProcessReverse(false);
+    CollectingListener listener;
+    PushParser pushParser(parser, &listener);
+    REQUIRE(pushParser.start() == READ_SUCCESS);
+
+    // The first record and the header of the second one
+    size_t end = input.find('\n', second + 1);
+    CHECK(pushParser.feed(input.data(), end) == 1);
+    CHECK(listener.alignments == 1);
+    CHECK(pushParser.finish() == 1);
+    CHECK(listener.alignments == 2);
+
+    // The parser can be reused after finish()
+    CHECK(pushParser.feed(input.data(), second + 1) == 1);
+    CHECK(pushParser.finish() == 0);
+}
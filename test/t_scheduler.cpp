@@ -0,0 +1,110 @@
+#include "common.h"
+#include "catch.hpp"
+#include "../WorkScheduler.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+
+using namespace std;
+
+TEST_CASE("Scheduler starts the largest tasks first") {
+    WorkScheduler scheduler(1, 100);
+    size_t estimates[] = {10, 5000, 20, 5000, 1};
+    for (int i = 0; i < 5; i++) {
+        scheduler.add(estimates[i]);
+    }
+
+    int expected[] = {1, 3, 2, 0, 4};
+    int task;
+    for (int i = 0; i < 5; i++) {
+        REQUIRE(scheduler.next(0, task));
+        CHECK(task == expected[i]);
+    }
+    CHECK_FALSE(scheduler.next(0, task));
+}
+
+TEST_CASE("Idle workers steal tasks queued for other workers") {
+    WorkScheduler scheduler(3, 100);
+    for (int i = 0; i < 30; i++) {
+        scheduler.add(i % 7 + 1);
+    }
+
+    // A single worker takes all tasks, two thirds of them are stolen
+    vector<bool> taken(30, false);
+    int task;
+    while (scheduler.next(2, task)) {
+        CHECK_FALSE(taken[task]);
+        taken[task] = true;
+    }
+    CHECK(count(taken.begin(), taken.end(), true) == 30);
+    CHECK(scheduler.steals() > 0);
+}
+
+TEST_CASE("Scheduler only hands out tasks inside the window") {
+    WorkScheduler scheduler(2, 3);
+    for (int i = 0; i < 6; i++) {
+        // Later tasks are larger, they would be started first without
+        // the window
+        scheduler.add(i + 1);
+    }
+
+    vector<int> tasks;
+    int task;
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(scheduler.next(i % 2, task));
+        tasks.push_back(task);
+    }
+    sort(tasks.begin(), tasks.end());
+    CHECK(tasks == vector<int>({0, 1, 2}));
+
+    scheduler.consumed(2);
+    vector<int> next;
+    for (int i = 0; i < 2; i++) {
+        REQUIRE(scheduler.next(i % 2, task));
+        next.push_back(task);
+    }
+    sort(next.begin(), next.end());
+    CHECK(next == vector<int>({3, 4}));
+
+    scheduler.consumed(6);
+    REQUIRE(scheduler.next(0, task));
+    CHECK(task == 5);
+    CHECK_FALSE(scheduler.next(1, task));
+}
+
+TEST_CASE("Concurrent workers take every task exactly once") {
+    const int tasks = 2000;
+    WorkScheduler scheduler(4, 64);
+    for (int i = 0; i < tasks; i++) {
+        scheduler.add((i * 7919) % 1000);
+    }
+
+    vector<int> counts(tasks, 0);
+    mutex lock;
+    vector<thread> workers;
+    for (int w = 0; w < 4; w++) {
+        workers.push_back(thread([&scheduler, &counts, &lock, w]() {
+            int task;
+            while (scheduler.next(w, task)) {
+                unique_lock<mutex> guard(lock);
+                counts[task]++;
+            }
+        }));
+    }
+
+    // Consume results in order as they become available
+    for (int consumed = 0; consumed < tasks; ) {
+        unique_lock<mutex> guard(lock);
+        while (consumed < tasks && counts[consumed] > 0) {
+            consumed++;
+        }
+        guard.unlock();
+        scheduler.consumed(consumed);
+        this_thread::yield();
+    }
+    for (int w = 0; w < 4; w++) {
+        workers[w].join();
+    }
+    CHECK(count(counts.begin(), counts.end(), 1) == tasks);
+}
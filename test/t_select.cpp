@@ -0,0 +1,33 @@
+#include "common.h"
+#include "catch.hpp"
+#include "../HintSelector.h"
+#include <string>
+#include <sstream>
+
+using namespace std;
+
+TEST_CASE("Top-k selection keeps the best scoring hints of every key") {
+    HintSelector selector;
+    selector.setup(2);
+    LineOutputStream stream(selector);
+    stream << "ctg1\tSpaln_scorer\tIntron\t200\t300\t.\t+\t.\tprot=p1; al_score=0.5;\n"
+            "ctg1\tSpaln_scorer\tCDS\t100\t199\t.\t+\t0\tprot=p1; eScore=30;\n"
+            "ctg1\tSpaln_scorer\tIntron\t200\t300\t.\t+\t.\tprot=p2; al_score=0.25;\n"
+            "ctg1\tSpaln_scorer\tIntron\t200\t300\t.\t-\t.\tprot=p3; al_score=0.1;\n"
+            "ctg1\tSpaln_scorer\tIntron\t200\t300\t.\t+\t.\tprot=p4; al_score=0.75;\n"
+            "ctg1\tSpaln_scorer\tCDS\t100\t199\t.\t+\t0\tprot=p4; eScore=20;\n"
+            "# comment\n"
+            "ctg1\tSpaln_scorer\tIntron\t200\t300\t.\t+\t.\tprot=p5; al_score=0.5;\n"
+            "ctg1\tSpaln_scorer\tCDS\t100\t199\t.\t+\t0\tprot=p5; eScore=40;\n";
+    stream.flush();
+    stringstream output;
+    selector.write(output);
+    // Ties are broken by the input order, p5 loses to p1
+    CHECK(output.str() ==
+          "ctg1\tSpaln_scorer\tIntron\t200\t300\t.\t+\t.\tprot=p1; al_score=0.5;\n"
+          "ctg1\tSpaln_scorer\tCDS\t100\t199\t.\t+\t0\tprot=p1; eScore=30;\n"
+          "ctg1\tSpaln_scorer\tIntron\t200\t300\t.\t-\t.\tprot=p3; al_score=0.1;\n"
+          "ctg1\tSpaln_scorer\tIntron\t200\t300\t.\t+\t.\tprot=p4; al_score=0.75;\n"
+          "# comment\n"
+          "ctg1\tSpaln_scorer\tCDS\t100\t199\t.\t+\t0\tprot=p5; eScore=40;\n");
+}
@@ -0,0 +1,138 @@
+#include "common.h"
+#include "catch.hpp"
+#include "helpers.h"
+#include "../CpuFeatures.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+TEST_CASE("All kernel variants agree with the generic kernels") {
+    srand(7);
+    const SimdKernels * generic = &GENERIC_KERNELS;
+    vector<char> dna(1000);
+    vector<uint16_t> pairs(1000);
+    vector<double> weights(1000);
+    vector<int32_t> fixedWeights(1000);
+    for (int i = 0; i < 1000; i++) {
+        dna[i] = rand() % 256 - 128;
+        if (i % 3 == 0) {
+            dna[i] = "acgtACGT-- n"[rand() % 12];
+        }
+        pairs[i] = rand() % (1 << 14);
+        // Long exon runs
+        if (i % 50 != 0) {
+            pairs[i] &= ~PACKED_INTRON_BIT;
+        }
+        weights[i] = (rand() % 1000) / 999.0;
+        fixedWeights[i] = rand() % KERNEL_FIXED_ONE;
+    }
+
+    ScoreMatrix matrix;
+    REQUIRE(matrix.loadFromFile(ROOT_PATH + "/test_files/blosum62_1.csv"));
+
+    for (int level = SIMD_AVX2; level < SIMD_LEVELS; level++) {
+        if (!CpuFeatures::supports(level)) {
+            WARN("Kernel level " << level << " is not supported by the CPU");
+            continue;
+        }
+        REQUIRE(CpuFeatures::select(level));
+        const SimdKernels * simd = CpuFeatures::kernels();
+        INFO("Kernels: " << simd->name);
+
+        vector<uint8_t> expectedClasses(1000), classes(1000);
+        for (int length = 0; length < 200; length += 13) {
+            generic->classifyNucleotides(dna.data(), length, expectedClasses.data());
+            simd->classifyNucleotides(dna.data(), length, classes.data());
+            CHECK(equal(classes.begin(), classes.begin() + length,
+                        expectedClasses.begin()));
+        }
+
+        int strides[] = {1, 3, -3};
+        for (int s = 0; s < 3; s++) {
+            int stride = strides[s];
+            const uint16_t * start = pairs.data() + (stride > 0 ? 0 : 999);
+            for (int count = 0; count <= 300; count += 7) {
+                CHECK(simd->exonRun(start, stride, count) ==
+                      generic->exonRun(start, stride, count));
+
+                vector<double> expected(count), scores(count);
+                generic->gatherScores(start, stride, count, matrix.getPairScores(),
+                                      expected.data());
+                simd->gatherScores(start, stride, count, matrix.getPairScores(),
+                                   scores.data());
+                CHECK(scores == expected);
+                CHECK(simd->dotProduct(scores.data(), weights.data(), count) ==
+                      generic->dotProduct(expected.data(), weights.data(), count));
+
+                vector<int32_t> expectedFixed(count), fixedScores(count);
+                generic->gatherFixedScores(start, stride, count,
+                        matrix.getFixedPairScores(), expectedFixed.data());
+                simd->gatherFixedScores(start, stride, count,
+                        matrix.getFixedPairScores(), fixedScores.data());
+                CHECK(fixedScores == expectedFixed);
+                CHECK(simd->fixedDotProduct(fixedScores.data(), fixedWeights.data(), count) ==
+                      generic->fixedDotProduct(expectedFixed.data(), fixedWeights.data(), count));
+            }
+        }
+
+        uint32_t masks[] = {0, 0xFFFFFFFF, 0x5555AAAA, 0x7FFFFFF0};
+        for (int m = 0; m < 4; m++) {
+            for (int count = 0; count <= 300; count += 11) {
+                int selected, expectedSelected;
+                CHECK(simd->maskedSum(pairs.data(), count, matrix.getPairScores(),
+                                      masks[m], &selected) ==
+                      generic->maskedSum(pairs.data(), count, matrix.getPairScores(),
+                                         masks[m], &expectedSelected));
+                CHECK(selected == expectedSelected);
+                CHECK(simd->fixedMaskedSum(pairs.data(), count, matrix.getFixedPairScores(),
+                                           masks[m], &selected) ==
+                      generic->fixedMaskedSum(pairs.data(), count, matrix.getFixedPairScores(),
+                                              masks[m], &expectedSelected));
+                CHECK(selected == expectedSelected);
+            }
+        }
+    }
+    CpuFeatures::select(CpuFeatures::detect());
+}
+
+TEST_CASE("Forced kernel variants produce identical output") {
+    string inputFile = ROOT_PATH + "/test_files/synthetic.ali";
+    string output = ROOT_PATH + "/test_files/test_simd_result";
+
+    StandardParser fileParser;
+
+    for (int level = 0; level < SIMD_LEVELS; level++) {
+        if (!CpuFeatures::select(level)) {
+            WARN("Kernel level " << level << " is not supported by the CPU");
+            continue;
+        }
+        INFO("Kernels: " << CpuFeatures::kernels()->name);
+        redirectInput(inputFile);
+        fileParser.parse(output);
+        CHECK(returnDiff("synthetic.gff", output) == 0);
+    }
+
+    // Integer scoring has no reference file, compare with generic kernels
+    fileParser.setIntegerScoring(true);
+    string expected;
+    for (int level = 0; level < SIMD_LEVELS; level++) {
+        if (!CpuFeatures::select(level)) {
+            continue;
+        }
+        INFO("Kernels: " << CpuFeatures::kernels()->name);
+        redirectInput(inputFile);
+        fileParser.parse(output);
+        string result = readFile(output);
+        if (level == SIMD_GENERIC) {
+            expected = result;
+            CHECK_FALSE(expected.empty());
+        } else {
+            CHECK(result == expected);
+        }
+    }
+    CpuFeatures::select(CpuFeatures::detect());
+
+    remove(output.c_str());
+}
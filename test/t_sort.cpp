@@ -0,0 +1,120 @@
+#include "common.h"
+#include "catch.hpp"
+#include "helpers.h"
+#include "../HintSorter.h"
+#include "../LoserTree.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <unistd.h>
+
+using namespace std;
+
+static string sortLines(const vector<string> & lines,
+                        unsigned long long memoryLimit, int & spills) {
+    HintSorter sorter;
+    sorter.setup(memoryLimit, ROOT_PATH + "/test_files/test_sort_run");
+    LineOutputStream stream(sorter);
+    for (unsigned int i = 0; i < lines.size(); i++) {
+        stream << lines[i] << "\n";
+    }
+    stream.flush();
+    spills = sorter.spills();
+    stringstream output;
+    CHECK(sorter.write(output));
+    return output.str();
+}
+
+/// Stable sort of the lines by the same key, for comparison
+static string reference(vector<string> lines) {
+    stable_sort(lines.begin(), lines.end(), [](const string & a, const string & b) {
+        return HintSorter::less(HintSorter::key(a.data(), a.size()),
+                                HintSorter::key(b.data(), b.size()));
+    });
+    string result;
+    for (unsigned int i = 0; i < lines.size(); i++) {
+        result += lines[i] + "\n";
+    }
+    return result;
+}
+
+TEST_CASE("Loser tree merges sorted sequences stably") {
+    vector<vector<int> > sequences = {{1, 4, 4, 9}, {}, {2, 4, 10}, {0, 4}, {3}};
+    vector<size_t> positions(sequences.size(), 0);
+    auto less = [&](int a, int b) {
+        return sequences[a][positions[a]] < sequences[b][positions[b]];
+    };
+    LoserTree<decltype(less)> tree(less);
+    vector<bool> empty(sequences.size(), false);
+    empty[1] = true;
+    tree.build(empty);
+
+    vector<pair<int, int> > merged;
+    while (!tree.empty()) {
+        int source = tree.winner();
+        merged.push_back(make_pair(sequences[source][positions[source]], source));
+        positions[source]++;
+        if (positions[source] < sequences[source].size()) {
+            tree.replay();
+        } else {
+            tree.finish();
+        }
+    }
+    vector<pair<int, int> > expected = {{0, 3}, {1, 0}, {2, 2}, {3, 4}, {4, 0},
+        {4, 0}, {4, 2}, {4, 3}, {9, 0}, {10, 2}};
+    CHECK(merged == expected);
+}
+
+TEST_CASE("Spilled sort runs are merged into the same result") {
+    vector<string> lines = readLines(ROOT_PATH + "/test_files/synthetic.gff");
+    REQUIRE(lines.size() > 100);
+    lines.push_back("ctg10\tSpaln_scorer\tCDS\t5\t9\t.\t+\t0\tprot=x;");
+    lines.push_back("ctg1\tSpaln_scorer\tCDS\t5\t9\t.\t+\t0\tprot=y;");
+
+    int spills;
+    string expected = reference(lines);
+    CHECK(sortLines(lines, 0, spills) == expected);
+    CHECK(spills == 0);
+    string spilled = sortLines(lines, 4 * 1024, spills);
+    CHECK(spills > 2);
+    CHECK(spilled == expected);
+    CHECK(access((ROOT_PATH + "/test_files/test_sort_run0").c_str(), F_OK) != 0);
+}
+
+TEST_CASE("Sorted files are merged and unsorted ones are rejected") {
+    vector<string> lines = readLines(ROOT_PATH + "/test_files/synthetic.gff");
+    REQUIRE(lines.size() > 100);
+    vector<string> files;
+    // Equal keys are taken from earlier files first
+    vector<string> concatenated;
+    for (int part = 0; part < 3; part++) {
+        vector<string> shard;
+        for (unsigned int i = part; i < lines.size(); i += 3) {
+            shard.push_back(lines[i]);
+            concatenated.push_back(lines[i]);
+        }
+        files.push_back(ROOT_PATH + "/test_files/test_sort_shard" + to_string(part));
+        ofstream ofs(files.back().c_str());
+        ofs << reference(shard);
+    }
+    // An empty shard
+    files.push_back(ROOT_PATH + "/test_files/test_sort_shard3");
+    ofstream(files.back().c_str());
+
+    stringstream merged;
+    CHECK(HintSorter::merge(files, merged));
+    CHECK(merged.str() == reference(concatenated));
+
+    ofstream unsorted(files[3].c_str());
+    unsorted << "ctg2\tSpaln_scorer\tCDS\t50\t90\t.\t+\t0\tprot=x;\n"
+            "ctg1\tSpaln_scorer\tCDS\t5\t9\t.\t+\t0\tprot=y;\n";
+    unsorted.close();
+    stringstream output;
+    CHECK_FALSE(HintSorter::merge(files, output));
+
+    for (unsigned int i = 0; i < files.size(); i++) {
+        remove(files[i].c_str());
+    }
+}
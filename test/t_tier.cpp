@@ -0,0 +1,57 @@
+#include "common.h"
+#include "catch.hpp"
+#include "helpers.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+TEST_CASE("Threshold tiers match separate runs with their thresholds") {
+    string inputFile = ROOT_PATH + "/test_files/synthetic.ali";
+    string output = ROOT_PATH + "/test_files/test_tier_main";
+    string strictExpected = ROOT_PATH + "/test_files/test_tier_strict_expected";
+    string looseExpected = ROOT_PATH + "/test_files/test_tier_loose_expected";
+
+    StandardParser fileParser;
+
+    // Separate runs with the thresholds of the tiers
+    double thresholds[] = {60, 0};
+    string expected[] = {strictExpected, looseExpected};
+    for (int i = 0; i < 2; i++) {
+        fileParser.setMinExonScore(thresholds[i]);
+        fileParser.setMinInitialExonScore(thresholds[i]);
+        fileParser.setMinInitialIntronScore(0);
+        redirectInput(inputFile);
+        fileParser.parse(expected[i]);
+    }
+
+    vector<Parser::Tier> tiers(2);
+    tiers[0].name = "strict";
+    tiers[1].name = "loose";
+    for (int i = 0; i < 2; i++) {
+        tiers[i].minExonScore = thresholds[i];
+        tiers[i].minInitialExonScore = thresholds[i];
+        tiers[i].minInitialIntronScore = 0;
+        tiers[i].outputFile = ROOT_PATH + "/test_files/test_tier_" + tiers[i].name;
+    }
+    fileParser.setMinExonScore(25);
+    fileParser.setMinInitialExonScore(25);
+    fileParser.setTiers(tiers);
+
+    int threads[] = {1, 3};
+    for (int i = 0; i < 2; i++) {
+        fileParser.setThreads(threads[i]);
+        redirectInput(inputFile);
+        CHECK(fileParser.parse(output) == READ_SUCCESS);
+        CHECK(returnDiff("synthetic.gff", output) == 0);
+        for (int j = 0; j < 2; j++) {
+            CHECK(system(("diff " + expected[j] + " " + tiers[j].outputFile +
+                          " >/dev/null").c_str()) == 0);
+        }
+    }
+
+    remove(output.c_str());
+    for (int i = 0; i < 2; i++) {
+        remove(expected[i].c_str());
+        remove(tiers[i].outputFile.c_str());
+    }
+}
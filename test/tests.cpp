@@ -1,4 +1,5 @@
 #define CATCH_CONFIG_RUNNER  // This tells Catch to provide a main() - only do this in one cpp file
+#define CATCH_CONFIG_NO_POSIX_SIGNALS // SIGSTKSZ is no longer a constant in newer glibc
 #include "common.h"
 #include "catch.hpp"
 